@@ -0,0 +1,773 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+
+// Times every stroker compiled in (see rvg-stroke-method.h) on the
+// tests of test-strokers.lua and prints the results as JSON. The tests
+// are read from the file written by test-strokers.lua -bench-corpus
+// (make bench-strokers.tests), in the same viewport coordinates that
+// test-strokers.lua strokes them in, so widths, tolerances and errors
+// are all in pixels.
+//
+//   bench-strokers [options] > results.json
+//
+//   -tests:<file>   read the tests from <file>
+//                   (default bench-strokers.tests)
+//   -warmup:<n>     untimed strokes before each measurement (default 3)
+//   -trials:<n>     timed trials per test and stroker (default 25)
+//   -cpu:<n>        pin the process to cpu <n>, or -1 to not pin (default 0)
+//   -method:<name>  only run stroker <name> (may be repeated)
+//   -test:<name>    only run test <name> (may be repeated)
+//   -list           list available strokers and tests
+//   -scaling:<n>    instead, time the stress paths of rvg-stress-paths.h
+//                   with 16, 64, 256, ... up to <n> segments
+//   -seed:<n>       seed for the stress paths (default 0)
+//   -pareto         instead, measure speed against accuracy (see below)
+//   -memory         also report the memory used by one stroke
+//
+// Each trial strokes the test as many times as needed to last at least
+// a millisecond, and the time per stroke is recorded. For each test and
+// stroker, the median and 95th percentile of these times are reported,
+// together with the throughput in input segments per second (using the
+// median) and the number of segments in the output. Scaling results
+// also report the size of the output, and the number of segments it
+// was requested with.
+//
+// Pareto results stroke every test with round joins and caps and no
+// dashes, so the exact stroke is known (see rvg-stroke-error.h). The
+// rvg stroker is run over a grid of stroke and Bezier approximation
+// tolerances, and the other strokers once each. Every result reports
+// the time and output segments as above, plus the maximum and RMS
+// distance between the boundaries of the output and of the exact
+// stroke. A result is marked pareto_optimal when no other result for
+// the same test and stroker is at least as good in time, output
+// segments and maximum error, and better in one of them.
+//
+// With -memory, every result also reports the number of allocations
+// and bytes allocated by a single stroke, the peak of the bytes
+// allocated at any one time during that stroke (including its output),
+// and the peak resident set size of the process, or null where the
+// platform does not provide it. Allocations are only counted by the
+// bench-strokers-memory build, whose operator new adds a header to
+// every block, so times should come from bench-strokers.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "rvg-chronos.h"
+#include "rvg-shape.h"
+#include "rvg-stroke-style.h"
+#include "rvg-i-input-path.h"
+#include "rvg-svg-path-parse.h"
+#include "rvg-stress-paths.h"
+#include "rvg-stroke-error.h"
+#include "rvg-memory-stats.h"
+
+#ifdef STROKER_RVG
+#include "rvg-stroker-rvg.h"
+#endif
+
+#ifdef STROKER_LIVAROT
+#include "livarot/rvg-stroker-livarot.h"
+#endif
+
+#ifdef STROKER_DIRECT2D
+#include "direct2d/rvg-stroker-direct2d.h"
+#endif
+
+#ifdef STROKER_QUARTZ
+#include "quartz/rvg-stroker-quartz.h"
+#endif
+
+#ifdef STROKER_AGG
+#include "agg/rvg-stroker-agg.h"
+#endif
+
+#ifdef STROKER_SKIA
+#include "skia/rvg-stroker-skia.h"
+#endif
+
+#ifdef STROKER_QT5
+#include "qt5/rvg-stroker-qt5.h"
+#endif
+
+#ifdef STROKER_MUPDF
+#include "mupdf/rvg-stroker-mupdf.h"
+#endif
+
+#ifdef STROKER_CAIRO
+#include "cairo/rvg-stroker-cairo.h"
+#endif
+
+#ifdef STROKER_GS
+#include "gs/rvg-stroker-gs.h"
+#endif
+
+#ifdef STROKER_OPENVG_RI
+#include "openvg-ri/rvg-stroker-openvg-ri.h"
+#endif
+
+using namespace rvg;
+
+// Counts the segments in a path
+class input_path_f_count_segments final:
+    public i_input_path<input_path_f_count_segments> {
+
+    size_t m_count;
+
+public:
+
+    input_path_f_count_segments(void): m_count{0} { ; }
+
+    size_t get_count(void) const {
+        return m_count;
+    }
+
+private:
+
+friend i_input_path<input_path_f_count_segments>;
+
+    void do_begin_contour(rvgf, rvgf) { ; }
+    void do_end_open_contour(rvgf, rvgf) { ; }
+    void do_end_closed_contour(rvgf, rvgf) { ; }
+    void do_linear_segment(rvgf, rvgf, rvgf, rvgf) {
+        ++m_count;
+    }
+    void do_quadratic_segment(rvgf, rvgf, rvgf, rvgf, rvgf, rvgf) {
+        ++m_count;
+    }
+    void do_rational_quadratic_segment(rvgf, rvgf, rvgf, rvgf, rvgf,
+        rvgf, rvgf) {
+        ++m_count;
+    }
+    void do_cubic_segment(rvgf, rvgf, rvgf, rvgf, rvgf, rvgf, rvgf,
+        rvgf) {
+        ++m_count;
+    }
+};
+
+static size_t count_segments(const shape &s) {
+    input_path_f_count_segments counter;
+    s.as_path_data_ptr()->iterate(counter);
+    return counter.get_count();
+}
+
+using stroker_function = shape (*)(const shape &input_shape,
+    const xform &screen_xf, float width, stroke_style::const_ptr style);
+
+struct bench_stroker {
+    const char *name;
+    stroker_function stroke;
+};
+
+// Same names as in rvg-lua-stroke-style.cpp. The native method leaves
+// stroking to the renderer, so there is nothing to time.
+static const bench_stroker bench_strokers[] = {
+#ifdef STROKER_RVG
+    { "rvg", stroker::rvg },
+#endif
+#ifdef STROKER_LIVAROT
+    { "livarot_stroke", stroker::livarot_stroke },
+    { "livarot_outline", stroker::livarot_outline },
+#endif
+#ifdef STROKER_DIRECT2D
+    { "direct2d", stroker::direct2d },
+#endif
+#ifdef STROKER_QUARTZ
+    { "quartz", stroker::quartz },
+#endif
+#ifdef STROKER_AGG
+    { "agg", stroker::agg },
+#endif
+#ifdef STROKER_SKIA
+    { "skia", stroker::skia },
+#endif
+#ifdef STROKER_QT5
+    { "qt5", stroker::qt5 },
+#endif
+#ifdef STROKER_MUPDF
+    { "mupdf", stroker::mupdf },
+#endif
+#ifdef STROKER_CAIRO
+    { "cairo_traps", stroker::cairo_traps },
+    { "cairo_polygon", stroker::cairo_polygon },
+    { "cairo_tristrip", stroker::cairo_tristrip },
+#endif
+#ifdef STROKER_GS
+    { "gs", stroker::gs },
+    { "gs_compat", stroker::gs_compat },
+    { "gs_fast", stroker::gs_fast },
+#endif
+#ifdef STROKER_OPENVG_RI
+    { "openvg_ri", stroker::openvg_ri },
+#endif
+};
+
+struct bench_test {
+    std::string name;
+    shape input;
+    float width;
+    stroke_style style;
+};
+
+static const struct {
+    const char *name;
+    e_stroke_join join;
+} named_joins[] = {
+    {"arcs", e_stroke_join::arcs},
+    {"miter_clip", e_stroke_join::miter_clip},
+    {"miter_or_bevel", e_stroke_join::miter_or_bevel},
+    {"round", e_stroke_join::round},
+    {"bevel", e_stroke_join::bevel},
+};
+
+static const struct {
+    const char *name;
+    e_stroke_cap cap;
+} named_caps[] = {
+    {"butt", e_stroke_cap::butt},
+    {"round", e_stroke_cap::round},
+    {"square", e_stroke_cap::square},
+    {"triangle", e_stroke_cap::triangle},
+    {"fletching", e_stroke_cap::fletching},
+};
+
+static bool find_join(const char *name, e_stroke_join &join) {
+    for (const auto &j: named_joins) {
+        if (strcmp(j.name, name) == 0) {
+            join = j.join;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool find_cap(const char *name, e_stroke_cap &cap) {
+    for (const auto &c: named_caps) {
+        if (strcmp(c.name, name) == 0) {
+            cap = c.cap;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses one line of test-strokers.lua -bench-corpus (see the format
+// there)
+static bool parse_bench_test(const char *line, bench_test &t) {
+    char name[256], join[32], inner_join[32], caps[4][32];
+    float width = 0.f, miter_limit = 0.f, dash_offset = 0.f;
+    int resets_on_move = 0, dash_count = 0, end = 0;
+    if (sscanf(line, "%255s %f %31s %31s %31s %31s %31s %31s %f %f %d %d%n",
+            name, &width, join, inner_join, caps[0], caps[1], caps[2],
+            caps[3], &miter_limit, &dash_offset, &resets_on_move,
+            &dash_count, &end) != 12 || dash_count < 0) {
+        return false;
+    }
+    line += end;
+    std::vector<float> dashes;
+    for (int i = 0; i < dash_count; ++i) {
+        float dash = 0.f;
+        if (sscanf(line, "%f%n", &dash, &end) != 1) {
+            return false;
+        }
+        dashes.push_back(dash);
+        line += end;
+    }
+    e_stroke_join j, ij;
+    e_stroke_cap c[4];
+    if (!find_join(join, j) || !find_join(inner_join, ij) ||
+        !find_cap(caps[0], c[0]) || !find_cap(caps[1], c[1]) ||
+        !find_cap(caps[2], c[2]) || !find_cap(caps[3], c[3])) {
+        return false;
+    }
+    auto p = make_path_data_from_svg_path(line);
+    if (!p) {
+        return false;
+    }
+    t.name = name;
+    t.input = shape(p);
+    t.width = width;
+    t.style = stroke_style{}.joined(j).inner_joined(ij).initial_capped(c[0]).
+        terminal_capped(c[1]).dash_initial_capped(c[2]).
+        dash_terminal_capped(c[3]).miter_limited(miter_limit).
+        dash_offset(dash_offset).reset_on_move(resets_on_move != 0);
+    if (!dashes.empty()) {
+        t.style = t.style.dashed(dashes);
+    }
+    return true;
+}
+
+// Reads the tests printed by test-strokers.lua -bench-corpus, one per
+// line
+static bool load_bench_tests(const char *filename,
+    std::vector<bench_test> &tests) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        return false;
+    }
+    bool ok = true;
+    std::string line;
+    int c = 0;
+    while (ok && c != EOF) {
+        c = fgetc(f);
+        if (c != '\n' && c != EOF) {
+            line += static_cast<char>(c);
+            continue;
+        }
+        if (!line.empty()) {
+            bench_test t;
+            ok = parse_bench_test(line.c_str(), t);
+            if (ok) {
+                tests.push_back(std::move(t));
+            }
+            line.clear();
+        }
+    }
+    fclose(f);
+    return ok && !tests.empty();
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0.;
+    }
+    auto rank = static_cast<size_t>(std::ceil(p*sorted.size()));
+    return sorted[std::min(std::max(rank, size_t{1}), sorted.size())-1];
+}
+
+static bool pin_to_cpu(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+// Memory used by a single stroke. Fields are -1 when unknown
+struct memory_use {
+    int64_t allocations, allocated_bytes, peak_bytes, peak_rss;
+};
+
+// Strokes once, returning the output
+template <typename STROKE>
+static shape measure_memory(STROKE stroke, const shape &input, float width,
+    stroke_style::const_ptr style, memory_use *use) {
+    reset_memory_peaks();
+    auto before = get_memory_stats();
+    shape output = stroke(input, xform{}, width, style);
+    auto after = get_memory_stats();
+    bool counted = before.allocations >= 0 && after.allocations >= 0;
+    use->allocations = counted? after.allocations - before.allocations: -1;
+    use->allocated_bytes = counted?
+        after.allocated_bytes - before.allocated_bytes: -1;
+    use->peak_bytes = counted? after.peak_live_bytes - before.live_bytes: -1;
+    use->peak_rss = after.peak_rss;
+    return output;
+}
+
+static void print_count(FILE *out, int64_t value) {
+    if (value >= 0) {
+        fprintf(out, "%lld", static_cast<long long>(value));
+    } else {
+        fputs("null", out);
+    }
+}
+
+// Closes the result, adding the memory use if it was measured
+static void print_memory_use(FILE *out, const memory_use *use) {
+    if (use) {
+        fputs(", \"allocations\": ", out);
+        print_count(out, use->allocations);
+        fputs(", \"allocated_bytes\": ", out);
+        print_count(out, use->allocated_bytes);
+        fputs(", \"peak_bytes\": ", out);
+        print_count(out, use->peak_bytes);
+        fputs(", \"peak_rss\": ", out);
+        print_count(out, use->peak_rss);
+    }
+    fputs("}", out);
+}
+
+// Test names can contain anything but quotes and backslashes, so
+// nothing needs escaping
+static void print_result(FILE *out, bool first, const char *test,
+    const char *stroker, size_t input_segments, size_t output_segments,
+    int repeats, const std::vector<double> &times, const memory_use *use) {
+    double median = percentile(times, .5);
+    double p95 = percentile(times, .95);
+    fprintf(out, "%s\n    {\"test\": \"%s\", \"stroker\": \"%s\", "
+        "\"input_segments\": %zu, \"output_segments\": %zu, "
+        "\"repeats\": %d, \"median\": %.9g, \"p95\": %.9g, "
+        "\"segments_per_second\": %.9g", first? "": ",", test, stroker,
+        input_segments, output_segments, repeats, median, p95,
+        median > 0.? input_segments/median: 0.);
+    print_memory_use(out, use);
+}
+
+static void print_scaling_result(FILE *out, bool first, const char *test,
+    int n, const char *stroker, size_t input_segments,
+    size_t output_segments, size_t output_bytes, int repeats,
+    const std::vector<double> &times, const memory_use *use) {
+    double median = percentile(times, .5);
+    double p95 = percentile(times, .95);
+    fprintf(out, "%s\n    {\"test\": \"%s\", \"n\": %d, "
+        "\"stroker\": \"%s\", \"input_segments\": %zu, "
+        "\"output_segments\": %zu, \"output_bytes\": %zu, "
+        "\"repeats\": %d, \"median\": %.9g, \"p95\": %.9g, "
+        "\"segments_per_second\": %.9g", first? "": ",", test, n, stroker,
+        input_segments, output_segments, output_bytes, repeats, median, p95,
+        median > 0.? input_segments/median: 0.);
+    print_memory_use(out, use);
+}
+
+// Memory taken by the arrays of the path data in a shape
+static size_t count_bytes(const shape &s) {
+    auto v = s.as_path_data_ptr()->view();
+    return v.size()*(sizeof(path_instruction) + sizeof(floatint)) +
+        v.data_size()*sizeof(rvgf);
+}
+
+// Sorted times per stroke over trials, and the number of strokes per
+// trial
+template <typename STROKE>
+static std::vector<double> measure(STROKE stroke, const shape &input,
+    float width, stroke_style::const_ptr style, int warmup, int trials,
+    int &repeats) {
+    xform screen_xf;
+    chronos time;
+    for (int j = 0; j < warmup; ++j) {
+        stroke(input, screen_xf, width, style);
+    }
+    // Double the repeats until a trial lasts a millisecond
+    repeats = 1;
+    for ( ;; ) {
+        time.reset();
+        for (int j = 0; j < repeats; ++j) {
+            stroke(input, screen_xf, width, style);
+        }
+        if (time.elapsed() >= 1.e-3 || repeats >= (1 << 20)) {
+            break;
+        }
+        repeats *= 2;
+    }
+    std::vector<double> times;
+    times.reserve(trials);
+    for (int k = 0; k < trials; ++k) {
+        time.reset();
+        for (int j = 0; j < repeats; ++j) {
+            stroke(input, screen_xf, width, style);
+        }
+        times.push_back(time.elapsed()/repeats);
+    }
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+// The spiral is dashed, as it is meant to be
+static stroke_style stress_style(const char *name) {
+    if (strcmp(name, "spiral") == 0) {
+        return stroke_style{}.dashed({2, 1, 0.5, 1});
+    }
+    return stroke_style{};
+}
+
+// Tolerances swept for the rvg stroker. By default, both are
+// RVG_STROKE_APPROXIMATION_TOLERANCE
+static const float pareto_stroke_tolerances[] = {
+    .8f, .4f, .2f, .1f, .05f, .025f
+};
+
+static const float pareto_bezier_tolerances[] = {
+    .4f, .2f, .1f, .05f, .02f, .01f, .005f
+};
+
+struct pareto_result {
+    bool swept;
+    float stroke_tolerance, bezier_tolerance;
+    size_t output_segments;
+    int repeats;
+    std::vector<double> times;
+    stroke_error error;
+    memory_use memory;
+    bool optimal;
+};
+
+template <typename STROKE>
+static pareto_result measure_pareto(STROKE stroke, const bench_test &t,
+    stroke_style::const_ptr style, int warmup, int trials, bool swept,
+    float stroke_tolerance, float bezier_tolerance) {
+    pareto_result r;
+    r.swept = swept;
+    r.stroke_tolerance = stroke_tolerance;
+    r.bezier_tolerance = bezier_tolerance;
+    shape output = measure_memory(stroke, t.input, t.width, style,
+        &r.memory);
+    r.output_segments = count_segments(output);
+    measure_stroke_error(t.input, t.width, output, &r.error);
+    r.times = measure(stroke, t.input, t.width, style, warmup, trials,
+        r.repeats);
+    r.optimal = true;
+    return r;
+}
+
+// True if a is at least as good as b in everything, and better in
+// something
+static bool dominates(const pareto_result &a, const pareto_result &b) {
+    double ta = percentile(a.times, .5), tb = percentile(b.times, .5);
+    if (ta > tb || a.output_segments > b.output_segments ||
+        !(a.error.max_error <= b.error.max_error)) {
+        return false;
+    }
+    return ta < tb || a.output_segments < b.output_segments ||
+        a.error.max_error < b.error.max_error;
+}
+
+static void mark_pareto_optimal(std::vector<pareto_result> &results) {
+    for (auto &r: results) {
+        r.optimal = std::none_of(results.begin(), results.end(),
+            [&r](const pareto_result &other) {
+                return dominates(other, r);
+            });
+    }
+}
+
+// JSON has no infinities, which is what an empty output measures
+static void print_number(FILE *out, double value) {
+    if (std::isfinite(value)) {
+        fprintf(out, "%.9g", value);
+    } else {
+        fputs("null", out);
+    }
+}
+
+static void print_pareto_result(FILE *out, bool first, const char *test,
+    const char *stroker, size_t input_segments, const pareto_result &r,
+    bool memory) {
+    double median = percentile(r.times, .5);
+    double p95 = percentile(r.times, .95);
+    fprintf(out, "%s\n    {\"test\": \"%s\", \"stroker\": \"%s\", "
+        "\"stroke_tolerance\": ", first? "": ",", test, stroker);
+    print_number(out, r.swept? r.stroke_tolerance: NAN);
+    fputs(", \"bezier_tolerance\": ", out);
+    print_number(out, r.swept? r.bezier_tolerance: NAN);
+    fprintf(out, ", \"input_segments\": %zu, \"output_segments\": %zu, "
+        "\"repeats\": %d, \"median\": %.9g, \"p95\": %.9g, "
+        "\"max_error\": ", input_segments, r.output_segments, r.repeats,
+        median, p95);
+    print_number(out, r.error.max_error);
+    fputs(", \"rms_error\": ", out);
+    print_number(out, r.error.rms_error);
+    fprintf(out, ", \"pareto_optimal\": %s", r.optimal? "true": "false");
+    print_memory_use(out, memory? &r.memory: nullptr);
+}
+
+static bool selected(const std::vector<std::string> &names,
+    const char *name) {
+    return names.empty() ||
+        std::find(names.begin(), names.end(), name) != names.end();
+}
+
+int main(int argc, char *argv[]) {
+    int warmup = 3, trials = 25, cpu = 0, scaling = 0, seed = 0;
+    bool list = false, pareto = false, memory = false;
+    const char *tests_name = "bench-strokers.tests";
+    std::vector<std::string> methods, tests;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        int value = 0, end = 0;
+        if (strcmp(arg, "-list") == 0) {
+            list = true;
+        } else if (strcmp(arg, "-pareto") == 0) {
+            pareto = true;
+        } else if (strcmp(arg, "-memory") == 0) {
+            memory = true;
+        } else if (sscanf(arg, "-warmup:%d%n", &value, &end) == 1 &&
+            arg[end] == 0 && value >= 0) {
+            warmup = value;
+        } else if (sscanf(arg, "-trials:%d%n", &value, &end) == 1 &&
+            arg[end] == 0 && value > 0) {
+            trials = value;
+        } else if (sscanf(arg, "-cpu:%d%n", &value, &end) == 1 &&
+            arg[end] == 0) {
+            cpu = value;
+        } else if (sscanf(arg, "-scaling:%d%n", &value, &end) == 1 &&
+            arg[end] == 0 && value > 0) {
+            scaling = value;
+        } else if (sscanf(arg, "-seed:%d%n", &value, &end) == 1 &&
+            arg[end] == 0) {
+            seed = value;
+        } else if (strncmp(arg, "-method:", 8) == 0) {
+            methods.emplace_back(arg+8);
+        } else if (strncmp(arg, "-tests:", 7) == 0) {
+            tests_name = arg+7;
+        } else if (strncmp(arg, "-test:", 6) == 0) {
+            tests.emplace_back(arg+6);
+        } else {
+            fprintf(stderr, "%s: invalid option %s\n", argv[0], arg);
+            return 1;
+        }
+    }
+    std::vector<bench_test> bench_tests;
+    if ((list || scaling == 0) &&
+        !load_bench_tests(tests_name, bench_tests)) {
+        fprintf(stderr, "%s: unable to load tests from %s\n", argv[0],
+            tests_name);
+        return 1;
+    }
+    if (list) {
+        for (const auto &s: bench_strokers) {
+            printf("stroker %s\n", s.name);
+        }
+        for (const auto &t: bench_tests) {
+            printf("test %s\n", t.name.c_str());
+        }
+        for (const auto &t: stress_paths) {
+            printf("stress %s\n", t.name);
+        }
+        return 0;
+    }
+    if (memory && !start_counting_allocations()) {
+        fprintf(stderr, "%s: unable to count allocations, use "
+            "bench-strokers-memory\n", argv[0]);
+        return 1;
+    }
+    bool pinned = pin_to_cpu(cpu);
+    if (cpu >= 0 && !pinned) {
+        fprintf(stderr, "%s: unable to pin to cpu %d\n", argv[0], cpu);
+    }
+    printf("{\n  \"warmup\": %d,\n  \"trials\": %d,\n  \"cpu\": %d,\n"
+        "  \"pinned\": %s,\n", warmup, trials, cpu, pinned? "true": "false");
+    bool first = true;
+    if (pareto) {
+        printf("  \"pareto\": [");
+        auto round_style = make_intrusive<stroke_style>(stroke_style{}.
+            joined(e_stroke_join::round).capped(e_stroke_cap::round));
+        for (const auto &t: bench_tests) {
+            if (!selected(tests, t.name.c_str())) {
+                continue;
+            }
+            size_t input_segments = count_segments(t.input);
+            for (const auto &s: bench_strokers) {
+                if (!selected(methods, s.name)) {
+                    continue;
+                }
+                std::vector<pareto_result> results;
+#ifdef STROKER_RVG
+                if (s.stroke == stroker::rvg) {
+                    for (float st: pareto_stroke_tolerances) {
+                        for (float bt: pareto_bezier_tolerances) {
+                            auto stroke = [st, bt](const shape &input,
+                                const xform &screen_xf, float width,
+                                stroke_style::const_ptr style) {
+                                return stroker::rvg_with_tolerances(input,
+                                    screen_xf, width, style, st, bt);
+                            };
+                            results.push_back(measure_pareto(stroke, t,
+                                round_style, warmup, trials, true, st, bt));
+                        }
+                    }
+                }
+#endif
+                if (results.empty()) {
+                    results.push_back(measure_pareto(s.stroke, t,
+                        round_style, warmup, trials, false, 0.f, 0.f));
+                }
+                mark_pareto_optimal(results);
+                for (const auto &r: results) {
+                    print_pareto_result(stdout, first, t.name.c_str(), s.name,
+                        input_segments, r, memory);
+                    first = false;
+                }
+            }
+        }
+        printf("\n  ]\n}\n");
+        return 0;
+    }
+    if (scaling > 0) {
+        printf("  \"seed\": %d,\n  \"scaling\": [", seed);
+        const float width = 4;
+        for (const auto &t: stress_paths) {
+            if (!selected(tests, t.name)) {
+                continue;
+            }
+            auto style = make_intrusive<stroke_style>(stress_style(t.name));
+            for (int n = 16; n <= scaling; n *= 4) {
+                shape input(t.generate(n, static_cast<uint32_t>(seed)));
+                size_t input_segments = count_segments(input);
+                for (const auto &s: bench_strokers) {
+                    if (!selected(methods, s.name)) {
+                        continue;
+                    }
+                    memory_use use;
+                    shape output = measure_memory(s.stroke, input, width,
+                        style, &use);
+                    int repeats = 1;
+                    auto times = measure(s.stroke, input, width, style,
+                        warmup, trials, repeats);
+                    print_scaling_result(stdout, first, t.name, n, s.name,
+                        input_segments, count_segments(output),
+                        count_bytes(output), repeats, times,
+                        memory? &use: nullptr);
+                    first = false;
+                }
+                if (n > scaling/4) {
+                    break;
+                }
+            }
+        }
+        printf("\n  ]\n}\n");
+        return 0;
+    }
+    printf("  \"results\": [");
+    for (const auto &t: bench_tests) {
+        if (!selected(tests, t.name.c_str())) {
+            continue;
+        }
+        auto style = make_intrusive<stroke_style>(t.style);
+        size_t input_segments = count_segments(t.input);
+        for (const auto &s: bench_strokers) {
+            if (!selected(methods, s.name)) {
+                continue;
+            }
+            memory_use use;
+            size_t output_segments = count_segments(measure_memory(
+                s.stroke, t.input, t.width, style, &use));
+            int repeats = 1;
+            auto times = measure(s.stroke, t.input, t.width, style, warmup,
+                trials, repeats);
+            print_result(stdout, first, t.name.c_str(), s.name, input_segments,
+                output_segments, repeats, times, memory? &use: nullptr);
+            first = false;
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,187 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+
+// Compares two PNG files, as ImageMagick's compare -metric rmse does,
+// and prints the root mean squared error, the largest channel error
+// (both normalized to [0,1]), and the number of mismatched pixels.
+//
+//   compare-images [options] <a.png> <b.png>
+//   compare-images [options] -batch:<list>
+//
+//   -fuzz:<percent>  pixels closer than this are not mismatches (default 0)
+//   -diff:<file>     write faded <a.png> with mismatches in red to <file>
+//   -batch:<list>    compare every pair in <list> (- for stdin) instead
+//
+// A batch list has one comparison per line, as "<a.png> <b.png>" or
+// "<a.png> <b.png> <diff.png>". Pairs are compared in parallel, and
+// the results are printed one per line, in the order of the list.
+//
+// The exit status is 0 if there are no mismatches, 1 if there are, and
+// 2 on error.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rvg-image.h"
+#include "rvg-image-compare.h"
+#include "rvg-pngio.h"
+
+using namespace rvg;
+
+static int load_rgba8(const char *name, packed_image<uint8_t, 4> *img) {
+    FILE *f = fopen(name, "rb");
+    if (!f) {
+        return 0;
+    }
+    int ret = load_png(f, img);
+    fclose(f);
+    return ret;
+}
+
+struct comparison {
+    std::string a, b, diff;
+    image_comparison result;
+    std::string error;
+};
+
+// Compares one pair, writing the diff image if it was asked for.
+// Returns false and sets the error on failure
+static bool compare(comparison &c, float fuzz) {
+    packed_image<uint8_t, 4> a, b, diff;
+    if (!load_rgba8(c.a.c_str(), &a)) {
+        c.error = "unable to load " + c.a;
+        return false;
+    }
+    if (!load_rgba8(c.b.c_str(), &b)) {
+        c.error = "unable to load " + c.b;
+        return false;
+    }
+    if (!compare_images(a, b, fuzz, &c.result,
+            c.diff.empty()? nullptr: &diff)) {
+        c.error = "image sizes differ";
+        return false;
+    }
+    if (!c.diff.empty()) {
+        FILE *f = fopen(c.diff.c_str(), "wb");
+        if (!f || !store_png<uint8_t>(f, diff, image_attributes(),
+                png_write_options::fast())) {
+            if (f) fclose(f);
+            c.error = "unable to write " + c.diff;
+            return false;
+        }
+        fclose(f);
+    }
+    return true;
+}
+
+// Reads the pairs of a batch list. Returns false on a malformed line
+static bool read_batch(FILE *f, std::vector<comparison> &batch) {
+    char line[3*4096+8], a[4096], b[4096], diff[4096];
+    while (fgets(line, sizeof(line), f)) {
+        int n = sscanf(line, "%4095s %4095s %4095s", a, b, diff);
+        if (n <= 0) {
+            continue;
+        }
+        if (n < 2) {
+            return false;
+        }
+        batch.push_back(comparison{a, b, n > 2? diff: "",
+            image_comparison{}, ""});
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    float fuzz = 0.f;
+    const char *diff_name = nullptr;
+    const char *batch_name = nullptr;
+    const char *names[2] = { nullptr, nullptr };
+    int nnames = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        float value = 0.f;
+        int end = 0;
+        if (sscanf(arg, "-fuzz:%f%n", &value, &end) == 1 &&
+            arg[end] == 0 && value >= 0.f) {
+            fuzz = value/100.f;
+        } else if (strncmp(arg, "-diff:", 6) == 0 && arg[6]) {
+            diff_name = arg+6;
+        } else if (strncmp(arg, "-batch:", 7) == 0 && arg[7]) {
+            batch_name = arg+7;
+        } else if (arg[0] != '-' && nnames < 2) {
+            names[nnames++] = arg;
+        } else {
+            fprintf(stderr, "%s: invalid option %s\n", argv[0], arg);
+            return 2;
+        }
+    }
+    std::vector<comparison> batch;
+    if (batch_name) {
+        if (nnames != 0 || diff_name) {
+            fprintf(stderr, "%s: -batch takes images and diffs from the "
+                "list\n", argv[0]);
+            return 2;
+        }
+        bool from_stdin = strcmp(batch_name, "-") == 0;
+        FILE *f = from_stdin? stdin: fopen(batch_name, "r");
+        if (!f) {
+            fprintf(stderr, "%s: unable to open %s\n", argv[0], batch_name);
+            return 2;
+        }
+        bool ok = read_batch(f, batch);
+        if (!from_stdin) {
+            fclose(f);
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: expected two or three names per line "
+                "in %s\n", argv[0], batch_name);
+            return 2;
+        }
+    } else {
+        if (nnames != 2) {
+            fprintf(stderr, "%s: expected two images\n", argv[0]);
+            return 2;
+        }
+        batch.push_back(comparison{names[0], names[1],
+            diff_name? diff_name: "", image_comparison{}, ""});
+    }
+    // Each comparison is parallel on its own, so a single pair keeps
+    // the threads. Otherwise, threads take whole pairs
+    std::vector<char> ok(batch.size());
+    #pragma omp parallel for schedule(dynamic) if(batch.size() > 1)
+    for (int i = 0; i < static_cast<int>(batch.size()); ++i) {
+        ok[i] = compare(batch[i], fuzz);
+    }
+    int status = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const auto &c = batch[i];
+        if (!ok[i]) {
+            fprintf(stderr, "%s: %s\n", argv[0], c.error.c_str());
+            if (batch_name) {
+                printf("error\n");
+            }
+            status = 2;
+            continue;
+        }
+        printf("%g %g %lld\n", c.result.rmse, c.result.max_error,
+            static_cast<long long>(c.result.mismatches));
+        if (c.result.mismatches > 0 && status == 0) {
+            status = 1;
+        }
+    }
+    return status;
+}
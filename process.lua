@@ -35,12 +35,20 @@ Usage:
   lua process.lua [options] <driver> [<input.rvg> [<output-name>]]
 where options are:
   -profile:<output>        write profiling info to <output>
+  -memory                  report allocations and peak memory of each phase
+                           (counting allocations needs memcount.so in LD_PRELOAD)
   -stroker:<method>        transform strokes to fills using <method>
   -stroker-repeats:<n>     repeat stroking <n> times
+  -stroker-instancing      stroke repeated shapes only once
   -accelerate-repeats:<n>  repeat acceleration <n> times
   -render-repeats:<n>      repeat rendering <n> times
   -width:<number>          set viewport width (and height proportionally if not set)
   -height:<number>         set viewport height (and width proportionally if not set)
+other options are passed to the driver, e.g.
+  -no-output               render but do not write the output image
+  -tile[:<size>]           (cairo, skia) render tiles in parallel
+  -threads:<n>             (cairo, skia) use <n> threads for tiles
+  -compact[:<bits>]        (rvg_binary) quantize paths to 16 or 24 bits
 ]=])
     os.exit()
 end
@@ -48,8 +56,10 @@ end
 local width, height
 local drivername, inputname, outputname, profilename
 local strokerrepeats = 1
+local strokerinstancing = false
 local renderrepeats = 1
 local acceleraterepeats = 1
+local memory = false
 
 -- list of supported options
 -- in each option,
@@ -76,6 +86,16 @@ local options = {
         strokername = o
         return true
     end },
+    { "^%-stroker%-instancing$", function(d)
+        if not d then return false end
+        strokerinstancing = true
+        return true
+    end },
+    { "^%-memory$", function(d)
+        if not d then return false end
+        memory = true
+        return true
+    end },
     { "^%-profile%:(.*)$", function(o)
         if not o or #o < 1 then return false end
         profilename = o
@@ -175,17 +195,59 @@ if strokername == "list" then
     os.exit()
 end
 
+-- memory accounting for each phase
+-- allocation counts are divided by the number of repeats, like times
+if memory and not util.memory_count() then
+    stderr("memcount.so not preloaded, reporting resident set size only\n")
+end
+local memorystart
+local function memory_begin()
+    if memory then
+        util.memory_reset_peaks()
+        memorystart = util.memory_stats()
+    end
+end
+local function memory_end(phase, repeats)
+    if not memory then return end
+    repeats = repeats or 1
+    local s = util.memory_stats()
+    local b = memorystart
+    local report = {}
+    if s.allocations and b.allocations then
+        report[#report+1] = string.format("%d allocations, %d bytes, peak %d bytes",
+            math.floor((s.allocations-b.allocations)/repeats),
+            math.floor((s.allocated_bytes-b.allocated_bytes)/repeats),
+            s.peak_live_bytes-b.live_bytes)
+    end
+    if s.peak_rss then
+        report[#report+1] = string.format("peak rss %d bytes", s.peak_rss)
+    end
+    stderr("%s memory: %s\n", phase, table.concat(report, ", "))
+end
+
 -- load and run the Lua program that defines the scene, window, and viewport
 -- the only globals visible are the ones exported by the
 stderr("processing %s\n", inputname)
+memory_begin()
 local time = chronos.chronos()
+-- files written by the rvg_binary driver are mapped instead
+local function is_scene_data_file(name)
+    local file = io.open(name, "rb")
+    if not file then return false end
+    local magic = file:read(8)
+    file:close()
+    return magic == "RVGSCENE"
+end
 local input
-if _VERSION == "Lua 5.1" then
+if is_scene_data_file(inputname) then
+    input = assert(driver.load_scene_data_file(inputname))
+elseif _VERSION == "Lua 5.1" then
     input = assert(setfenv(assert(loadfile(inputname)), driver)())
 else
     input = assert(assert(loadfile(inputname, "bt", driver))())
 end
 stderr("loaded in %gs\n", time:elapsed())
+memory_end("load")
 
 -- by default, dump to stadard out
 local output = io.stdout
@@ -245,13 +307,26 @@ if strokername and strokername ~= "native" then
         input.scene:get_scene_data():iterate(filter.make_scene_f_stroke(method, true, stroked))
     end
     local mocktime = time:elapsed()/strokerrepeats
+    memory_begin()
     time:reset()
+    local cache
     for i = 1, strokerrepeats do
         stderr("stroker pass %d\n", i)
         stroked = driver.scene_data()
-        input.scene:get_scene_data():iterate(filter.make_scene_f_stroke(method, stroked))
+        if strokerinstancing then
+            cache = filter.stroke_instance_cache()
+            input.scene:get_scene_data():iterate(filter.make_scene_f_stroke(method, cache, stroked))
+        else
+            input.scene:get_scene_data():iterate(filter.make_scene_f_stroke(method, stroked))
+        end
     end
     stderr("stroke in %gs\n", time:elapsed()/strokerrepeats - mocktime)
+    memory_end("stroke", strokerrepeats)
+    if cache then
+        stderr("stroke instancing: %d instances, %d stroked (%.2fx), %d of %d paths unique, saved about %gs\n",
+            cache:get_instances(), cache:get_strokes(), cache:get_dedup_ratio(),
+            cache:get_unique_paths(), cache:get_path_lookups(), cache:get_saved_time())
+    end
     if profilename then
         util.profiler_stop()
     end
@@ -264,6 +339,7 @@ if profilename then
     stderr("profiling accelerate...\n")
     util.profiler_start("accelerate-" .. profilename)
 end
+memory_begin()
 time:reset()
 local accel
 for i = 1, acceleraterepeats do
@@ -271,6 +347,7 @@ for i = 1, acceleraterepeats do
     accel = driver.accelerate(input.scene, input.window, viewport, rejected)
 end
 stderr("accelerate in %gs\n", time:elapsed()/acceleraterepeats)
+memory_end("accelerate", acceleraterepeats)
 if profilename then
     util.profiler_stop()
 end
@@ -281,12 +358,14 @@ if profilename then
     stderr("profiling render...\n")
     util.profiler_start("render-" .. profilename)
 end
+memory_begin()
 time:reset()
 for i = 1, renderrepeats do
     stderr("render pass %d\n", i)
     driver.render(accel, input.window, viewport, output, rejected)
 end
 stderr("render in %gs\n", time:elapsed()/renderrepeats)
+memory_end("render", renderrepeats)
 if profilename then
     util.profiler_stop()
 end
@@ -0,0 +1,441 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+
+// Runs the static tests of test-strokers.lua on a stroker, in parallel,
+// comparing each output against its ground truth, and writes the
+// results, with per-test timing, as JSON.
+//
+//   run-stroker-tests [options] <stroker> [<test-strokers.lua options>]
+//
+//   -threads:<n>          worker threads (default: one per core)
+//   -test:<name>          only run test <name> (may be repeated)
+//   -output-dir:<dir>     where outputs and diffs go (default a)
+//   -reference-dir:<dir>  where ground truth <test>_distroke.png is
+//                         found (default a/distroke)
+//   -results:<file>       results file (default <output-dir>/results.json)
+//   -fuzz:<percent>       as in compare-images (default 20)
+//   -max-mismatches:<n>   pixels beyond the fuzz a test may have before
+//                         it fails (default 0)
+//   -no-compare           only stroke and render
+//
+// Run it from the directory that contains test-strokers.lua. Options
+// after the stroker are passed to test-strokers.lua, after
+// -driver:skia, so they can replace it. The output of each test goes
+// to <output-dir>/<test>.png, and the differences to the ground truth,
+// if there is one, to <output-dir>/<test>_compare.png.
+//
+// Each worker thread keeps its own Lua state, with test-strokers.lua
+// loaded once, and runs the script as a function for each test. Modules
+// are required only once per state. Tests are handed out one at a time
+// from a shared queue, so a slow test never holds back the others. When
+// the results file of a previous run exists, the tests that took longest
+// are started first.
+//
+// The rmse, maximum error and mismatches of each compared test are also
+// printed to stdout, one line per test, in the format of compare-images
+// followed by the test name. A test fails if it cannot be run or
+// compared, or if it has more mismatches than -max-mismatches allows.
+// The exit status is 1 if any test failed.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "rvg-lua.h"
+#include "rvg-chronos.h"
+#include "rvg-image.h"
+#include "rvg-image-compare.h"
+#include "rvg-pngio.h"
+
+using namespace rvg;
+
+struct test_result {
+    std::string name;
+    std::string error;   // empty if the test succeeded
+    int thread = -1;
+    double stroke = 0.;  // as measured by test-strokers.lua, or by the
+                         // stroker itself when it reports it
+    double render = 0.;
+    double compare = 0.;
+    double total = 0.;   // including setup
+    bool compared = false;
+    image_comparison comparison;
+};
+
+// Raised by os.exit, so the script can end without ending the process
+static char exit_key;
+
+static int exit_script(lua_State *L) {
+    lua_pushlightuserdata(L, &exit_key);
+    return lua_error(L);
+}
+
+static int traceback(lua_State *L) {
+    const char *msg = lua_tostring(L, 1);
+    if (msg) {
+        luaL_traceback(L, L, msg, 1);
+    }
+    return 1;
+}
+
+// Collects the names the script prints
+static int collect_print(lua_State *L) {
+    auto *names = static_cast<std::vector<std::string> *>(
+        lua_touserdata(L, lua_upvalueindex(1)));
+    for (int i = 1; i <= lua_gettop(L); ++i) {
+        const char *s = lua_tostring(L, i);
+        if (s) {
+            names->emplace_back(s);
+        }
+    }
+    return 0;
+}
+
+// Returns a new state with test-strokers.lua loaded as a function in
+// the registry, or nullptr, with a message in error
+static lua_State *new_test_state(int *script, std::string &error) {
+    lua_State *L = luaL_newstate();
+    if (!L) {
+        error = "unable to create Lua state";
+        return nullptr;
+    }
+    luaL_openlibs(L);
+    lua_getglobal(L, "os");
+    lua_pushcfunction(L, exit_script);
+    lua_setfield(L, -2, "exit");
+    lua_pop(L, 1);
+    if (luaL_loadfile(L, "test-strokers.lua") != LUA_OK) {
+        error = lua_tostring(L, -1);
+        lua_close(L);
+        return nullptr;
+    }
+    *script = luaL_ref(L, LUA_REGISTRYINDEX);
+    return L;
+}
+
+// Runs the script with the given arguments. Returns false, with a
+// message in error, if it fails
+static bool run_script(lua_State *L, int script,
+    const std::vector<std::string> &args, std::string &error) {
+    lua_pushcfunction(L, traceback);
+    int base = lua_gettop(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, script);
+    for (const auto &a: args) {
+        lua_pushstring(L, a.c_str());
+    }
+    bool ok = lua_pcall(L, static_cast<int>(args.size()), 0, base) ==
+        LUA_OK;
+    if (!ok && lua_touserdata(L, -1) != &exit_key) {
+        const char *msg = lua_tostring(L, -1);
+        error = msg? msg: "unknown error";
+    } else {
+        ok = true;
+    }
+    lua_settop(L, base-1);
+    return ok;
+}
+
+static bool list_tests(std::vector<std::string> &names, std::string &error) {
+    int script = LUA_NOREF;
+    lua_State *L = new_test_state(&script, error);
+    if (!L) {
+        return false;
+    }
+    lua_pushlightuserdata(L, &names);
+    lua_pushcclosure(L, collect_print, 1);
+    lua_setglobal(L, "print");
+    bool ok = run_script(L, script, {"-test:list"}, error);
+    lua_close(L);
+    std::sort(names.begin(), names.end());
+    return ok;
+}
+
+static int load_rgba8(const std::string &name,
+    packed_image<uint8_t, 4> *img) {
+    FILE *f = fopen(name.c_str(), "rb");
+    if (!f) {
+        return 0;
+    }
+    int ret = load_png(f, img);
+    fclose(f);
+    return ret;
+}
+
+static bool exists(const std::string &name) {
+    FILE *f = fopen(name.c_str(), "rb");
+    if (f) {
+        fclose(f);
+        return true;
+    }
+    return false;
+}
+
+// Compares output against reference, writing the differences to diff
+static bool compare(const std::string &output, const std::string &reference,
+    const std::string &diff_name, float fuzz, image_comparison *result,
+    std::string &error) {
+    packed_image<uint8_t, 4> a, b, diff;
+    if (!load_rgba8(reference, &a)) {
+        error = "unable to load " + reference;
+        return false;
+    }
+    if (!load_rgba8(output, &b)) {
+        error = "unable to load " + output;
+        return false;
+    }
+    if (!compare_images(a, b, fuzz, result, &diff)) {
+        error = "image sizes differ";
+        return false;
+    }
+    FILE *f = fopen(diff_name.c_str(), "wb");
+    if (!f || !store_png<uint8_t>(f, diff, image_attributes(),
+            png_write_options::fast())) {
+        if (f) fclose(f);
+        error = "unable to write " + diff_name;
+        return false;
+    }
+    fclose(f);
+    return true;
+}
+
+// Reads the total time of each test from the results of a previous run,
+// which have one test per line
+static std::map<std::string, double> previous_times(const char *name) {
+    std::map<std::string, double> times;
+    FILE *f = fopen(name, "r");
+    if (!f) {
+        return times;
+    }
+    char line[4096], test[256];
+    while (fgets(line, sizeof(line), f)) {
+        const char *total = strstr(line, "\"total\": ");
+        double t = 0.;
+        if (sscanf(line, " {\"test\": \"%255[^\"]\"", test) == 1 &&
+            total && sscanf(total+9, "%lf", &t) == 1) {
+            times[test] = t;
+        }
+    }
+    fclose(f);
+    return times;
+}
+
+static void print_string(FILE *out, const std::string &s) {
+    fputc('"', out);
+    for (unsigned char c: s) {
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c == '\n') {
+            fputs("\\n", out);
+        } else if (c == '\t') {
+            fputs("\\t", out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void print_result(FILE *out, bool first, const test_result &r) {
+    fprintf(out, "%s\n    {\"test\": ", first? "": ",");
+    print_string(out, r.name);
+    fprintf(out, ", \"thread\": %d, \"stroke\": %.9g, \"render\": %.9g, "
+        "\"compare\": %.9g, \"total\": %.9g", r.thread, r.stroke, r.render,
+        r.compare, r.total);
+    if (r.compared) {
+        fprintf(out, ", \"rmse\": %.9g, \"max_error\": %.9g, "
+            "\"mismatches\": %lld", r.comparison.rmse,
+            r.comparison.max_error,
+            static_cast<long long>(r.comparison.mismatches));
+    }
+    if (!r.error.empty()) {
+        fputs(", \"error\": ", out);
+        print_string(out, r.error);
+    }
+    fputs("}", out);
+}
+
+int main(int argc, char *argv[]) {
+    int threads = omp_get_max_threads();
+    float fuzz = .2f;
+    int max_mismatches = 0;
+    bool no_compare = false;
+    std::string output_dir = "a", reference_dir = "a/distroke";
+    std::string results_name, stroker;
+    std::vector<std::string> tests, passed;
+    int i = 1;
+    for ( ; i < argc; ++i) {
+        const char *arg = argv[i];
+        int value = 0, end = 0;
+        float fvalue = 0.f;
+        if (strcmp(arg, "-no-compare") == 0) {
+            no_compare = true;
+        } else if (sscanf(arg, "-threads:%d%n", &value, &end) == 1 &&
+            arg[end] == 0 && value > 0) {
+            threads = value;
+        } else if (sscanf(arg, "-fuzz:%f%n", &fvalue, &end) == 1 &&
+            arg[end] == 0 && fvalue >= 0.f) {
+            fuzz = fvalue/100.f;
+        } else if (sscanf(arg, "-max-mismatches:%d%n", &value, &end) == 1 &&
+            arg[end] == 0 && value >= 0) {
+            max_mismatches = value;
+        } else if (strncmp(arg, "-test:", 6) == 0 && arg[6]) {
+            tests.emplace_back(arg+6);
+        } else if (strncmp(arg, "-output-dir:", 12) == 0 && arg[12]) {
+            output_dir = arg+12;
+        } else if (strncmp(arg, "-reference-dir:", 15) == 0 && arg[15]) {
+            reference_dir = arg+15;
+        } else if (strncmp(arg, "-results:", 9) == 0 && arg[9]) {
+            results_name = arg+9;
+        } else if (arg[0] != '-') {
+            stroker = arg;
+            ++i;
+            break;
+        } else {
+            fprintf(stderr, "%s: invalid option %s\n", argv[0], arg);
+            return 1;
+        }
+    }
+    if (stroker.empty()) {
+        fprintf(stderr, "%s: expected a stroker\n", argv[0]);
+        return 1;
+    }
+    for ( ; i < argc; ++i) {
+        passed.emplace_back(argv[i]);
+    }
+    if (results_name.empty()) {
+        results_name = output_dir + "/results.json";
+    }
+    std::string error;
+    if (tests.empty() && !list_tests(tests, error)) {
+        fprintf(stderr, "%s: %s\n", argv[0], error.c_str());
+        return 1;
+    }
+    // Longest first, so the last tests to finish are short
+    auto before = previous_times(results_name.c_str());
+    std::vector<test_result> results(tests.size());
+    std::vector<size_t> order(tests.size());
+    for (size_t j = 0; j < tests.size(); ++j) {
+        results[j].name = tests[j];
+        order[j] = j;
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&before, &tests](size_t a, size_t b) {
+            auto ta = before.find(tests[a]), tb = before.find(tests[b]);
+            double da = ta != before.end()? ta->second: 0.;
+            double db = tb != before.end()? tb->second: 0.;
+            return da > db;
+        });
+    chronos wall;
+    bool failed = false;
+    // Drivers that use OpenMP run single-threaded inside each worker
+    #pragma omp parallel num_threads(threads)
+    {
+        int script = LUA_NOREF;
+        std::string state_error;
+        lua_State *L = new_test_state(&script, state_error);
+        chronos time;
+        #pragma omp for schedule(dynamic, 1)
+        for (size_t k = 0; k < order.size(); ++k) {
+            test_result &r = results[order[k]];
+            r.thread = omp_get_thread_num();
+            if (!L) {
+                r.error = state_error;
+                continue;
+            }
+            std::string output = output_dir + "/" + r.name + ".png";
+            std::vector<std::string> args{"-driver:skia"};
+            args.insert(args.end(), passed.begin(), passed.end());
+            args.push_back("-test:" + r.name);
+            args.push_back("-stroker:" + stroker);
+            args.push_back("-output:" + output);
+            // test-strokers.lua fills this table in
+            lua_newtable(L);
+            lua_setglobal(L, "test_strokers_timing");
+            time.reset();
+            if (run_script(L, script, args, r.error)) {
+                lua_getglobal(L, "test_strokers_timing");
+                lua_getfield(L, -1, "stroke");
+                r.stroke = lua_tonumber(L, -1);
+                lua_getfield(L, -2, "render");
+                r.render = lua_tonumber(L, -1);
+                lua_pop(L, 3);
+                std::string reference = reference_dir + "/" + r.name +
+                    "_distroke.png";
+                if (!no_compare && exists(reference)) {
+                    double start = time.elapsed();
+                    r.compared = compare(output, reference, output_dir +
+                        "/" + r.name + "_compare.png", fuzz, &r.comparison,
+                        r.error);
+                    r.compare = time.elapsed() - start;
+                    if (r.compared &&
+                        r.comparison.mismatches > max_mismatches) {
+                        r.error = std::to_string(r.comparison.mismatches) +
+                            " pixels differ from the ground truth by more "
+                            "than the fuzz";
+                    }
+                }
+            }
+            r.total = time.elapsed();
+            if (!r.error.empty()) {
+                #pragma omp atomic write
+                failed = true;
+            }
+            #pragma omp critical
+            fprintf(stderr, "%s%s\n", r.name.c_str(),
+                r.error.empty()? "": " failed");
+        }
+        if (L) {
+            lua_close(L);
+        }
+    }
+    double elapsed = wall.elapsed(), sum = 0.;
+    for (const auto &r: results) {
+        sum += r.total;
+        if (!r.error.empty()) {
+            fprintf(stderr, "%s: %s\n", r.name.c_str(), r.error.c_str());
+        }
+        if (r.compared) {
+            printf("%g %g %lld %s\n", r.comparison.rmse,
+                r.comparison.max_error,
+                static_cast<long long>(r.comparison.mismatches),
+                r.name.c_str());
+        }
+    }
+    FILE *out = fopen(results_name.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "%s: unable to write %s\n", argv[0],
+            results_name.c_str());
+        return 1;
+    }
+    fputs("{\n  \"stroker\": ", out);
+    print_string(out, stroker);
+    fprintf(out, ",\n  \"threads\": %d,\n  \"wall\": %.9g,\n"
+        "  \"sum\": %.9g,\n  \"results\": [", threads, elapsed, sum);
+    bool first = true;
+    for (const auto &r: results) {
+        print_result(out, first, r);
+        first = false;
+    }
+    fputs("\n  ]\n}\n", out);
+    fclose(out);
+    return failed? 1: 0;
+}
@@ -0,0 +1,276 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cmath>
+#include <algorithm>
+
+#include "rvg-compact-path-data.h"
+
+namespace rvg {
+
+// Receives the input path instructions of a path_data and appends them
+// to a compact_path_data, one contour at a time. The frame of a contour
+// can only be computed once all its points are known, so points are
+// kept in full precision until the contour ends. Contours whose points
+// cannot be quantized are dropped and clear the finite flag.
+class compact_path_data_encoder final:
+    public i_input_path<compact_path_data_encoder> {
+
+    compact_path_data &m_compact;
+    std::vector<rvgf> m_points;
+    bool m_in_contour;
+    bool m_finite;
+
+public:
+
+    explicit compact_path_data_encoder(compact_path_data &compact):
+        m_compact(compact),
+        m_in_contour(false),
+        m_finite(true) {
+        ;
+    }
+
+    bool is_finite(void) const {
+        return m_finite;
+    }
+
+    // Terminates a contour left open at the end of the path
+    void finish(void) {
+        if (m_in_contour) {
+            end_contour(path_instruction::end_open_contour);
+        }
+    }
+
+private:
+
+    void push(rvgf x, rvgf y) {
+        if (!std::isfinite(x) || !std::isfinite(y)) {
+            m_finite = false;
+        }
+        m_points.push_back(x);
+        m_points.push_back(y);
+    }
+
+    void store(int32_t q, int w) {
+        for (int i = 0; i < w; ++i) {
+            m_compact.m_coordinates.push_back(
+                static_cast<uint8_t>((static_cast<uint32_t>(q) >> (8*i))
+                    & 0xff));
+        }
+    }
+
+    void end_contour(path_instruction instruction) {
+        m_compact.m_instructions.push_back(instruction);
+        m_in_contour = false;
+        if (!m_finite) {
+            m_points.clear();
+            return;
+        }
+        // Compute frame from the bounding box of the contour
+        rvgf xmin = m_points[0], xmax = m_points[0];
+        rvgf ymin = m_points[1], ymax = m_points[1];
+        for (size_t i = 0; i < m_points.size(); i += 2) {
+            xmin = std::min(xmin, m_points[i]);
+            xmax = std::max(xmax, m_points[i]);
+            ymin = std::min(ymin, m_points[i+1]);
+            ymax = std::max(ymax, m_points[i+1]);
+        }
+        int w = static_cast<int>(m_compact.m_precision);
+        int32_t qmax = (int32_t{1} << (8*w-1)) - 1;
+        compact_path_data::frame f;
+        // Halve the differences rather than the sums, which overflow
+        // for large coordinates of the same sign
+        f.x = xmin + rvgf{.5}*(xmax-xmin);
+        f.y = ymin + rvgf{.5}*(ymax-ymin);
+        rvgf extent = std::max(xmax-xmin, ymax-ymin)*rvgf{.5};
+        f.scale = extent > 0? extent/static_cast<rvgf>(qmax): rvgf{1};
+        // The differences overflow if the contour spans most of the range
+        if (!std::isfinite(f.x) || !std::isfinite(f.y) ||
+            !std::isfinite(f.scale)) {
+            m_finite = false;
+            m_points.clear();
+            return;
+        }
+        m_compact.m_frames.push_back(f);
+        for (size_t i = 0; i < m_points.size(); i += 2) {
+            // Clamp before rounding, so lround stays within range
+            auto quantize = [&](rvgf v, rvgf o) {
+                rvgf q = (v-o)/f.scale;
+                q = std::min(static_cast<rvgf>(qmax),
+                    std::max(-static_cast<rvgf>(qmax), q));
+                return static_cast<int32_t>(std::lround(q));
+            };
+            store(quantize(m_points[i], f.x), w);
+            store(quantize(m_points[i+1], f.y), w);
+        }
+        m_points.clear();
+    }
+
+friend i_input_path<compact_path_data_encoder>;
+
+    void do_begin_contour(rvgf x0, rvgf y0) {
+        finish();
+        m_compact.m_instructions.push_back(path_instruction::begin_contour);
+        m_in_contour = true;
+        push(x0, y0);
+    }
+
+    void do_end_open_contour(rvgf, rvgf) {
+        if (m_in_contour) {
+            end_contour(path_instruction::end_open_contour);
+        }
+    }
+
+    void do_end_closed_contour(rvgf, rvgf) {
+        if (m_in_contour) {
+            end_contour(path_instruction::end_closed_contour);
+        }
+    }
+
+    void do_linear_segment(rvgf, rvgf, rvgf x1, rvgf y1) {
+        m_compact.m_instructions.push_back(path_instruction::linear_segment);
+        push(x1, y1);
+    }
+
+    void do_quadratic_segment(rvgf, rvgf, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2) {
+        m_compact.m_instructions.push_back(
+            path_instruction::quadratic_segment);
+        push(x1, y1);
+        push(x2, y2);
+    }
+
+    void do_rational_quadratic_segment(rvgf, rvgf, rvgf x1, rvgf y1,
+        rvgf w1, rvgf x2, rvgf y2) {
+        m_compact.m_instructions.push_back(
+            path_instruction::rational_quadratic_segment);
+        m_compact.m_rational.push_back(x1);
+        m_compact.m_rational.push_back(y1);
+        m_compact.m_rational.push_back(w1);
+        push(x2, y2);
+    }
+
+    void do_cubic_segment(rvgf, rvgf, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+        m_compact.m_instructions.push_back(path_instruction::cubic_segment);
+        push(x1, y1);
+        push(x2, y2);
+        push(x3, y3);
+    }
+};
+
+compact_path_data::compact_path_data(void):
+    m_precision(precision::bits16) {
+    ;
+}
+
+compact_path_data::ptr make_compact_path_data(const path_data &path,
+    compact_path_data::precision p) {
+    auto compact = make_intrusive<compact_path_data>();
+    compact->m_precision = p;
+    compact_path_data_encoder encoder{*compact};
+    path.iterate(encoder);
+    encoder.finish();
+    if (!encoder.is_finite()) {
+        return nullptr;
+    }
+    compact->m_instructions.shrink_to_fit();
+    compact->m_frames.shrink_to_fit();
+    compact->m_coordinates.shrink_to_fit();
+    compact->m_rational.shrink_to_fit();
+    return compact;
+}
+
+compact_path_data::ptr make_compact_path_data(
+    compact_path_data::precision p,
+    const path_instruction *instructions, size_t size,
+    const compact_path_data::frame *frames, size_t frame_count,
+    const uint8_t *coordinates, size_t coordinate_count,
+    const rvgf *rational, size_t rational_count) {
+    if (p != compact_path_data::precision::bits16 &&
+        p != compact_path_data::precision::bits24) {
+        return nullptr;
+    }
+    // Count what the instructions consume, so iteration cannot run past
+    // the end of any array
+    size_t points = 0, contours = 0, rationals = 0;
+    bool in_contour = false;
+    for (size_t i = 0; i < size; ++i) {
+        switch (instructions[i]) {
+            case path_instruction::begin_contour:
+                if (in_contour) {
+                    return nullptr;
+                }
+                in_contour = true;
+                points += 1;
+                break;
+            case path_instruction::end_open_contour:
+            case path_instruction::end_closed_contour:
+                if (!in_contour) {
+                    return nullptr;
+                }
+                in_contour = false;
+                contours += 1;
+                break;
+            case path_instruction::linear_segment:
+                points += 1;
+                break;
+            case path_instruction::quadratic_segment:
+                points += 2;
+                break;
+            case path_instruction::rational_quadratic_segment:
+                points += 1;
+                rationals += 3;
+                break;
+            case path_instruction::cubic_segment:
+                points += 3;
+                break;
+            default:
+                return nullptr;
+        }
+        if (!in_contour && instructions[i] !=
+            path_instruction::end_open_contour && instructions[i] !=
+            path_instruction::end_closed_contour) {
+            return nullptr;
+        }
+    }
+    if (in_contour || contours != frame_count ||
+        rationals != rational_count ||
+        points*2*static_cast<size_t>(p) != coordinate_count) {
+        return nullptr;
+    }
+    auto compact = make_intrusive<compact_path_data>();
+    compact->m_precision = p;
+    compact->m_instructions.assign(instructions, instructions+size);
+    compact->m_frames.assign(frames, frames+frame_count);
+    compact->m_coordinates.assign(coordinates, coordinates+coordinate_count);
+    compact->m_rational.assign(rational, rational+rational_count);
+    return compact;
+}
+
+size_t compact_path_data::get_memory_usage(void) const {
+    return m_instructions.size()*sizeof(path_instruction) +
+        m_frames.size()*sizeof(frame) +
+        m_coordinates.size()*sizeof(uint8_t) +
+        m_rational.size()*sizeof(rvgf);
+}
+
+path_data::ptr compact_path_data::decompact(void) const {
+    auto path = make_intrusive<path_data>();
+    this->iterate(*path);
+    return path;
+}
+
+} // namespace rvg
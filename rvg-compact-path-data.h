@@ -0,0 +1,360 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_COMPACT_PATH_DATA_H
+#define RVG_COMPACT_PATH_DATA_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits> // std::enable_if
+
+#include "rvg-ptr.h"
+#include "rvg-i-path.h"
+#include "rvg-path-instruction.h"
+#include "rvg-floatint.h"
+#include "rvg-input-path-f-forward-if.h"
+#include "rvg-path-data.h"
+
+namespace rvg {
+
+// A read-only, quantized version of the input path instructions in a
+// path_data, for large static datasets.
+//
+// There is no offset array. Instead, each instruction consumes a fixed
+// number of coordinates from the coordinate array, so iteration simply
+// advances (or, in reverse, retreats) a cursor. Consecutive segments
+// share a common endpoint, just as in path_data.
+//
+//   begin_contour                            x0 y0
+//   end_open_contour
+//   end_closed_contour
+//   linear_segment                           x1 y1
+//   quadratic_segment                        x1 y1 x2 y2
+//   rational_quadratic_segment               x2 y2 (and x1 y1 w1)
+//   cubic_segment                            x1 y1 x2 y2 x3 y3
+//
+// Coordinates are stored as 16- or 24-bit signed fixed-point values
+// relative to a per-contour frame (origin and scale). The homogeneous
+// middle control points of rational quadratic segments can be at
+// infinity, so they are kept in full precision in a separate array.
+// Decoding happens inside the iteration loop.
+//
+// Only input path instructions are kept. Regular path, decorated path
+// and parameter instructions are dropped, and a contour left open at
+// the end of the path is terminated with end_open_contour. Iteration
+// always covers the entire path.
+//
+// scene_f_write_binary uses it to store quantized paths in binary scene
+// files (see rvg-scene-binary-format.h). scene_data_file decodes them
+// back into path_data on load, so the saving is in file size and I/O,
+// not in the memory the drivers use.
+class compact_path_data final:
+    public boost::intrusive_ref_counter<compact_path_data> {
+
+public:
+
+    // Number of bits per coordinate
+    enum class precision: uint8_t {
+        bits16 = 2,
+        bits24 = 3
+    };
+
+    // Maps quantized coordinates back to the contour's coordinates
+    struct frame {
+        rvgf x, y, scale;
+    };
+
+    using ptr = boost::intrusive_ptr<compact_path_data>;
+    using const_ptr = boost::intrusive_ptr<const compact_path_data>;
+
+    // Use make_compact_path_data instead
+    compact_path_data(void);
+
+    compact_path_data(const compact_path_data &other) = default;
+    compact_path_data(compact_path_data &&other) = default;
+    compact_path_data &operator=(const compact_path_data &other) = default;
+    compact_path_data &operator=(compact_path_data &&other) = default;
+
+    auto size(void) const {
+        return m_instructions.size();
+    }
+
+    bool empty(void) const {
+        return m_instructions.empty();
+    }
+
+    precision get_precision(void) const {
+        return m_precision;
+    }
+
+    // Bytes used by the arrays
+    size_t get_memory_usage(void) const;
+
+    // Converts back to a path_data
+    path_data::ptr decompact(void) const;
+
+    const std::vector<path_instruction> &get_instructions(void) const {
+        return m_instructions;
+    }
+
+    // One frame per contour
+    const std::vector<frame> &get_frames(void) const {
+        return m_frames;
+    }
+
+    // Little-endian, 2 or 3 bytes per coordinate, depending on precision
+    const std::vector<uint8_t> &get_coordinates(void) const {
+        return m_coordinates;
+    }
+
+    // x1, y1, w1 of each rational quadratic segment
+    const std::vector<rvgf> &get_rational(void) const {
+        return m_rational;
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void iterate(PF &sink) const {
+        if (m_precision == precision::bits24) {
+            iterate_helper<3>(sink);
+        } else {
+            iterate_helper<2>(sink);
+        }
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void iterate(PF &&sink) const {
+        this->iterate(sink);
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void riterate(PF &sink) const {
+        if (m_precision == precision::bits24) {
+            riterate_helper<3>(sink);
+        } else {
+            riterate_helper<2>(sink);
+        }
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void riterate(PF &&sink) const {
+        this->riterate(sink);
+    }
+
+private:
+
+    std::vector<path_instruction> m_instructions;
+    std::vector<frame> m_frames;
+    std::vector<uint8_t> m_coordinates;
+    std::vector<rvgf> m_rational;
+    precision m_precision;
+
+    // Loads a little-endian signed integer with W bytes
+    template <int W>
+    static int32_t load(const uint8_t *c) {
+        if (W == 2) {
+            return static_cast<int16_t>(c[0] | (c[1] << 8));
+        } else {
+            uint32_t u = static_cast<uint32_t>(c[0]) |
+                (static_cast<uint32_t>(c[1]) << 8) |
+                (static_cast<uint32_t>(c[2]) << 16);
+            // sign extend from 24 bits
+            return static_cast<int32_t>(u ^ 0x800000u) - 0x800000;
+        }
+    }
+
+    template <int W, typename PF>
+    void iterate_helper(PF &sink) const;
+
+    template <int W, typename PF>
+    void riterate_helper(PF &sink) const;
+
+friend class compact_path_data_encoder;
+friend compact_path_data::ptr make_compact_path_data(const path_data &path,
+    precision p);
+friend compact_path_data::ptr make_compact_path_data(precision p,
+    const path_instruction *instructions, size_t size,
+    const frame *frames, size_t frame_count,
+    const uint8_t *coordinates, size_t coordinate_count,
+    const rvgf *rational, size_t rational_count);
+};
+
+// Quantizes the input path instructions of path. Returns a null pointer
+// if a contour has coordinates that are not finite, or a bounding box
+// too large to represent, since these cannot be quantized.
+compact_path_data::ptr make_compact_path_data(const path_data &path,
+    compact_path_data::precision p = compact_path_data::precision::bits16);
+
+// Copies arrays previously obtained from a compact_path_data. Returns a
+// null pointer unless the instructions form a sequence of contours and
+// the array sizes match what they consume.
+compact_path_data::ptr make_compact_path_data(
+    compact_path_data::precision p,
+    const path_instruction *instructions, size_t size,
+    const compact_path_data::frame *frames, size_t frame_count,
+    const uint8_t *coordinates, size_t coordinate_count,
+    const rvgf *rational, size_t rational_count);
+
+template <int W, typename PF>
+void compact_path_data::iterate_helper(PF &sink) const {
+    auto &input = make_input_path_f_forward_if(sink);
+    const uint8_t *c = m_coordinates.data();
+    const rvgf *r = m_rational.data();
+    const frame *f = m_frames.data();
+    rvgf x0 = 0, y0 = 0;
+    // Decodes the next point and advances the cursor
+    auto next = [&c, &f](rvgf &x, rvgf &y) {
+        x = f->x + f->scale*static_cast<rvgf>(load<W>(c));
+        y = f->y + f->scale*static_cast<rvgf>(load<W>(c+W));
+        c += 2*W;
+    };
+    for (auto instruction: m_instructions) {
+        switch (instruction) {
+            case path_instruction::begin_contour:
+                next(x0, y0);
+                input.begin_contour(x0, y0);
+                break;
+            case path_instruction::end_open_contour:
+                input.end_open_contour(x0, y0);
+                ++f;
+                break;
+            case path_instruction::end_closed_contour:
+                input.end_closed_contour(x0, y0);
+                ++f;
+                break;
+            case path_instruction::linear_segment: {
+                rvgf x1, y1;
+                next(x1, y1);
+                input.linear_segment(x0, y0, x1, y1);
+                x0 = x1; y0 = y1;
+                break;
+            }
+            case path_instruction::quadratic_segment: {
+                rvgf x1, y1, x2, y2;
+                next(x1, y1);
+                next(x2, y2);
+                input.quadratic_segment(x0, y0, x1, y1, x2, y2);
+                x0 = x2; y0 = y2;
+                break;
+            }
+            case path_instruction::rational_quadratic_segment: {
+                rvgf x2, y2;
+                next(x2, y2);
+                input.rational_quadratic_segment(x0, y0, r[0], r[1], r[2],
+                    x2, y2);
+                r += 3;
+                x0 = x2; y0 = y2;
+                break;
+            }
+            case path_instruction::cubic_segment: {
+                rvgf x1, y1, x2, y2, x3, y3;
+                next(x1, y1);
+                next(x2, y2);
+                next(x3, y3);
+                input.cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3);
+                x0 = x3; y0 = y3;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+template <int W, typename PF>
+void compact_path_data::riterate_helper(PF &sink) const {
+    auto &input = make_input_path_f_forward_if(sink);
+    const uint8_t *c = m_coordinates.data() + m_coordinates.size();
+    const rvgf *r = m_rational.data() + m_rational.size();
+    const frame *f = m_frames.data() + m_frames.size();
+    // Decodes the point at offset i (in points) from the cursor
+    auto at = [&c, &f](int i, rvgf &x, rvgf &y) {
+        x = f->x + f->scale*static_cast<rvgf>(load<W>(c+2*W*i));
+        y = f->y + f->scale*static_cast<rvgf>(load<W>(c+2*W*i+W));
+    };
+    bool open_contour = true;
+    for (auto it = m_instructions.rbegin(); it != m_instructions.rend();
+        ++it) {
+        switch (*it) {
+            case path_instruction::begin_contour: {
+                rvgf x0, y0;
+                c -= 2*W;
+                at(0, x0, y0);
+                if (open_contour) {
+                    input.end_open_contour(x0, y0);
+                } else {
+                    input.end_closed_contour(x0, y0);
+                }
+                break;
+            }
+            case path_instruction::end_open_contour:
+            case path_instruction::end_closed_contour: {
+                --f;
+                rvgf xn, yn;
+                at(-1, xn, yn);
+                input.begin_contour(xn, yn);
+                open_contour = (*it == path_instruction::end_open_contour);
+                break;
+            }
+            case path_instruction::linear_segment: {
+                rvgf x0, y0, x1, y1;
+                c -= 2*W;
+                at(-1, x0, y0);
+                at(0, x1, y1);
+                input.linear_segment(x1, y1, x0, y0);
+                break;
+            }
+            case path_instruction::quadratic_segment: {
+                rvgf x0, y0, x1, y1, x2, y2;
+                c -= 4*W;
+                at(-1, x0, y0);
+                at(0, x1, y1);
+                at(1, x2, y2);
+                input.quadratic_segment(x2, y2, x1, y1, x0, y0);
+                break;
+            }
+            case path_instruction::rational_quadratic_segment: {
+                rvgf x0, y0, x2, y2;
+                c -= 2*W;
+                at(-1, x0, y0);
+                at(0, x2, y2);
+                r -= 3;
+                input.rational_quadratic_segment(x2, y2, r[0], r[1], r[2],
+                    x0, y0);
+                break;
+            }
+            case path_instruction::cubic_segment: {
+                rvgf x0, y0, x1, y1, x2, y2, x3, y3;
+                c -= 6*W;
+                at(-1, x0, y0);
+                at(0, x1, y1);
+                at(1, x2, y2);
+                at(2, x3, y3);
+                input.cubic_segment(x3, y3, x2, y2, x1, y1, x0, y0);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace rvg
+
+#endif
@@ -0,0 +1,283 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_CUBIC_PARAMETERS_BATCH_H
+#define RVG_CUBIC_PARAMETERS_BATCH_H
+
+#include <vector>
+#include <array>
+
+#include <boost/range/adaptor/sliced.hpp>
+
+#include "rvg-path-data.h"
+#include "rvg-xform.h"
+#include "rvg-input-path-f-xform.h"
+#include "rvg-precision-escalation.h"
+#include "rvg-i-input-path-f-forwarder.h"
+#include "rvg-i-parameters-f-forwarder.h"
+#include "rvg-input-path-f-find-cubic-parameters.h"
+#include "rvg-input-path-f-find-monotonic-parameters.h"
+#include "rvg-monotonic-parameters-f-forward-if.h"
+
+// Analyses all cubic segments in a path at once, instead of one at a
+// time as they stream through input_path_f_find_cubic_parameters (and,
+// optionally, input_path_f_find_monotonic_parameters). The control
+// points are first gathered into one array per coordinate. The
+// coefficients of the inflection and double-point polynomials are then
+// evaluated in a single branch-free loop the compiler can vectorize.
+// Root finding is branchy, so it runs per cubic, but in parallel.
+// Finally, the path is replayed with the parameter instructions
+// inserted exactly where the streaming filters would put them.
+//
+// The rvg stroker analyses long paths this way, and then puts the
+// replay filter in place of input_path_f_find_cubic_parameters.
+
+// Paths with fewer instructions than this are not worth the
+// extra pass, and go through the streaming filter
+#define RVG_CUBIC_PARAMETERS_BATCH_THRESHOLD (256)
+
+// Paths with fewer cubics than this are analysed in a single thread
+#define RVG_CUBIC_PARAMETERS_BATCH_PARALLEL_THRESHOLD (1024)
+
+namespace rvg {
+
+class cubic_parameters_batch {
+
+    // Everything found for a given cubic
+    struct found_parameters {
+        cubic_parameters::found_parameters cubic;
+        cubic_parameters::parameters root_dx, root_dy;
+    };
+
+    // Gathers the control points of all cubics in a path
+    class input_path_f_gather final:
+        public i_input_path<input_path_f_gather> {
+
+        std::array<std::vector<rvgf>, 4> &m_x, &m_y;
+
+    public:
+
+        input_path_f_gather(std::array<std::vector<rvgf>, 4> &x,
+            std::array<std::vector<rvgf>, 4> &y): m_x(x), m_y(y) { ; }
+
+    private:
+
+    friend i_input_path<input_path_f_gather>;
+
+        void do_begin_contour(rvgf, rvgf) { ; }
+        void do_end_open_contour(rvgf, rvgf) { ; }
+        void do_end_closed_contour(rvgf, rvgf) { ; }
+        void do_linear_segment(rvgf, rvgf, rvgf, rvgf) { ; }
+        void do_quadratic_segment(rvgf, rvgf, rvgf, rvgf, rvgf, rvgf) { ; }
+        void do_rational_quadratic_segment(rvgf, rvgf, rvgf, rvgf, rvgf,
+            rvgf, rvgf) { ; }
+        void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+            rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+            m_x[0].push_back(x0); m_y[0].push_back(y0);
+            m_x[1].push_back(x1); m_y[1].push_back(y1);
+            m_x[2].push_back(x2); m_y[2].push_back(y2);
+            m_x[3].push_back(x3); m_y[3].push_back(y3);
+        }
+    };
+
+    // Replays a path, inserting the parameters found for each cubic
+    template <typename SINK>
+    class input_path_f_replay final:
+        public i_sink<input_path_f_replay<SINK>>,
+        public i_input_path_f_forwarder<input_path_f_replay<SINK>>,
+        public i_parameters_f_forwarder<SINK, input_path_f_replay<SINK>> {
+
+        const cubic_parameters_batch &m_batch;
+        size_t m_index;
+        SINK m_sink;
+
+    public:
+
+        input_path_f_replay(const cubic_parameters_batch &batch,
+            SINK &&sink):
+            m_batch(batch),
+            m_index(0),
+            m_sink(std::forward<SINK>(sink)) {
+            static_assert(meta::is_an_i_cubic_parameters<SINK>::value,
+                "sink is not an i_cubic_parameters");
+            static_assert(meta::is_an_i_input_path<SINK>::value,
+                "sink is not an i_input_path");
+        }
+
+    private:
+
+    friend i_sink<input_path_f_replay<SINK>>;
+
+        SINK &do_sink(void) {
+            return m_sink;
+        }
+
+        const SINK &do_sink(void) const {
+            return m_sink;
+        }
+
+    friend i_input_path<input_path_f_replay<SINK>>;
+
+        void do_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+            rvgf x2, rvgf y2) {
+            if (m_batch.m_monotonic) {
+                monotonic_parameters::quadratic_segment_extremes(x0, y0,
+                    x1, y1, x2, y2,
+                    make_monotonic_parameters_f_forward_if(m_sink));
+            }
+            return m_sink.quadratic_segment(x0, y0, x1, y1, x2, y2);
+        }
+
+        void do_rational_quadratic_segment(rvgf x0, rvgf y0,
+            rvgf x1, rvgf y1, rvgf w1, rvgf x2, rvgf y2) {
+            if (m_batch.m_monotonic) {
+                monotonic_parameters::rational_quadratic_segment_extremes(
+                    x0, y0, x1, y1, w1, x2, y2,
+                    make_monotonic_parameters_f_forward_if(m_sink));
+            }
+            return m_sink.rational_quadratic_segment(x0, y0, x1, y1, w1,
+                x2, y2);
+        }
+
+        void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+            rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+            const auto &found = m_batch.m_found[m_index++];
+            auto &roots = make_monotonic_parameters_f_forward_if(m_sink);
+            for (auto t: found.root_dx) {
+                roots.root_dx_parameter(t);
+            }
+            for (auto t: found.root_dy) {
+                roots.root_dy_parameter(t);
+            }
+            for (auto t: found.cubic.inflections) {
+                m_sink.inflection_parameter(t);
+            }
+            for (auto t: found.cubic.double_points) {
+                m_sink.double_point_parameter(t);
+            }
+            return m_sink.cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3);
+        }
+    };
+
+    const path_data &m_path;
+    xform m_xf;
+    bool m_monotonic;
+    std::vector<found_parameters> m_found;
+
+    void analyze(const std::array<std::vector<rvgf>, 4> &x,
+        const std::array<std::vector<rvgf>, 4> &y) {
+        const int n = static_cast<int>(x[0].size());
+        m_found.resize(n);
+        // Control points shifted so p0 is at the origin, as in
+        // cubic_parameters::analyze
+        std::vector<cubic_parameters::coefficients<rvgf>> c(n);
+        const rvgf *x0 = x[0].data(), *x1 = x[1].data(),
+            *x2 = x[2].data(), *x3 = x[3].data();
+        const rvgf *y0 = y[0].data(), *y1 = y[1].data(),
+            *y2 = y[2].data(), *y3 = y[3].data();
+#pragma omp simd
+        for (int i = 0; i < n; ++i) {
+            c[i] = cubic_parameters::make_coefficients(
+                x1[i]-x0[i], y1[i]-y0[i],
+                x2[i]-x0[i], y2[i]-y0[i],
+                x3[i]-x0[i], y3[i]-y0[i]);
+        }
+#pragma omp parallel for schedule(static) \
+    if (n > RVG_CUBIC_PARAMETERS_BATCH_PARALLEL_THRESHOLD)
+        for (int i = 0; i < n; ++i) {
+            auto &found = m_found[i];
+            bool robust = precision_escalation::try_single() &&
+                cubic_parameters::find_parameters(c[i], found.cubic);
+            precision_escalation::count_cubic(cubic_parameters::escalate(
+                robust, R2{x0[i], y0[i]}, R2{x1[i], y1[i]},
+                R2{x2[i], y2[i]}, R2{x3[i], y3[i]}, found.cubic));
+            if (m_monotonic) {
+                using namespace boost::adaptors;
+                auto tdx = monotonic_parameters::cubic_segment_roots(
+                    x0[i], x1[i], x2[i], x3[i]);
+                for (auto t: tdx | sliced(1, tdx.size()-1)) {
+                    found.root_dx.push_back(t);
+                }
+                auto tdy = monotonic_parameters::cubic_segment_roots(
+                    y0[i], y1[i], y2[i], y3[i]);
+                for (auto t: tdy | sliced(1, tdy.size()-1)) {
+                    found.root_dy.push_back(t);
+                }
+            }
+        }
+    }
+
+public:
+
+    // If monotonic is true, also finds the root_dx and root_dy
+    // parameters of all segments, as if the path had gone through
+    // make_input_path_f_find_monotonic_parameters(
+    //     make_input_path_f_find_cubic_parameters(sink))
+    // The path must outlive the batch
+    explicit cubic_parameters_batch(const path_data &path,
+        bool monotonic = false):
+        cubic_parameters_batch(path, make_identity(), monotonic) { ; }
+
+    // Same, but analyses the path transformed by xf
+    cubic_parameters_batch(const path_data &path, const xform &xf,
+        bool monotonic = false):
+        m_path(path), m_xf(xf), m_monotonic(monotonic) {
+        std::array<std::vector<rvgf>, 4> x, y;
+        m_path.iterate(make_input_path_f_xform(m_xf,
+            input_path_f_gather{x, y}));
+        analyze(x, y);
+    }
+
+    // Number of cubics analysed
+    size_t size(void) const {
+        return m_found.size();
+    }
+
+    // Sends the transformed path to sink, with all parameters inserted
+    template <typename SINK>
+    void iterate(SINK &&sink) const {
+        m_path.iterate(make_input_path_f_xform(m_xf,
+            input_path_f_replay<SINK>{*this, std::forward<SINK>(sink)}));
+    }
+
+    // Returns a filter that inserts the parameters into the transformed
+    // path, as it comes from further up a pipeline. Filters up there
+    // may add segments, but not cubics. Each filter replays the path once
+    template <typename SINK>
+    auto operator()(SINK &&sink) const {
+        return input_path_f_replay<SINK>{*this, std::forward<SINK>(sink)};
+    }
+
+};
+
+// Same output as
+//  path.iterate(make_input_path_f_find_cubic_parameters(sink))
+template <typename SINK>
+void batch_find_cubic_parameters(const path_data &path, SINK &&sink) {
+    cubic_parameters_batch{path}.iterate(std::forward<SINK>(sink));
+}
+
+// Same output as
+//  path.iterate(make_input_path_f_find_monotonic_parameters(
+//      make_input_path_f_find_cubic_parameters(sink)))
+template <typename SINK>
+void batch_find_monotonic_and_cubic_parameters(const path_data &path,
+    SINK &&sink) {
+    cubic_parameters_batch{path, true}.iterate(std::forward<SINK>(sink));
+}
+
+} // namespace rvg
+
+#endif
@@ -15,10 +15,14 @@
 //
 #include <cairo.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <cmath>
 #include <memory>
+#include <vector>
 
 #include "rvg-lua.h"
 
@@ -28,9 +32,12 @@
 
 #include "rvg-input-path-f-xform.h"
 #include "rvg-rgba.h"
+#include "rvg-bbox.h"
+#include "rvg-pngio.h"
 
 #include "rvg-lua-facade.h"
 
+#include "rvg-driver-options.h"
 #include "rvg-driver-cairo.h"
 
 
@@ -40,10 +47,20 @@ namespace rvg {
 
 class accelerated {
     std::shared_ptr<cairo_surface_t> m_surface;
+    scene m_scene;
+    xform m_screen_xf;
 public:
-    accelerated(cairo_surface_t *surface): m_surface(surface, &cairo_surface_destroy) { }
+    accelerated(cairo_surface_t *surface, const scene &c,
+        const xform &screen_xf):
+        m_surface(surface, &cairo_surface_destroy),
+        m_scene(c),
+        m_screen_xf(screen_xf) { }
     cairo_surface_t * get_surface(void) const { return m_surface.get(); }
     cairo_surface_t * get_surface(void) { return m_surface.get(); }
+    // Tiled rendering replays the scene itself, so each thread can
+    // use its own cairo context
+    const scene &get_scene(void) const { return m_scene; }
+    const xform &get_screen_xf(void) const { return m_screen_xf; }
 };
 
 class input_path_f_to_cairo final: public i_input_path<input_path_f_to_cairo> {
@@ -77,13 +94,29 @@ class scene_f_to_cairo final: public i_scene_data<scene_f_to_cairo> {
 
     cairo_t *m_cr;
     std::vector<xform> m_xf_stack;
+    std::vector<bbox<double>> *m_extents;
+    const std::vector<bbox<double>> *m_cull;
+    bbox<double> m_tile;
+    size_t m_index;
 
 public:
 
     scene_f_to_cairo(const xform &screen_xf, cairo_t *cr);
 
+    // Instead of drawing, appends the device-space extents of each
+    // painted shape to extents
+    scene_f_to_cairo(const xform &screen_xf, cairo_t *cr,
+        std::vector<bbox<double>> *extents);
+
+    // Draws only painted shapes whose extents, as measured by the
+    // constructor above, overlap the tile
+    scene_f_to_cairo(const xform &screen_xf, cairo_t *cr,
+        const std::vector<bbox<double>> &extents, const bbox<double> &tile);
+
 private:
 
+    bbox<double> get_device_extents(bool stroke) const;
+
     void push_xf(const xform &xf);
     void pop_xf(void);
     const xform &top_xf(void) const;
@@ -184,10 +217,61 @@ void input_path_f_to_cairo::do_end_closed_contour(rvgf x0, rvgf y0) {
 scene_f_to_cairo::scene_f_to_cairo(
     const xform &screen_xf,
     cairo_t *cr):
-    m_cr(cr) {
+    m_cr(cr),
+    m_extents(nullptr),
+    m_cull(nullptr),
+    m_index(0) {
+    push_xf(screen_xf);
+}
+
+scene_f_to_cairo::scene_f_to_cairo(
+    const xform &screen_xf,
+    cairo_t *cr,
+    std::vector<bbox<double>> *extents):
+    m_cr(cr),
+    m_extents(extents),
+    m_cull(nullptr),
+    m_index(0) {
+    push_xf(screen_xf);
+}
+
+scene_f_to_cairo::scene_f_to_cairo(
+    const xform &screen_xf,
+    cairo_t *cr,
+    const std::vector<bbox<double>> &extents,
+    const bbox<double> &tile):
+    m_cr(cr),
+    m_extents(nullptr),
+    m_cull(&extents),
+    m_tile(tile),
+    m_index(0) {
     push_xf(screen_xf);
 }
 
+bbox<double> scene_f_to_cairo::get_device_extents(bool stroke) const {
+    double x1, y1, x2, y2;
+    if (stroke) {
+        cairo_stroke_extents(m_cr, &x1, &y1, &x2, &y2);
+    } else {
+        cairo_fill_extents(m_cr, &x1, &y1, &x2, &y2);
+    }
+    if (x1 >= x2 || y1 >= y2) {
+        return bbox<double>{};
+    }
+    // Extents are in user space. Map the corners to device space and
+    // pad by a pixel to account for antialiasing
+    double xs[4] = {x1, x2, x2, x1}, ys[4] = {y1, y1, y2, y2};
+    bbox<double> b;
+    for (int i = 0; i < 4; ++i) {
+        cairo_user_to_device(m_cr, &xs[i], &ys[i]);
+        b[0] = std::min(b[0], xs[i]-1.);
+        b[1] = std::min(b[1], ys[i]-1.);
+        b[2] = std::max(b[2], xs[i]+1.);
+        b[3] = std::max(b[3], ys[i]+1.);
+    }
+    return b;
+}
+
 void scene_f_to_cairo::push_xf(const xform &xf) {
     m_xf_stack.push_back(top_xf() * xf);
     auto cm = xf_to_cairo(top_xf());
@@ -315,6 +399,13 @@ void scene_f_to_cairo::do_gouraud_triangle(const patch<3,3> &) {
 
 void scene_f_to_cairo::do_painted_shape(e_winding_rule wr,
     const shape &s, const paint &p) {
+    size_t index = m_index++;
+    if (m_cull) {
+        if (index >= m_cull->size()) return;
+        const auto &e = (*m_cull)[index];
+        if (e[2] <= m_tile[0] || e[0] >= m_tile[2] ||
+            e[3] <= m_tile[1] || e[1] >= m_tile[3]) return;
+    }
     const stroke_style *st = nullptr;
     float w = 0.f;
     xform pre_xf;
@@ -331,6 +422,16 @@ void scene_f_to_cairo::do_painted_shape(e_winding_rule wr,
         path_shape = s.as_path_data_ptr(top_xf());
     }
 
+    if (m_extents) {
+        set_path(*path_shape, pre_xf);
+        if (st) {
+            set_stroke_style(w, *st);
+        }
+        m_extents->push_back(get_device_extents(st != nullptr));
+        cairo_new_path(m_cr);
+        pop_xf();
+        return;
+    }
     auto pattern = paint_to_cairo_pattern(p, s.get_xf().inverse().transformed(pre_xf));
     cairo_set_source(m_cr, pattern);
     set_path(*path_shape, pre_xf);
@@ -393,7 +494,7 @@ void scene_f_to_cairo::do_end_transform(uint16_t depth, const xform &xf) {
 }
 
 const accelerated accelerate(const scene &c, const window &w,
-    const viewport &v) {
+    const viewport &v, const std::vector<std::string> &args) {
     int xl, yb, xr, yt;
     std::tie(xl, yb) = v.bl();
     std::tie(xr, yt) = v.tr();
@@ -401,13 +502,17 @@ const accelerated accelerate(const scene &c, const window &w,
         scaled(1,-1).translated(0,static_cast<rvgf>(yt));
     xform screen_xf = flip * c.get_xf().windowviewport(w, v).translated(-xl, yb);
 
+    // Tiled rendering replays the scene, so it needs no recording
+    if (render_tile_size_option(args) > 0) {
+        return accelerated{nullptr, c, screen_xf};
+    }
     cairo_surface_t *surface = cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, nullptr);
     cairo_t *cr = cairo_create(surface);
     scene_f_to_cairo cs(screen_xf, cr);
     c.get_scene_data().iterate(cs);
     cairo_surface_flush(surface);
     cairo_destroy(cr);
-    return surface;
+    return accelerated{surface, c, screen_xf};
 }
 
 static cairo_status_t write_fn(void *closure, const unsigned char *data,
@@ -418,31 +523,122 @@ static cairo_status_t write_fn(void *closure, const unsigned char *data,
         return CAIRO_STATUS_WRITE_ERROR;
 }
 
-static bool opt_no_output(const std::vector<std::string> &args) {
-    for (const auto &s : args)
-        if (s.compare("-no-output") == 0) return true;
+// Converts a row of premultiplied ARGB32 pixels to RGBA, the way cairo
+// does it when writing PNGs
+static void unpremultiply_row(const unsigned char *in, int width,
+    uint8_t *out) {
+    for (int x = 0; x < width; ++x) {
+        uint32_t p;
+        memcpy(&p, in + 4*x, sizeof(p));
+        uint32_t alpha = p >> 24;
+        uint8_t *q = out + 4*x;
+        if (alpha == 0) {
+            q[0] = q[1] = q[2] = q[3] = 0;
+        } else {
+            auto unpremultiply = [alpha](uint32_t c) {
+                return static_cast<uint8_t>(((c & 0xff)*255 + alpha/2)/alpha);
+            };
+            q[0] = unpremultiply(p >> 16);
+            q[1] = unpremultiply(p >> 8);
+            q[2] = unpremultiply(p);
+            q[3] = static_cast<uint8_t>(alpha);
+        }
+    }
+}
 
-    return false;
+// Splits the image into bands of tiles, each band as many tile rows
+// tall as there are threads. All tiles in a band render in parallel,
+// each with its own context drawing into the tile's rectangle of the
+// band, which also clips it. Shapes whose extents miss the tile are
+// culled before their paths are built. Each band is streamed to out,
+// unless it is null, before the next one is rendered.
+static void render_bands(const accelerated &a, int width, int height,
+    int tile_size, int threads, FILE *out) {
+    // Measure all painted shapes once, on a single thread
+    std::vector<bbox<double>> extents;
+    {
+        cairo_surface_t *scratch = cairo_image_surface_create(
+            CAIRO_FORMAT_A8, 1, 1);
+        cairo_t *cr = cairo_create(scratch);
+        scene_f_to_cairo cs(a.get_screen_xf(), cr, &extents);
+        a.get_scene().get_scene_data().iterate(cs);
+        cairo_destroy(cr);
+        cairo_surface_destroy(scratch);
+    }
+    png_stream_writer writer;
+    if (out && !writer.open(out, width, height, 4, 8)) {
+        return;
+    }
+    int nx = (width+tile_size-1)/tile_size;
+    int band_height = std::min(threads*tile_size, height);
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+    std::vector<unsigned char> band(static_cast<size_t>(stride)*band_height);
+    unsigned char *data = band.data();
+    std::vector<uint8_t> row(4*static_cast<size_t>(width));
+    for (int y0 = 0; y0 < height; y0 += band_height) {
+        int bh = std::min(band_height, height-y0);
+        int ny = (bh+tile_size-1)/tile_size;
+        std::fill(band.begin(), band.end(), 0);
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for (int i = 0; i < nx*ny; ++i) {
+            int x0 = (i%nx)*tile_size;
+            int ty = (i/nx)*tile_size;
+            int tw = std::min(tile_size, width-x0);
+            int th = std::min(tile_size, bh-ty);
+            cairo_surface_t *tile = cairo_image_surface_create_for_data(
+                data + static_cast<size_t>(stride)*ty + 4*x0,
+                CAIRO_FORMAT_ARGB32, tw, th, stride);
+            cairo_t *cr = cairo_create(tile);
+            scene_f_to_cairo cs(a.get_screen_xf().translated(-x0, -(y0+ty)),
+                cr, extents, bbox<double>(x0, y0+ty, x0+tw, y0+ty+th));
+            a.get_scene().get_scene_data().iterate(cs);
+            cairo_destroy(cr);
+            cairo_surface_flush(tile);
+            cairo_surface_destroy(tile);
+        }
+        if (out) {
+            for (int y = 0; y < bh; ++y) {
+                unpremultiply_row(data + y*stride, width, row.data());
+                writer.write_row(row.data());
+            }
+        }
+    }
+    if (out) {
+        writer.close();
+    }
 }
 
 void render(const accelerated &a, const window &w, const viewport &v,
     FILE *out, const std::vector<std::string> &args) {
-    (void) args;
     (void) w;
     int xl, yb, xr, yt;
     std::tie(xl, yb) = v.bl();
     std::tie(xr, yt) = v.tr();
 
+    // Tiled rendering is enabled by -tile, -tile:<size>, or -threads:<n>
+    int tile_size = render_tile_size_option(args);
+    if (tile_size > 0) {
+        render_bands(a, std::abs(xl-xr), std::abs(yt-yb), tile_size,
+            threads_option(args),
+            has_option(args, "-no-output")? nullptr: out);
+        return;
+    }
 
     cairo_surface_t *surface = (cairo_surface_t *)
         cairo_image_surface_create(CAIRO_FORMAT_ARGB32, std::fabs(xl-xr),
             std::fabs(yt-yb));
     cairo_t *cr = cairo_create(surface);
-    cairo_set_source_surface(cr, a.get_surface(), 0., 0.);
-    cairo_paint(cr);
+    if (a.get_surface()) {
+        cairo_set_source_surface(cr, a.get_surface(), 0., 0.);
+        cairo_paint(cr);
+    } else {
+        // Accelerated for tiled rendering, so there is no recording
+        scene_f_to_cairo cs(a.get_screen_xf(), cr);
+        a.get_scene().get_scene_data().iterate(cs);
+    }
     cairo_surface_flush(surface);
 
-    if (!opt_no_output(args))
+    if (!has_option(args, "-no-output"))
         cairo_surface_write_to_png_stream(surface, write_fn, out);
 
     cairo_destroy(cr);
@@ -459,7 +655,8 @@ static int luaaccelerate(lua_State *L) {
         rvg::driver::cairo::accelerate(
             rvg_lua_check<rvg::scene>(L, 1),
             rvg_lua_check<rvg::window>(L, 2),
-            rvg_lua_check<rvg::viewport>(L, 3)));
+            rvg_lua_check<rvg::viewport>(L, 3),
+            rvg_lua_optargs(L, 4)));
     return 1;
 }
 
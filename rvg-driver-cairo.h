@@ -31,7 +31,8 @@ namespace rvg {
 class accelerated;
 
 const accelerated accelerate(const scene &c, const window &w,
-    const viewport &v);
+    const viewport &v, const std::vector<std::string> &args =
+        std::vector<std::string>());
 
 void render(const accelerated &a, const window &w, const viewport &v,
     FILE *out, const std::vector<std::string> &args =
@@ -1217,25 +1217,37 @@ void render(const accelerated &a, const window &w, const viewport &v,
     int vymax = std::max(yb,yt);
     int width = vxmax-vxmin;
     int height = vymax-vymin;
-    image<uint8_t, 4> buf;
-    buf.resize(width, height);
+    // Render bands of about a megapixel from the top down, streaming
+    // each band out before starting the next
+    int band_height = std::max(1, std::min(height,
+        (1 << 20)/std::max(width, 1)));
+    png_stream_writer writer;
+    if (!writer.open(out, width, height, 4, 8)) {
+        return;
+    }
+    packed_image<uint8_t, 4> buf;
+    for (int top = height; top > 0; top -= band_height) {
+        int bottom = std::max(0, top-band_height);
+        buf.resize(width, top-bottom);
 #pragma omp parallel for
-    for (int i = 0; i < height; ++i) {
-        rvgf y = vymin+i+0.5f;
-        for (int j = 0; j < width; ++j) {
-            rvgf x = vxmin+j+0.5f;
-			RGBA<uint16_t> sc;
-			for (int s = 0; s < n; ++s) {
-				sc += remove_gamma(
-                    post_divide(
-                        sample(a, x+ox[s], y+oy[s],
-                            make_rgba8(255, 255, 255, 255))));
-			}
-			auto c = add_gamma(RGBA8{sc/n});
-			buf.set_pixel(j, i, c[0], c[1], c[2], c[3]);
+        for (int i = bottom; i < top; ++i) {
+            rvgf y = vymin+i+0.5f;
+            for (int j = 0; j < width; ++j) {
+                rvgf x = vxmin+j+0.5f;
+                RGBA<uint16_t> sc;
+                for (int s = 0; s < n; ++s) {
+                    sc += remove_gamma(
+                        post_divide(
+                            sample(a, x+ox[s], y+oy[s],
+                                make_rgba8(255, 255, 255, 255))));
+                }
+                auto c = add_gamma(RGBA8{sc/n});
+                buf.set_pixel(j, i-bottom, c[0], c[1], c[2], c[3]);
+            }
         }
+        writer.write_band(buf);
     }
-    store_png<uint8_t>(out, buf);
+    writer.close();
 }
 
 } } } // namespace rvg::driver::distroke
@@ -1280,5 +1292,7 @@ int luaopen_driver_distroke(lua_State *L) {
     rvg_lua_createtype<accelerated>(L, "distroke accelerated", -1);
     // mettab
     rvg_lua_facade_new_driver(L, moddistroke); // mettab driver
+    lua_pushinteger(L, version); // mettab driver version
+    lua_setfield(L, -2, "version"); // mettab driver
     return 1;
 }
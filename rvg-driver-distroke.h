@@ -152,6 +152,11 @@ private:
 
 };
 
+// Identifies the output of render. Bump it whenever a change to the
+// renderer changes the images it produces, so cached renders are
+// discarded
+constexpr int version = 1;
+
 accelerated accelerate(const scene &c, const window &w, const viewport &v);
 
 void render(const accelerated &a, const window &w, const viewport &v,
@@ -13,12 +13,12 @@
 //
 // Contact information: diego.nehab@gmail.com
 //
-#include <sstream>
-
 #include "rvg-lua.h"
 
 #include "rvg-xform.h"
 #include "rvg-input-path-f-xform.h"
+#include "rvg-number-format.h"
+#include "rvg-file-ostream.h"
 
 #include "rvg-lua-facade.h"
 
@@ -333,7 +333,7 @@ const scene &accelerate(const scene &c, const window &w,
 
 void render(const scene &c, const window &w, const viewport &v,
     std::ostream &out, const std::vector<std::string> &args) {
-    (void) args;
+    auto loc = imbue_number_format(out, get_number_format_precision(args));
     auto screen_xf = make_windowviewport(w, v)*c.get_xf();
     scene_f_print_eps sp(screen_xf, out);
     out << "%!PS-Adobe-3.0 EPSF-3.0\n";
@@ -342,6 +342,7 @@ void render(const scene &c, const window &w, const viewport &v,
                                 bb[2] << ' ' << bb[3] << '\n';
     print_xform(screen_xf, out);
     c.get_scene_data().iterate(sp);
+    out.imbue(loc);
 }
 
 } } } // namespace rvg::driver::cpp
@@ -359,10 +360,8 @@ static int luarender(lua_State *L) {
     auto c = rvg_lua_check<rvg::scene>(L, 1);
     auto w = rvg_lua_check<rvg::window>(L, 2);
     auto v = rvg_lua_check<rvg::viewport>(L, 3);
-    FILE *f = rvg_lua_check_file(L, 4);
-    std::ostringstream sout;
-    rvg::driver::eps::render(c, w, v, sout);
-    fwrite(sout.str().data(), 1, sout.str().size(), f);
+    rvg::file_ostream out(rvg_lua_check_file(L, 4));
+    rvg::driver::eps::render(c, w, v, out, rvg_lua_optargs(L, 5));
     return 0;
 }
 
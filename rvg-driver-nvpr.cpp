@@ -527,12 +527,12 @@ void render(const scene &c, const window &w, const viewport &v,
     c.get_scene_data().iterate(nvpr_scene);
     glPopMatrix();
     glFlush();
-    std::vector<uint8_t> data(width*height*4);
+    // Both OpenGL and images keep rows bottom to top
+    packed_image<uint8_t, 4> buf;
+    buf.resize(width, height);
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &data[0]);
-    image<uint8_t, 4> buf;
-    buf.load_from(width, width, height, 4*width, 4, &data[0], &data[1],
-        &data[2], &data[3]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+        buf.get_row(0));
     store_png<uint8_t>(out, buf);
 	// 7. Terminate EGL when finished
 	eglTerminate(egl_dpy);
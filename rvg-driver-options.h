@@ -0,0 +1,101 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_DRIVER_OPTIONS_H
+#define RVG_DRIVER_OPTIONS_H
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Parsing of the options that process.lua passes on to the drivers
+
+namespace rvg {
+    namespace driver {
+
+// Returns true if args contain the option name
+static inline bool has_option(const std::vector<std::string> &args,
+    const char *name) {
+    for (const auto &s : args) {
+        if (s.compare(name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the value of the last option in args that matches format,
+// which must be of the form "-<name>:%d%n", if the value is positive.
+// Otherwise, returns 0.
+static inline int positive_option(const std::vector<std::string> &args,
+    const char *format) {
+    int value = 0;
+    for (const auto &s : args) {
+        int n = 0, end = 0;
+        if (sscanf(s.c_str(), format, &n, &end) == 1 && s[end] == 0 &&
+            n > 0) {
+            value = n;
+        }
+    }
+    return value;
+}
+
+// Returns the tile size given by the last of -tile:<size> and -tile,
+// which stands for 256, or 0 if there is neither
+static inline int tile_size_option(const std::vector<std::string> &args) {
+    int size = 0;
+    for (const auto &s : args) {
+        int value = 0, end = 0;
+        if (s.compare("-tile") == 0) {
+            size = 256;
+        } else if (sscanf(s.c_str(), "-tile:%d%n", &value, &end) == 1 &&
+            s[end] == 0 && value > 0) {
+            size = value;
+        }
+    }
+    return size;
+}
+
+// Returns the tile size for drivers that render in tiles, where
+// -threads:<n> alone turns tiling on with the default size
+static inline int render_tile_size_option(
+    const std::vector<std::string> &args) {
+    int size = tile_size_option(args);
+    if (size == 0 && positive_option(args, "-threads:%d%n") > 0) {
+        size = 256;
+    }
+    return size;
+}
+
+// Returns the thread count given by -threads:<n>, or the OpenMP
+// default if there is none
+static inline int threads_option(const std::vector<std::string> &args) {
+    int threads = positive_option(args, "-threads:%d%n");
+#ifdef _OPENMP
+    if (threads <= 0) {
+        threads = omp_get_max_threads();
+    }
+#endif
+    return std::max(threads, 1);
+}
+
+} } // namespace rvg::driver
+
+#endif
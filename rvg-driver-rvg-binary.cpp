@@ -0,0 +1,96 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cstdio>
+
+#include "rvg-lua.h"
+#include "rvg-lua-facade.h"
+#include "rvg-scene-f-write-binary.h"
+#include "rvg-file-ostream.h"
+#include "rvg-driver-rvg-binary.h"
+
+namespace rvg {
+    namespace driver {
+        namespace rvg_binary {
+
+const scene &accelerate(const scene &c, const window &w,
+    const viewport &v) {
+    (void) w;
+    (void) v;
+    return c;
+}
+
+// Returns the bits per coordinate given by -compact:<bits>, 16 for
+// -compact, or 0 for full precision
+static int opt_compact_bits(const std::vector<std::string> &args) {
+    int bits = 0;
+    for (const auto &s : args) {
+        int value = 0, end = 0;
+        if (s.compare("-compact") == 0) {
+            bits = 16;
+        } else if (sscanf(s.c_str(), "-compact:%d%n", &value, &end) == 1 &&
+            s[end] == 0 && (value == 16 || value == 24)) {
+            bits = value;
+        }
+    }
+    return bits;
+}
+
+void render(const scene &c, const window &w, const viewport &v,
+    std::ostream &out, const std::vector<std::string> &args) {
+    auto wb = make_scene_f_write_binary(out, opt_compact_bits(args));
+    wb.frame(c.get_xf(), c.get_background_color(), w, v);
+    c.get_scene_data().iterate(wb);
+    wb.end();
+}
+
+} } } // namespace rvg::driver::rvg_binary
+
+// Lua version of the accelerate function.
+// Since there is no acceleration, we simply
+// and return the input scene unmodified.
+static int luaaccelerate(lua_State *L) {
+    lua_settop(L, 1);
+    return 1;
+}
+
+// Lua version of render function
+static int luarender(lua_State *L) {
+    auto c = rvg_lua_check<rvg::scene>(L, 1);
+    auto w = rvg_lua_check<rvg::window>(L, 2);
+    auto v = rvg_lua_check<rvg::viewport>(L, 3);
+    rvg::file_ostream out(rvg_lua_check_file(L, 4));
+    rvg::driver::rvg_binary::render(c, w, v, out, rvg_lua_optargs(L, 5));
+    return 0;
+}
+
+// List of Lua functions exported into driver table
+static const luaL_Reg modrvgbinary[] = {
+    {"render", luarender },
+    {"accelerate", luaaccelerate },
+    {NULL, NULL}
+};
+
+// Lua function invoked to be invoked by require"driver.cpp"
+extern "C"
+#ifndef _WIN32
+__attribute__((visibility("default")))
+#else
+__declspec(dllexport)
+#endif
+int luaopen_driver_rvg_binary(lua_State *L) {
+    rvg_lua_facade_new_driver(L, modrvgbinary);
+    return 1;
+}
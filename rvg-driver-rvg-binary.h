@@ -0,0 +1,39 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_DRIVER_RVG_BINARY_H
+#define RVG_DRIVER_RVG_BINARY_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "rvg-window.h"
+#include "rvg-viewport.h"
+#include "rvg-scene.h"
+
+namespace rvg {
+    namespace driver {
+        namespace rvg_binary {
+
+const scene &accelerate(const scene &c, const window &w, const viewport &v);
+
+void render(const scene &c, const window &w, const viewport &v,
+    std::ostream &out, const std::vector<std::string> &args =
+        std::vector<std::string>());
+
+} } } // namespace rvg::driver::rvg_binary
+
+#endif
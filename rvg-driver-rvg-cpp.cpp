@@ -13,11 +13,11 @@
 //
 // Contact information: diego.nehab@gmail.com
 //
-#include <sstream>
-
 #include "rvg-lua.h"
 #include "rvg-lua-facade.h"
 #include "rvg-scene-f-print-rvg.h"
+#include "rvg-number-format.h"
+#include "rvg-file-ostream.h"
 #include "rvg-driver-rvg-cpp.h"
 
 namespace rvg {
@@ -31,16 +31,17 @@ const scene &accelerate(const scene &c, const viewport &vp) {
 
 void render(const scene &c, const window &w, const viewport &v,
     std::ostream &out, const std::vector<std::string> &args) {
+    auto loc = imbue_number_format(out, get_number_format_precision(args));
     auto sp = make_scene_f_print_rvg_cpp(out);
     out << "// Automatically generated. Do not modify.";
     out << "\n#include \"rvg-facade.h\"";
     out << "\nauto ";
     const char *name = "load";
     int begin = 0, end = 0;
-	if (!args.empty()) {
-        sscanf(args[0].c_str(), "-name:%n%*s%n", &begin, &end);
-        if (begin > 0 && end > begin && args[0][end] == 0) {
-            name = args[0].c_str()+begin;
+    for (const auto &arg: args) {
+        sscanf(arg.c_str(), "-name:%n%*s%n", &begin, &end);
+        if (begin > 0 && end > begin && arg[end] == 0) {
+            name = arg.c_str()+begin;
         }
     }
 	out << name << "(void) {";
@@ -55,6 +56,7 @@ void render(const scene &c, const window &w, const viewport &v,
     out << "\n  auto v = viewport(" << vcor[0] << ',' << vcor[1] << ',' << vcor[2] << ',' << vcor[3] << ");";
     out << "\n  return rvg_facade::description{c, w, v};";
     out << "\n}\n";
+    out.imbue(loc);
 }
 
 } } } // namespace rvg::driver::rvg_cpp
@@ -72,11 +74,8 @@ static int luarender(lua_State *L) {
     auto c = rvg_lua_check<rvg::scene>(L, 1);
     auto w = rvg_lua_check<rvg::window>(L, 2);
     auto v = rvg_lua_check<rvg::viewport>(L, 3);
-    FILE *f = rvg_lua_check_file(L, 4);
-    auto args = rvg_lua_optargs(L, 5);
-    std::ostringstream sout;
-    rvg::driver::rvg_cpp::render(c, w, v, sout, args);
-    fwrite(sout.str().data(), 1, sout.str().size(), f);
+    rvg::file_ostream out(rvg_lua_check_file(L, 4));
+    rvg::driver::rvg_cpp::render(c, w, v, out, rvg_lua_optargs(L, 5));
     return 0;
 }
 
@@ -13,11 +13,11 @@
 //
 // Contact information: diego.nehab@gmail.com
 //
-#include <sstream>
-
 #include "rvg-lua.h"
 #include "rvg-lua-facade.h"
 #include "rvg-scene-f-print-rvg.h"
+#include "rvg-number-format.h"
+#include "rvg-file-ostream.h"
 #include "rvg-driver-rvg-lua.h"
 
 namespace rvg {
@@ -33,7 +33,7 @@ const scene &accelerate(const scene &c, const window &w,
 
 void render(const scene &c, const window &w, const viewport &v,
     std::ostream &out, const std::vector<std::string> &args) {
-    (void) args;
+    auto loc = imbue_number_format(out, get_number_format_precision(args));
     auto sp = make_scene_f_print_rvg_lua(out);
     out << "local rvg = {}";
     out << "\n\nrvg.scene = scene({";
@@ -46,6 +46,7 @@ void render(const scene &c, const window &w, const viewport &v,
     out << "\n\nrvg.viewport = viewport(" << vcor[0] << ',' << vcor[1] << ',' << vcor[2] << ',' << vcor[3] << ")";
     out << "\n\nreturn rvg";
     out << "\n";
+    out.imbue(loc);
 }
 
 } } } // namespace rvg::driver::rvg_lua
@@ -63,10 +64,8 @@ static int luarender(lua_State *L) {
     auto c = rvg_lua_check<rvg::scene>(L, 1);
     auto w = rvg_lua_check<rvg::window>(L, 2);
     auto v = rvg_lua_check<rvg::viewport>(L, 3);
-    FILE *f = rvg_lua_check_file(L, 4);
-    std::ostringstream sout;
-    rvg::driver::rvg_lua::render(c, w, v, sout);
-    fwrite(sout.str().data(), 1, sout.str().size(), f);
+    rvg::file_ostream out(rvg_lua_check_file(L, 4));
+    rvg::driver::rvg_lua::render(c, w, v, out, rvg_lua_optargs(L, 5));
     return 0;
 }
 
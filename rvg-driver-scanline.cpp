@@ -0,0 +1,960 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rvg-lua.h"
+
+#include "rvg-i-input-path.h"
+#include "rvg-i-scene-data.h"
+#include "rvg-input-path-f-xform.h"
+#include "rvg-image.h"
+#include "rvg-pngio.h"
+#include "rvg-rgba.h"
+
+#include "rvg-lua-facade.h"
+
+#include "rvg-driver-scanline.h"
+
+// Flattening tolerance, in pixels
+#define RVG_SCANLINE_FLATTENING_TOLERANCE (0.25f)
+
+// Entries in the lookup table of each color ramp
+#define RVG_SCANLINE_RAMP_SIZE (1024)
+
+// A row is swept densely when it has at least one cell for every this
+// many pixels between its first and last cell
+#define RVG_SCANLINE_DENSE_ROW (4)
+
+namespace rvg {
+    namespace driver {
+        namespace scanline {
+
+// Converts curves to line segments in screen coordinates, and closes
+// every contour. The number of segments is chosen so the polyline stays
+// within the flattening tolerance of the curve.
+class input_path_f_flatten final: public i_input_path<input_path_f_flatten> {
+
+    std::vector<rvgf> &m_edges;
+    rvgf m_tolerance;
+    rvgf m_x0, m_y0; // start of current contour
+    rvgf m_xc, m_yc; // current point
+    bool m_in_contour;
+
+public:
+
+    input_path_f_flatten(rvgf tolerance, std::vector<rvgf> &edges):
+        m_edges(edges),
+        m_tolerance(tolerance),
+        m_x0(0), m_y0(0),
+        m_xc(0), m_yc(0),
+        m_in_contour(false) {
+        ;
+    }
+
+    void finish(void) {
+        close();
+    }
+
+private:
+
+    void line(rvgf x1, rvgf y1) {
+        if (x1 != m_xc || y1 != m_yc) {
+            m_edges.insert(m_edges.end(), {m_xc, m_yc, x1, y1});
+            m_xc = x1;
+            m_yc = y1;
+        }
+    }
+
+    void close(void) {
+        if (m_in_contour) {
+            line(m_x0, m_y0);
+            m_in_contour = false;
+        }
+    }
+
+    static int segments(rvgf deviation, rvgf tolerance) {
+        rvgf n = std::ceil(std::sqrt(deviation/tolerance));
+        return static_cast<int>(std::min(std::max(n, rvgf{1}), rvgf{1024}));
+    }
+
+    // Subdivides the conic at t = 1/2 until the middle of each piece is
+    // within the tolerance of its chord. (x1, y1) are homogeneous.
+    void conic(rvgf x0, rvgf y0, rvgf x1, rvgf y1, rvgf w1,
+        rvgf x2, rvgf y2, int depth) {
+        if (w1 <= rvgf{-1} || !std::isfinite(w1)) {
+            line(x2, y2);
+            return;
+        }
+        rvgf s = rvgf{1}+w1;
+        rvgf mx = (x0+rvgf{2}*x1+x2)/(rvgf{2}*s);
+        rvgf my = (y0+rvgf{2}*y1+y2)/(rvgf{2}*s);
+        rvgf dx = mx-rvgf{.5}*(x0+x2), dy = my-rvgf{.5}*(y0+y2);
+        if (depth >= 16 || (w1 > 0 && dx*dx+dy*dy <= m_tolerance*m_tolerance)) {
+            line(mx, my);
+            line(x2, y2);
+            return;
+        }
+        rvgf w = std::sqrt(rvgf{.5}*s);
+        conic(x0, y0, w*(x0+x1)/s, w*(y0+y1)/s, w, mx, my, depth+1);
+        conic(mx, my, w*(x1+x2)/s, w*(y1+y2)/s, w, x2, y2, depth+1);
+    }
+
+friend i_input_path<input_path_f_flatten>;
+
+    void do_begin_contour(rvgf x0, rvgf y0) {
+        close();
+        m_x0 = m_xc = x0;
+        m_y0 = m_yc = y0;
+        m_in_contour = true;
+    }
+
+    void do_end_open_contour(rvgf, rvgf) {
+        close();
+    }
+
+    void do_end_closed_contour(rvgf, rvgf) {
+        close();
+    }
+
+    void do_linear_segment(rvgf, rvgf, rvgf x1, rvgf y1) {
+        line(x1, y1);
+    }
+
+    void do_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2) {
+        // Deviation from n chords is |p0-2p1+p2|/(4n^2)
+        rvgf ddx = x0-rvgf{2}*x1+x2, ddy = y0-rvgf{2}*y1+y2;
+        int n = segments(std::hypot(ddx, ddy), rvgf{4}*m_tolerance);
+        for (int i = 1; i < n; ++i) {
+            rvgf t = static_cast<rvgf>(i)/static_cast<rvgf>(n), s = rvgf{1}-t;
+            line(s*s*x0+rvgf{2}*s*t*x1+t*t*x2, s*s*y0+rvgf{2}*s*t*y1+t*t*y2);
+        }
+        line(x2, y2);
+    }
+
+    void do_rational_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf w1, rvgf x2, rvgf y2) {
+        conic(x0, y0, x1, y1, w1, x2, y2, 0);
+    }
+
+    void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+        // Deviation from n chords is at most 3M/(4n^2), where M is the
+        // largest second difference of the control points
+        rvgf m = std::max(
+            std::hypot(x0-rvgf{2}*x1+x2, y0-rvgf{2}*y1+y2),
+            std::hypot(x1-rvgf{2}*x2+x3, y1-rvgf{2}*y2+y3));
+        int n = segments(rvgf{3}*m, rvgf{4}*m_tolerance);
+        for (int i = 1; i < n; ++i) {
+            rvgf t = static_cast<rvgf>(i)/static_cast<rvgf>(n), s = rvgf{1}-t;
+            rvgf a = s*s*s, b = rvgf{3}*s*s*t, c = rvgf{3}*s*t*t, d = t*t*t;
+            line(a*x0+b*x1+c*x2+d*x3, a*y0+b*y1+c*y2+d*y3);
+        }
+        line(x3, y3);
+    }
+};
+
+// Evaluates a paint at pixel centers and composites it onto a row of
+// premultiplied RGBA pixels
+class paint_sampler {
+
+    paint::e_type m_type;
+    float m_color[4];
+    xform m_inverse;
+    e_spread m_spread;
+    std::vector<float> m_ramp;
+    float m_x1, m_y1, m_dx, m_dy, m_inv_len2; // linear
+    float m_cx, m_cy, m_fx, m_fy, m_r;        // radial
+
+public:
+
+    paint_sampler(const paint &p, const xform &screen_xf):
+        m_type(p.get_type()),
+        m_color{0.f, 0.f, 0.f, 0.f},
+        m_spread(e_spread::clamp),
+        m_x1(0), m_y1(0), m_dx(0), m_dy(0), m_inv_len2(0),
+        m_cx(0), m_cy(0), m_fx(0), m_fy(0), m_r(0) {
+        float opacity = static_cast<float>(p.get_opacity())/255.f;
+        switch (m_type) {
+            case paint::e_type::solid_color:
+                premultiply(p.get_solid_color(), opacity, m_color);
+                break;
+            case paint::e_type::linear_gradient: {
+                const auto &lg = p.get_linear_gradient_data();
+                set_ramp(lg.get_color_ramp(), opacity);
+                m_x1 = lg.get_x1();
+                m_y1 = lg.get_y1();
+                m_dx = lg.get_x2()-m_x1;
+                m_dy = lg.get_y2()-m_y1;
+                float len2 = m_dx*m_dx+m_dy*m_dy;
+                m_inv_len2 = len2 > 0.f? 1.f/len2: 0.f;
+                break;
+            }
+            case paint::e_type::radial_gradient: {
+                const auto &rg = p.get_radial_gradient_data();
+                set_ramp(rg.get_color_ramp(), opacity);
+                m_cx = rg.get_cx();
+                m_cy = rg.get_cy();
+                m_fx = rg.get_fx();
+                m_fy = rg.get_fy();
+                m_r = rg.get_r();
+                break;
+            }
+            default:
+                // Textures are not supported
+                m_type = paint::e_type::empty;
+                break;
+        }
+        m_inverse = p.get_xf().transformed(screen_xf).inverse();
+    }
+
+    bool is_empty(void) const {
+        return m_type == paint::e_type::empty ||
+            (m_type == paint::e_type::solid_color && m_color[3] == 0.f);
+    }
+
+    // Composites n pixels starting at x, all with the same coverage
+    void composite(float *row, int x, int y, int n, float coverage,
+        std::vector<float> &scratch) const {
+        float *d = row + 4*x;
+        if (m_type == paint::e_type::solid_color) {
+            float r = coverage*m_color[0], g = coverage*m_color[1],
+                b = coverage*m_color[2], a = coverage*m_color[3];
+            float k = 1.f-a;
+            for (int i = 0; i < n; ++i) {
+                d[4*i+0] = r + k*d[4*i+0];
+                d[4*i+1] = g + k*d[4*i+1];
+                d[4*i+2] = b + k*d[4*i+2];
+                d[4*i+3] = a + k*d[4*i+3];
+            }
+            return;
+        }
+        scratch.resize(4*static_cast<size_t>(n));
+        float *s = scratch.data();
+        sample(x, y, n, s);
+        for (int i = 0; i < n; ++i) {
+            float k = 1.f-coverage*s[4*i+3];
+            d[4*i+0] = coverage*s[4*i+0] + k*d[4*i+0];
+            d[4*i+1] = coverage*s[4*i+1] + k*d[4*i+1];
+            d[4*i+2] = coverage*s[4*i+2] + k*d[4*i+2];
+            d[4*i+3] = coverage*s[4*i+3] + k*d[4*i+3];
+        }
+    }
+
+private:
+
+    static void premultiply(RGBA8 c, float opacity, float *out) {
+        float a = opacity*static_cast<float>(c[3])/255.f;
+        out[0] = a*static_cast<float>(c[0])/255.f;
+        out[1] = a*static_cast<float>(c[1])/255.f;
+        out[2] = a*static_cast<float>(c[2])/255.f;
+        out[3] = a;
+    }
+
+    // Tabulates the ramp, interpolating unpremultiplied colors
+    void set_ramp(const color_ramp &ramp, float opacity) {
+        m_spread = ramp.get_spread();
+        const auto &stops = ramp.get_color_stops();
+        m_ramp.assign(4*(RVG_SCANLINE_RAMP_SIZE+1), 0.f);
+        if (stops.empty()) {
+            return;
+        }
+        size_t j = 0;
+        for (int i = 0; i <= RVG_SCANLINE_RAMP_SIZE; ++i) {
+            float t = static_cast<float>(i)/RVG_SCANLINE_RAMP_SIZE;
+            while (j < stops.size() && stops[j].get_offset() < t) {
+                ++j;
+            }
+            RGBA8 c;
+            if (j == 0) {
+                c = stops.front().get_color();
+            } else if (j == stops.size()) {
+                c = stops.back().get_color();
+            } else {
+                const auto &a = stops[j-1], &b = stops[j];
+                float span = b.get_offset()-a.get_offset();
+                float u = span > 0.f? (t-a.get_offset())/span: 1.f;
+                RGBA8 ca = a.get_color(), cb = b.get_color();
+                float v[4];
+                for (int k = 0; k < 4; ++k) {
+                    v[k] = (1.f-u)*static_cast<float>(ca[k]) +
+                        u*static_cast<float>(cb[k]);
+                }
+                float alpha = opacity*v[3]/255.f;
+                m_ramp[4*i+0] = alpha*v[0]/255.f;
+                m_ramp[4*i+1] = alpha*v[1]/255.f;
+                m_ramp[4*i+2] = alpha*v[2]/255.f;
+                m_ramp[4*i+3] = alpha;
+                continue;
+            }
+            premultiply(c, opacity, &m_ramp[4*i]);
+        }
+    }
+
+    // Applies the spread, returning false if the pixel is transparent
+    bool spread(float &t) const {
+        switch (m_spread) {
+            case e_spread::clamp:
+                t = std::min(std::max(t, 0.f), 1.f);
+                return true;
+            case e_spread::wrap:
+                t -= std::floor(t);
+                return true;
+            case e_spread::mirror:
+                t -= 2.f*std::floor(.5f*t);
+                if (t > 1.f) t = 2.f-t;
+                return true;
+            case e_spread::transparent:
+            default:
+                return t >= 0.f && t <= 1.f;
+        }
+    }
+
+    void sample(int x, int y, int n, float *s) const {
+        for (int i = 0; i < n; ++i, s += 4) {
+            rvgf px, py, pw;
+            std::tie(px, py, pw) = m_inverse.apply(
+                static_cast<rvgf>(x+i)+rvgf{.5}, static_cast<rvgf>(y)+rvgf{.5});
+            px /= pw;
+            py /= pw;
+            float t = 0.f;
+            bool defined = true;
+            if (m_type == paint::e_type::linear_gradient) {
+                t = ((px-m_x1)*m_dx+(py-m_y1)*m_dy)*m_inv_len2;
+            } else {
+                // Find s > 0 such that f + s (p - f) is on the circle.
+                // The pixel is at t = 1/s along the gradient
+                float dx = px-m_fx, dy = py-m_fy;
+                float ex = m_fx-m_cx, ey = m_fy-m_cy;
+                float a = dx*dx+dy*dy;
+                float b = dx*ex+dy*ey;
+                float c = ex*ex+ey*ey-m_r*m_r;
+                float disc = b*b-a*c;
+                if (a == 0.f) {
+                    t = 0.f;
+                } else if (disc < 0.f) {
+                    defined = false;
+                } else {
+                    float root = (-b+std::sqrt(disc))/a;
+                    defined = root > 0.f;
+                    t = defined? 1.f/root: 0.f;
+                }
+            }
+            if (defined && spread(t)) {
+                const float *c = &m_ramp[4*static_cast<int>(
+                    t*RVG_SCANLINE_RAMP_SIZE+.5f)];
+                s[0] = c[0]; s[1] = c[1]; s[2] = c[2]; s[3] = c[3];
+            } else {
+                s[0] = s[1] = s[2] = s[3] = 0.f;
+            }
+        }
+    }
+};
+
+// A painted shape, flattened to line segments in screen coordinates
+struct fill {
+    e_winding_rule winding_rule;
+    paint_sampler sampler;
+    std::vector<rvgf> edges; // x0 y0 x1 y1, for each segment
+};
+
+class accelerated {
+    std::shared_ptr<const std::vector<fill>> m_fills;
+    RGBA8 m_background_color;
+public:
+    accelerated(std::shared_ptr<const std::vector<fill>> fills,
+        RGBA8 background_color):
+        m_fills(fills),
+        m_background_color(background_color) { ; }
+    const std::vector<fill> &get_fills(void) const { return *m_fills; }
+    RGBA8 get_background_color(void) const { return m_background_color; }
+};
+
+// Computes exact area coverage with a sparse scanline accumulator, in
+// the style of FreeType and AGG. Each segment is clipped to the
+// viewport and walked across the pixel grid in fixed point. Every pixel
+// it touches receives a cell with the signed height of the segment
+// inside the pixel (cover) and twice the signed area to the right of
+// the segment (area). Cells are bucketed by row and sorted by column,
+// and a sweep turns their running sum into coverage. Only pixels
+// crossed by an edge are stored; the spans between them have constant
+// coverage.
+class rasterizer {
+
+    enum {
+        subpixel_shift = 8,
+        subpixel_scale = 1 << subpixel_shift,
+        subpixel_mask = subpixel_scale - 1
+    };
+
+    struct cell {
+        int x, y, cover, area;
+    };
+
+    int m_width, m_height;
+    std::vector<cell> m_cells;
+    std::vector<cell> m_sorted;
+    std::vector<int> m_row_start;
+    std::vector<int> m_cover, m_area, m_alpha;
+    cell m_curr;
+    int m_ymin, m_ymax;
+
+public:
+
+    rasterizer(int width, int height):
+        m_width(width),
+        m_height(height),
+        m_curr{0, 0, 0, 0},
+        m_ymin(height),
+        m_ymax(-1) {
+        ;
+    }
+
+    void reset(void) {
+        m_cells.clear();
+        m_curr = cell{0, 0, 0, 0};
+        m_ymin = m_height;
+        m_ymax = -1;
+    }
+
+    // Adds a segment in pixel coordinates
+    void add_edge(rvgf x0, rvgf y0, rvgf x1, rvgf y1) {
+        // Clip in y. Parts above and below the viewport do not
+        // contribute to any row
+        rvgf h = static_cast<rvgf>(m_height);
+        if ((y0 <= 0 && y1 <= 0) || (y0 >= h && y1 >= h) || y0 == y1 ||
+            !std::isfinite(x0+y0+x1+y1)) {
+            return;
+        }
+        auto x_at = [&](rvgf y) {
+            return x0+(x1-x0)*((y-y0)/(y1-y0));
+        };
+        rvgf ya = y0, xa = x0, yb = y1, xb = x1;
+        if (ya < 0) { xa = x_at(0); ya = 0; }
+        if (ya > h) { xa = x_at(h); ya = h; }
+        if (yb < 0) { xb = x_at(0); yb = 0; }
+        if (yb > h) { xb = x_at(h); yb = h; }
+        // Clip in x. Coverage accumulates from left to right, so parts
+        // to the right of the viewport can be dropped, and parts to the
+        // left become vertical segments on its left border
+        rvgf w = static_cast<rvgf>(m_width);
+        rvgf ts[4] = {0, 1, 0, 1};
+        int nt = 1;
+        if (xa != xb) {
+            for (rvgf bx: {rvgf{0}, w}) {
+                rvgf t = (bx-xa)/(xb-xa);
+                if (t > 0 && t < 1) {
+                    ts[nt++] = t;
+                }
+            }
+        }
+        ts[nt++] = 1;
+        // At most two interior crossings
+        if (nt == 4 && ts[2] < ts[1]) {
+            std::swap(ts[1], ts[2]);
+        }
+        for (int i = 0; i+1 < nt; ++i) {
+            rvgf ta = ts[i], tb = ts[i+1];
+            rvgf pxa = xa+(xb-xa)*ta, pya = ya+(yb-ya)*ta;
+            rvgf pxb = xa+(xb-xa)*tb, pyb = ya+(yb-ya)*tb;
+            if (i == 0) { pxa = xa; pya = ya; }
+            if (i+2 == nt) { pxb = xb; pyb = yb; }
+            rvgf mx = rvgf{.5}*(pxa+pxb);
+            if (mx >= w) {
+                continue;
+            }
+            if (mx <= 0) {
+                pxa = pxb = 0;
+            }
+            pxa = std::min(std::max(pxa, rvgf{0}), w);
+            pxb = std::min(std::max(pxb, rvgf{0}), w);
+            render_line(to_subpixel(pxa), to_subpixel(pya),
+                to_subpixel(pxb), to_subpixel(pyb));
+        }
+    }
+
+    // Calls span(x, y, n, alpha) for each run of pixels with the same
+    // nonzero coverage, with alpha between 1 and 255
+    template <typename SPAN>
+    void sweep(e_winding_rule rule, SPAN &&span) {
+        add_curr_cell();
+        sort_cells();
+        bool complement = rule == e_winding_rule::zero ||
+            rule == e_winding_rule::even;
+        bool odd = rule == e_winding_rule::odd ||
+            rule == e_winding_rule::even;
+        int ybegin = complement? 0: m_ymin;
+        int yend = complement? m_height: m_ymax+1;
+        auto emit = [&](int x, int y, int n, int area) {
+            int alpha = coverage(area, odd, complement);
+            if (alpha > 0 && n > 0) {
+                span(x, y, n, alpha);
+            }
+        };
+        for (int y = ybegin; y < yend; ++y) {
+            int x = 0, cover = 0;
+            if (y >= m_ymin && y <= m_ymax) {
+                const cell *c = m_sorted.data() + m_row_start[y-m_ymin];
+                const cell *end = m_sorted.data() + m_row_start[y-m_ymin+1];
+                while (end != c && (end-1)->x >= m_width) {
+                    --end;
+                }
+                if (c != end && RVG_SCANLINE_DENSE_ROW*(end-c) >=
+                        (end-1)->x+1-c->x) {
+                    emit(0, y, c->x, 0);
+                    x = sweep_dense_row(c, end, y, odd, complement, cover,
+                        span);
+                }
+                while (c != end) {
+                    int cx = c->x, area = 0, cell_cover = 0;
+                    do {
+                        area += c->area;
+                        cell_cover += c->cover;
+                        ++c;
+                    } while (c != end && c->x == cx);
+                    emit(x, y, cx-x, cover << (subpixel_shift+1));
+                    cover += cell_cover;
+                    emit(cx, y, 1, (cover << (subpixel_shift+1)) - area);
+                    x = cx+1;
+                }
+            }
+            emit(x, y, m_width-x, cover << (subpixel_shift+1));
+        }
+    }
+
+private:
+
+    // Rows where cells cover a large fraction of the pixels between the
+    // first and last cell are scattered into per-pixel accumulators, so
+    // the coverage of the whole run is converted in one vectorizable
+    // loop. Returns the column after the last cell
+    template <typename SPAN>
+    int sweep_dense_row(const cell *&c, const cell *end, int y, bool odd,
+        bool complement, int &cover, SPAN &&span) {
+        int xa = c->x, n = (end-1)->x+1-xa;
+        m_cover.assign(static_cast<size_t>(n), 0);
+        m_area.assign(static_cast<size_t>(n), 0);
+        m_alpha.resize(static_cast<size_t>(n));
+        int *cv = m_cover.data(), *ar = m_area.data(), *al = m_alpha.data();
+        for ( ; c != end; ++c) {
+            cv[c->x-xa] += c->cover;
+            ar[c->x-xa] += c->area;
+        }
+        for (int i = 0; i < n; ++i) {
+            cover += cv[i];
+            cv[i] = cover;
+        }
+        int fold = odd? 511: -1, flip = complement? 255: 0;
+#pragma omp simd
+        for (int i = 0; i < n; ++i) {
+            int a = ((cv[i] << (subpixel_shift+1)) - ar[i]) >>
+                (2*subpixel_shift + 1 - 8);
+            a = a < 0? -a: a;
+            a &= fold;
+            a = a > 256 && odd? 512-a: a;
+            a = a > 255? 255: a;
+            al[i] = a ^ flip;
+        }
+        for (int i = 0; i < n; ) {
+            int j = i+1;
+            while (j < n && al[j] == al[i]) {
+                ++j;
+            }
+            if (al[i] > 0) {
+                span(xa+i, y, j-i, al[i]);
+            }
+            i = j;
+        }
+        return xa+n;
+    }
+
+    static int to_subpixel(rvgf v) {
+        return static_cast<int>(std::lround(v*subpixel_scale));
+    }
+
+    static int coverage(int area, bool odd, bool complement) {
+        int c = area >> (2*subpixel_shift + 1 - 8);
+        if (c < 0) c = -c;
+        if (odd) {
+            c &= 511;
+            if (c > 256) c = 512 - c;
+        }
+        if (c > 255) c = 255;
+        return complement? 255-c: c;
+    }
+
+    void add_curr_cell(void) {
+        if (m_curr.area | m_curr.cover) {
+            m_cells.push_back(m_curr);
+            m_ymin = std::min(m_ymin, m_curr.y);
+            m_ymax = std::max(m_ymax, m_curr.y);
+        }
+    }
+
+    void set_curr_cell(int x, int y) {
+        if (m_curr.x != x || m_curr.y != y) {
+            add_curr_cell();
+            m_curr = cell{x, y, 0, 0};
+        }
+    }
+
+    // Counting sort by row, then sort each row by column
+    void sort_cells(void) {
+        m_sorted.resize(m_cells.size());
+        if (m_ymax < m_ymin) {
+            return;
+        }
+        int rows = m_ymax-m_ymin+1;
+        m_row_start.assign(static_cast<size_t>(rows)+1, 0);
+        for (const auto &c: m_cells) {
+            ++m_row_start[c.y-m_ymin+1];
+        }
+        for (int i = 0; i < rows; ++i) {
+            m_row_start[i+1] += m_row_start[i];
+        }
+        std::vector<int> next(m_row_start.begin(), m_row_start.end()-1);
+        for (const auto &c: m_cells) {
+            m_sorted[next[c.y-m_ymin]++] = c;
+        }
+        for (int i = 0; i < rows; ++i) {
+            std::sort(m_sorted.begin()+m_row_start[i],
+                m_sorted.begin()+m_row_start[i+1],
+                [](const cell &a, const cell &b) { return a.x < b.x; });
+        }
+    }
+
+    // Accumulates a segment contained in a single row
+    void render_hline(int ey, int x1, int y1, int x2, int y2) {
+        int ex1 = x1 >> subpixel_shift;
+        int ex2 = x2 >> subpixel_shift;
+        int fx1 = x1 & subpixel_mask;
+        int fx2 = x2 & subpixel_mask;
+        if (y1 == y2) {
+            set_curr_cell(ex2, ey);
+            return;
+        }
+        if (ex1 == ex2) {
+            int delta = y2-y1;
+            m_curr.cover += delta;
+            m_curr.area += (fx1+fx2)*delta;
+            return;
+        }
+        int64_t p = static_cast<int64_t>(subpixel_scale-fx1)*(y2-y1);
+        int first = subpixel_scale, incr = 1;
+        int64_t dx = static_cast<int64_t>(x2)-x1;
+        if (dx < 0) {
+            p = static_cast<int64_t>(fx1)*(y2-y1);
+            first = 0;
+            incr = -1;
+            dx = -dx;
+        }
+        int64_t delta = p/dx, mod = p%dx;
+        if (mod < 0) { --delta; mod += dx; }
+        m_curr.cover += static_cast<int>(delta);
+        m_curr.area += (fx1+first)*static_cast<int>(delta);
+        ex1 += incr;
+        set_curr_cell(ex1, ey);
+        y1 += static_cast<int>(delta);
+        if (ex1 != ex2) {
+            p = static_cast<int64_t>(subpixel_scale)*(y2-y1+delta);
+            int64_t lift = p/dx, rem = p%dx;
+            if (rem < 0) { --lift; rem += dx; }
+            mod -= dx;
+            while (ex1 != ex2) {
+                delta = lift;
+                mod += rem;
+                if (mod >= 0) { mod -= dx; ++delta; }
+                m_curr.cover += static_cast<int>(delta);
+                m_curr.area += subpixel_scale*static_cast<int>(delta);
+                y1 += static_cast<int>(delta);
+                ex1 += incr;
+                set_curr_cell(ex1, ey);
+            }
+        }
+        int d = y2-y1;
+        m_curr.cover += d;
+        m_curr.area += (fx2+subpixel_scale-first)*d;
+    }
+
+    // Accumulates a segment in subpixel coordinates
+    void render_line(int x1, int y1, int x2, int y2) {
+        int ey1 = y1 >> subpixel_shift;
+        int ey2 = y2 >> subpixel_shift;
+        int fy1 = y1 & subpixel_mask;
+        int fy2 = y2 & subpixel_mask;
+        set_curr_cell(x1 >> subpixel_shift, ey1);
+        if (ey1 == ey2) {
+            render_hline(ey1, x1, fy1, x2, fy2);
+            return;
+        }
+        int64_t dx = static_cast<int64_t>(x2)-x1;
+        int64_t dy = static_cast<int64_t>(y2)-y1;
+        int incr = 1;
+        if (dx == 0) {
+            int ex = x1 >> subpixel_shift;
+            int two_fx = (x1 - (ex << subpixel_shift)) << 1;
+            int first = subpixel_scale;
+            if (dy < 0) { first = 0; incr = -1; }
+            int delta = first-fy1;
+            m_curr.cover += delta;
+            m_curr.area += two_fx*delta;
+            ey1 += incr;
+            set_curr_cell(ex, ey1);
+            delta = first+first-subpixel_scale;
+            int area = two_fx*delta;
+            while (ey1 != ey2) {
+                m_curr.cover = delta;
+                m_curr.area = area;
+                ey1 += incr;
+                set_curr_cell(ex, ey1);
+            }
+            delta = fy2-subpixel_scale+first;
+            m_curr.cover += delta;
+            m_curr.area += two_fx*delta;
+            return;
+        }
+        int64_t p = (subpixel_scale-fy1)*dx;
+        int first = subpixel_scale;
+        if (dy < 0) {
+            p = fy1*dx;
+            first = 0;
+            incr = -1;
+            dy = -dy;
+        }
+        int64_t delta = p/dy, mod = p%dy;
+        if (mod < 0) { --delta; mod += dy; }
+        int x_from = x1+static_cast<int>(delta);
+        render_hline(ey1, x1, fy1, x_from, first);
+        ey1 += incr;
+        set_curr_cell(x_from >> subpixel_shift, ey1);
+        if (ey1 != ey2) {
+            p = subpixel_scale*dx;
+            int64_t lift = p/dy, rem = p%dy;
+            if (rem < 0) { --lift; rem += dy; }
+            mod -= dy;
+            while (ey1 != ey2) {
+                delta = lift;
+                mod += rem;
+                if (mod >= 0) { mod -= dy; ++delta; }
+                int x_to = x_from+static_cast<int>(delta);
+                render_hline(ey1, x_from, subpixel_scale-first, x_to, first);
+                x_from = x_to;
+                ey1 += incr;
+                set_curr_cell(x_from >> subpixel_shift, ey1);
+            }
+        }
+        render_hline(ey1, x_from, subpixel_scale-first, x2, fy2);
+    }
+};
+
+// Flattens the painted shapes in a scene
+class scene_f_to_fills final: public i_scene_data<scene_f_to_fills> {
+
+    std::vector<fill> &m_fills;
+    std::vector<xform> m_xf_stack;
+
+public:
+
+    scene_f_to_fills(const xform &screen_xf, std::vector<fill> &fills):
+        m_fills(fills) {
+        m_xf_stack.push_back(screen_xf);
+    }
+
+private:
+
+    void push_xf(const xform &xf) {
+        m_xf_stack.push_back(m_xf_stack.back() * xf);
+    }
+
+    void pop_xf(void) {
+        if (m_xf_stack.size() > 1) {
+            m_xf_stack.pop_back();
+        }
+    }
+
+    const xform &top_xf(void) const {
+        return m_xf_stack.back();
+    }
+
+friend i_scene_data<scene_f_to_fills>;
+
+    void do_painted_shape(e_winding_rule wr, const shape &s, const paint &p) {
+        paint_sampler sampler{p, top_xf()};
+        if (sampler.is_empty() || s.is_empty()) {
+            return;
+        }
+        xform shape_xf = s.get_xf().transformed(top_xf());
+        // Strokes are converted to fills by the rvg stroker
+        auto path = s.as_path_data_ptr(top_xf());
+        std::vector<rvgf> edges;
+        input_path_f_flatten flatten{RVG_SCANLINE_FLATTENING_TOLERANCE, edges};
+        path->iterate(make_input_path_f_xform(shape_xf, flatten));
+        flatten.finish();
+        m_fills.push_back(fill{
+            s.is_stroke()? e_winding_rule::non_zero: wr,
+            std::move(sampler),
+            std::move(edges)
+        });
+    }
+
+    void do_tensor_product_patch(const patch<16,4> &) { ; }
+    void do_coons_patch(const patch<12,4> &) { ; }
+    void do_gouraud_triangle(const patch<3,3> &) { ; }
+    void do_stencil_shape(e_winding_rule, const shape &) { ; }
+    void do_begin_clip(uint16_t) { ; }
+    void do_activate_clip(uint16_t) { ; }
+    void do_end_clip(uint16_t) { ; }
+    void do_begin_fade(uint16_t, unorm8) { ; }
+    void do_end_fade(uint16_t, unorm8) { ; }
+    void do_begin_blur(uint16_t, float) { ; }
+    void do_end_blur(uint16_t, float) { ; }
+
+    void do_begin_transform(uint16_t, const xform &xf) {
+        push_xf(xf);
+    }
+
+    void do_end_transform(uint16_t, const xform &) {
+        pop_xf();
+    }
+};
+
+const accelerated accelerate(const scene &c, const window &w,
+    const viewport &v) {
+    int xl, yb, xr, yt;
+    std::tie(xl, yb) = v.bl();
+    std::tie(xr, yt) = v.tr();
+    xform flip = make_translation(0,-static_cast<rvgf>(yb)).
+        scaled(1,-1).translated(0,static_cast<rvgf>(yt));
+    xform screen_xf = flip * c.get_xf().windowviewport(w, v).translated(-xl, yb);
+    auto fills = std::make_shared<std::vector<fill>>();
+    scene_f_to_fills sf(screen_xf, *fills);
+    c.get_scene_data().iterate(sf);
+    return accelerated{fills, c.get_background_color()};
+}
+
+static bool opt_no_output(const std::vector<std::string> &args) {
+    for (const auto &s : args)
+        if (s.compare("-no-output") == 0) return true;
+
+    return false;
+}
+
+void render(const accelerated &a, const window &w, const viewport &v,
+    FILE *out, const std::vector<std::string> &args) {
+    (void) w;
+    int xl, yb, xr, yt;
+    std::tie(xl, yb) = v.bl();
+    std::tie(xr, yt) = v.tr();
+    int width = std::abs(xr-xl);
+    int height = std::abs(yt-yb);
+    // Premultiplied RGBA, starting with the background color
+    float background[4];
+    RGBA8 bg = a.get_background_color();
+    float bga = static_cast<float>(bg[3])/255.f;
+    for (int k = 0; k < 3; ++k) {
+        background[k] = bga*static_cast<float>(bg[k])/255.f;
+    }
+    background[3] = bga;
+    std::vector<float> pixels(4*static_cast<size_t>(width)*height);
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        std::copy(background, background+4, &pixels[i]);
+    }
+    rasterizer r{width, height};
+    std::vector<float> scratch;
+    for (const auto &f: a.get_fills()) {
+        r.reset();
+        const auto &e = f.edges;
+        for (size_t i = 0; i+3 < e.size(); i += 4) {
+            r.add_edge(e[i], e[i+1], e[i+2], e[i+3]);
+        }
+        r.sweep(f.winding_rule, [&](int x, int y, int n, int alpha) {
+            f.sampler.composite(&pixels[4*static_cast<size_t>(y)*width],
+                x, y, n, static_cast<float>(alpha)/255.f, scratch);
+        });
+    }
+    if (!opt_no_output(args)) {
+        // Rasterizer rows go top to bottom, image rows bottom to top
+        packed_image<uint8_t,4> img;
+        img.resize(width, height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const float *p = &pixels[4*(static_cast<size_t>(y)*width+x)];
+                float alpha = p[3];
+                if (alpha > 0.f) {
+                    float inv = 1.f/alpha;
+                    img.set_pixel<unorm_converter<float,uint8_t>>(x,
+                        height-1-y, std::min(p[0]*inv, 1.f),
+                        std::min(p[1]*inv, 1.f), std::min(p[2]*inv, 1.f),
+                        std::min(alpha, 1.f));
+                } else {
+                    img.set_pixel(x, height-1-y, 0, 0, 0, 0);
+                }
+            }
+        }
+        store_png<uint8_t>(out, img);
+    }
+}
+
+} } } // namespace rvg::driver::scanline
+
+// Lua version of the accelerate function.
+static int luaaccelerate(lua_State *L) {
+    rvg_lua_push<rvg::driver::scanline::accelerated>(L,
+        rvg::driver::scanline::accelerate(
+            rvg_lua_check<rvg::scene>(L, 1),
+            rvg_lua_check<rvg::window>(L, 2),
+            rvg_lua_check<rvg::viewport>(L, 3)));
+    return 1;
+}
+
+// Lua version of render function
+static int luarender(lua_State *L) {
+    auto a = rvg_lua_check<rvg::driver::scanline::accelerated>(L, 1);
+    auto w = rvg_lua_check<rvg::window>(L, 2);
+    auto v = rvg_lua_check<rvg::viewport>(L, 3);
+    auto o = rvg_lua_optargs(L, 5);
+    rvg::driver::scanline::render(a, w, v, rvg_lua_check_file(L, 4), o);
+    return 0;
+}
+
+// List of Lua functions exported into driver table
+static const luaL_Reg modscanline[] = {
+    {"render", luarender },
+    {"accelerate", luaaccelerate },
+    {NULL, NULL}
+};
+
+// Lua function invoked to be invoked by require"driver.scanline"
+extern "C"
+#ifndef _WIN32
+__attribute__((visibility("default")))
+#else
+__declspec(dllexport)
+#endif
+int luaopen_driver_scanline(lua_State *L) {
+    rvg_lua_init(L);
+    if (!rvg_lua_typeexists<rvg::driver::scanline::accelerated>(L, -1)) {
+        rvg_lua_createtype<rvg::driver::scanline::accelerated>(L,
+            "scanline accelerated", -1);
+    }
+    rvg_lua_facade_new_driver(L, modscanline);
+    return 1;
+}
@@ -13,6 +13,8 @@
 //
 // Contact information: diego.nehab@gmail.com
 //
+#include <algorithm>
+#include <cstdio>
 #include <string>
 #include <sstream>
 #include <cmath>
@@ -38,6 +40,7 @@
 
 #include "rvg-i-sink.h"
 
+#include "rvg-driver-options.h"
 #include "rvg-driver-skia.h"
 
 #include "SkPath.h"
@@ -45,10 +48,12 @@
 #include "SkCanvas.h"
 #include "SkTileMode.h"
 #include "SkBitmap.h"
+#include "SkPixmap.h"
 #include "SkImage.h"
 #include "SkEncodedImageFormat.h"
 #include "SkPicture.h"
 #include "SkPictureRecorder.h"
+#include "SkBBHFactory.h"
 #include "SkGradientShader.h"
 #include "SkMaskFilter.h"
 #include "SkDashPathEffect.h"
@@ -389,9 +394,12 @@ const accelerated accelerate(const scene &c, const window &w,
         scaled(1.f,-1.f).translated(0.f,static_cast<float>(yt));
     xform screen_xf = flip * c.get_xf().windowviewport(w, v).translated(-xl, yb);
 
+    // The R-tree lets playback into a tile skip commands outside it
+    SkRTreeFactory bbh_factory;
     SkPictureRecorder recorder;
     SkCanvas* canvas = recorder.beginRecording({0, 0,
-        static_cast<float>(width), static_cast<float>(height)});
+        static_cast<float>(width), static_cast<float>(height)},
+        &bbh_factory);
 
     auto iter = skia_scene_iterator(*canvas, screen_xf);
 
@@ -401,16 +409,66 @@ const accelerated accelerate(const scene &c, const window &w,
     return recorder.finishRecordingAsPicture();
 }
 
-static bool opt_no_output(const std::vector<std::string> &args) {
-    for (const auto &s : args)
-        if (s.compare("-no-output") == 0) return true;
-
-    return false;
+// Plays the picture back into bands of tiles, each band as many tile
+// rows tall as there are threads. All tiles in a band are played back
+// concurrently, into one canvas per tile that draws directly into the
+// tile's rectangle of the band, and whose bounds clip the playback.
+// SkPicture is immutable, so threads can share it. Each band is
+// streamed to out, unless it is null, before the next one is rendered.
+static void render_bands(const accelerated &a, int width, int height,
+    int tile_size, int threads, FILE *out) {
+    png_stream_writer writer;
+    if (out && !writer.open(out, width, height, 4, 8)) {
+        return;
+    }
+    const int nx = (width+tile_size-1)/tile_size;
+    const int band_height = std::min(threads*tile_size, height);
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(width, band_height);
+    const size_t row_size = info.minRowBytes();
+    const size_t pixel_size = info.bytesPerPixel();
+    std::vector<char> pixels(row_size*band_height);
+    // PNG wants unpremultiplied RGBA
+    const SkImageInfo rgba_info = SkImageInfo::Make(width, band_height,
+        kRGBA_8888_SkColorType, kUnpremul_SkAlphaType);
+    const size_t rgba_row_size = rgba_info.minRowBytes();
+    std::vector<char> rgba(rgba_row_size*band_height);
+    sk_sp<const SkPicture> picture = a.get_picture();
+    for (int y0 = 0; y0 < height; y0 += band_height) {
+        int bh = std::min(band_height, height-y0);
+        int ny = (bh+tile_size-1)/tile_size;
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for (int i = 0; i < nx*ny; ++i) {
+            int x0 = (i%nx)*tile_size;
+            int ty = (i/nx)*tile_size;
+            int tw = std::min(tile_size, width-x0);
+            int th = std::min(tile_size, bh-ty);
+            SkImageInfo tile_info = SkImageInfo::MakeN32Premul(tw, th);
+            std::unique_ptr<SkCanvas> canvas = SkCanvas::MakeRasterDirect(
+                tile_info, pixels.data() + ty*row_size + x0*pixel_size,
+                row_size);
+            canvas->clear(0);
+            canvas->translate(static_cast<SkScalar>(-x0),
+                static_cast<SkScalar>(-(y0+ty)));
+            picture->playback(canvas.get());
+            canvas->flush();
+        }
+        if (out) {
+            SkPixmap band(info.makeWH(width, bh), pixels.data(), row_size);
+            band.readPixels(rgba_info.makeWH(width, bh), rgba.data(),
+                rgba_row_size);
+            for (int y = 0; y < bh; ++y) {
+                writer.write_row(rgba.data() + y*rgba_row_size);
+            }
+        }
+    }
+    if (out) {
+        writer.close();
+    }
 }
 
 void render(const accelerated &a, const window &w, const viewport &v,
     FILE *out, const std::vector<std::string> &args) {
-    (void) args; (void) w;
+    (void) w;
 
     int xl, yb, xr, yt;
     std::tie(xl, yb) = v.bl();
@@ -418,6 +476,14 @@ void render(const accelerated &a, const window &w, const viewport &v,
     int width = std::abs(xl - xr);
     int height = std::abs(yt - yb);
 
+    // Tiled playback is enabled by -tile, -tile:<size>, or -threads:<n>
+    int tile_size = render_tile_size_option(args);
+    if (tile_size > 0) {
+        render_bands(a, width, height, tile_size, threads_option(args),
+            has_option(args, "-no-output")? nullptr: out);
+        return;
+    }
+
     SkImageInfo info = SkImageInfo::MakeN32Premul(width, height);
     const size_t row_size = info.minRowBytes();
 
@@ -429,7 +495,7 @@ void render(const accelerated &a, const window &w, const viewport &v,
     a.get_picture()->playback(canvas.get());
     canvas->flush();
 
-    if (!opt_no_output(args)) {
+    if (!has_option(args, "-no-output")) {
         auto image = SkImage::MakeFromBitmap(bitmap);
         auto data = image->encodeToData(SkEncodedImageFormat::kPNG , 100);
         fwrite(data->data(), 1, data->size(), out);
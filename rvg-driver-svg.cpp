@@ -30,6 +30,8 @@
 #include "rvg-xform.h"
 #include "rvg-paint.h"
 #include "rvg-path-data.h"
+#include "rvg-number-format.h"
+#include "rvg-file-ostream.h"
 
 #include "rvg-svg-path-f-command-printer.h"
 #include "rvg-input-path-f-to-svg-path.h"
@@ -732,7 +734,7 @@ private:
 
 void render(const scene &accel, const window &w, const viewport &v,
     std::ostream &out, const std::vector<std::string> &args) {
-    (void) args;
+    auto loc = imbue_number_format(out, get_number_format_precision(args));
     int vxl, vyb, vxr, vyt;
     std::tie(vxl, vyb) = v.bl();
     std::tie(vxr, vyt) = v.tr();
@@ -793,6 +795,7 @@ void render(const scene &accel, const window &w, const viewport &v,
     out << --nl << "</g>";
     out << --nl << "</g>";
     out << "\n</svg>\n";
+    out.imbue(loc);
 }
 
 } } } // namespace rvg::driver::svg
@@ -810,10 +813,8 @@ static int luarender(lua_State *L) {
     auto accel = rvg_lua_check<rvg::scene>(L, 1);
     auto w = rvg_lua_check<rvg::window>(L, 2);
     auto v = rvg_lua_check<rvg::viewport>(L, 3);
-    FILE *f = rvg_lua_check_file(L, 4);
-    std::ostringstream sout;
-    rvg::driver::svg::render(accel, w, v, sout);
-    fwrite(sout.str().data(), 1, sout.str().size(), f);
+    rvg::file_ostream out(rvg_lua_check_file(L, 4));
+    rvg::driver::svg::render(accel, w, v, out, rvg_lua_optargs(L, 5));
     return 0;
 }
 
@@ -42,10 +42,9 @@ rvg::RGBA8 rgb8(int r, int g, int b) {
 }
 
 rvg::shape path(const char *svg) {
-    auto p = rvg::make_intrusive<rvg::path_data>();
-    if (!svg_path_iterate(svg, *p)) {
-        p->clear();
-        p->shrink_to_fit();
+    auto p = rvg::make_path_data_from_svg_path(svg);
+    if (!p) {
+        p = rvg::make_intrusive<rvg::path_data>();
     }
     return rvg::shape(p);
 }
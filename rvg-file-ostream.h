@@ -0,0 +1,108 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_FILE_OSTREAM_H
+#define RVG_FILE_OSTREAM_H
+
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace rvg {
+
+// A stream buffer that collects output in a large buffer and writes
+// it to a FILE * only when the buffer is full or flushed. This replaces
+// the std::ostringstream our writers used to fill before copying the
+// result to the file, which kept the entire output in memory and
+// copied it twice.
+class file_streambuf final: public std::streambuf {
+
+    FILE *m_file;
+    std::vector<char> m_buffer;
+
+    bool flush_buffer(void) {
+        size_t n = static_cast<size_t>(pptr() - pbase());
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        return n == 0 || fwrite(m_buffer.data(), 1, n, m_file) == n;
+    }
+
+public:
+
+    explicit file_streambuf(FILE *file, size_t size = 1 << 20):
+        m_file(file),
+        m_buffer(size > 0? size: 1) {
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    ~file_streambuf() {
+        flush_buffer();
+    }
+
+    file_streambuf(const file_streambuf &) = delete;
+    file_streambuf &operator=(const file_streambuf &) = delete;
+
+protected:
+
+    int_type overflow(int_type c) override {
+        if (!flush_buffer()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        // Large writes go straight to the file
+        if (n >= epptr() - pptr()) {
+            if (!flush_buffer()) {
+                return 0;
+            }
+            if (static_cast<size_t>(n) >= m_buffer.size()) {
+                return static_cast<std::streamsize>(
+                    fwrite(s, 1, static_cast<size_t>(n), m_file));
+            }
+        }
+        traits_type::copy(pptr(), s, static_cast<size_t>(n));
+        pbump(static_cast<int>(n));
+        return n;
+    }
+
+    int sync(void) override {
+        return flush_buffer() && fflush(m_file) == 0? 0: -1;
+    }
+};
+
+// An output stream writing to a FILE * through a file_streambuf.
+// The FILE * is not closed on destruction.
+class file_ostream final: public std::ostream {
+
+    file_streambuf m_buf;
+
+public:
+
+    explicit file_ostream(FILE *file, size_t size = 1 << 20):
+        std::ostream(nullptr),
+        m_buf(file, size) {
+        rdbuf(&m_buf);
+    }
+};
+
+} // namespace rvg
+
+#endif
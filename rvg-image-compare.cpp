@@ -0,0 +1,114 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <algorithm>
+#include <cmath>
+
+#include "rvg-image-compare.h"
+
+namespace rvg {
+
+// ImageMagick's fuzz distance between two RGBA pixels, squared, in
+// 8-bit units and times 3*255^2, given the squared alpha difference,
+// the product of the alphas, and the squared RGB distance. The alpha
+// difference counts 3 times, and the color differences are scaled by
+// the product of the alphas, so they matter less as the pixels become
+// transparent
+static inline int64_t fuzz_distance2(int da2, int alphas, int dc2) {
+    return INT64_C(3)*255*255*da2 + static_cast<int64_t>(alphas)*dc2;
+}
+
+int compare_images(const packed_image<uint8_t, 4> &a,
+    const packed_image<uint8_t, 4> &b, float fuzz,
+    image_comparison *result, packed_image<uint8_t, 4> *diff) {
+    const int width = a.get_width(), height = a.get_height();
+    if (!result || width != b.get_width() || height != b.get_height()) {
+        return 0;
+    }
+    if (diff) {
+        diff->resize(width, height);
+        diff->set_color_space(a.get_color_space());
+    }
+    // Value of fuzz_distance2 above which a pixel is a mismatch
+    const float f = std::min(std::max(fuzz, 0.f), 1.f);
+    const int64_t threshold = static_cast<int64_t>(
+        std::floor(3.*255.*255.*255.*255.*f*f));
+    uint64_t sum = 0;
+    int64_t mismatches = 0;
+    int max_error = 0;
+#pragma omp parallel for schedule(static) reduction(+:sum,mismatches) \
+    reduction(max:max_error)
+    for (int y = 0; y < height; ++y) {
+        const uint8_t *pa = a.get_row(y), *pb = b.get_row(y);
+        uint64_t row_sum = 0;
+        int64_t row_mismatches = 0;
+        int row_max = 0;
+#pragma omp simd reduction(+:row_sum,row_mismatches) reduction(max:row_max)
+        for (int x = 0; x < width; ++x) {
+            int dc2 = 0, da2 = 0;
+            for (int c = 0; c < 4; ++c) {
+                int d = static_cast<int>(pa[4*x+c]) -
+                    static_cast<int>(pb[4*x+c]);
+                if (c < 3) {
+                    dc2 += d*d;
+                } else {
+                    da2 = d*d;
+                }
+                d = d < 0? -d: d;
+                row_max = d > row_max? d: row_max;
+            }
+            row_sum += static_cast<uint64_t>(dc2 + da2);
+            row_mismatches += fuzz_distance2(da2, pa[4*x+3]*pb[4*x+3],
+                dc2) > threshold;
+        }
+        sum += row_sum;
+        mismatches += row_mismatches;
+        max_error = std::max(max_error, row_max);
+        if (diff) {
+            uint8_t *pd = diff->get_row(y);
+            for (int x = 0; x < width; ++x) {
+                int dc2 = 0;
+                for (int c = 0; c < 3; ++c) {
+                    int d = static_cast<int>(pa[4*x+c]) -
+                        static_cast<int>(pb[4*x+c]);
+                    dc2 += d*d;
+                }
+                int da = static_cast<int>(pa[4*x+3]) -
+                    static_cast<int>(pb[4*x+3]);
+                if (fuzz_distance2(da*da, pa[4*x+3]*pb[4*x+3], dc2) >
+                    threshold) {
+                    pd[4*x+0] = 255;
+                    pd[4*x+1] = 0;
+                    pd[4*x+2] = 0;
+                } else {
+                    // Three quarters of the way to white
+                    for (int c = 0; c < 3; ++c) {
+                        pd[4*x+c] = static_cast<uint8_t>(
+                            (pa[4*x+c] + 3*255)/4);
+                    }
+                }
+                pd[4*x+3] = 255;
+            }
+        }
+    }
+    result->pixels = static_cast<int64_t>(width)*height;
+    result->mismatches = mismatches;
+    result->max_error = max_error/255.;
+    result->rmse = result->pixels > 0?
+        std::sqrt(static_cast<double>(sum)/(4.*result->pixels))/255.: 0.;
+    return 1;
+}
+
+} // namespace rvg
@@ -0,0 +1,48 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_IMAGE_COMPARE_H
+#define RVG_IMAGE_COMPARE_H
+
+#include <cstdint>
+
+#include "rvg-image.h"
+
+namespace rvg {
+
+// Differences between two images of the same size, with all errors
+// normalized to [0,1]
+struct image_comparison {
+    double rmse = 0;         // root mean squared error over all channels
+    double max_error = 0;    // largest difference in any channel
+    int64_t mismatches = 0;  // pixels that differ by more than the fuzz
+    int64_t pixels = 0;      // pixels compared
+};
+
+// Compares two 8-bit RGBA images, as load_png returns them. As with
+// ImageMagick's compare -fuzz, a pixel is a mismatch when its distance
+// is larger than fuzz. The squared distance is the squared alpha
+// difference plus the squared RGB distance, weighted by the product of
+// the alphas and divided by 3, all normalized to [0,1]. If diff is
+// not null, it receives a faded copy of a with the mismatches in red.
+// Rows are distributed among threads.
+// Returns 0 if the images have different sizes
+int compare_images(const packed_image<uint8_t, 4> &a,
+    const packed_image<uint8_t, 4> &b, float fuzz,
+    image_comparison *result, packed_image<uint8_t, 4> *diff = nullptr);
+
+} // namespace rvg
+
+#endif // RVG_IMAGE_COMPARE_H
@@ -32,13 +32,35 @@
 namespace rvg {
 
 
-template <typename T, size_t N>
+// Images are stored one row after the other, from the bottom row to the
+// top row, with pitch pixels per row. A planar image stores each channel
+// in turn, so consecutive channels of a pixel are m_pitch*m_height apart.
+// A packed image interleaves the channels of each pixel, so rows can be
+// handed as they are to libraries that want interleaved data, such as
+// libpng.
+template <typename T, size_t N, e_organization O = e_organization::planar>
 class image final: public i_image {
 
     int m_width, m_height, m_pitch;
     e_color_space m_color_space;
     std::vector<T> m_data;
 
+    static constexpr bool packed = (O == e_organization::packed);
+
+    // Distance between consecutive pixels in a row
+    static constexpr int pixel_advance(void) {
+        return packed? static_cast<int>(N): 1;
+    }
+
+    // Distance between consecutive channels of a pixel
+    int channel_advance(void) const {
+        return packed? 1: m_pitch*m_height;
+    }
+
+    int pixel_index(int x, int y) const {
+        return pixel_advance()*(x+m_pitch*y);
+    }
+
     template <typename C>
     void get_pixel_helper(int) const { }
 
@@ -46,7 +68,7 @@ class image final: public i_image {
     void get_pixel_helper(int i, U &first, Args&... others) const {
         C convert;
         first = convert(m_data[i]);
-        get_pixel_helper<C>(i+m_pitch*m_height, others...);
+        get_pixel_helper<C>(i+channel_advance(), others...);
     }
 
     template <typename C>
@@ -56,15 +78,15 @@ class image final: public i_image {
     void set_pixel_helper(int i, const U first, Args... others) {
         C convert;
         m_data[i] = convert(first);
-        set_pixel_helper<C>(i+m_pitch*m_height, others...);
+        set_pixel_helper<C>(i+channel_advance(), others...);
     }
 
 public:
 
-    using ptr = boost::intrusive_ptr<image<T,N>>;
-    using const_ptr = boost::intrusive_ptr<const image<T,N>>;
+    using ptr = boost::intrusive_ptr<image<T,N,O>>;
+    using const_ptr = boost::intrusive_ptr<const image<T,N,O>>;
 
-    virtual ~image<T,N>() { ; }
+    virtual ~image() { ; }
 
     image(void):
         m_width(0),
@@ -75,28 +97,39 @@ public:
     const std::vector<T> &get_data(void) const { return m_data; }
     std::vector<T> &get_data(void) { return m_data; }
 
+    // Interleaved channels of row y, only available in packed images
+    template <e_organization P = O,
+        typename = typename std::enable_if<P == e_organization::packed>::type>
+    const T *get_row(int y) const { return &m_data[pixel_index(0, y)]; }
+
+    template <e_organization P = O,
+        typename = typename std::enable_if<P == e_organization::packed>::type>
+    T *get_row(int y) { return &m_data[pixel_index(0, y)]; }
+
     template <typename C, typename ...Args,
         typename = typename std::enable_if<sizeof...(Args) == N>::type>
     void get_pixel(int x, int y, Args&... channels) const {
-        get_pixel_helper<C>(x+m_pitch*y, channels...);
+        get_pixel_helper<C>(pixel_index(x, y), channels...);
     }
 
     template <typename ...Args,
         typename = typename std::enable_if<sizeof...(Args) == N>::type>
     void get_pixel(int x, int y, Args&... channels) const {
-        get_pixel_helper<unorm_converter<T,T>>(x+m_pitch*y, channels...);
+        get_pixel_helper<unorm_converter<T,T>>(pixel_index(x, y),
+            channels...);
     }
 
     template <typename C, typename ...Args,
         typename = typename std::enable_if<sizeof...(Args) == N>::type>
     void set_pixel(int x, int y, Args... channels) {
-        set_pixel_helper<C>(x+m_pitch*y, channels...);
+        set_pixel_helper<C>(pixel_index(x, y), channels...);
     }
 
     template <typename ...Args,
         typename = typename std::enable_if<sizeof...(Args) == N>::type>
     void set_pixel(int x, int y, Args... channels) {
-        set_pixel_helper<unorm_converter<T,T>>(x+m_pitch*y, channels...);
+        set_pixel_helper<unorm_converter<T,T>>(pixel_index(x, y),
+            channels...);
     }
 
     template <typename C = unorm_converter<T,T>, typename ...Args,
@@ -111,10 +144,10 @@ public:
                 set_pixel_helper<C>(base+offset,
                     channels[base_in+offset_in]...);
                 offset_in += advance_in;
-                offset += 1;
+                offset += pixel_advance();
             }
             base_in += pitch_in;
-            base += pitch;
+            base += pixel_advance()*pitch;
         }
     }
 
@@ -131,10 +164,10 @@ public:
             for (int j = 0; j < m_width; j++) {
                 get_pixel_helper<C>(base+offset,
                     channels[base_out+offset_out]...);
-                offset += 1;
+                offset += pixel_advance();
                 offset_out += advance_out;
             }
-            base += m_pitch;
+            base += pixel_advance()*m_pitch;
             base_out += pitch_out;
         }
     }
@@ -158,7 +191,7 @@ protected:
     }
 
     e_organization do_get_organization(void) const {
-        return e_organization::planar;
+        return O;
     }
 
     e_channel_type do_get_channel_type(void) const {
@@ -185,14 +218,19 @@ protected:
     };
 
     void do_set_unorm(int x, int y, int c, float v) {
-        m_data[x+m_pitch*(y+m_height*c)] = unorm<T>{unorm<float>{v}};
+        m_data[pixel_index(x, y)+channel_advance()*c] =
+            unorm<T>{unorm<float>{v}};
     }
 
     float do_get_unorm(int x, int y, int c) const {
-        return unorm<float>{unorm<T>{m_data[x+m_pitch*(y+m_height*c)]}};
+        return unorm<float>{unorm<T>{
+            m_data[pixel_index(x, y)+channel_advance()*c]}};
     }
 };
 
+template <typename T, size_t N>
+using packed_image = image<T,N,e_organization::packed>;
+
 } // namespace rvg
 
 #endif // RVG_IMAGE_H
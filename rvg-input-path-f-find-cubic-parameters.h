@@ -16,14 +16,136 @@
 #ifndef RVG_INPUT_PATH_F_FIND_CUBIC_PARAMETER_H
 #define RVG_INPUT_PATH_F_FIND_CUBIC_PARAMETER_H
 
+#include <boost/container/static_vector.hpp>
+
 #include "rvg-bezier.h"
 #include "rvg-util.h"
+#include "rvg-precision-escalation.h"
 #include "rvg-i-point-input-path-f-forwarder.h"
 #include "rvg-i-cubic-parameters.h"
 #include "rvg-i-parameters-f-forwarder.h"
 
 namespace rvg {
 
+namespace cubic_parameters {
+
+// Parameters found while analysing a cubic are buffered here
+// before being forwarded. This allows us to discard the results of
+// a fragile single-precision analysis and redo it in double precision
+using parameters = boost::container::static_vector<rvgf, 4>;
+
+struct found_parameters {
+    parameters inflections;
+    parameters double_points;
+};
+
+// Coefficients of the inflection polynomial and of the
+// double-point polynomial
+template <typename T>
+struct coefficients {
+    T b0, b1, b2, b3;
+    T d1, d2, d3;
+};
+
+// Determinant of {{ax, ay, 1}, {bx, by, 1}, {cx, cy, 1}}, with the
+// terms in the same order as det(const R2 &, const R2 &, const R2 &)
+// in rvg-point.h, so the single-precision analysis is unchanged
+template <typename T>
+inline T det(T ax, T ay, T bx, T by, T cx, T cy) {
+    return   ay*cx + bx*cy + ax*by
+           - ax*cy - ay*bx - by*cx;
+}
+
+// Receives control points shifted so p0 is at the origin
+template <typename T>
+inline coefficients<T> make_coefficients(T u1x, T u1y, T u2x, T u2y,
+    T u3x, T u3y) {
+    using util::det;
+    T u0x = T{0}, u0y = T{0};
+    coefficients<T> c;
+    // Compute det of minors and from them the
+    // discriminant of the inflection polynomial
+    c.b3 = 3*cubic_parameters::det(u1x, u1y, u2x, u2y, u3x, u3y);
+    c.b2 = cubic_parameters::det(u0x, u0y, u2x, u2y, u3x, u3y);
+    c.b1 = cubic_parameters::det(u0x, u0y, u1x, u1y, u3x, u3y);
+    c.b0 = 3*cubic_parameters::det(u0x, u0y, u1x, u1y, u2x, u2y);
+    c.d1 = 2*det(c.b1, c.b0, c.b2, c.b1);
+    c.d2 = det(c.b1, c.b0, c.b3, c.b2);
+    c.d3 = 2*det(c.b2, c.b1, c.b3, c.b2);
+    return c;
+}
+
+// The analysis is fragile when the discriminant is too close to
+// zero for its sign to be trusted, i.e., when the cubic is nearly
+// a cusp
+template <typename T>
+inline bool find_parameters(const coefficients<T> &c,
+    found_parameters &found) {
+    using util::is_almost_equal;
+    using precision_escalation::is_fragile;
+    T d1d3 = c.d1*c.d3;
+    T d2d2 = c.d2*c.d2;
+    bool almost_zero = is_almost_equal(d1d3, d2d2);
+    T d = d1d3-d2d2; // Finally, the discriminant
+    // If the discriminant is positive, we have a serpentine
+    // We simply find the parameters for the inflections
+    if (d > 0 || almost_zero) {
+        // We know the cubic inflection polynomial given by
+        // std::make_tuple(b0, b1, b2, b3) really is a
+        // quadratic because the curve is integral.
+        // So we lower the degree before looking for roots
+        auto infls = std::make_tuple(c.b0,
+            T{.25}*(3*(c.b1+c.b2)-(c.b0+c.b3)), c.b3);
+        auto ts = bezier_roots<T>(infls);
+        if (ts.size() > 2) {
+            for (unsigned i = 1; i < ts.size()-1; i++) {
+                found.inflections.push_back(static_cast<rvgf>(ts[i]));
+            }
+        }
+    }
+    // If the discriminant is negative, we have a loop
+    // We simply find the parameters for the double-point
+    if (d < 0 || almost_zero) {
+        auto doubpts = std::make_tuple(c.d1, c.d2, c.d3);
+        auto ts = bezier_roots<T>(doubpts);
+        if (ts.size() > 2) {
+            for (unsigned i = 1; i < ts.size()-1; i++) {
+                found.double_points.push_back(static_cast<rvgf>(ts[i]));
+            }
+        }
+    }
+    // A discriminant within the tolerance of zero is a near cusp. Its
+    // sign, and so which parameters we found, cannot be trusted
+    return !almost_zero && !is_fragile(d, std::fabs(d1d3)+d2d2);
+}
+
+template <typename T>
+inline bool analyze(const R2 &p0, const R2 &p1, const R2 &p2,
+    const R2 &p3, found_parameters &found) {
+    // Shift points so p0 is at the origin
+    auto shift = [&p0](const R2 &p, int i) {
+        return static_cast<T>(p[i])-static_cast<T>(p0[i]);
+    };
+    return find_parameters(make_coefficients(shift(p1, 0), shift(p1, 1),
+        shift(p2, 0), shift(p2, 1), shift(p3, 0), shift(p3, 1)), found);
+}
+
+// Analyses in double precision a cubic whose single-precision
+// analysis was not robust. Returns true if it did so.
+inline bool escalate(bool robust, const R2 &p0, const R2 &p1,
+    const R2 &p2, const R2 &p3, found_parameters &found) {
+    if (robust || (precision_escalation::try_single() &&
+        !precision_escalation::allowed())) {
+        return false;
+    }
+    found.inflections.clear();
+    found.double_points.clear();
+    analyze<double>(p0, p1, p2, p3, found);
+    return true;
+}
+
+} // namespace cubic_parameters
+
 template <typename SINK>
 class input_path_f_find_cubic_parameters final:
     public i_sink<input_path_f_find_cubic_parameters<SINK>>,
@@ -59,51 +181,16 @@ friend i_sink<input_path_f_find_cubic_parameters<SINK>>;
 friend i_point_input_path<input_path_f_find_cubic_parameters<SINK>>;
 
     void do_cubic_segment(const R2 &p0, const R2 &p1, const R2 &p2, const R2 &p3) {
-        using util::det;
-        using util::is_almost_equal;
-        // Shift points so p0 is at the origin
-        R2 u0 = R2{0,0};
-        R2 u1 = p1-p0;
-        R2 u2 = p2-p0;
-        R2 u3 = p3-p0;
-		// Compute det of minors and from them the
-        // discriminant of the inflection polynomial
-		rvgf b3 = 3*det(u1, u2, u3);
-		rvgf b2 = det(u0, u2, u3);
-		rvgf b1 = det(u0, u1, u3);
-		rvgf b0 = 3*det(u0, u1, u2);
-        rvgf d1 = 2*det(b1, b0, b2, b1);
-        rvgf d2 = det(b1, b0, b3, b2);
-        rvgf d3 = 2*det(b2, b1, b3, b2);
-        rvgf d1d3 = d1*d3;
-        rvgf d2d2 = d2*d2;
-        bool almost_zero = is_almost_equal(d1d3, d2d2);
-        rvgf d = d1d3-d2d2; // Finally, the discriminant
-        // If the discriminant is positive, we have a serpentine
-        // We simply find the parameters for the inflections
-        if (d > 0 || almost_zero) {
-            // We know the cubic inflection polynomial given by
-            // std::make_tuple(b0, b1, b2, b3) really is a
-            // quadratic because the curve is integral.
-            // So we lower the degree before looking for roots
-            auto infls = std::make_tuple(b0, rvgf{.25}*(3*(b1+b2)-(b0+b3)), b3);
-            auto ts = bezier_roots<rvgf>(infls);
-            if (ts.size() > 2) {
-                for (unsigned i = 1; i < ts.size()-1; i++) {
-                    m_sink.inflection_parameter(ts[i]);
-                }
-            }
+        cubic_parameters::found_parameters found;
+        bool robust = precision_escalation::try_single() &&
+            cubic_parameters::analyze<rvgf>(p0, p1, p2, p3, found);
+        precision_escalation::count_cubic(cubic_parameters::escalate(
+            robust, p0, p1, p2, p3, found));
+        for (auto t: found.inflections) {
+            m_sink.inflection_parameter(t);
         }
-        // If the discriminant is negative, we have a loop
-        // We simply find the parameters for the double-point
-        if (d < 0 || almost_zero) {
-            auto doubpts = std::make_tuple(d1, d2, d3);
-            auto ts = bezier_roots<rvgf>(doubpts);
-            if (ts.size() > 2) {
-                for (unsigned i = 1; i < ts.size()-1; i++) {
-                    m_sink.double_point_parameter(ts[i]);
-                }
-            }
+        for (auto t: found.double_points) {
+            m_sink.double_point_parameter(t);
         }
         m_sink.cubic_segment(p0, p1, p2, p3);
     }
@@ -29,6 +29,91 @@
 
 namespace rvg {
 
+namespace monotonic_parameters {
+
+// Roots of the derivative of a one-dimensional cubic, including the
+// 0 and 1 endpoints
+inline auto cubic_segment_roots(rvgf a0, rvgf a1, rvgf a2, rvgf a3) {
+    return bezier_roots<rvgf>(
+        bezier_differences(std::make_tuple(a0, a1, a2, a3)));
+}
+
+template <typename SINK>
+void quadratic_segment_extremes(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+    rvgf x2, rvgf y2, SINK &sink) {
+    using namespace boost::adaptors;
+    auto x = std::make_tuple(x0, x1, x2);
+    auto dx = bezier_differences(x);
+    auto tdx = bezier_roots<rvgf>(dx);
+    for (auto t: tdx | sliced(1, tdx.size()-1)) {
+        sink.root_dx_parameter(t);
+    }
+    auto y = std::make_tuple(y0, y1, y2);
+    auto dy = bezier_differences(y);
+    auto tdy = bezier_roots<rvgf>(dy);
+    for (auto t: tdy | sliced(1, tdy.size()-1)) {
+        sink.root_dy_parameter(t);
+    }
+}
+
+// To find the zeros of the derivatie of a rational curve, we can
+// ignore the denominator w^2 in x' = (w u' - u w')/w^2
+// and y' = (w v' - v w')/w^2
+// When computing tangents, we only care about the ratio
+// x':y', and therefore we can again ignore it w^2
+// So we always work with (w u' - u w') and (w v' - v w').
+template <typename SINK>
+void rational_quadratic_segment_extremes(rvgf u0, rvgf v0,
+    rvgf u1, rvgf v1, rvgf w1, rvgf u2, rvgf v2, SINK &sink) {
+    using namespace boost::adaptors;
+    auto w = std::make_tuple(1.f, w1, 1.f);
+    auto dw = bezier_differences(w);
+
+    auto u = std::make_tuple(u0, u1, u2);
+    auto du = bezier_differences(u);
+    auto dx = bezier_lower_degree(
+        tuple_zip_map(
+            bezier_product<rvgf>(w, du),
+            bezier_product<rvgf>(u, dw),
+            std::minus<rvgf>{}
+        )
+    );
+    auto tdx = bezier_roots<rvgf>(dx);
+    for (auto t: tdx | sliced(1, tdx.size()-1)) {
+        sink.root_dx_parameter(t);
+    }
+
+    auto v = std::make_tuple(v0, v1, v2);
+    auto dv = bezier_differences(v);
+    auto dy = bezier_lower_degree(
+        tuple_zip_map(
+            bezier_product<rvgf>(w, dv),
+            bezier_product<rvgf>(v, dw),
+            std::minus<rvgf>{}
+        )
+    );
+    auto tdy = bezier_roots<rvgf>(dy);
+    for (auto t: tdy | sliced(1, tdy.size()-1)) {
+        sink.root_dy_parameter(t);
+    }
+}
+
+template <typename SINK>
+void cubic_segment_extremes(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+    rvgf x2, rvgf y2, rvgf x3, rvgf y3, SINK &sink) {
+    using namespace boost::adaptors;
+    auto tdx = cubic_segment_roots(x0, x1, x2, x3);
+    for (auto t: tdx | sliced(1, tdx.size()-1)) {
+        sink.root_dx_parameter(t);
+    }
+    auto tdy = cubic_segment_roots(y0, y1, y2, y3);
+    for (auto t: tdy | sliced(1, tdy.size()-1)) {
+        sink.root_dy_parameter(t);
+    }
+}
+
+} // namespace monotonic_parameters
+
 template <typename SINK>
 class input_path_f_find_monotonic_parameters final:
     public i_sink<input_path_f_find_monotonic_parameters<SINK>>,
@@ -63,95 +148,25 @@ friend i_sink<input_path_f_find_monotonic_parameters<SINK>>;
 
 friend i_input_path<input_path_f_find_monotonic_parameters<SINK>>;
 
-    void quadratic_segment_extremes(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
-        rvgf x2, rvgf y2) {
-        using namespace boost::adaptors;
-        auto x = std::make_tuple(x0, x1, x2);
-        auto dx = bezier_differences(x);
-        auto tdx = bezier_roots<rvgf>(dx);
-        for (auto t: tdx | sliced(1, tdx.size()-1)) {
-            m_sink.root_dx_parameter(t);
-        }
-        auto y = std::make_tuple(y0, y1, y2);
-        auto dy = bezier_differences(y);
-        auto tdy = bezier_roots<rvgf>(dy);
-        for (auto t: tdy | sliced(1, tdy.size()-1)) {
-            m_sink.root_dy_parameter(t);
-        }
-    }
-
     void do_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
         rvgf x2, rvgf y2) {
-        quadratic_segment_extremes(x0, y0, x1, y1, x2, y2);
+        monotonic_parameters::quadratic_segment_extremes(x0, y0, x1, y1,
+            x2, y2, m_sink);
         return m_sink.quadratic_segment(x0, y0, x1, y1, x2, y2);
     }
 
-    // To find the zeros of the derivatie of a rational curve, we can
-    // ignore the denominator w^2 in x' = (w u' - u w')/w^2
-    // and y' = (w v' - v w')/w^2
-    // When computing tangents, we only care about the ratio
-    // x':y', and therefore we can again ignore it w^2
-    // So we always work with (w u' - u w') and (w v' - v w').
-    void rational_quadratic_segment_extremes(rvgf u0, rvgf v0,
-        rvgf u1, rvgf v1, rvgf w1, rvgf u2, rvgf v2) {
-        using namespace boost::adaptors;
-        auto w = std::make_tuple(1.f, w1, 1.f);
-        auto dw = bezier_differences(w);
-
-        auto u = std::make_tuple(u0, u1, u2);
-        auto du = bezier_differences(u);
-        auto dx = bezier_lower_degree(
-            tuple_zip_map(
-                bezier_product<rvgf>(w, du),
-                bezier_product<rvgf>(u, dw),
-                std::minus<rvgf>{}
-            )
-        );
-        auto tdx = bezier_roots<rvgf>(dx);
-        for (auto t: tdx | sliced(1, tdx.size()-1)) {
-            m_sink.root_dx_parameter(t);
-        }
-
-        auto v = std::make_tuple(v0, v1, v2);
-        auto dv = bezier_differences(v);
-        auto dy = bezier_lower_degree(
-            tuple_zip_map(
-                bezier_product<rvgf>(w, dv),
-                bezier_product<rvgf>(v, dw),
-                std::minus<rvgf>{}
-            )
-        );
-        auto tdy = bezier_roots<rvgf>(dy);
-        for (auto t: tdy | sliced(1, tdy.size()-1)) {
-            m_sink.root_dy_parameter(t);
-        }
-    }
-
     void do_rational_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
         rvgf w1, rvgf x2, rvgf y2) {
-        rational_quadratic_segment_extremes(x0, y0, x1, y1, w1, x2, y2);
+        monotonic_parameters::rational_quadratic_segment_extremes(x0, y0,
+            x1, y1, w1, x2, y2, m_sink);
         return m_sink.rational_quadratic_segment(x0, y0, x1, y1, w1,
             x2, y2);
     }
 
-    void cubic_segment_extremes(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
-        rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
-        using namespace boost::adaptors;
-        auto dx = bezier_differences(std::make_tuple(x0, x1, x2, x3));
-        auto tdx = bezier_roots<rvgf>(dx);
-        for (auto t: tdx | sliced(1, tdx.size()-1)) {
-            m_sink.root_dx_parameter(t);
-        }
-        auto dy = bezier_differences(std::make_tuple(y0, y1, y2, y3));
-        auto tdy = bezier_roots<rvgf>(dy);
-        for (auto t: tdy | sliced(1, tdy.size()-1)) {
-            m_sink.root_dy_parameter(t);
-        }
-    }
-
     void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
         rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
-        cubic_segment_extremes(x0, y0, x1, y1, x2, y2, x3, y3);
+        monotonic_parameters::cubic_segment_extremes(x0, y0, x1, y1,
+            x2, y2, x3, y3, m_sink);
         return m_sink.cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3);
     }
 
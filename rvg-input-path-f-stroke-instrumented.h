@@ -0,0 +1,100 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_INPUT_PATH_F_STROKE_INSTRUMENTED_H
+#define RVG_INPUT_PATH_F_STROKE_INSTRUMENTED_H
+
+#include "rvg-input-path-f-stroke.h"
+#include "rvg-path-f-instrument.h"
+#include "rvg-path-instrumentation.h"
+
+namespace rvg {
+
+// Puts a path_f_instrument in front of each stage. The constructor
+// resets the instrumentation with one stage for each e_stroke_stage.
+class stroke_stage_instrument {
+
+    path_instrumentation &m_instrumentation;
+
+public:
+
+    explicit stroke_stage_instrument(path_instrumentation &instrumentation):
+        m_instrumentation(instrumentation) {
+        m_instrumentation.reset({
+#define RVG_STROKE_STAGE_NAME(name) #name,
+            RVG_STROKE_STAGES(RVG_STROKE_STAGE_NAME)
+#undef RVG_STROKE_STAGE_NAME
+        });
+    }
+
+    template <typename SINK>
+    auto operator()(e_stroke_stage stage, SINK &&sink) const {
+        return make_path_f_instrument(
+            m_instrumentation[static_cast<size_t>(stage)],
+            std::forward<SINK>(sink));
+    }
+};
+
+// The stroking pipeline of rvg-input-path-f-stroke.h, with a
+// path_f_instrument in front of each stage and of the sink. The
+// instrumentation is reset with one stage for each.
+template <typename SINK>
+static auto
+make_input_path_f_stroke_instrumented(
+    rvgf width,
+    stroke_style::const_ptr style,
+    rvgf ptol,
+    rvgf ftol,
+    rvgf alpha,
+    rvgf delta,
+    path_instrumentation &instrumentation,
+    SINK &&sink) {
+  return make_input_path_f_stroke_wrapped(width, style, ptol, ftol, alpha,
+    delta, stroke_find_cubic_parameters{},
+    stroke_stage_instrument{instrumentation}, std::forward<SINK>(sink));
+}
+
+template <typename SINK>
+static auto
+make_input_path_f_stroke_instrumented(
+    rvgf width,
+    stroke_style::const_ptr style,
+    rvgf ptol,
+    rvgf alpha,
+    rvgf delta,
+    path_instrumentation &instrumentation,
+    SINK &&sink) {
+  return make_input_path_f_stroke_instrumented(width, style, ptol, ptol,
+    alpha, delta, instrumentation, std::forward<SINK>(sink));
+}
+
+template <typename SINK>
+static auto
+make_input_path_f_stroke_instrumented(
+    rvgf width,
+    stroke_style::const_ptr style,
+    path_instrumentation &instrumentation,
+    SINK &&sink) {
+  return make_input_path_f_stroke_instrumented(width, style,
+      RVG_STROKE_APPROXIMATION_TOLERANCE,
+      RVG_REGULARITY_ANGULAR_TOLERANCE,
+      RVG_REGULARITY_NUMERICAL_TOLERANCE*
+          std::numeric_limits<rvgf>::epsilon(),
+    instrumentation, std::forward<SINK>(sink));
+}
+
+} // namespace rvg
+
+#endif
@@ -32,32 +32,146 @@
 
 namespace rvg {
 
-template <typename SINK>
+#ifndef RVG_THICKEN_WITH_CUBICS
+#define RVG_STROKE_STAGE_FIND_CUBIC_PARAMETERS(X) X(find_cubic_parameters)
+#else
+#define RVG_STROKE_STAGE_FIND_CUBIC_PARAMETERS(X)
+#endif
+
+// Stages of the stroking pipeline, in order, followed by the sink.
+// X(name) is expanded for each, so the names cannot drift from
+// e_stroke_stage.
+#define RVG_STROKE_STAGES(X) \
+    X(close_contours) \
+    RVG_STROKE_STAGE_FIND_CUBIC_PARAMETERS(X) \
+    X(find_tolerance_offsetting_parameters) \
+    X(to_regular_path) \
+    X(orient) \
+    X(find_width_offsetting_parameters) \
+    X(to_decorated_path) \
+    X(simplify_joins) \
+    X(forward_and_backward) \
+    X(thicken) \
+    X(simplify) \
+    X(sink)
+
+enum class e_stroke_stage {
+#define RVG_STROKE_STAGE_ENUMERATOR(name) name,
+    RVG_STROKE_STAGES(RVG_STROKE_STAGE_ENUMERATOR)
+#undef RVG_STROKE_STAGE_ENUMERATOR
+};
+
+// Wrappers receive each stage and return what the stage upstream of it
+// should feed. This one returns the stage itself.
+struct stroke_stage_identity {
+    template <typename SINK>
+    SINK &&operator()(e_stroke_stage, SINK &&sink) const {
+        return std::forward<SINK>(sink);
+    }
+};
+
+// Makes the find_cubic_parameters stage. The stage can instead replay
+// parameters found beforehand (see cubic_parameters_batch).
+struct stroke_find_cubic_parameters {
+    template <typename SINK>
+    auto operator()(SINK &&sink) const {
+        return make_input_path_f_find_cubic_parameters(
+            std::forward<SINK>(sink));
+    }
+};
+
+// ptol is the stroke approximation tolerance, used to find the
+// offsetting parameters, split the path into regular pieces, and
+// simplify the output. ftol is the tolerance used when fitting Bezier
+// segments to the offsets in the thicken stage. The
+// find_cubic_parameters stage is made by find_cubic_parameters (see
+// stroke_find_cubic_parameters). Each stage, and the sink, goes
+// through wrap (see stroke_stage_identity, and stroke_stage_instrument
+// in rvg-input-path-f-stroke-instrumented.h).
+//
+// The offsetting parameters are found twice, at ptol on the input
+// segments and at width/2 on the oriented regular pieces. The passes
+// cannot be fused: the second analyses pieces that only exist after
+// to_regular_path splits at the parameters the first one found, and
+// orient may reverse them. Root brackets depend on the piece interval,
+// so they cannot be shared either. Sharing only the curvature
+// polynomials saves too little to be worth a cache (the second pass
+// is under 10% of the stroke time).
+template <typename FIND_CUBIC_PARAMETERS, typename WRAP, typename SINK>
 static auto
-make_input_path_f_stroke(
+make_input_path_f_stroke_wrapped(
     rvgf width,
     stroke_style::const_ptr style,
     rvgf ptol,
+    rvgf ftol,
     rvgf alpha,
     rvgf delta,
+    const FIND_CUBIC_PARAMETERS &find_cubic_parameters,
+    const WRAP &wrap,
     SINK &&sink) {
-  return make_input_path_f_close_contours(
+  using S = e_stroke_stage;
+#ifdef RVG_THICKEN_WITH_CUBICS
+  (void) find_cubic_parameters;
+#endif
+  return wrap(S::close_contours,
+    make_input_path_f_close_contours(
 #ifndef RVG_THICKEN_WITH_CUBICS
-      make_input_path_f_find_cubic_parameters(
+     wrap(S::find_cubic_parameters,
+      find_cubic_parameters(
 #endif
+       wrap(S::find_tolerance_offsetting_parameters,
         make_path_f_find_offsetting_parameters(ptol,
+         wrap(S::to_regular_path,
           make_input_path_f_to_regular_path(ptol, alpha, delta,
+           wrap(S::orient,
             make_regular_path_f_orient(
+             wrap(S::find_width_offsetting_parameters,
               make_path_f_find_offsetting_parameters(width/2,
+               wrap(S::to_decorated_path,
                 make_regular_path_f_to_decorated_path(width, style,
+                 wrap(S::simplify_joins,
                   make_decorated_path_f_simplify_joins(width/2,
+                   wrap(S::forward_and_backward,
                     make_decorated_path_f_forward_and_backward(
-                      make_decorated_path_f_thicken(width, style, ptol,
-                        make_input_path_f_simplify(ptol, sink)))))))))
+                     wrap(S::thicken,
+                      make_decorated_path_f_thicken(width, style, ftol,
+                       wrap(S::simplify,
+                        make_input_path_f_simplify(ptol,
+                         wrap(S::sink,
+                          std::forward<SINK>(sink))))))))))))))))))))
 #ifndef RVG_THICKEN_WITH_CUBICS
-        )
+      ))
 #endif
-      );
+    ));
+}
+
+template <typename SINK>
+static auto
+make_input_path_f_stroke(
+    rvgf width,
+    stroke_style::const_ptr style,
+    rvgf ptol,
+    rvgf ftol,
+    rvgf alpha,
+    rvgf delta,
+    SINK &&sink) {
+  return make_input_path_f_stroke_wrapped(width, style, ptol, ftol, alpha,
+    delta, stroke_find_cubic_parameters{}, stroke_stage_identity{},
+    std::forward<SINK>(sink));
+}
+
+// The thicken stage uses the stroke approximation tolerance as well
+template <typename SINK>
+static auto
+make_input_path_f_stroke(
+    rvgf width,
+    stroke_style::const_ptr style,
+    rvgf ptol,
+    rvgf alpha,
+    rvgf delta,
+    SINK &&sink) {
+  return make_input_path_f_stroke(width, style, ptol, ptol, alpha, delta,
+    std::forward<SINK>(sink));
 }
 
 template <typename SINK>
@@ -22,6 +22,7 @@
 #include "rvg-i-image.h"
 #include "rvg-image.h"
 #include "rvg-pngio.h"
+#include "rvg-image-compare.h"
 
 #include "rvg-lua-image.h"
 
@@ -89,9 +90,55 @@ static int is_image(lua_State *L) {
     return 1;
 }
 
+// Images loaded with png.load(file, 4) from 8-bit files
+static const rvg::packed_image<uint8_t, 4> *check_rgba8(lua_State *L,
+    int idx) {
+    auto img = rvg_lua_check_either<
+        rvg::i_image::const_ptr,
+        rvg::i_image::ptr
+    >(L, idx);
+    if (img->get_channel_type() != rvg::e_channel_type::uint8_t_ ||
+        img->get_num_channels() != 4 ||
+        img->get_organization() != rvg::e_organization::packed) {
+        luaL_argerror(L, idx, "expected packed 8-bit RGBA image");
+    }
+    return static_cast<const rvg::packed_image<uint8_t, 4> *>(img.get());
+}
+
+static int compare_image(lua_State *L) {
+    auto a = check_rgba8(L, 1);
+    auto b = check_rgba8(L, 2);
+    auto fuzz = static_cast<float>(luaL_optnumber(L, 3, 0.));
+    rvg::packed_image<uint8_t, 4>::ptr diff;
+    if (lua_toboolean(L, 4)) {
+        diff = rvg::make_intrusive<rvg::packed_image<uint8_t, 4>>();
+    }
+    rvg::image_comparison result;
+    if (!rvg::compare_images(*a, *b, fuzz, &result, diff.get())) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "image sizes differ");
+        return 2;
+    }
+    lua_createtable(L, 0, 4);
+    lua_pushnumber(L, result.rmse);
+    lua_setfield(L, -2, "rmse");
+    lua_pushnumber(L, result.max_error);
+    lua_setfield(L, -2, "max_error");
+    lua_pushinteger(L, result.mismatches);
+    lua_setfield(L, -2, "mismatches");
+    lua_pushinteger(L, result.pixels);
+    lua_setfield(L, -2, "pixels");
+    if (diff) {
+        rvg_lua_push<rvg::i_image::ptr>(L, diff);
+        return 2;
+    }
+    return 1;
+}
+
 static const luaL_Reg mod_image[] = {
     {"image", create_image},
     {"is_image", is_image},
+    {"compare", compare_image},
     {NULL, NULL}
 };
 
@@ -17,6 +17,7 @@
 #include "rvg-svg-path-parse.h"
 
 #include "rvg-path-f-to-lua-path.h"
+#include "rvg-path-data-file.h"
 #include "rvg-lua-path-data.h"
 
 using namespace rvg;
@@ -336,10 +337,10 @@ static luaL_Reg const_path_data__index[] = {
 
 static path_data::ptr create_from_string(lua_State *L, int base) {
     const char *svg = lua_tostring(L, base);
-    auto p = make_intrusive<path_data>();
-    rvg_lua_push<path_data::ptr>(L, p);
-    if (!svg_path_iterate(svg, *p))
+    auto p = make_path_data_from_svg_path(svg);
+    if (!p)
         luaL_argerror(L, 1, "invalid SVG path data");
+    rvg_lua_push<path_data::ptr>(L, p);
     return p;
 }
 
@@ -408,8 +409,85 @@ static int create(lua_State *L) {
     return 1;
 }
 
+static size_t check_path_data_file_index(lua_State *L, int idx,
+    const path_data_file &file) {
+    auto i = luaL_checkinteger(L, idx)-1;
+    if (i < 0 || static_cast<size_t>(i) >= file.size())
+        luaL_argerror(L, idx, "index out of bounds");
+    return static_cast<size_t>(i);
+}
+
+static int path_data_file_size(lua_State *L) {
+    auto file = rvg_lua_check<path_data_file::ptr>(L, 1);
+    lua_pushinteger(L, static_cast<lua_Integer>(file->size()));
+    return 1;
+}
+
+static int path_data_file_path_data(lua_State *L) {
+    auto file = rvg_lua_check<path_data_file::ptr>(L, 1);
+    auto i = check_path_data_file_index(L, 2, *file);
+    rvg_lua_push<path_data::ptr>(L, file->get_path_data(i));
+    return 1;
+}
+
+static int path_data_file_iterate(lua_State *L) {
+    auto file = rvg_lua_check<path_data_file::ptr>(L, 1);
+    auto i = check_path_data_file_index(L, 2, *file);
+    file->get_view(i).iterate(make_path_f_to_lua_path_in_stack(L, 3));
+    return 0;
+}
+
+static int path_data_file_riterate(lua_State *L) {
+    auto file = rvg_lua_check<path_data_file::ptr>(L, 1);
+    auto i = check_path_data_file_index(L, 2, *file);
+    file->get_view(i).riterate(make_path_f_to_lua_path_in_stack(L, 3));
+    return 0;
+}
+
+static luaL_Reg path_data_file__index[] = {
+    {"size", path_data_file_size },
+    {"path_data", path_data_file_path_data },
+    {"iterate", path_data_file_iterate },
+    {"riterate", path_data_file_riterate },
+    { nullptr, nullptr }
+};
+
+static int write_path_data_file(lua_State *L) {
+    const char *filename = luaL_checkstring(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int n = rvg_lua_len(L, 2);
+    std::vector<path_data::const_ptr> paths;
+    paths.reserve(n);
+    for (int i = 1; i <= n; ++i) {
+        lua_rawgeti(L, 2, i);
+        paths.push_back(rvg_lua_check_either<path_data::const_ptr,
+            path_data::ptr>(L, -1));
+        lua_pop(L, 1);
+    }
+    if (!rvg::write_path_data_file(paths, filename)) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "failed to write path data file");
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static int map_path_data_file(lua_State *L) {
+    auto file = rvg::map_path_data_file(luaL_checkstring(L, 1));
+    if (!file) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "failed to map path data file");
+        return 2;
+    }
+    rvg_lua_push<path_data_file::ptr>(L, file);
+    return 1;
+}
+
 static const luaL_Reg mod_path_data[] = {
     {"path_data", create},
+    {"write_path_data_file", write_path_data_file},
+    {"map_path_data_file", map_path_data_file},
     {NULL, NULL}
 };
 
@@ -423,6 +501,11 @@ int rvg_lua_path_data_init(lua_State *L, int ctxidx) {
         rvg_lua_setmethods<path_data::const_ptr>(L, const_path_data__index,
             0, ctxidx);
     }
+    if (!rvg_lua_typeexists<path_data_file::ptr>(L, ctxidx)) {
+        rvg_lua_createtype<path_data_file::ptr>(L, "path_data_file", ctxidx);
+        rvg_lua_setmethods<path_data_file::ptr>(L, path_data_file__index,
+            0, ctxidx);
+    }
     return 0;
 }
 
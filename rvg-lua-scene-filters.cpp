@@ -188,8 +188,71 @@ static int filter_make_scene_f_spy(lua_State *L) {
     }
 }
 
+static int stroke_instance_cache_get_instances(lua_State *L) {
+    lua_pushinteger(L, static_cast<lua_Integer>(
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_instances()));
+    return 1;
+}
+
+static int stroke_instance_cache_get_strokes(lua_State *L) {
+    lua_pushinteger(L, static_cast<lua_Integer>(
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_strokes()));
+    return 1;
+}
+
+static int stroke_instance_cache_get_dedup_ratio(lua_State *L) {
+    lua_pushnumber(L,
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_dedup_ratio());
+    return 1;
+}
+
+static int stroke_instance_cache_get_path_lookups(lua_State *L) {
+    lua_pushinteger(L, static_cast<lua_Integer>(
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_path_lookups()));
+    return 1;
+}
+
+static int stroke_instance_cache_get_unique_paths(lua_State *L) {
+    lua_pushinteger(L, static_cast<lua_Integer>(
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_unique_paths()));
+    return 1;
+}
+
+static int stroke_instance_cache_get_stroke_time(lua_State *L) {
+    lua_pushnumber(L,
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_stroke_time());
+    return 1;
+}
+
+static int stroke_instance_cache_get_saved_time(lua_State *L) {
+    lua_pushnumber(L,
+        rvg_lua_check<stroke_instance_cache::ptr>(L, 1)->get_saved_time());
+    return 1;
+}
+
+static luaL_Reg stroke_instance_cache__index[] = {
+    {"get_instances", stroke_instance_cache_get_instances },
+    {"get_strokes", stroke_instance_cache_get_strokes },
+    {"get_dedup_ratio", stroke_instance_cache_get_dedup_ratio },
+    {"get_path_lookups", stroke_instance_cache_get_path_lookups },
+    {"get_unique_paths", stroke_instance_cache_get_unique_paths },
+    {"get_stroke_time", stroke_instance_cache_get_stroke_time },
+    {"get_saved_time", stroke_instance_cache_get_saved_time },
+    { nullptr, nullptr }
+};
+
+static int filter_stroke_instance_cache(lua_State *L) {
+    return rvg_lua_push<stroke_instance_cache::ptr>(L,
+        make_intrusive<stroke_instance_cache>());
+}
+
 static auto make_lua_scene_f_stroke(lua_State *L) {
-    if (lua_gettop(L) > 2) {
+    if (lua_gettop(L) > 2 &&
+        rvg_lua_is<stroke_instance_cache::ptr>(L, 2)) {
+        return make_scene_f_stroke(rvg_lua_check<e_stroke_method>(L, 1),
+            rvg_lua_check<stroke_instance_cache::ptr>(L, 2),
+            make_scene_f_to_lua_scene_ref(L, 3));
+    } else if (lua_gettop(L) > 2) {
         return make_scene_f_stroke(rvg_lua_check<e_stroke_method>(L, 1),
             lua_toboolean(L, 2), make_scene_f_to_lua_scene_ref(L, 3));
     } else {
@@ -205,6 +268,7 @@ static int filter_make_scene_f_stroke(lua_State *L) {
 static const luaL_Reg modfilter[] = {
     {"make_scene_f_spy", filter_make_scene_f_spy},
     {"make_scene_f_stroke", filter_make_scene_f_stroke},
+    {"stroke_instance_cache", filter_stroke_instance_cache},
     {NULL, NULL}
 };
 
@@ -222,6 +286,12 @@ int rvg_lua_scene_filters_init(lua_State *L, int ctxidx) {
         decltype(make_lua_scene_f_stroke(nullptr))
     >(L, "scene_f_stroke", ctxidx);
 
+    if (!rvg_lua_typeexists<stroke_instance_cache::ptr>(L, ctxidx)) {
+        rvg_lua_createtype<stroke_instance_cache::ptr>(L,
+            "stroke_instance_cache", ctxidx);
+        rvg_lua_setmethods<stroke_instance_cache::ptr>(L,
+            stroke_instance_cache__index, 0, ctxidx);
+    }
 
     return 0;
 }
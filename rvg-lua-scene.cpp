@@ -21,6 +21,8 @@
 #include "rvg-lua-scene.h"
 #include "rvg-lua-facade.h"
 #include "rvg-lua-rgba.h"
+#include "rvg-lua-bbox.h"
+#include "rvg-scene-data-file.h"
 
 using namespace rvg;
 
@@ -67,8 +69,35 @@ static int create(lua_State *L) {
     return rvg_lua_push<scene>(L, rvg_lua_scene_create(L, 1));
 }
 
+// Returns a table with the scene, window, and viewport in a file written
+// by scene_f_write_binary, just like the Lua programs read by process.lua
+static int load_scene_data_file(lua_State *L) {
+    auto file = map_scene_data_file(luaL_checkstring(L, 1));
+    if (!file) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "failed to map scene data file");
+        return 2;
+    }
+    auto data = file->get_scene_data();
+    if (!data) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "corrupt scene data file");
+        return 2;
+    }
+    lua_createtable(L, 0, 3);
+    rvg_lua_push<scene>(L, scene{data,
+        file->get_background_color()}.transformed(file->get_xf()));
+    lua_setfield(L, -2, "scene");
+    rvg_lua_push<window>(L, file->get_window());
+    lua_setfield(L, -2, "window");
+    rvg_lua_push<viewport>(L, file->get_viewport());
+    lua_setfield(L, -2, "viewport");
+    return 1;
+}
+
 static const luaL_Reg mod_scene[] = {
     {"scene", create},
+    {"load_scene_data_file", load_scene_data_file},
     {NULL, NULL}
 };
 
@@ -76,6 +105,7 @@ int rvg_lua_scene_init(lua_State *L, int ctxidx) {
     rvg_lua_rgba_init(L, ctxidx);
     rvg_lua_xform_init(L, ctxidx);
     rvg_lua_scene_data_init(L, ctxidx);
+    rvg_lua_bbox_init(L, ctxidx);
     if (!rvg_lua_typeexists<scene>(L, ctxidx)) {
 		rvg_lua_createtype<scene>(L, "scene", ctxidx);
 		rvg_lua_set_xformable<scene>(L, ctxidx);
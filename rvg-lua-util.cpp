@@ -19,6 +19,7 @@
 #include "rvg-util.h"
 #include "rvg-floatint.h"
 #include "rvg-xform-svd.h"
+#include "rvg-memory-stats.h"
 
 #ifdef USE_GPERFTOOLS
 #include <gperftools/profiler.h>
@@ -100,6 +101,38 @@ static int util_profiler_stop(lua_State *L) {
     return 0;
 }
 
+static int util_memory_count(lua_State *L) {
+    lua_pushboolean(L, rvg::start_counting_allocations());
+    return 1;
+}
+
+// Unknown fields are left nil
+static void util_set_memory_field(lua_State *L, const char *name,
+    int64_t value) {
+    if (value >= 0) {
+        lua_pushinteger(L, static_cast<lua_Integer>(value));
+        lua_setfield(L, -2, name);
+    }
+}
+
+static int util_memory_stats(lua_State *L) {
+    auto stats = rvg::get_memory_stats();
+    lua_newtable(L);
+    util_set_memory_field(L, "allocations", stats.allocations);
+    util_set_memory_field(L, "allocated_bytes", stats.allocated_bytes);
+    util_set_memory_field(L, "live_bytes", stats.live_bytes);
+    util_set_memory_field(L, "peak_live_bytes", stats.peak_live_bytes);
+    util_set_memory_field(L, "rss", stats.rss);
+    util_set_memory_field(L, "peak_rss", stats.peak_rss);
+    return 1;
+}
+
+static int util_memory_reset_peaks(lua_State *L) {
+    (void) L;
+    rvg::reset_memory_peaks();
+    return 0;
+}
+
 static const luaL_Reg modutil[] = {
     {"is_almost_equal", util_is_almost_equal},
     {"is_almost_one", util_is_almost_one},
@@ -110,6 +143,9 @@ static const luaL_Reg modutil[] = {
     {"sgn", util_sgn},
     {"profiler_start", util_profiler_start},
     {"profiler_stop", util_profiler_stop},
+    {"memory_count", util_memory_count},
+    {"memory_stats", util_memory_stats},
+    {"memory_reset_peaks", util_memory_reset_peaks},
     {NULL, NULL}
 };
 
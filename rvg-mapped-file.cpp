@@ -0,0 +1,89 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "rvg-mapped-file.h"
+
+namespace rvg {
+
+mapped_file::mapped_file(void):
+    m_base(nullptr),
+    m_length(0) {
+    ;
+}
+
+mapped_file::~mapped_file() {
+#ifndef _WIN32
+    if (m_base) {
+        munmap(const_cast<unsigned char *>(m_base), m_length);
+    }
+#endif
+}
+
+bool mapped_file::open(const char *filename) {
+#ifdef _WIN32
+    // No mmap here, so read the whole file into an aligned buffer
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        return false;
+    }
+    if (fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return false;
+    }
+    long length = ftell(f);
+    if (length < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return false;
+    }
+    m_length = static_cast<size_t>(length);
+    m_buffer.resize((m_length+7)/8);
+    bool ok = fread(m_buffer.data(), 1, m_length, f) == m_length;
+    fclose(f);
+    if (!ok) {
+        return false;
+    }
+    m_base = reinterpret_cast<const unsigned char *>(m_buffer.data());
+#else
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void *base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    m_base = static_cast<const unsigned char *>(base);
+    m_length = length;
+#endif
+    return true;
+}
+
+} // namespace rvg
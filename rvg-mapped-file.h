@@ -0,0 +1,59 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_MAPPED_FILE_H
+#define RVG_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rvg {
+
+// A read-only file mapped into memory. Where mmap is not available,
+// the whole file is read into a buffer aligned to 8 bytes instead.
+class mapped_file {
+
+    const unsigned char *m_base;
+    size_t m_length;
+#ifdef _WIN32
+    std::vector<uint64_t> m_buffer;
+#endif
+
+public:
+
+    mapped_file(void);
+
+    ~mapped_file();
+
+    mapped_file(const mapped_file &other) = delete;
+    mapped_file &operator=(const mapped_file &other) = delete;
+
+    // Maps the file, returning true on success
+    bool open(const char *filename);
+
+    const unsigned char *get_base(void) const {
+        return m_base;
+    }
+
+    // Size of the file in bytes
+    size_t get_length(void) const {
+        return m_length;
+    }
+};
+
+} // namespace rvg
+
+#endif
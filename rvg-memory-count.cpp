@@ -0,0 +1,170 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "rvg-memory-count.h"
+
+// Replaces the global operator new and delete with versions that keep
+// the size of each block in a header, so live bytes can be tracked.
+// Blocks remember whether they were counted, so starting and stopping
+// at any time keeps the counts consistent. While counting is stopped,
+// the only overhead is the header.
+
+#ifdef RVG_HAVE_MEMORY_COUNT
+
+#define RVG_REPLACEMENT __attribute__((visibility("default")))
+
+namespace {
+
+struct block_header {
+    size_t size;
+    bool counted;
+};
+
+// Keeps the alignment malloc guarantees
+const size_t header_size = (sizeof(block_header) + alignof(max_align_t) - 1)
+    / alignof(max_align_t) * alignof(max_align_t);
+
+std::atomic<bool> counting{false};
+std::atomic<int64_t> allocations{0};
+std::atomic<int64_t> allocated_bytes{0};
+std::atomic<int64_t> live_bytes{0};
+std::atomic<int64_t> peak_live_bytes{0};
+
+void *allocate(size_t size) noexcept {
+    auto *block = static_cast<char *>(std::malloc(header_size + size));
+    if (!block) {
+        return nullptr;
+    }
+    auto *header = reinterpret_cast<block_header *>(block);
+    header->size = size;
+    header->counted = counting.load(std::memory_order_relaxed);
+    if (header->counted) {
+        auto n = static_cast<int64_t>(size);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(n, std::memory_order_relaxed);
+        int64_t live = live_bytes.fetch_add(n, std::memory_order_relaxed)+n;
+        int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !peak_live_bytes.compare_exchange_weak(peak,
+            live, std::memory_order_relaxed)) {
+            ;
+        }
+    }
+    return block + header_size;
+}
+
+void *allocate_or_throw(size_t size) {
+    for ( ;; ) {
+        void *p = allocate(size);
+        if (p) {
+            return p;
+        }
+        auto handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+void deallocate(void *p) noexcept {
+    if (!p) {
+        return;
+    }
+    auto *block = static_cast<char *>(p) - header_size;
+    auto *header = reinterpret_cast<block_header *>(block);
+    if (header->counted) {
+        live_bytes.fetch_sub(static_cast<int64_t>(header->size),
+            std::memory_order_relaxed);
+    }
+    std::free(block);
+}
+
+} // anonymous namespace
+
+RVG_REPLACEMENT void *operator new(size_t size) {
+    return allocate_or_throw(size);
+}
+
+RVG_REPLACEMENT void *operator new[](size_t size) {
+    return allocate_or_throw(size);
+}
+
+RVG_REPLACEMENT void *operator new(size_t size,
+    const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+RVG_REPLACEMENT void *operator new[](size_t size,
+    const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+RVG_REPLACEMENT void operator delete(void *p) noexcept {
+    deallocate(p);
+}
+
+RVG_REPLACEMENT void operator delete[](void *p) noexcept {
+    deallocate(p);
+}
+
+RVG_REPLACEMENT void operator delete(void *p, size_t) noexcept {
+    deallocate(p);
+}
+
+RVG_REPLACEMENT void operator delete[](void *p, size_t) noexcept {
+    deallocate(p);
+}
+
+RVG_REPLACEMENT void operator delete(void *p,
+    const std::nothrow_t &) noexcept {
+    deallocate(p);
+}
+
+RVG_REPLACEMENT void operator delete[](void *p,
+    const std::nothrow_t &) noexcept {
+    deallocate(p);
+}
+
+extern "C" {
+
+void rvg_memory_count_start(void) {
+    counting.store(true, std::memory_order_relaxed);
+}
+
+void rvg_memory_count_stop(void) {
+    counting.store(false, std::memory_order_relaxed);
+}
+
+void rvg_memory_count_get(int64_t *n, int64_t *bytes, int64_t *live,
+    int64_t *peak) {
+    *n = allocations.load(std::memory_order_relaxed);
+    *bytes = allocated_bytes.load(std::memory_order_relaxed);
+    *live = live_bytes.load(std::memory_order_relaxed);
+    *peak = peak_live_bytes.load(std::memory_order_relaxed);
+}
+
+void rvg_memory_count_reset_peak(void) {
+    peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+}
+
+}
+
+#endif // RVG_HAVE_MEMORY_COUNT
@@ -0,0 +1,55 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_MEMORY_COUNT_H
+#define RVG_MEMORY_COUNT_H
+
+#include <cstdint>
+
+// Interface to the counting operator new and delete in
+// rvg-memory-count.cpp. That file is linked into bench-strokers-memory,
+// and built as memcount.so, to be preloaded into the Lua interpreter:
+//
+//   LD_PRELOAD=./memcount.so luapp process.lua -memory ...
+//
+// The functions are declared weak, so code that uses them can be
+// loaded without the counting allocator. They are null in that case.
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#define RVG_MEMORY_COUNT_API \
+    __attribute__((weak, visibility("default")))
+#define RVG_HAVE_MEMORY_COUNT
+#endif
+
+#ifdef RVG_HAVE_MEMORY_COUNT
+extern "C" {
+
+// Allocations are only counted between start and stop
+RVG_MEMORY_COUNT_API void rvg_memory_count_start(void);
+RVG_MEMORY_COUNT_API void rvg_memory_count_stop(void);
+
+// Calls to operator new and bytes requested since counting started,
+// bytes still allocated by those calls, and the largest the latter
+// has been since the last reset
+RVG_MEMORY_COUNT_API void rvg_memory_count_get(int64_t *allocations,
+    int64_t *allocated_bytes, int64_t *live_bytes,
+    int64_t *peak_live_bytes);
+
+RVG_MEMORY_COUNT_API void rvg_memory_count_reset_peak(void);
+
+}
+#endif
+
+#endif // RVG_MEMORY_COUNT_H
@@ -0,0 +1,114 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cstdio>
+
+#ifdef __APPLE__
+#include <sys/resource.h>
+#endif
+
+#include "rvg-memory-count.h"
+#include "rvg-memory-stats.h"
+
+namespace rvg {
+
+namespace {
+
+#if defined(__linux__)
+// Reads the VmRSS and VmHWM lines, in kB
+void get_rss(int64_t *rss, int64_t *peak_rss) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        long long kb = 0;
+        if (sscanf(line, "VmRSS: %lld", &kb) == 1) {
+            *rss = static_cast<int64_t>(kb)*1024;
+        } else if (sscanf(line, "VmHWM: %lld", &kb) == 1) {
+            *peak_rss = static_cast<int64_t>(kb)*1024;
+        }
+    }
+    fclose(f);
+}
+
+// Writing 5 to clear_refs resets VmHWM to VmRSS
+void reset_peak_rss(void) {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+#elif defined(__APPLE__)
+// Only the peak is available, and ru_maxrss is in bytes
+void get_rss(int64_t *, int64_t *peak_rss) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        *peak_rss = static_cast<int64_t>(usage.ru_maxrss);
+    }
+}
+
+void reset_peak_rss(void) {
+    ;
+}
+#else
+void get_rss(int64_t *, int64_t *) {
+    ;
+}
+
+void reset_peak_rss(void) {
+    ;
+}
+#endif
+
+} // anonymous namespace
+
+bool start_counting_allocations(void) {
+#ifdef RVG_HAVE_MEMORY_COUNT
+    if (rvg_memory_count_start) {
+        rvg_memory_count_start();
+        return true;
+    }
+#endif
+    return false;
+}
+
+memory_stats get_memory_stats(void) {
+    memory_stats stats;
+    stats.allocations = stats.allocated_bytes = -1;
+    stats.live_bytes = stats.peak_live_bytes = -1;
+    stats.rss = stats.peak_rss = -1;
+#ifdef RVG_HAVE_MEMORY_COUNT
+    if (rvg_memory_count_get) {
+        rvg_memory_count_get(&stats.allocations, &stats.allocated_bytes,
+            &stats.live_bytes, &stats.peak_live_bytes);
+    }
+#endif
+    get_rss(&stats.rss, &stats.peak_rss);
+    return stats;
+}
+
+void reset_memory_peaks(void) {
+#ifdef RVG_HAVE_MEMORY_COUNT
+    if (rvg_memory_count_reset_peak) {
+        rvg_memory_count_reset_peak();
+    }
+#endif
+    reset_peak_rss();
+}
+
+} // namespace rvg
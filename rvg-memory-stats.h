@@ -0,0 +1,46 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_MEMORY_STATS_H
+#define RVG_MEMORY_STATS_H
+
+#include <cstdint>
+
+namespace rvg {
+
+// Snapshot of the memory used by the process. Allocation counts come
+// from the counting allocator in rvg-memory-count.cpp, and resident
+// set sizes from the operating system. Fields are -1 when unknown.
+struct memory_stats {
+    int64_t allocations;     // calls to operator new since counting started
+    int64_t allocated_bytes; // bytes requested by those calls
+    int64_t live_bytes;      // bytes still allocated by those calls
+    int64_t peak_live_bytes; // peak of live_bytes since last reset
+    int64_t rss;             // resident set size, in bytes
+    int64_t peak_rss;        // peak of rss since last reset, in bytes
+};
+
+// Returns false if the counting allocator is not linked in or preloaded
+bool start_counting_allocations(void);
+
+memory_stats get_memory_stats(void);
+
+// Starts new peaks from the current values. The peak resident set size
+// can only be reset on Linux.
+void reset_memory_peaks(void);
+
+} // namespace rvg
+
+#endif // RVG_MEMORY_STATS_H
@@ -0,0 +1,313 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include "rvg-number-format.h"
+
+namespace rvg {
+
+namespace {
+
+// Powers of 10 that are exactly representable as doubles
+const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const int max_exact_pow10 = 22;
+
+// Writes the number 0.d1d2...dn * 10^(x+1), where d1 is the leading
+// digit of digits, in fixed or exponential notation
+char *write_decimal(bool negative, uint64_t digits, int x, bool shortest,
+    int precision, char *buf) {
+    while (digits % 10 == 0 && digits != 0) {
+        digits /= 10;
+    }
+    char d[20];
+    int n = 0;
+    do {
+        d[n++] = static_cast<char>('0' + digits % 10);
+        digits /= 10;
+    } while (digits != 0);
+    // d holds the digits in reverse order
+    int ax = x < 0? -x: x;
+    int exp_length = n + (n > 1) + 2 + (ax >= 100? 3: 2);
+    int fixed_length = x >= 0? std::max(n, x+1) + (n > x+1): 1 + n - x;
+    bool exponential = shortest? exp_length < fixed_length:
+        (x < -4 || x >= precision);
+    char *c = buf;
+    if (negative) {
+        *c++ = '-';
+    }
+    if (exponential) {
+        *c++ = d[n-1];
+        if (n > 1) {
+            *c++ = '.';
+            for (int i = n-2; i >= 0; --i) {
+                *c++ = d[i];
+            }
+        }
+        *c++ = 'e';
+        *c++ = x < 0? '-': '+';
+        if (ax >= 100) {
+            *c++ = static_cast<char>('0' + ax/100);
+        }
+        *c++ = static_cast<char>('0' + (ax/10)%10);
+        *c++ = static_cast<char>('0' + ax%10);
+    } else if (x >= 0) {
+        for (int i = 0; i <= x; ++i) {
+            *c++ = i < n? d[n-1-i]: '0';
+        }
+        if (n > x+1) {
+            *c++ = '.';
+            for (int i = x+1; i < n; ++i) {
+                *c++ = d[n-1-i];
+            }
+        }
+    } else {
+        *c++ = '0';
+        *c++ = '.';
+        for (int i = 0; i < -x-1; ++i) {
+            *c++ = '0';
+        }
+        for (int i = n-1; i >= 0; --i) {
+            *c++ = d[i];
+        }
+    }
+    return c;
+}
+
+// Computes the p-digit integer nearest to a * 10^(p-1-x), adjusting
+// x when it is off by one. Returns false when this cannot be done
+// exactly in double precision, or when exact_ties is set and the
+// result is too close to a tie to be sure of the rounding direction.
+bool round_to_digits(double a, int p, int &x, uint64_t &digits,
+    double &scaled, bool exact_ties) {
+    const double lo = exact_pow10[p-1], hi = exact_pow10[p];
+    for (int i = 0; i < 3; ++i) {
+        int k = p-1-x;
+        if (k > max_exact_pow10 || -k > max_exact_pow10) {
+            return false;
+        }
+        scaled = k >= 0? a*exact_pow10[k]: a/exact_pow10[-k];
+        if (scaled >= hi) {
+            ++x;
+        } else if (scaled < lo) {
+            --x;
+        } else {
+            double f = static_cast<double>(static_cast<uint64_t>(scaled));
+            double r = scaled - f;
+            if (exact_ties && std::fabs(r - .5) < 1e-6) {
+                return false;
+            }
+            digits = static_cast<uint64_t>(f);
+            // round half to even
+            if (r > .5 || (r == .5 && (digits & 1))) {
+                ++digits;
+            }
+            if (digits >= static_cast<uint64_t>(hi)) {
+                digits /= 10;
+                ++x;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns 1 if digits * 10^(x+1-p) reads back as v, 0 if it does not,
+// and -1 if we cannot tell without strtof
+int round_trips(uint64_t digits, int p, int x, float v) {
+    int k = p-1-x;
+    if (k > max_exact_pow10 || -k > max_exact_pow10) {
+        return -1;
+    }
+    // Both operands are exact, so q is correctly rounded
+    double d = static_cast<double>(digits);
+    double q = k >= 0? d/exact_pow10[k]: d*exact_pow10[-k];
+    // Rounding q to float can only go wrong if q lies exactly halfway
+    // between two normal floats, i.e., if the 29 bits of its mantissa
+    // that do not fit in a float are 100...0
+    uint64_t bits;
+    memcpy(&bits, &q, sizeof(bits));
+    if ((bits & 0x1fffffff) == 0x10000000) {
+        return -1;
+    }
+    return static_cast<float>(q) == v;
+}
+
+// Parses the output of "%.*e" into digits and exponent
+void parse_scientific(const char *s, uint64_t &digits, int &x) {
+    digits = 0;
+    for ( ; *s && *s != 'e'; ++s) {
+        if (*s >= '0' && *s <= '9') {
+            digits = 10*digits + static_cast<uint64_t>(*s - '0');
+        }
+    }
+    x = *s? std::atoi(s+1): 0;
+}
+
+// Slow path based on snprintf and strtof/strtod
+char *format_number_slow(double v, bool is_float, int precision,
+    char *buf) {
+    char tmp[number_format_buffer_size];
+    if (!std::isfinite(v) || precision > 0) {
+        int n = snprintf(tmp, sizeof(tmp), "%.*g", precision > 0?
+            precision: 17, v);
+        for (int i = 0; i < n; ++i) {
+            buf[i] = tmp[i];
+        }
+        return buf + n;
+    }
+    int pmin = is_float? 1: 15, pmax = is_float? 9: 17;
+    for (int p = pmin; p <= pmax; ++p) {
+        snprintf(tmp, sizeof(tmp), "%.*e", p-1, std::fabs(v));
+        bool ok = is_float? std::strtof(tmp, nullptr) ==
+            static_cast<float>(std::fabs(v)):
+            std::strtod(tmp, nullptr) == std::fabs(v);
+        if (ok || p == pmax) {
+            uint64_t digits;
+            int x;
+            parse_scientific(tmp, digits, x);
+            return write_decimal(std::signbit(v), digits, x, true, 0, buf);
+        }
+    }
+    return buf;
+}
+
+} // anonymous namespace
+
+char *format_number(float v, int precision, char *buf) {
+    if (!std::isfinite(v) || precision > 9) {
+        return format_number_slow(v, true, precision, buf);
+    }
+    bool negative = std::signbit(v);
+    if (v == 0.f) {
+        char *c = buf;
+        if (negative) {
+            *c++ = '-';
+        }
+        *c++ = '0';
+        return c;
+    }
+    double a = std::fabs(static_cast<double>(v));
+    // Estimate of the decimal exponent. round_to_digits fixes it
+    // when it is off by one
+    uint64_t bits;
+    memcpy(&bits, &a, sizeof(bits));
+    int e2 = static_cast<int>((bits >> 52) & 0x7ff) - 1023;
+    int x0 = (e2*78913) >> 18; // floor(e2*log10(2))
+    uint64_t digits;
+    double scaled;
+    int x;
+    if (precision > 0) {
+        x = x0;
+        if (!round_to_digits(a, precision, x, digits, scaled, true)) {
+            return format_number_slow(v, true, precision, buf);
+        }
+        return write_decimal(negative, digits, x, false, precision, buf);
+    }
+    // Tests the p-digit number nearest to v
+    auto test = [&](int p) {
+        x = x0;
+        if (!round_to_digits(a, p, x, digits, scaled, false)) {
+            return -1;
+        }
+        return round_trips(digits, p, x, static_cast<float>(a));
+    };
+    // If the nearest p-digit number reads back as v, so does the
+    // nearest (p+1)-digit number, so we can search for the smallest p
+    int lo = 1, hi = 9;
+    while (lo < hi) {
+        int mid = (lo+hi)/2;
+        int r = test(mid);
+        if (r < 0) {
+            return format_number_slow(v, true, 0, buf);
+        } else if (r > 0) {
+            hi = mid;
+        } else {
+            lo = mid+1;
+        }
+    }
+    // The nearest (lo-1)-digit number does not read back as v, but the
+    // one on the other side of v might, because the interval of numbers
+    // that read back as v is not symmetric at powers of 2
+    if (lo > 1 && test(lo-1) == 0) {
+        uint64_t other = static_cast<double>(digits) > scaled?
+            digits-1: digits+1;
+        if (other >= static_cast<uint64_t>(exact_pow10[lo-2]) &&
+            other < static_cast<uint64_t>(exact_pow10[lo-1]) &&
+            round_trips(other, lo-1, x, static_cast<float>(a)) > 0) {
+            return write_decimal(negative, other, x, true, 0, buf);
+        }
+    }
+    if (test(lo) <= 0) {
+        return format_number_slow(v, true, 0, buf);
+    }
+    return write_decimal(negative, digits, x, true, 0, buf);
+}
+
+char *format_number(double v, int precision, char *buf) {
+    float f = static_cast<float>(v);
+    if (static_cast<double>(f) == v && precision <= 9) {
+        return format_number(f, precision, buf);
+    }
+    return format_number_slow(v, false, precision, buf);
+}
+
+number_format_put::iter_type number_format_put::do_put(iter_type out,
+    std::ios_base &str, char_type fill, double v) const {
+    if ((str.flags() & (std::ios_base::floatfield | std::ios_base::showpos |
+        std::ios_base::showpoint)) || str.width() != 0) {
+        return std::num_put<char>::do_put(out, str, fill, v);
+    }
+    char buf[number_format_buffer_size];
+    char *end = format_number(v, m_precision, buf);
+    for (const char *c = buf; c != end; ++c) {
+        *out++ = *c;
+    }
+    return out;
+}
+
+std::locale imbue_number_format(std::ostream &out, int precision) {
+    return out.imbue(std::locale(out.getloc(),
+        new number_format_put(precision)));
+}
+
+int get_number_format_precision(const std::ostream &out) {
+    const auto *put = dynamic_cast<const number_format_put *>(
+        &std::use_facet<std::num_put<char>>(out.getloc()));
+    return put? put->get_precision(): -1;
+}
+
+int get_number_format_precision(const std::vector<std::string> &args,
+    int def) {
+    for (const auto &arg: args) {
+        int precision = 0, end = 0;
+        if (sscanf(arg.c_str(), "-precision:%d%n", &precision, &end) == 1 &&
+            arg[end] == 0 && precision >= 0) {
+            def = precision;
+        }
+    }
+    return def;
+}
+
+} // namespace rvg
@@ -0,0 +1,86 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_NUMBER_FORMAT_H
+#define RVG_NUMBER_FORMAT_H
+
+#include <locale>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Our text writers (the SVG and EPS drivers, the RVG printers, and
+// svg_path_f_command_printer) spend most of their time formatting
+// floating-point numbers. The functions here are much faster than the
+// standard library's locale-aware formatting.
+//
+// With precision 0, numbers are printed with the fewest significant
+// digits that read back as the same float. Like std::to_chars, they
+// use fixed or exponential notation, whichever is shorter. With
+// precision p > 0, numbers are printed as with "%.pg", so trailing
+// zeros are dropped. With p = 6, this matches std::ostream's default.
+//
+// Values that are exactly representable as float are round-tripped
+// through float. Other doubles use the shortest of 15, 16, or 17
+// significant digits that reads back as the same double.
+
+namespace rvg {
+
+// Size of a buffer that can hold any formatted number
+constexpr int number_format_buffer_size = 32;
+
+// Writes v to buf and returns a pointer past the last character.
+// The result is not null-terminated.
+char *format_number(float v, int precision, char *buf);
+
+char *format_number(double v, int precision, char *buf);
+
+// A num_put facet that formats floating-point numbers using
+// format_number. Streams using a non-default floatfield, showpos,
+// showpoint, or a field width fall back to std::num_put.
+class number_format_put final: public std::num_put<char> {
+    int m_precision;
+
+public:
+    explicit number_format_put(int precision = 0, size_t refs = 0):
+        std::num_put<char>(refs),
+        m_precision(precision) {
+        ;
+    }
+
+    int get_precision(void) const {
+        return m_precision;
+    }
+
+protected:
+    iter_type do_put(iter_type out, std::ios_base &str, char_type fill,
+        double v) const override;
+};
+
+// Makes out format floating-point numbers with format_number.
+// Returns the previous locale, so the caller can restore it.
+std::locale imbue_number_format(std::ostream &out, int precision = 0);
+
+// Returns the precision out was imbued with, or -1 if it was not
+int get_number_format_precision(const std::ostream &out);
+
+// Returns the precision given by a "-precision:<p>" option, or
+// the default if there is no such option
+int get_number_format_precision(const std::vector<std::string> &args,
+    int def = 0);
+
+} // namespace rvg
+
+#endif
@@ -0,0 +1,167 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cstdio>
+#include <cstring>
+
+#include "rvg-path-data-file.h"
+
+namespace rvg {
+
+namespace {
+
+const char magic[8] = {'R', 'V', 'G', 'P', 'A', 'T', 'H', 'S'};
+const uint32_t version = 1;
+const uint32_t byte_order = 0x01020304;
+
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t float_size;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(header) == 32, "unexpected header padding");
+
+uint64_t align8(uint64_t pos) {
+    return (pos + 7) & ~uint64_t{7};
+}
+
+bool write_padded(FILE *f, const void *data, size_t len, uint64_t &pos) {
+    static const char zeros[8] = {0};
+    uint64_t aligned = align8(pos);
+    if (aligned != pos && fwrite(zeros, 1, aligned-pos, f) != aligned-pos) {
+        return false;
+    }
+    if (len > 0 && fwrite(data, 1, len, f) != len) {
+        return false;
+    }
+    pos = aligned + len;
+    return true;
+}
+
+} // anonymous namespace
+
+bool write_path_data_file(const std::vector<path_data::const_ptr> &paths,
+    const char *filename) {
+    header h;
+    memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.byte_order = byte_order;
+    h.float_size = sizeof(rvgf);
+    h.reserved = 0;
+    h.count = paths.size();
+    // Lay out all arrays before writing anything
+    std::vector<uint64_t> directory;
+    directory.reserve(5*paths.size());
+    uint64_t pos = sizeof(header) + 5*sizeof(uint64_t)*paths.size();
+    for (const auto &p: paths) {
+        auto v = p->view();
+        directory.push_back(v.size());
+        directory.push_back(v.data_size());
+        directory.push_back(pos = align8(pos));
+        pos += v.size()*sizeof(path_instruction);
+        directory.push_back(pos = align8(pos));
+        pos += v.size()*sizeof(floatint);
+        directory.push_back(pos = align8(pos));
+        pos += v.data_size()*sizeof(rvgf);
+    }
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        return false;
+    }
+    pos = 0;
+    bool ok = write_padded(f, &h, sizeof(h), pos) &&
+        write_padded(f, directory.data(),
+            directory.size()*sizeof(uint64_t), pos);
+    for (size_t i = 0; ok && i < paths.size(); ++i) {
+        auto v = paths[i]->view();
+        ok = write_padded(f, v.get_instructions(),
+                v.size()*sizeof(path_instruction), pos) &&
+            write_padded(f, v.get_offsets(),
+                v.size()*sizeof(floatint), pos) &&
+            write_padded(f, v.get_data(),
+                v.data_size()*sizeof(rvgf), pos);
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+path_data_file::path_data_file(void):
+    m_base(nullptr),
+    m_length(0),
+    m_directory(nullptr),
+    m_count(0) {
+    ;
+}
+
+bool path_data_file::open(const char *filename) {
+    if (!m_file.open(filename)) {
+        return false;
+    }
+    m_base = m_file.get_base();
+    m_length = m_file.get_length();
+    // Validate header
+    if (m_length < sizeof(header)) {
+        return false;
+    }
+    header h;
+    memcpy(&h, m_base, sizeof(h));
+    if (memcmp(h.magic, magic, sizeof(magic)) != 0 ||
+        h.version != version || h.byte_order != byte_order ||
+        h.float_size != sizeof(rvgf)) {
+        return false;
+    }
+    // Validate directory
+    uint64_t available = (m_length - sizeof(header))/sizeof(entry);
+    if (h.count > available) {
+        return false;
+    }
+    m_directory = reinterpret_cast<const entry *>(m_base + sizeof(header));
+    auto fits = [this](uint64_t pos, uint64_t count, uint64_t size) {
+        return pos % 8 == 0 && pos <= m_length &&
+            count <= (m_length - pos)/size;
+    };
+    for (uint64_t i = 0; i < h.count; ++i) {
+        const entry &e = m_directory[i];
+        if (!fits(e.instructions, e.size, sizeof(path_instruction)) ||
+            !fits(e.offsets, e.size, sizeof(floatint)) ||
+            !fits(e.data, e.data_size, sizeof(rvgf))) {
+            return false;
+        }
+    }
+    // Validate the offsets of each path against its data
+    for (uint64_t i = 0; i < h.count; ++i) {
+        if (!get_view(static_cast<size_t>(i)).is_valid()) {
+            return false;
+        }
+    }
+    m_count = static_cast<size_t>(h.count);
+    return true;
+}
+
+path_data_file::ptr map_path_data_file(const char *filename) {
+    auto file = make_intrusive<path_data_file>();
+    if (!file->open(filename)) {
+        return nullptr;
+    }
+    return file;
+}
+
+} // namespace rvg
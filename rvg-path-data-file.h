@@ -0,0 +1,134 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_PATH_DATA_FILE_H
+#define RVG_PATH_DATA_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "rvg-ptr.h"
+#include "rvg-path-data.h"
+#include "rvg-mapped-file.h"
+
+namespace rvg {
+
+// A binary container for many path_data, laid out so that a reader can
+// map the file into memory and iterate over the paths in place, without
+// parsing or copying anything.
+//
+// All integers are uint64_t unless noted otherwise, and everything is
+// stored in the byte order of the machine that wrote the file.
+//
+//   header
+//     magic                "RVGPATHS" (8 bytes)
+//     version              uint32_t, currently 1
+//     byte order           uint32_t, 0x01020304
+//     float size           uint32_t, sizeof(rvgf) (4 or 8)
+//     reserved             uint32_t, 0
+//     path count           n
+//   directory, one entry per path
+//     instruction count    (also the offset count)
+//     data count
+//     instructions         file position of the instruction array
+//     offsets              file position of the offset array
+//     data                 file position of the data array
+//   arrays
+//
+// Each array holds exactly the bytes of the corresponding path_data
+// vector (m_instructions, m_offsets, and m_data), starting at a position
+// that is a multiple of 8. The file can only be read by builds using the
+// same rvgf and the same byte order it was written with.
+//
+// The reader checks that the header and directory are consistent with
+// the file size, and that each path is valid (see
+// path_data_view::is_valid). This is a pass over all instructions when
+// the file is opened, but nothing is copied.
+
+// Writes paths to a file, returning true on success
+bool write_path_data_file(const std::vector<path_data::const_ptr> &paths,
+    const char *filename);
+
+class path_data_file final:
+    public boost::intrusive_ref_counter<path_data_file> {
+
+    struct entry {
+        uint64_t size;
+        uint64_t data_size;
+        uint64_t instructions;
+        uint64_t offsets;
+        uint64_t data;
+    };
+
+    mapped_file m_file;
+    const unsigned char *m_base;
+    size_t m_length;
+    const entry *m_directory;
+    size_t m_count;
+
+public:
+
+    using ptr = boost::intrusive_ptr<path_data_file>;
+    using const_ptr = boost::intrusive_ptr<const path_data_file>;
+
+    // Use map_path_data_file instead
+    path_data_file(void);
+
+    // Number of paths in the file
+    size_t size(void) const {
+        return m_count;
+    }
+
+    bool empty(void) const {
+        return m_count == 0;
+    }
+
+    // Size of the file in bytes
+    size_t get_length(void) const {
+        return m_length;
+    }
+
+    // Returns a view of the i-th path, pointing into the mapping.
+    // The view is valid as long as the path_data_file is alive.
+    path_data_view get_view(size_t i) const {
+        const entry &e = m_directory[i];
+        return path_data_view{
+            reinterpret_cast<const path_instruction *>(m_base+e.instructions),
+            reinterpret_cast<const floatint *>(m_base+e.offsets),
+            static_cast<size_t>(e.size),
+            reinterpret_cast<const rvgf *>(m_base+e.data),
+            static_cast<size_t>(e.data_size)};
+    }
+
+    // Returns a copy of the i-th path, for use in shapes
+    path_data::ptr get_path_data(size_t i) const {
+        return make_intrusive<path_data>(get_view(i));
+    }
+
+private:
+
+    bool open(const char *filename);
+
+friend path_data_file::ptr map_path_data_file(const char *filename);
+};
+
+// Maps a file written by write_path_data_file into memory.
+// Returns a null pointer on failure.
+path_data_file::ptr map_path_data_file(const char *filename);
+
+} // namespace rvg
+
+#endif
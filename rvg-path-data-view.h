@@ -0,0 +1,144 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_PATH_DATA_VIEW_H
+#define RVG_PATH_DATA_VIEW_H
+
+#include <cstddef>
+#include <type_traits> // std::enable_if
+
+#include "rvg-i-path.h"
+#include "rvg-path-instruction.h"
+#include "rvg-floatint.h"
+#include "rvg-input-path-f-forward-if.h"
+#include "rvg-regular-path-f-forward-if.h"
+#include "rvg-decorated-path-f-forward-if.h"
+#include "rvg-monotonic-parameters-f-forward-if.h"
+#include "rvg-cubic-parameters-f-forward-if.h"
+#include "rvg-offsetting-parameters-f-forward-if.h"
+#include "rvg-join-parameters-f-forward-if.h"
+#include "rvg-dashing-parameters-f-forward-if.h"
+
+namespace rvg {
+
+// A read-only view of the instruction, offset, and data arrays of a
+// path (see the layout in rvg-path-data.h). The view does not own
+// the arrays. They can live inside a path_data, or anywhere else in
+// memory (e.g., in a memory-mapped file), as long as they outlive the
+// view. All iteration over path_data goes through here.
+class path_data_view {
+
+    const path_instruction *m_instructions;
+    const floatint *m_offsets;
+    const rvgf *m_data;
+    size_t m_size;
+    size_t m_data_size;
+
+public:
+
+    path_data_view(const path_instruction *instructions,
+        const floatint *offsets, size_t size,
+        const rvgf *data, size_t data_size):
+        m_instructions(instructions),
+        m_offsets(offsets),
+        m_data(data),
+        m_size(size),
+        m_data_size(data_size) {
+        ;
+    }
+
+    // Number of entries in the instruction and offset arrays
+    size_t size(void) const {
+        return m_size;
+    }
+
+    bool empty(void) const {
+        return m_size == 0;
+    }
+
+    // Number of entries in the data array
+    size_t data_size(void) const {
+        return m_data_size;
+    }
+
+    const path_instruction *get_instructions(void) const {
+        return m_instructions;
+    }
+
+    const floatint *get_offsets(void) const {
+        return m_offsets;
+    }
+
+    const rvgf *get_data(void) const {
+        return m_data;
+    }
+
+    // Returns true if every instruction is known, and every offset
+    // leaves room in the data array for all the values its instruction
+    // reads. Arrays that come from files must pass before iteration.
+    bool is_valid(void) const;
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void iterate(PF &sink, int first, int last) const;
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void iterate(PF &&sink, int first, int last) const {
+        this->iterate(sink, first, last);
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void iterate(PF &sink) const;
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void iterate(PF &&sink) const {
+        this->iterate(sink);
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void riterate(PF &sink, int last, int first) const;
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void riterate(PF &&sink, int last, int first) const {
+        this->riterate(sink, last, first);
+    }
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void riterate(PF &sink) const;
+
+    template <typename PF, typename =
+        std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
+    void riterate(PF &&sink) const {
+        this->riterate(sink);
+    }
+
+private:
+
+    template <typename PF>
+    int riterate_parameters(PF &sink, int first, int last) const;
+
+};
+
+#include "rvg-path-data-view.hpp"
+
+} // namespace rvg
+
+#endif
@@ -34,6 +34,14 @@ static void propagate_orientation(rvgf &dx, rvgf &dy, rvgf &dx0, rvgf &dy0) {
     }
 }
 
+path_data::path_data(const path_data_view &view):
+    m_instructions(view.get_instructions(),
+        view.get_instructions() + view.size()),
+    m_offsets(view.get_offsets(), view.get_offsets() + view.size()),
+    m_data(view.get_data(), view.get_data() + view.data_size()) {
+    ;
+}
+
 void path_data::find_first_contour_orientation(int begin, int end,
     rvgf &dx, rvgf &dy) const {
     for (int index = begin; index < end; ++index) {
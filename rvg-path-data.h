@@ -31,6 +31,7 @@
 #include "rvg-offsetting-parameters-f-forward-if.h"
 #include "rvg-join-parameters-f-forward-if.h"
 #include "rvg-dashing-parameters-f-forward-if.h"
+#include "rvg-path-data-view.h"
 
 namespace rvg {
 
@@ -146,6 +147,9 @@ public:
     path_data &operator=(const path_data &other) = default;
     path_data &operator=(path_data &&other) = default;
 
+    // copies the arrays referenced by a view
+    explicit path_data(const path_data_view &view);
+
     void propagate_orientations(void);
     void propagate_contour_orientations(int begin, int end);
     void find_first_contour_orientation(int begin, int end, rvgf &dx, rvgf &dy) const;
@@ -173,6 +177,18 @@ public:
         m_data.shrink_to_fit();
     }
 
+    // Reserves space for a number of instructions and of data entries
+    void reserve(size_t instructions, size_t data) {
+        m_instructions.reserve(instructions);
+        m_offsets.reserve(instructions);
+        m_data.reserve(data);
+    }
+
+    path_data_view view(void) const {
+        return path_data_view{m_instructions.data(), m_offsets.data(),
+            m_instructions.size(), m_data.data(), m_data.size()};
+    }
+
     template <typename PF, typename =
         std::enable_if<rvg::meta::is_an_i_path<PF>::value>>
     void iterate(PF &sink, int first, int last) const;
@@ -218,9 +234,6 @@ public:
 
 private:
 
-    template <typename PF>
-    int riterate_parameters(PF &sink, int first, int last) const;
-
 // i_input_path interface
 friend i_input_path<path_data>;
 
@@ -21,14 +21,17 @@
 #include <utility>
 
 #include <boost/range/adaptor/sliced.hpp>
+#include <boost/container/static_vector.hpp>
 
 #include "rvg-i-parameters-f-forwarder.h"
 #include "rvg-i-input-path-f-forwarder.h"
 #include "rvg-i-regular-path-f-forwarder.h"
 #include "rvg-i-offsetting-parameters.h"
 #include "rvg-tuple.h"
+#include "rvg-adjacent-range.h"
 #include "rvg-bezier.h"
 #include "rvg-util.h"
+#include "rvg-precision-escalation.h"
 
 // The radius of curvature of a curve a(t) = (x(t), y(t)) is
 //
@@ -110,6 +113,54 @@ friend i_sink<path_f_find_offsetting_parameters<SINK>>;
         return m_sink;
     }
 
+    // Parameters found while analysing a segment are buffered here
+    // before being forwarded. This allows us to discard the results of
+    // a fragile single-precision analysis and redo it in double precision
+    using parameters = boost::container::static_vector<rvgf, 16>;
+
+    struct found_parameters {
+        parameters evolute_cusps;
+        parameters offset_cusps;
+    };
+
+    // Runs the analysis in single precision and, if the result is
+    // fragile, again in double precision. Then forwards the parameters.
+    // Whole segments come through the first pass, and pieces through
+    // the second.
+    template <typename ANALYZE>
+    void analyze_segment(bool segment, const ANALYZE &analyze) {
+        found_parameters found;
+        bool robust = false;
+        if (precision_escalation::try_single()) {
+            robust = analyze(rvgf{0}, found) ||
+                !precision_escalation::allowed();
+        }
+        if (!robust) {
+            found.evolute_cusps.clear();
+            found.offset_cusps.clear();
+            analyze(double{0}, found);
+        }
+        if (segment) {
+            precision_escalation::count(!robust);
+        } else {
+            precision_escalation::count_piece(!robust);
+        }
+        for (auto t: found.evolute_cusps) {
+            m_sink.evolute_cusp_parameter(t);
+        }
+        for (auto t: found.offset_cusps) {
+            m_sink.offset_cusp_parameter(t);
+        }
+    }
+
+    // Largest absolute value among the Bezier coefficients
+    template <typename T, typename BEZIER_TUPLE>
+    static T max_abs_coefficient(const BEZIER_TUPLE &B) {
+        return tuple_reduce(B, [](T m, T b) {
+            return std::max(m, static_cast<T>(std::fabs(b)));
+        }, T{0});
+    }
+
     // In the case of quadratics, the polynomial
     //
     //   3 q(t) p'(t) - 2 q'(t) p(t) = 0
@@ -131,41 +182,50 @@ friend i_sink<path_f_find_offsetting_parameters<SINK>>;
     //
     //   p(t) = ((1-t)*2(x1-x0)+t*2(x2-x1))^2 + ((1-t)*2(y1-y0)+t*2(y2-y1))^2
     //
-    template <typename SEG>
-    void process_quadratic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
-        rvgf x1, rvgf y1, rvgf x2, rvgf y2, SEG sink_segment) {
-        rvgf b = (x1-x0)*(x0-rvgf{2}*x1+x2) + (y1-y0)*(y0-rvgf{2}*y1+y2);
-        rvgf a = util::sq(x0-rvgf{2}*x1+x2) + util::sq(y0-rvgf{2}*y1+y2);
-        rvgf q = rvgf{4.}*(x2*(y0-y1) + x0*(y1-y2) + x1*(y2-y0));
-        rvgf dx0 = rvgf{2.}*(x1-x0), dx1 = rvgf{2.}*(x2-x1);
-        rvgf dy0 = rvgf{2.}*(y1-y0), dy1 = rvgf{2.}*(y2-y1);
-        auto f = [&](rvgf t) {
-            rvgf p = util::sq((rvgf{1.}-t)*dx0 + t*dx1) +
-                util::sq((rvgf{1.}-t)*dy0 + t*dy1);
+    // The analysis is fragile when a almost vanishes, or when
+    // p(t)^(3/2) - s |q| almost vanishes at the ends of a bracket.
+    //
+    template <typename T>
+    bool analyze_quadratic_segment_piece(T ti, T tf, T x0, T y0,
+        T x1, T y1, T x2, T y2, found_parameters &found) const {
+        using precision_escalation::is_fragile;
+        T b = (x1-x0)*(x0-T{2}*x1+x2) + (y1-y0)*(y0-T{2}*y1+y2);
+        T a = util::sq(x0-T{2}*x1+x2) + util::sq(y0-T{2}*y1+y2);
+        T q = T{4}*(x2*(y0-y1) + x0*(y1-y2) + x1*(y2-y0));
+        T dx0 = T{2}*(x1-x0), dx1 = T{2}*(x2-x1);
+        T dy0 = T{2}*(y1-y0), dy1 = T{2}*(y2-y1);
+        auto f = [&](T t) {
+            T p = util::sq((T{1}-t)*dx0 + t*dx1) +
+                util::sq((T{1}-t)*dy0 + t*dy1);
             return p*std::sqrt(p);
         };
-        rvgf z = m_offset*std::fabs(q);
-        rvgf s = rvgf(util::sgn(a));
+        T z = static_cast<T>(m_offset)*std::fabs(q);
+        T pmax = util::sq(dx0) + util::sq(dx1) + util::sq(dy0) + util::sq(dy1);
+        T scale = pmax*std::sqrt(pmax) + z;
+        bool robust = (a == 0 || !is_fragile(a, pmax)) &&
+            !is_fragile(f(ti)-z, scale) && !is_fragile(f(tf)-z, scale);
+        T s = T(util::sgn(a));
         b *= s; a *= s;
         // two intervals to test for roots
         if (a != 0 && -b >= ti*a && -b <= tf*a) {
-            rvgf root = rvgf{0.};
-            rvgf c = -b/a;
-            m_sink.evolute_cusp_parameter(c);
-            if (bisect<rvgf>(f, ti, c, z, &root)) {
-                m_sink.offset_cusp_parameter(root);
+            T root = T{0};
+            T c = -b/a;
+            robust = robust && !is_fragile(f(c)-z, scale);
+            found.evolute_cusps.push_back(static_cast<rvgf>(c));
+            if (bisect<T>(f, ti, c, z, &root)) {
+                found.offset_cusps.push_back(static_cast<rvgf>(root));
             }
-            if (bisect<rvgf>(f, c, tf, z, &root)) {
-                m_sink.offset_cusp_parameter(root);
+            if (bisect<T>(f, c, tf, z, &root)) {
+                found.offset_cusps.push_back(static_cast<rvgf>(root));
             }
         // one interval to test for roots
         } else {
-            rvgf root = rvgf{0.};
-            if (bisect(f, ti, tf, z, &root)) {
-                m_sink.offset_cusp_parameter(root);
+            T root = T{0};
+            if (bisect<T>(f, ti, tf, z, &root)) {
+                found.offset_cusps.push_back(static_cast<rvgf>(root));
             }
         }
-        return sink_segment();
+        return robust;
     }
 
     // In the case of rational quadratics, we have
@@ -222,81 +282,97 @@ friend i_sink<path_f_find_offsetting_parameters<SINK>>;
     //
     //   p(t)^(3/2) - s |q(t)| = 0
     //
-    template <typename SEG>
-    void process_rational_quadratic_segment_piece(rvgf ti, rvgf tf, rvgf u0, rvgf v0,
-        rvgf u1, rvgf v1, rvgf w1, rvgf u2, rvgf v2, SEG sink_segment) {
+    // The analysis is fragile when two critical points almost
+    // coincide, or when the function almost vanishes at one of them.
+    //
+    template <typename T>
+    bool analyze_rational_quadratic_segment_piece(T ti, T tf, T u0, T v0,
+        T u1, T v1, T w1, T u2, T v2, found_parameters &found) const {
         // ensure we are dealing with an elliptic arc
-        assert(w1 > rvgf{-1.} && w1 < rvgf{1.});
+        assert(w1 > T{-1.} && w1 < T{1.});
         using namespace boost::adaptors;
-        auto s = m_offset;
+        using precision_escalation::is_fragile;
+        using precision_escalation::is_fragile_pair;
+        T s = static_cast<T>(m_offset);
         // build wu(t) ( w(t) wu'(t) - w'(t) wu(t) ) +
         //   wv(t) ( w(t) wv'(t) - w'(t) wv(t) )
         auto u = std::make_tuple(u0, u1, u2);
         auto v = std::make_tuple(v0, v1, v2);
-        auto w = std::make_tuple(rvgf{1.}, w1, rvgf{1.});
+        auto w = std::make_tuple(T{1.}, w1, T{1.});
         auto du = bezier_derivative(u);
         auto dv = bezier_derivative(v);
         auto dw = bezier_derivative(w);
         auto wu = bezier_lower_degree(
             tuple_zip_map(
-                bezier_product<rvgf>(w, du),
-                bezier_product<rvgf>(u, dw),
-                std::minus<rvgf>{}
+                bezier_product<T>(w, du),
+                bezier_product<T>(u, dw),
+                std::minus<T>{}
             )
         );
         auto dwu = bezier_derivative(wu);
         auto wv = bezier_lower_degree(
             tuple_zip_map(
-                bezier_product<rvgf>(w, dv),
-                bezier_product<rvgf>(v, dw),
-                std::minus<rvgf>{}
+                bezier_product<T>(w, dv),
+                bezier_product<T>(v, dw),
+                std::minus<T>{}
             )
         );
         auto dwv = bezier_derivative(wv);
         auto c = tuple_zip_map(
-            bezier_product<rvgf>(
+            bezier_product<T>(
                 wu,
                 bezier_lower_degree(
                     tuple_zip_map(
-                        bezier_product<rvgf>(w, dwu),
-                        bezier_product<rvgf>(dw, wu),
-                        std::minus<rvgf>{}
+                        bezier_product<T>(w, dwu),
+                        bezier_product<T>(dw, wu),
+                        std::minus<T>{}
                     )
                 )
             ),
-            bezier_product<rvgf>(
+            bezier_product<T>(
                 wv,
                 bezier_lower_degree(
                     tuple_zip_map(
-                        bezier_product<rvgf>(w, dwv),
-                        bezier_product<rvgf>(dw, wv),
-                        std::minus<rvgf>{}
+                        bezier_product<T>(w, dwv),
+                        bezier_product<T>(dw, wv),
+                        std::minus<T>{}
                     )
                 )
             ),
-            std::plus<rvgf>{}
+            std::plus<T>{}
         );
         // find the roots of wu(t) ( w(t) wu'(t) - w'(t) wu(t) ) +
         //   wv(t) ( w(t) wv'(t) - w'(t) wv(t) )
-        auto critical = bezier_roots<rvgf>(c, ti, tf);
+        auto critical = bezier_roots<T>(c, ti, tf);
         for (auto t: critical | sliced(1, critical.size()-1)) {
-            m_sink.evolute_cusp_parameter(t);
+            found.evolute_cusps.push_back(static_cast<rvgf>(t));
         }
         // use these to bracket and solve for the roots of p(t)^(3/2) - s q(t)
-        auto ts = refine_roots<rvgf>([&w, &wu, &wv, &dwu, &dwv, s](rvgf t) {
-            rvgf wt = bezier_evaluate_horner<rvgf>(w, t);
-            rvgf wut = bezier_evaluate_horner<rvgf>(wu, t);
-            rvgf wvt = bezier_evaluate_horner<rvgf>(wv, t);
-            rvgf dwut = bezier_evaluate_horner<rvgf>(dwu, t);
-            rvgf dwvt = bezier_evaluate_horner<rvgf>(dwv, t);
-            rvgf pt = wut*wut + wvt*wvt;
-            rvgf qt = wut*dwvt - wvt*dwut;
+        auto g = [&w, &wu, &wv, &dwu, &dwv, s](T t) {
+            T wt = bezier_evaluate_horner<T>(w, t);
+            T wut = bezier_evaluate_horner<T>(wu, t);
+            T wvt = bezier_evaluate_horner<T>(wv, t);
+            T dwut = bezier_evaluate_horner<T>(dwu, t);
+            T dwvt = bezier_evaluate_horner<T>(dwv, t);
+            T pt = wut*wut + wvt*wvt;
+            T qt = wut*dwvt - wvt*dwut;
             return pt*std::sqrt(pt) - std::fabs(s*wt*wt*qt);
-        }, critical);
+        };
+        auto ts = refine_roots<T>(g, critical);
         for (auto t: ts | sliced(1, ts.size()-1)) {
-            m_sink.offset_cusp_parameter(t);
+            found.offset_cusps.push_back(static_cast<rvgf>(t));
         }
-        return sink_segment();
+        T pmax = util::sq(max_abs_coefficient<T>(wu)) +
+            util::sq(max_abs_coefficient<T>(wv));
+        T scale = pmax*std::sqrt(pmax) + s*std::sqrt(pmax)*
+            (max_abs_coefficient<T>(dwu) + max_abs_coefficient<T>(dwv));
+        for (auto t: critical) {
+            if (is_fragile(g(t), scale)) return false;
+        }
+        for (const auto &adj: make_adjacent_range(critical)) {
+            if (is_fragile_pair(adj.first, adj.second)) return false;
+        }
+        return true;
     }
 
     // In the case of cubics, the polynomial
@@ -317,11 +393,18 @@ friend i_sink<path_f_find_offsetting_parameters<SINK>>;
     //
     // which we find by bisection
     //
-    template <typename SEG>
-    void process_cubic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
-        rvgf x1, rvgf y1, rvgf x2, rvgf y2, rvgf x3, rvgf y3, SEG sink_segment) {
+    // The analysis is fragile when two critical points almost
+    // coincide, or when either function almost vanishes at one of
+    // them. This is what happens near cusps and when the
+    // tangents at the ends of a bracket are nearly parallel.
+    //
+    template <typename T>
+    bool analyze_cubic_segment_piece(T ti, T tf, T x0, T y0,
+        T x1, T y1, T x2, T y2, T x3, T y3, found_parameters &found) const {
         using namespace boost::adaptors;
-        auto s = m_offset;
+        using precision_escalation::is_fragile;
+        using precision_escalation::is_fragile_pair;
+        T s = static_cast<T>(m_offset);
         // build 3 q(t) p'(t) - 2 q'(t) p(t)
         auto x = std::make_tuple(x0, x1, x2, x3);
         auto y = std::make_tuple(y0, y1, y2, y3);
@@ -331,23 +414,23 @@ friend i_sink<path_f_find_offsetting_parameters<SINK>>;
         auto ddy = bezier_derivative(dy);
         auto q = bezier_lower_degree(
             tuple_zip_map(
-                bezier_product<rvgf>(dx, ddy),
-                bezier_product<rvgf>(dy, ddx),
-                std::minus<rvgf>{}
+                bezier_product<T>(dx, ddy),
+                bezier_product<T>(dy, ddx),
+                std::minus<T>{}
             )
         );
         auto dq = bezier_derivative(q);
         auto p = tuple_zip_map(
-            bezier_product<rvgf>(dx, dx),
-            bezier_product<rvgf>(dy, dy),
-            std::plus<rvgf>{}
+            bezier_product<T>(dx, dx),
+            bezier_product<T>(dy, dy),
+            std::plus<T>{}
         );
         auto dp = bezier_derivative(p);
         auto c = tuple_zip_map(
-            bezier_product<rvgf>(q, dp),
-            bezier_product<rvgf>(dq, p),
-            [](rvgf a, rvgf b) {
-                return rvgf{1.5}*a - b;
+            bezier_product<T>(q, dp),
+            bezier_product<T>(dq, p),
+            [](T a, T b) {
+                return T{1.5}*a - b;
             }
         );
         // find roots of 3 q(t) p'(t) - 2 q'(t) p(t)
@@ -355,34 +438,81 @@ friend i_sink<path_f_find_offsetting_parameters<SINK>>;
         // into the product of two quadratics (always possible) and use the
         // roots to isolate the roots of the polynomial we
         // care about. Here we skip this optimization.
-        auto critical = bezier_roots<rvgf>(c, ti, tf);
+        auto critical = bezier_roots<T>(c, ti, tf);
         // ??D when looking for the roots of p(t)^(3/2) +/- s q(t)
         // we could find the roots of q(t) and use them
         // to separate the regions where we need to use + or -.
         // Here we skip this optimization.
         for (auto t: critical | sliced(1, critical.size()-1)) {
-            m_sink.evolute_cusp_parameter(t);
+            found.evolute_cusps.push_back(static_cast<rvgf>(t));
         }
         // use these to bracket and solve for the roots of p(t)^(3/2) - s q(t)
-        auto tp = refine_roots<rvgf>([&p, &q, s](rvgf t) {
-            rvgf pt = bezier_evaluate_horner<rvgf>(p, t);
-            rvgf qt = bezier_evaluate_horner<rvgf>(q, t);
+        auto gp = [&p, &q, s](T t) {
+            T pt = bezier_evaluate_horner<T>(p, t);
+            T qt = bezier_evaluate_horner<T>(q, t);
             return pt*std::sqrt(pt) - s*qt;
-        }, critical);
+        };
+        auto tp = refine_roots<T>(gp, critical);
         for (auto t: tp | sliced(1, tp.size()-1)) {
             if (!util::is_almost_zero(t) && !util::is_almost_one(t))
-                m_sink.offset_cusp_parameter(t);
+                found.offset_cusps.push_back(static_cast<rvgf>(t));
         }
         // do the same for p(t)^(3/2) + s q(t)
-        auto tm = refine_roots<rvgf>([&p, &q, s](rvgf t) {
-            rvgf pt = bezier_evaluate_horner<rvgf>(p, t);
-            rvgf qt = bezier_evaluate_horner<rvgf>(q, t);
+        auto gm = [&p, &q, s](T t) {
+            T pt = bezier_evaluate_horner<T>(p, t);
+            T qt = bezier_evaluate_horner<T>(q, t);
             return pt*std::sqrt(pt) + s*qt;
-        }, critical);
+        };
+        auto tm = refine_roots<T>(gm, critical);
         for (auto t: tm | sliced(1, tm.size()-1)) {
             if (!util::is_almost_zero(t) && !util::is_almost_one(t))
-                m_sink.offset_cusp_parameter(t);
+                found.offset_cusps.push_back(static_cast<rvgf>(t));
+        }
+        T pmax = max_abs_coefficient<T>(p);
+        T scale = pmax*std::sqrt(pmax) + s*max_abs_coefficient<T>(q);
+        for (auto t: critical) {
+            if (is_fragile(gp(t), scale) || is_fragile(gm(t), scale))
+                return false;
+        }
+        for (const auto &adj: make_adjacent_range(critical)) {
+            if (is_fragile_pair(adj.first, adj.second)) return false;
         }
+        return true;
+    }
+
+    template <typename SEG>
+    void process_quadratic_segment_piece(bool segment, rvgf ti, rvgf tf,
+        rvgf x0, rvgf y0, rvgf x1, rvgf y1, rvgf x2, rvgf y2,
+        SEG sink_segment) {
+        analyze_segment(segment, [&](auto zero, found_parameters &found) {
+            using T = decltype(zero);
+            return this->template analyze_quadratic_segment_piece<T>(ti, tf,
+                x0, y0, x1, y1, x2, y2, found);
+        });
+        return sink_segment();
+    }
+
+    template <typename SEG>
+    void process_rational_quadratic_segment_piece(bool segment, rvgf ti,
+        rvgf tf, rvgf u0, rvgf v0, rvgf u1, rvgf v1, rvgf w1, rvgf u2,
+        rvgf v2, SEG sink_segment) {
+        analyze_segment(segment, [&](auto zero, found_parameters &found) {
+            using T = decltype(zero);
+            return this->template analyze_rational_quadratic_segment_piece<T>(
+                ti, tf, u0, v0, u1, v1, w1, u2, v2, found);
+        });
+        return sink_segment();
+    }
+
+    template <typename SEG>
+    void process_cubic_segment_piece(bool segment, rvgf ti, rvgf tf,
+        rvgf x0, rvgf y0, rvgf x1, rvgf y1, rvgf x2, rvgf y2, rvgf x3,
+        rvgf y3, SEG sink_segment) {
+        analyze_segment(segment, [&](auto zero, found_parameters &found) {
+            using T = decltype(zero);
+            return this->template analyze_cubic_segment_piece<T>(ti, tf,
+                x0, y0, x1, y1, x2, y2, x3, y3, found);
+        });
         return sink_segment();
     }
 
@@ -390,8 +520,8 @@ friend i_regular_path<path_f_find_offsetting_parameters<SINK>>;
 
     void do_quadratic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
         rvgf x1, rvgf y1, rvgf x2, rvgf y2) {
-        return process_quadratic_segment_piece(ti, tf, x0, y0, x1, y1, x2, y2,
-            [&](void) {
+        return process_quadratic_segment_piece(false, ti, tf, x0, y0, x1, y1,
+            x2, y2, [&](void) {
                 m_sink.quadratic_segment_piece(ti, tf, x0, y0, x1, y1, x2, y2);
             }
         );
@@ -399,8 +529,8 @@ friend i_regular_path<path_f_find_offsetting_parameters<SINK>>;
 
     void do_rational_quadratic_segment_piece(rvgf ti, rvgf tf, rvgf u0, rvgf v0,
         rvgf u1, rvgf v1, rvgf w1, rvgf u2, rvgf v2) {
-        return process_rational_quadratic_segment_piece(ti, tf, u0, v0, u1, v1, w1,
-            u2, v2,
+        return process_rational_quadratic_segment_piece(false, ti, tf, u0, v0,
+            u1, v1, w1, u2, v2,
             [&](void) {
                 m_sink.rational_quadratic_segment_piece(ti, tf, u0, v0, u1, v1, w1,
                     u2, v2);
@@ -410,7 +540,8 @@ friend i_regular_path<path_f_find_offsetting_parameters<SINK>>;
 
     void do_cubic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0, rvgf x1, rvgf y1,
         rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
-        return process_cubic_segment_piece(ti, tf, x0, y0, x1, y1, x2, y2, x3, y3,
+        return process_cubic_segment_piece(false, ti, tf, x0, y0, x1, y1,
+            x2, y2, x3, y3,
             [&](void) {
                 m_sink.cubic_segment_piece(ti, tf, x0, y0, x1, y1, x2, y2, x3, y3);
             }
@@ -420,13 +551,14 @@ friend i_regular_path<path_f_find_offsetting_parameters<SINK>>;
 friend i_input_path<path_f_find_offsetting_parameters<SINK>>;
 
     void do_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1, rvgf x2, rvgf y2) {
-        return process_quadratic_segment_piece(0, 1, x0, y0, x1, y1, x2, y2,
-            [&](void) { m_sink.quadratic_segment(x0, y0, x1, y1, x2, y2); });
+        return process_quadratic_segment_piece(true, 0, 1, x0, y0, x1, y1,
+            x2, y2, [&](void) { m_sink.quadratic_segment(x0, y0, x1, y1, x2, y2); });
     }
 
     void do_rational_quadratic_segment(rvgf u0, rvgf v0, rvgf u1, rvgf v1, rvgf w1,
         rvgf u2, rvgf v2) {
-        return process_rational_quadratic_segment_piece(0, 1, u0, v0, u1, v1, w1, u2, v2,
+        return process_rational_quadratic_segment_piece(true, 0, 1, u0, v0,
+            u1, v1, w1, u2, v2,
             [&](void) {
                 m_sink.rational_quadratic_segment(u0, v0, u1, v1, w1, u2, v2);
             }
@@ -435,7 +567,8 @@ friend i_input_path<path_f_find_offsetting_parameters<SINK>>;
 
     void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1, rvgf x2, rvgf y2,
         rvgf x3, rvgf y3) {
-        return process_cubic_segment_piece(0, 1, x0, y0, x1, y1, x2, y2, x3, y3,
+        return process_cubic_segment_piece(true, 0, 1, x0, y0, x1, y1,
+            x2, y2, x3, y3,
             [&](void) { m_sink.cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3); });
     }
 
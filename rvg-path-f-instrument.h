@@ -0,0 +1,388 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_PATH_F_INSTRUMENT_H
+#define RVG_PATH_F_INSTRUMENT_H
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "rvg-i-path.h"
+#include "rvg-path-instruction.h"
+#include "rvg-path-instrumentation.h"
+
+namespace rvg {
+
+// Forwards every instruction to its sink, counting the instructions by
+// type and accumulating the time (and, on x86, the cycles) spent in the
+// sink into a stage of a path_instrumentation. Like path_f_spy, it
+// implements exactly the interfaces its sink implements, so it can be
+// spliced between any two filters. Pipelines that do not use it pay
+// nothing; the overhead of the clock reads in a filter is charged to
+// the stage upstream of it.
+template <typename SINK>
+class path_f_instrument final:
+    public meta::inherit_if_i_input_path<SINK,
+        i_input_path<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_regular_path<SINK,
+        i_regular_path<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_decorated_path<SINK,
+        i_decorated_path<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_monotonic_parameters<SINK,
+        i_monotonic_parameters<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_cubic_parameters<SINK,
+        i_cubic_parameters<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_offsetting_parameters<SINK,
+        i_offsetting_parameters<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_join_parameters<SINK,
+        i_join_parameters<path_f_instrument<SINK>>>,
+    public meta::inherit_if_i_dashing_parameters<SINK,
+        i_dashing_parameters<path_f_instrument<SINK>>>
+{
+
+    path_instrumentation::stage &m_stage;
+    SINK m_sink;
+
+public:
+
+    explicit path_f_instrument(path_instrumentation::stage &stage,
+        SINK &&sink):
+        m_stage(stage),
+        m_sink(std::forward<SINK>(sink)) {
+        ;
+    }
+
+private:
+
+    static uint64_t read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    template <typename F>
+    void timed(path_instruction instruction, F &&forward) {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        uint64_t start_cycles = read_cycles();
+        forward();
+        uint64_t cycles = read_cycles() - start_cycles;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now() - start).count();
+        m_stage.add(instruction, static_cast<uint64_t>(ns), cycles);
+    }
+
+friend i_input_path<path_f_instrument<SINK>>;
+
+    void do_begin_contour(rvgf x0, rvgf y0) {
+        timed(path_instruction::begin_contour, [&](void) {
+            m_sink.begin_contour(x0, y0);
+        });
+    }
+
+    void do_end_open_contour(rvgf x0, rvgf y0) {
+        timed(path_instruction::end_open_contour, [&](void) {
+            m_sink.end_open_contour(x0, y0);
+        });
+    }
+
+    void do_end_closed_contour(rvgf x0, rvgf y0) {
+        timed(path_instruction::end_closed_contour, [&](void) {
+            m_sink.end_closed_contour(x0, y0);
+        });
+    }
+
+    void do_linear_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1) {
+        timed(path_instruction::linear_segment, [&](void) {
+            m_sink.linear_segment(x0, y0, x1, y1);
+        });
+    }
+
+    void do_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2) {
+        timed(path_instruction::quadratic_segment, [&](void) {
+            m_sink.quadratic_segment(x0, y0, x1, y1, x2, y2);
+        });
+    }
+
+    void do_rational_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf w1, rvgf x2, rvgf y2) {
+        timed(path_instruction::rational_quadratic_segment, [&](void) {
+            m_sink.rational_quadratic_segment(x0, y0, x1, y1, w1,
+                x2, y2);
+        });
+    }
+
+    void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+        timed(path_instruction::cubic_segment, [&](void) {
+            m_sink.cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3);
+        });
+    }
+
+friend i_regular_path<path_f_instrument<SINK>>;
+
+    void do_begin_regular_contour(rvgf xi, rvgf yi, rvgf dxi, rvgf dyi) {
+        timed(path_instruction::begin_regular_contour, [&](void) {
+            m_sink.begin_regular_contour(xi, yi, dxi, dyi);
+        });
+    }
+
+    void do_end_regular_open_contour(rvgf dxf, rvgf dyf, rvgf xf, rvgf yf) {
+        timed(path_instruction::end_regular_open_contour, [&](void) {
+            m_sink.end_regular_open_contour(dxf, dyf, xf, yf);
+        });
+    }
+
+    void do_end_regular_closed_contour(rvgf dxf, rvgf dyf, rvgf xf, rvgf yf) {
+        timed(path_instruction::end_regular_closed_contour, [&](void) {
+            m_sink.end_regular_closed_contour(dxf, dyf, xf, yf);
+        });
+    }
+
+    void do_degenerate_segment(rvgf xi, rvgf yi, rvgf dx, rvgf dy,
+            rvgf xf, rvgf yf) {
+        timed(path_instruction::degenerate_segment, [&](void) {
+            m_sink.degenerate_segment(xi, yi, dx, dy, xf, yf);
+        });
+    }
+
+    void do_cusp(rvgf dxi, rvgf dyi, rvgf x, rvgf y, rvgf dxf, rvgf dyf,
+        rvgf w) {
+        timed(path_instruction::cusp, [&](void) {
+            m_sink.cusp(dxi, dyi, x, y, dxf, dyf, w);
+        });
+    }
+
+    void do_inner_cusp(rvgf dxi, rvgf dyi, rvgf x, rvgf y, rvgf dxf, rvgf dyf,
+        rvgf w) {
+        timed(path_instruction::inner_cusp, [&](void) {
+            m_sink.inner_cusp(dxi, dyi, x, y, dxf, dyf, w);
+        });
+    }
+
+    void do_begin_segment_piece(rvgf xi, rvgf yi, rvgf dxi, rvgf dyi) {
+        timed(path_instruction::begin_segment_piece, [&](void) {
+            m_sink.begin_segment_piece(xi, yi, dxi, dyi);
+        });
+    }
+
+    void do_end_segment_piece(rvgf dxf, rvgf dyf, rvgf xf, rvgf yf) {
+        timed(path_instruction::end_segment_piece, [&](void) {
+            m_sink.end_segment_piece(dxf, dyf, xf, yf);
+        });
+    }
+
+    void do_linear_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
+        rvgf x1, rvgf y1) {
+        timed(path_instruction::linear_segment_piece, [&](void) {
+            m_sink.linear_segment_piece(ti, tf, x0, y0, x1, y1);
+        });
+    }
+
+    void do_quadratic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
+        rvgf x1, rvgf y1, rvgf x2, rvgf y2) {
+        timed(path_instruction::quadratic_segment_piece, [&](void) {
+            m_sink.quadratic_segment_piece(ti, tf, x0, y0, x1, y1, x2, y2);
+        });
+    }
+
+    void do_rational_quadratic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
+        rvgf x1, rvgf y1, rvgf w1, rvgf x2, rvgf y2) {
+        timed(path_instruction::rational_quadratic_segment_piece, [&](void) {
+            m_sink.rational_quadratic_segment_piece(ti, tf, x0, y0,
+                x1, y1, w1, x2, y2);
+        });
+    }
+
+    void do_cubic_segment_piece(rvgf ti, rvgf tf, rvgf x0, rvgf y0,
+        rvgf x1, rvgf y1, rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+        timed(path_instruction::cubic_segment_piece, [&](void) {
+            m_sink.cubic_segment_piece(ti, tf, x0, y0, x1, y1,
+                x2, y2, x3, y3);
+        });
+    }
+
+friend i_cubic_parameters<path_f_instrument<SINK>>;
+
+    void do_inflection_parameter(rvgf t) {
+        timed(path_instruction::inflection_parameter, [&](void) {
+            m_sink.inflection_parameter(t);
+        });
+    }
+
+    void do_double_point_parameter(rvgf t) {
+        timed(path_instruction::double_point_parameter, [&](void) {
+            m_sink.double_point_parameter(t);
+        });
+    }
+
+friend i_monotonic_parameters<path_f_instrument<SINK>>;
+
+    void do_root_dx_parameter(rvgf t) {
+        timed(path_instruction::root_dx_parameter, [&](void) {
+            m_sink.root_dx_parameter(t);
+        });
+    }
+
+    void do_root_dy_parameter(rvgf t) {
+        timed(path_instruction::root_dy_parameter, [&](void) {
+            m_sink.root_dy_parameter(t);
+        });
+    }
+
+    void do_root_dw_parameter(rvgf t) {
+        timed(path_instruction::root_dw_parameter, [&](void) {
+            m_sink.root_dw_parameter(t);
+        });
+    }
+
+friend i_offsetting_parameters<path_f_instrument<SINK>>;
+
+    void do_offset_cusp_parameter(rvgf t) {
+        timed(path_instruction::offset_cusp_parameter, [&](void) {
+            m_sink.offset_cusp_parameter(t);
+        });
+    }
+
+    void do_evolute_cusp_parameter(rvgf t) {
+        timed(path_instruction::evolute_cusp_parameter, [&](void) {
+            m_sink.evolute_cusp_parameter(t);
+        });
+    }
+
+friend i_join_parameters<path_f_instrument<SINK>>;
+
+    void do_join_tangent_parameter(rvgf t) {
+        timed(path_instruction::join_tangent_parameter, [&](void) {
+            m_sink.join_tangent_parameter(t);
+        });
+    }
+
+    void do_join_vertex_parameter(rvgf t) {
+        timed(path_instruction::join_vertex_parameter, [&](void) {
+            m_sink.join_vertex_parameter(t);
+        });
+    }
+
+friend i_decorated_path<path_f_instrument<SINK>>;
+
+    void do_initial_cap(rvgf x, rvgf y, rvgf dx, rvgf dy) {
+        timed(path_instruction::initial_cap, [&](void) {
+            m_sink.initial_cap(x, y, dx, dy);
+        });
+    }
+
+    void do_terminal_cap(rvgf dx, rvgf dy, rvgf x, rvgf y) {
+        timed(path_instruction::terminal_cap, [&](void) {
+            m_sink.terminal_cap(dx, dy, x, y);
+        });
+    }
+
+    void do_initial_butt_cap(rvgf x, rvgf y, rvgf dx, rvgf dy) {
+        timed(path_instruction::initial_butt_cap, [&](void) {
+            m_sink.initial_butt_cap(x, y, dx, dy);
+        });
+    }
+
+    void do_terminal_butt_cap(rvgf dx, rvgf dy, rvgf x, rvgf y) {
+        timed(path_instruction::terminal_butt_cap, [&](void) {
+            m_sink.terminal_butt_cap(dx, dy, x, y);
+        });
+    }
+
+    void do_backward_initial_cap(rvgf x, rvgf y, rvgf dx, rvgf dy) {
+        timed(path_instruction::backward_initial_cap, [&](void) {
+            m_sink.backward_initial_cap(x, y, dx, dy);
+        });
+    }
+
+    void do_backward_terminal_cap(rvgf dx, rvgf dy, rvgf x, rvgf y) {
+        timed(path_instruction::backward_terminal_cap, [&](void) {
+            m_sink.backward_terminal_cap(dx, dy, x, y);
+        });
+    }
+
+    void do_backward_initial_butt_cap(rvgf x, rvgf y, rvgf dx, rvgf dy) {
+        timed(path_instruction::backward_initial_butt_cap, [&](void) {
+            m_sink.backward_initial_butt_cap(x, y, dx, dy);
+        });
+    }
+
+    void do_backward_terminal_butt_cap(rvgf dx, rvgf dy, rvgf x, rvgf y) {
+        timed(path_instruction::backward_terminal_butt_cap, [&](void) {
+            m_sink.backward_terminal_butt_cap(dx, dy, x, y);
+        });
+    }
+
+    void do_join(rvgf dxi, rvgf dyi, rvgf x, rvgf y, rvgf dxf, rvgf dyf,
+        rvgf w) {
+        timed(path_instruction::join, [&](void) {
+            m_sink.join(dxi, dyi, x, y, dxf, dyf, w);
+        });
+    }
+
+    void do_inner_join(rvgf dxi, rvgf dyi, rvgf x, rvgf y, rvgf dxf, rvgf dyf,
+        rvgf w) {
+        timed(path_instruction::inner_join, [&](void) {
+            m_sink.inner_join(dxi, dyi, x, y, dxf, dyf, w);
+        });
+    }
+
+friend i_dashing_parameters<path_f_instrument<SINK>>;
+
+    void do_begin_dash_parameter(rvgf t) {
+        timed(path_instruction::begin_dash_parameter, [&](void) {
+            m_sink.begin_dash_parameter(t);
+        });
+    }
+
+    void do_end_dash_parameter(rvgf t) {
+        timed(path_instruction::end_dash_parameter, [&](void) {
+            m_sink.end_dash_parameter(t);
+        });
+    }
+
+    void do_backward_begin_dash_parameter(rvgf t) {
+        timed(path_instruction::backward_begin_dash_parameter, [&](void) {
+            m_sink.backward_begin_dash_parameter(t);
+        });
+    }
+
+    void do_backward_end_dash_parameter(rvgf t) {
+        timed(path_instruction::backward_end_dash_parameter, [&](void) {
+            m_sink.backward_end_dash_parameter(t);
+        });
+    }
+
+};
+
+template <typename SINK>
+inline path_f_instrument<SINK> make_path_f_instrument(
+    path_instrumentation::stage &stage, SINK &&sink) {
+    return path_f_instrument<SINK>(stage, std::forward<SINK>(sink));
+}
+
+} // namespace rvg
+
+#endif
@@ -81,6 +81,72 @@ enum class path_instruction: uint8_t {
 	backward_end_dash_parameter
 };
 
+// Number of data values an instruction reads, starting at its offset
+// (see the layout in rvg-path-data.h). Parameters embed their value in
+// the offset and read none. Returns -1 for values that are not
+// instructions.
+static inline int path_instruction_data_size(path_instruction instruction) {
+    switch (instruction) {
+        case path_instruction::begin_contour:
+        case path_instruction::end_open_contour:
+        case path_instruction::end_closed_contour:
+            return 2;
+        case path_instruction::linear_segment:
+            return 4;
+        case path_instruction::quadratic_segment:
+            return 6;
+        case path_instruction::rational_quadratic_segment:
+            return 7;
+        case path_instruction::cubic_segment:
+            return 8;
+        case path_instruction::begin_regular_contour:
+        case path_instruction::end_regular_open_contour:
+        case path_instruction::end_regular_closed_contour:
+        case path_instruction::begin_segment_piece:
+        case path_instruction::end_segment_piece:
+            return 4;
+        case path_instruction::degenerate_segment:
+        case path_instruction::linear_segment_piece:
+            return 6;
+        case path_instruction::cusp:
+        case path_instruction::inner_cusp:
+            return 7;
+        case path_instruction::quadratic_segment_piece:
+            return 8;
+        case path_instruction::rational_quadratic_segment_piece:
+            return 9;
+        case path_instruction::cubic_segment_piece:
+            return 10;
+        case path_instruction::inflection_parameter:
+        case path_instruction::double_point_parameter:
+        case path_instruction::root_dx_parameter:
+        case path_instruction::root_dy_parameter:
+        case path_instruction::root_dw_parameter:
+        case path_instruction::offset_cusp_parameter:
+        case path_instruction::evolute_cusp_parameter:
+        case path_instruction::join_tangent_parameter:
+        case path_instruction::join_vertex_parameter:
+        case path_instruction::begin_dash_parameter:
+        case path_instruction::end_dash_parameter:
+        case path_instruction::backward_begin_dash_parameter:
+        case path_instruction::backward_end_dash_parameter:
+            return 0;
+        case path_instruction::initial_cap:
+        case path_instruction::terminal_cap:
+        case path_instruction::backward_initial_cap:
+        case path_instruction::backward_terminal_cap:
+        case path_instruction::initial_butt_cap:
+        case path_instruction::terminal_butt_cap:
+        case path_instruction::backward_initial_butt_cap:
+        case path_instruction::backward_terminal_butt_cap:
+            return 4;
+        case path_instruction::join:
+        case path_instruction::inner_join:
+            return 7;
+    }
+    return -1;
+}
+
 } // namespace rvg
 
 #endif
@@ -0,0 +1,173 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <ostream>
+#include <iomanip>
+
+#include "rvg-path-instrumentation.h"
+
+namespace rvg {
+
+void path_instrumentation::reset(std::initializer_list<const char *> names) {
+    m_stages.clear();
+    m_stages.reserve(names.size());
+    for (auto name: names) {
+        m_stages.emplace_back(name);
+    }
+}
+
+uint64_t path_instrumentation::get_self_nanoseconds(size_t i) const {
+    uint64_t total = m_stages[i].nanoseconds;
+    uint64_t downstream = i+1 < m_stages.size()?
+        m_stages[i+1].nanoseconds: 0;
+    return total > downstream? total-downstream: 0;
+}
+
+uint64_t path_instrumentation::get_self_cycles(size_t i) const {
+    uint64_t total = m_stages[i].cycles;
+    uint64_t downstream = i+1 < m_stages.size()? m_stages[i+1].cycles: 0;
+    return total > downstream? total-downstream: 0;
+}
+
+const char *path_instrumentation::get_instruction_name(
+    path_instruction instruction) {
+    switch (instruction) {
+        case path_instruction::begin_contour:
+            return "begin_contour";
+        case path_instruction::end_open_contour:
+            return "end_open_contour";
+        case path_instruction::end_closed_contour:
+            return "end_closed_contour";
+        case path_instruction::linear_segment:
+            return "linear_segment";
+        case path_instruction::quadratic_segment:
+            return "quadratic_segment";
+        case path_instruction::rational_quadratic_segment:
+            return "rational_quadratic_segment";
+        case path_instruction::cubic_segment:
+            return "cubic_segment";
+        case path_instruction::begin_regular_contour:
+            return "begin_regular_contour";
+        case path_instruction::end_regular_open_contour:
+            return "end_regular_open_contour";
+        case path_instruction::end_regular_closed_contour:
+            return "end_regular_closed_contour";
+        case path_instruction::degenerate_segment:
+            return "degenerate_segment";
+        case path_instruction::cusp:
+            return "cusp";
+        case path_instruction::inner_cusp:
+            return "inner_cusp";
+        case path_instruction::begin_segment_piece:
+            return "begin_segment_piece";
+        case path_instruction::end_segment_piece:
+            return "end_segment_piece";
+        case path_instruction::linear_segment_piece:
+            return "linear_segment_piece";
+        case path_instruction::quadratic_segment_piece:
+            return "quadratic_segment_piece";
+        case path_instruction::rational_quadratic_segment_piece:
+            return "rational_quadratic_segment_piece";
+        case path_instruction::cubic_segment_piece:
+            return "cubic_segment_piece";
+        case path_instruction::inflection_parameter:
+            return "inflection_parameter";
+        case path_instruction::double_point_parameter:
+            return "double_point_parameter";
+        case path_instruction::root_dx_parameter:
+            return "root_dx_parameter";
+        case path_instruction::root_dy_parameter:
+            return "root_dy_parameter";
+        case path_instruction::root_dw_parameter:
+            return "root_dw_parameter";
+        case path_instruction::offset_cusp_parameter:
+            return "offset_cusp_parameter";
+        case path_instruction::evolute_cusp_parameter:
+            return "evolute_cusp_parameter";
+        case path_instruction::join_tangent_parameter:
+            return "join_tangent_parameter";
+        case path_instruction::join_vertex_parameter:
+            return "join_vertex_parameter";
+        case path_instruction::initial_cap:
+            return "initial_cap";
+        case path_instruction::terminal_cap:
+            return "terminal_cap";
+        case path_instruction::backward_initial_cap:
+            return "backward_initial_cap";
+        case path_instruction::backward_terminal_cap:
+            return "backward_terminal_cap";
+        case path_instruction::initial_butt_cap:
+            return "initial_butt_cap";
+        case path_instruction::terminal_butt_cap:
+            return "terminal_butt_cap";
+        case path_instruction::backward_initial_butt_cap:
+            return "backward_initial_butt_cap";
+        case path_instruction::backward_terminal_butt_cap:
+            return "backward_terminal_butt_cap";
+        case path_instruction::join:
+            return "join";
+        case path_instruction::inner_join:
+            return "inner_join";
+        case path_instruction::begin_dash_parameter:
+            return "begin_dash_parameter";
+        case path_instruction::end_dash_parameter:
+            return "end_dash_parameter";
+        case path_instruction::backward_begin_dash_parameter:
+            return "backward_begin_dash_parameter";
+        case path_instruction::backward_end_dash_parameter:
+            return "backward_end_dash_parameter";
+        default:
+            return "unknown";
+    }
+}
+
+void path_instrumentation::print_summary(std::ostream &out) const {
+    uint64_t total = m_stages.empty()? 0: m_stages[0].nanoseconds;
+    auto flags = out.flags();
+    auto precision = out.precision();
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        const auto &s = m_stages[i];
+        uint64_t self = get_self_nanoseconds(i);
+        out << s.name << ": " << s.calls << " calls, "
+            << std::fixed << std::setprecision(3)
+            << s.nanoseconds*1.e-6 << "ms total, "
+            << self*1.e-6 << "ms self ("
+            << std::setprecision(1)
+            << (total > 0? 100.*self/total: 0.) << "%), "
+            << get_self_cycles(i) << " cycles self\n";
+        for (size_t j = 0; j < instruction_count; ++j) {
+            if (s.instructions[j] > 0) {
+                out << "  " << get_instruction_name(
+                    static_cast<path_instruction>(j)) << " "
+                    << s.instructions[j] << '\n';
+            }
+        }
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void path_instrumentation::print_folded(std::ostream &out) const {
+    std::string stack;
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        if (i > 0) {
+            stack += ';';
+        }
+        stack += m_stages[i].name;
+        out << stack << ' ' << get_self_nanoseconds(i) << '\n';
+    }
+}
+
+} // namespace rvg
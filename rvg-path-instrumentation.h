@@ -0,0 +1,102 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_PATH_INSTRUMENTATION_H
+#define RVG_PATH_INSTRUMENTATION_H
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "rvg-path-instruction.h"
+
+namespace rvg {
+
+// Counters filled by path_f_instrument filters spliced into a pipeline,
+// one stage per filter, in pipeline order. Each filter measures the
+// time spent in the calls it forwards, which includes every stage
+// downstream of it. The time spent in a stage alone is the difference
+// between its total and the total of the next stage.
+class path_instrumentation {
+public:
+
+    static constexpr size_t instruction_count = static_cast<size_t>(
+        path_instruction::backward_end_dash_parameter)+1;
+
+    struct stage {
+        std::string name;
+        uint64_t calls;
+        uint64_t nanoseconds;
+        uint64_t cycles;
+        std::array<uint64_t, instruction_count> instructions;
+
+        explicit stage(const char *stage_name):
+            name(stage_name),
+            calls(0),
+            nanoseconds(0),
+            cycles(0),
+            instructions{} {
+            ;
+        }
+
+        void add(path_instruction instruction, uint64_t ns, uint64_t cy) {
+            ++calls;
+            ++instructions[static_cast<size_t>(instruction)];
+            nanoseconds += ns;
+            cycles += cy;
+        }
+    };
+
+    // Replaces all stages by new stages with the given names. The
+    // stages cannot be added later, so references remain valid.
+    void reset(std::initializer_list<const char *> names);
+
+    size_t size(void) const {
+        return m_stages.size();
+    }
+
+    stage &operator[](size_t i) {
+        return m_stages[i];
+    }
+
+    const stage &operator[](size_t i) const {
+        return m_stages[i];
+    }
+
+    // Time and cycles spent in stage i, excluding downstream stages
+    uint64_t get_self_nanoseconds(size_t i) const;
+    uint64_t get_self_cycles(size_t i) const;
+
+    // Name of an instruction, as used by the Lua bindings
+    static const char *get_instruction_name(path_instruction instruction);
+
+    // One line per stage with calls, total and self times, and the
+    // number of each instruction received
+    void print_summary(std::ostream &out) const;
+
+    // Folded stacks, one line per stage, with self time in nanoseconds,
+    // as consumed by flamegraph.pl and similar tools
+    void print_folded(std::ostream &out) const;
+
+private:
+    std::vector<stage> m_stages;
+};
+
+} // namespace rvg
+
+#endif
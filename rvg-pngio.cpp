@@ -13,6 +13,7 @@
 //
 // Contact information: diego.nehab@gmail.com
 //
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -23,6 +24,10 @@
 #include <png.h>
 #include <zlib.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "rvg-ptr.h"
 #include "rvg-meta.h"
 #include "rvg-image.h"
@@ -121,7 +126,8 @@ static size_t io_memory_reader_io(t_io *self, char *out, size_t len) {
 static size_t io_memory_writer_io(t_io *self, char *in, size_t len) {
     // need to realloc
     if (self->context.memory.pos + len > self->context.memory.size) {
-        size_t newsize = std::max(2*self->context.memory.size, static_cast<size_t>(64*1024));
+        size_t newsize = std::max({2*self->context.memory.size,
+            self->context.memory.pos + len, static_cast<size_t>(64*1024)});
         char *tmp = reinterpret_cast<char *>(realloc(self->context.memory.data,
             newsize));
         if (!tmp) return 0;
@@ -170,16 +176,17 @@ void io_fn(png_structp png_ptr, png_bytep data, png_size_t len) {
 
 namespace rvg {
 
-template <typename U, typename T, size_t N, size_t... Is>
-void load_png_helper(int width, int height, const U *base, image<T,N> *out,
+template <typename U, typename T, size_t N, e_organization O, size_t... Is>
+void load_png_helper(int width, int height, const U *base,
+    image<T,N,O> *out,
     std::index_sequence<Is...>) {
     constexpr int n = static_cast<int>(N);
     out->template load_from<unorm_converter<U,T>>(width, width, height,
         n*width, n, (base+Is)...);
 }
 
-template <typename U, typename T, size_t N, size_t... Is>
-void store_png_helper(int width, int height, const image<T,N> &in,
+template <typename U, typename T, size_t N, e_organization O, size_t... Is>
+void store_png_helper(int width, int height, const image<T,N,O> &in,
     U *base, std::index_sequence<Is...>) {
     constexpr int n = static_cast<int>(N);
     in.template store_into<unorm_converter<T,U>>(width, height, n*width, n,
@@ -306,10 +313,13 @@ int describe_png(const std::string &memory, int *width, int *height,
     return ret;
 }
 
-template <typename T, size_t N,
+template <typename T, size_t N, e_organization O,
     typename = typename std::enable_if<(N > 0 && N <= 4)>::type>
-int load_png(t_io *reader, image<T,N> *out,
+int load_png(t_io *reader, image<T,N,O> *out,
     image_attributes *attrs) {
+    // packed 8- and 16-bit images are decoded in place
+    static constexpr bool direct = (O == e_organization::packed) &&
+        (std::is_same<T,uint8_t>::value || std::is_same<T,uint16_t>::value);
     // temporary image storage
     png_bytepp volatile row_pointers = nullptr;
     png_bytep volatile buffer = nullptr;
@@ -435,13 +445,22 @@ int load_png(t_io *reader, image<T,N> *out,
     assert(color_type == PNG_COLOR_TYPE_RGB || N != 3);
     assert(color_type == PNG_COLOR_TYPE_RGB_ALPHA || N != 4);
     int pixel_size = (bit_depth == 8)? N: 2*N;
-    // allocate data for reading
-    buffer = reinterpret_cast<png_bytep>(
-        png_malloc(png_ptr, height*width*pixel_size));
     row_pointers = reinterpret_cast<png_bytepp>(
         png_malloc(png_ptr, height*sizeof(png_bytep)));
-    for (int i = 0; i < height; i++) {
-        row_pointers[i] = &buffer[(height-1-i)*width*pixel_size];
+    if (direct) {
+        // point rows straight into the image, flipped
+        out->resize(width, height);
+        for (int i = 0; i < height; i++) {
+            row_pointers[i] = reinterpret_cast<png_bytep>(
+                &out->get_data()[N*out->get_pitch()*(height-1-i)]);
+        }
+    } else {
+        // allocate data for reading
+        buffer = reinterpret_cast<png_bytep>(
+            png_malloc(png_ptr, height*width*pixel_size));
+        for (int i = 0; i < height; i++) {
+            row_pointers[i] = &buffer[(height-1-i)*width*pixel_size];
+        }
     }
     // read attributes
     if (attrs) {
@@ -454,7 +473,9 @@ int load_png(t_io *reader, image<T,N> *out,
     // read image
     png_read_image(png_ptr, row_pointers);
     //// save to image object
-    if (bit_depth == 8) {
+    if (direct) {
+        ;
+    } else if (bit_depth == 8) {
         uint8_t *base = reinterpret_cast<uint8_t *>(buffer);
         load_png_helper(width, height, base, out, std::make_index_sequence<N>{});
     } else {
@@ -473,8 +494,8 @@ int load_png(t_io *reader, image<T,N> *out,
     return 1;
 }
 
-template <typename T, size_t N>
-int load_png(FILE *file, image<T,N> *out,
+template <typename T, size_t N, e_organization O>
+int load_png(FILE *file, image<T,N,O> *out,
     image_attributes *attrs) {
     t_io reader;
     io_file_reader_init(&reader, file);
@@ -483,8 +504,8 @@ int load_png(FILE *file, image<T,N> *out,
     return ret;
 }
 
-template <typename T, size_t N>
-int load_png(const std::string &memory, image<T,N> *out,
+template <typename T, size_t N, e_organization O>
+int load_png(const std::string &memory, image<T,N,O> *out,
     image_attributes *attrs) {
     t_io reader;
     io_memory_reader_init(&reader, const_cast<char *>(&memory[0]),
@@ -561,9 +582,61 @@ template int load_png(const std::string &memory,
     image<float, 4> *out,
     image_attributes *attrs);
 
+template int load_png(FILE *file,
+    packed_image<uint8_t, 1> *out,
+    image_attributes *attrs);
+template int load_png(FILE *file,
+    packed_image<uint8_t, 2> *out,
+    image_attributes *attrs);
+template int load_png(FILE *file,
+    packed_image<uint8_t, 3> *out,
+    image_attributes *attrs);
+template int load_png(FILE *file,
+    packed_image<uint8_t, 4> *out,
+    image_attributes *attrs);
+
+template int load_png(FILE *file,
+    packed_image<uint16_t, 1> *out,
+    image_attributes *attrs);
+template int load_png(FILE *file,
+    packed_image<uint16_t, 2> *out,
+    image_attributes *attrs);
+template int load_png(FILE *file,
+    packed_image<uint16_t, 3> *out,
+    image_attributes *attrs);
+template int load_png(FILE *file,
+    packed_image<uint16_t, 4> *out,
+    image_attributes *attrs);
+
+template int load_png(const std::string &memory,
+    packed_image<uint8_t, 1> *out,
+    image_attributes *attrs);
+template int load_png(const std::string &memory,
+    packed_image<uint8_t, 2> *out,
+    image_attributes *attrs);
+template int load_png(const std::string &memory,
+    packed_image<uint8_t, 3> *out,
+    image_attributes *attrs);
+template int load_png(const std::string &memory,
+    packed_image<uint8_t, 4> *out,
+    image_attributes *attrs);
+
+template int load_png(const std::string &memory,
+    packed_image<uint16_t, 1> *out,
+    image_attributes *attrs);
+template int load_png(const std::string &memory,
+    packed_image<uint16_t, 2> *out,
+    image_attributes *attrs);
+template int load_png(const std::string &memory,
+    packed_image<uint16_t, 3> *out,
+    image_attributes *attrs);
+template int load_png(const std::string &memory,
+    packed_image<uint16_t, 4> *out,
+    image_attributes *attrs);
+
 template <typename T, size_t N>
 i_image::ptr load_png(t_io *reader, image_attributes *attrs) {
-    auto p = make_intrusive<image<T,N>>();
+    auto p = make_intrusive<packed_image<T,N>>();
     if (load_png(reader, p.get(), attrs)) return p;
     else return nullptr;
 }
@@ -613,12 +686,373 @@ i_image::ptr load_png(const std::string &memory, int wanted_channels,
     return ret;
 }
 
-template <typename U, typename T, size_t N,
+// Uncompressed bytes per band when deflating in parallel
+static const size_t png_band_size = 256*1024;
+
+// Deflate window, and size of the dictionary that primes each band
+static const size_t png_window_size = 32*1024;
+
+static int png_threads(const png_write_options &options) {
+    int threads = options.threads;
+#ifdef _OPENMP
+    if (threads <= 0) threads = omp_get_max_threads();
+#endif
+    return std::max(threads, 1);
+}
+
+static uint8_t png_paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+// Applies filter type to row, given the previous row (or nullptr for
+// the first row), writing the type byte followed by the filtered bytes
+static void png_filter_row(int type, const uint8_t *row, const uint8_t *prev,
+    size_t len, size_t bpp, uint8_t *out) {
+    out[0] = static_cast<uint8_t>(type);
+    ++out;
+    for (size_t i = 0; i < len; ++i) {
+        int a = i >= bpp? row[i-bpp]: 0;
+        int b = prev? prev[i]: 0;
+        int c = (prev && i >= bpp)? prev[i-bpp]: 0;
+        int x = row[i];
+        switch (type) {
+            case 1: x -= a; break;
+            case 2: x -= b; break;
+            case 3: x -= (a + b) >> 1; break;
+            case 4: x -= png_paeth(a, b, c); break;
+            default: break;
+        }
+        out[i] = static_cast<uint8_t>(x);
+    }
+}
+
+// Picks the filter that minimizes the sum of absolute differences,
+// the same heuristic libpng uses
+static void png_filter_row_adaptive(const uint8_t *row, const uint8_t *prev,
+    size_t len, size_t bpp, uint8_t *out, std::vector<uint8_t> &scratch) {
+    scratch.resize(len+1);
+    unsigned long best = ~0ul;
+    for (int type = 0; type <= 4; ++type) {
+        png_filter_row(type, row, prev, len, bpp, scratch.data());
+        unsigned long sum = 0;
+        for (size_t i = 1; i <= len && sum < best; ++i) {
+            sum += static_cast<unsigned long>(
+                std::abs(static_cast<int>(static_cast<int8_t>(scratch[i]))));
+        }
+        if (sum < best) {
+            best = sum;
+            std::copy(scratch.begin(), scratch.end(), out);
+        }
+    }
+}
+
+// Deflates a band into out as raw deflate data, primed with a
+// dictionary. All but the last band end in a sync flush, so they can
+// be concatenated.
+static bool png_deflate_band(const uint8_t *data, size_t len,
+    const uint8_t *dictionary, size_t dictionary_len, int level, bool last,
+    std::vector<uint8_t> &out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    if (dictionary_len > 0 && deflateSetDictionary(&zs, dictionary,
+            static_cast<uInt>(dictionary_len)) != Z_OK) {
+        deflateEnd(&zs);
+        return false;
+    }
+    out.resize(deflateBound(&zs, static_cast<uLong>(len)) + 64);
+    zs.next_in = const_cast<Bytef *>(data);
+    zs.avail_in = static_cast<uInt>(len);
+    int flush = last? Z_FINISH: Z_SYNC_FLUSH;
+    int ret = Z_OK;
+    for ( ;; ) {
+        zs.next_out = out.data() + zs.total_out;
+        zs.avail_out = static_cast<uInt>(out.size() - zs.total_out);
+        ret = deflate(&zs, flush);
+        if (ret == Z_STREAM_END || (ret == Z_OK && zs.avail_out > 0 &&
+            zs.avail_in == 0) || (ret != Z_OK && ret != Z_BUF_ERROR)) {
+            break;
+        }
+        out.resize(2*out.size());
+    }
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return last? ret == Z_STREAM_END: ret == Z_OK;
+}
+
+static bool png_write_all(t_io *writer, const uint8_t *data, size_t len) {
+    return writer->io(writer, reinterpret_cast<char *>(
+        const_cast<uint8_t *>(data)), len) == len;
+}
+
+static bool png_write_chunk(t_io *writer, const char *type,
+    const uint8_t *data, size_t len) {
+    uint8_t header[8] = {
+        static_cast<uint8_t>(len >> 24), static_cast<uint8_t>(len >> 16),
+        static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len),
+        static_cast<uint8_t>(type[0]), static_cast<uint8_t>(type[1]),
+        static_cast<uint8_t>(type[2]), static_cast<uint8_t>(type[3])
+    };
+    uLong crc = crc32(0L, header+4, 4);
+    if (len > 0) crc = crc32(crc, data, static_cast<uInt>(len));
+    uint8_t trailer[4] = {
+        static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+        static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)
+    };
+    return png_write_all(writer, header, 8) &&
+        (len == 0 || png_write_all(writer, data, len)) &&
+        png_write_all(writer, trailer, 4);
+}
+
+// Filters and deflates rows in bands, pigz style, and writes each band
+// as one IDAT chunk. Rows are buffered until there is a band for each
+// thread, and these bands are then filtered and deflated in parallel.
+// Everything up to the first IDAT chunk must already have been written.
+class png_idat_writer {
+
+    t_io *m_writer;
+    size_t m_row_bytes, m_bpp;
+    bool m_swap;
+    int m_filter, m_level, m_threads, m_band_rows;
+    std::vector<uint8_t> m_rows;   // rows waiting to be deflated
+    std::vector<uint8_t> m_prev;   // last row deflated, for filtering
+    std::vector<uint8_t> m_window; // last filtered bytes deflated
+    uLong m_adler;
+    bool m_started;
+
+public:
+
+    // If swap is set, 16-bit samples are byte-swapped as rows come in
+    png_idat_writer(t_io *writer, size_t row_bytes, size_t bpp, bool swap,
+        const png_write_options &options, int threads):
+        m_writer(writer),
+        m_row_bytes(row_bytes),
+        m_bpp(bpp),
+        m_swap(swap),
+        m_filter(options.filter),
+        m_level(options.compression_level),
+        m_threads(threads),
+        m_band_rows(static_cast<int>(std::max(size_t{1},
+            png_band_size/(row_bytes+1)))),
+        m_adler(adler32(0L, nullptr, 0)),
+        m_started(false) {
+        if (m_level < 0 || m_level > 9) m_level = Z_DEFAULT_COMPRESSION;
+        m_rows.reserve(m_row_bytes*m_band_rows*m_threads);
+    }
+
+    bool write_row(const uint8_t *row) {
+        size_t end = m_rows.size();
+        m_rows.insert(m_rows.end(), row, row+m_row_bytes);
+        // PNG samples are big-endian
+        if (m_swap) {
+            for (size_t i = end; i+1 < m_rows.size(); i += 2) {
+                std::swap(m_rows[i], m_rows[i+1]);
+            }
+        }
+        if (m_rows.size() >= m_row_bytes*m_band_rows*m_threads) {
+            return flush(false);
+        }
+        return true;
+    }
+
+    // Deflates the remaining rows and writes the end of the file
+    bool finish(void) {
+        return flush(true) && png_write_chunk(m_writer, "IEND", nullptr, 0);
+    }
+
+private:
+
+    // Each band is primed with the last 32KiB of the data before it, and
+    // all but the very last band end in a sync flush, so the bands
+    // concatenate into a single zlib stream
+    bool flush(bool last) {
+        size_t filtered_row_bytes = m_row_bytes+1;
+        int height = static_cast<int>(m_rows.size()/m_row_bytes);
+        if (height == 0 && !last) {
+            return true;
+        }
+        // filter every row, after the window left by the previous flush
+        size_t w = m_window.size();
+        std::vector<uint8_t> filtered(w + filtered_row_bytes*height);
+        std::copy(m_window.begin(), m_window.end(), filtered.begin());
+#pragma omp parallel num_threads(m_threads)
+        {
+            std::vector<uint8_t> scratch;
+#pragma omp for schedule(static)
+            for (int i = 0; i < height; ++i) {
+                const uint8_t *row = &m_rows[m_row_bytes*i];
+                const uint8_t *prev = i > 0? row-m_row_bytes:
+                    (m_prev.empty()? nullptr: m_prev.data());
+                uint8_t *out = &filtered[w + filtered_row_bytes*i];
+                if (m_filter >= 0 && m_filter <= 4) {
+                    png_filter_row(m_filter, row, prev, m_row_bytes, m_bpp,
+                        out);
+                } else {
+                    png_filter_row_adaptive(row, prev, m_row_bytes, m_bpp,
+                        out, scratch);
+                }
+            }
+        }
+        // deflate bands, priming each with the data before it
+        int bands = std::max(1, (height+m_band_rows-1)/m_band_rows);
+        size_t band_bytes = filtered_row_bytes*m_band_rows;
+        std::vector<std::vector<uint8_t>> deflated(bands);
+        std::vector<uLong> adler(bands);
+        int failed = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(m_threads) \
+    reduction(+:failed)
+        for (int i = 0; i < bands; ++i) {
+            size_t begin = w + band_bytes*i;
+            size_t end = std::min(filtered.size(), begin + band_bytes);
+            size_t dictionary_len = std::min(begin, png_window_size);
+            const uint8_t *data = filtered.data();
+            if (!png_deflate_band(data+begin, end-begin,
+                    data+begin-dictionary_len, dictionary_len, m_level,
+                    last && i == bands-1, deflated[i])) {
+                ++failed;
+            }
+            adler[i] = adler32(adler32(0L, nullptr, 0), data+begin,
+                static_cast<uInt>(end-begin));
+        }
+        if (failed) {
+            return false;
+        }
+        // zlib header, with the level hint, before the first band
+        if (!m_started) {
+            int hint = m_level == Z_DEFAULT_COMPRESSION? 2:
+                (m_level < 2? 0: (m_level < 6? 1: (m_level == 6? 2: 3)));
+            uint8_t cmf = 0x78, flg = static_cast<uint8_t>(hint << 6);
+            flg = static_cast<uint8_t>(flg + 31 - (cmf*256 + flg) % 31);
+            deflated.front().insert(deflated.front().begin(), {cmf, flg});
+            m_started = true;
+        }
+        // check value after the last band
+        for (int i = 0; i < bands; ++i) {
+            size_t begin = w + band_bytes*i;
+            size_t end = std::min(filtered.size(), begin + band_bytes);
+            m_adler = adler32_combine(m_adler, adler[i],
+                static_cast<z_off_t>(end-begin));
+        }
+        if (last) {
+            deflated.back().insert(deflated.back().end(), {
+                static_cast<uint8_t>(m_adler >> 24),
+                static_cast<uint8_t>(m_adler >> 16),
+                static_cast<uint8_t>(m_adler >> 8),
+                static_cast<uint8_t>(m_adler)});
+        }
+        for (const auto &band: deflated) {
+            if (!png_write_chunk(m_writer, "IDAT", band.data(),
+                    band.size())) {
+                return false;
+            }
+        }
+        // keep what the next flush needs
+        if (height > 0) {
+            m_prev.assign(m_rows.end()-m_row_bytes, m_rows.end());
+        }
+        size_t keep = std::min(filtered.size(), png_window_size);
+        m_window.assign(filtered.end()-keep, filtered.end());
+        m_rows.clear();
+        return true;
+    }
+};
+
+// Writes the image data and the end of the file in parallel. Errors
+// are returned rather than raised, so the writer is destroyed before
+// libpng longjmps out
+static bool png_write_idat_parallel(t_io *writer, png_bytepp rows,
+    int height, size_t row_bytes, size_t bpp, bool swap,
+    const png_write_options &options, int threads) {
+    png_idat_writer idat(writer, row_bytes, bpp, swap, options, threads);
+    for (int i = 0; i < height; ++i) {
+        if (!idat.write_row(rows[i])) {
+            return false;
+        }
+    }
+    return idat.finish();
+}
+
+// Sets the image header, gamma and compression options
+static void png_set_header(png_structp png_ptr, png_infop info_ptr,
+    int width, int height, int channels, int bit_depth,
+    e_color_space color_space, const png_write_options &options) {
+    int color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+    switch (channels) {
+        case 1: color_type = PNG_COLOR_TYPE_GRAY; break;
+        case 2: color_type = PNG_COLOR_TYPE_GRAY_ALPHA; break;
+        case 3: color_type = PNG_COLOR_TYPE_RGB; break;
+        case 4: color_type = PNG_COLOR_TYPE_RGB_ALPHA; break;
+    }
+    // set basic image parameters
+    png_set_IHDR(png_ptr, info_ptr, width, height, bit_depth,
+        color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+        PNG_FILTER_TYPE_DEFAULT);
+    bool has_color = (channels == 3 || channels == 4);
+    // set gamma
+    switch (color_space) {
+        case e_color_space::sRGB:
+            if (has_color) {
+                png_set_sRGB_gAMA_and_cHRM(png_ptr, info_ptr,
+                    PNG_sRGB_INTENT_RELATIVE);
+            } else {
+                png_set_gAMA(png_ptr, info_ptr, 1.0/2.2);
+            }
+            break;
+        case e_color_space::linear:
+            png_set_gAMA(png_ptr, info_ptr, 1.0);
+            break;
+        default:
+            break;
+    }
+    // set compression options
+    if (options.compression_level >= 0 && options.compression_level <= 9) {
+        png_set_compression_level(png_ptr, options.compression_level);
+    }
+    if (options.filter >= 0 && options.filter <= 4) {
+        png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE,
+            PNG_FILTER_NONE << options.filter);
+    }
+}
+
+// Copies attributes to PNG format. The returned array must outlive
+// png_write_info
+static png_text *png_set_attributes(png_structp png_ptr, png_infop info_ptr,
+    const image_attributes &attrs) {
+    if (attrs.empty()) {
+        return nullptr;
+    }
+    png_text *png_attrs = reinterpret_cast<png_text *>(png_malloc(png_ptr,
+        attrs.size()*sizeof(png_text)));
+    for (unsigned i = 0; i < attrs.size(); ++i) {
+        png_attrs[i].compression = PNG_TEXT_COMPRESSION_NONE;
+        png_attrs[i].key = const_cast<char *>(attrs[i].first.c_str());
+        png_attrs[i].text = const_cast<char *>(attrs[i].second.c_str());
+    }
+    png_set_text(png_ptr, info_ptr, png_attrs, static_cast<int>(attrs.size()));
+    return png_attrs;
+}
+
+static bool png_swap_16(int bit_depth) {
+    long int a = 1;
+    return bit_depth == 16 && (*((unsigned char *) &a) == 1);
+}
+
+template <typename U, typename T, size_t N, e_organization O,
     typename = typename std::enable_if<(N > 0 && N <= 4) &&
         (std::is_same<U,uint8_t>::value ||
          std::is_same<U,uint16_t>::value) >::type>
-int store_png(t_io *writer, const image<T,N> &in,
-    const image_attributes &attrs) {
+int store_png(t_io *writer, const image<T,N,O> &in,
+    const image_attributes &attrs, const png_write_options &options) {
+    // packed images with the right channel type are encoded in place
+    static constexpr bool direct = (O == e_organization::packed) &&
+        std::is_same<T,U>::value;
     // temporary image storage
     png_bytepp volatile row_pointers = nullptr;
     png_bytep  volatile buffer = nullptr;
@@ -646,60 +1080,37 @@ int store_png(t_io *writer, const image<T,N> &in,
         return 0;
     }
     // copy attributes to PNG format
-    if (!attrs.empty()) {
-        png_attrs = (png_text *) png_malloc(png_ptr,
-                attrs.size()*sizeof(png_text));
-        for (unsigned i = 0; i < attrs.size(); ++i) {
-            png_attrs[i].compression = PNG_TEXT_COMPRESSION_NONE;
-            png_attrs[i].key = const_cast<char *>(attrs[i].first.c_str());
-            png_attrs[i].text = const_cast<char *>(attrs[i].second.c_str());
-        }
-        png_set_text(png_ptr, info_ptr, png_attrs, (int) attrs.size());
-    }
+    png_attrs = png_set_attributes(png_ptr, info_ptr, attrs);
     png_set_write_fn(png_ptr, writer, io_fn, nullptr);
     int height = in.get_height();
     int width = in.get_width();
-    int color_type;
-    switch (N) {
-        case 1: color_type = PNG_COLOR_TYPE_GRAY; break;
-        case 2: color_type = PNG_COLOR_TYPE_GRAY_ALPHA; break;
-        case 3: color_type = PNG_COLOR_TYPE_RGB; break;
-        case 4: color_type = PNG_COLOR_TYPE_RGB_ALPHA; break;
-    }
     int bit_depth = sizeof(U) == 1? 8: 16;
     int pixel_size = N * bit_depth/8;
-    // set basic image parameters
-    png_set_IHDR(png_ptr, info_ptr, width, height, bit_depth,
-        color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
-        PNG_FILTER_TYPE_DEFAULT);
-    static bool has_color = (N == 3 || N == 4);
-    // set gamma
-    switch (in.get_color_space()) {
-        case e_color_space::sRGB:
-            if (has_color) {
-                png_set_sRGB_gAMA_and_cHRM(png_ptr, info_ptr,
-                    PNG_sRGB_INTENT_RELATIVE);
-            } else {
-                png_set_gAMA(png_ptr, info_ptr, 1.0/2.2);
-            }
-            break;
-        case e_color_space::linear:
-            png_set_gAMA(png_ptr, info_ptr, 1.0);
-            break;
-        default:
-            break;
-    }
-    // allocate temporary image buffer and row_pointers
-    buffer = reinterpret_cast<png_bytep>(png_malloc(png_ptr,
-        height*width*pixel_size));
+    png_set_header(png_ptr, info_ptr, width, height, static_cast<int>(N),
+        bit_depth, in.get_color_space(), options);
     row_pointers = reinterpret_cast<png_bytepp>(png_malloc(png_ptr,
         height*sizeof(png_bytep)));
-    // set row pointers to flip image
-    for (int i = 0; i < height; i++) {
-        row_pointers[i] = &buffer[(height-i-1)*width*pixel_size];
+    if (direct) {
+        // set row pointers into the image, flipped. libpng copies each
+        // row before transforming it, so the image is not modified
+        for (int i = 0; i < height; i++) {
+            row_pointers[i] = const_cast<png_bytep>(
+                reinterpret_cast<png_const_bytep>(
+                    &in.get_data()[N*in.get_pitch()*(height-i-1)]));
+        }
+    } else {
+        // allocate temporary image buffer
+        buffer = reinterpret_cast<png_bytep>(png_malloc(png_ptr,
+            height*width*pixel_size));
+        // set row pointers to flip image
+        for (int i = 0; i < height; i++) {
+            row_pointers[i] = &buffer[(height-i-1)*width*pixel_size];
+        }
     }
     // copy into buffer
-    if (bit_depth == 8) {
+    if (direct) {
+        ;
+    } else if (bit_depth == 8) {
         uint8_t *base = reinterpret_cast<uint8_t *>(buffer);
         store_png_helper(width, height, in, base, std::make_index_sequence<N>{});
     } else {
@@ -709,18 +1120,23 @@ int store_png(t_io *writer, const image<T,N> &in,
     // write image info
     png_write_info(png_ptr, info_ptr);
     // should we flip endianness?
-    static bool depth_16 = (sizeof(U) > 1);
-    if (depth_16) {
-        long int a = 1;
-        int swap = (*((unsigned char *) &a) == 1);
+    bool swap = png_swap_16(bit_depth);
+    int threads = png_threads(options);
+    size_t row_bytes = static_cast<size_t>(width)*pixel_size;
+    if (threads > 1 && row_bytes*height >= 2*png_band_size) {
+        if (!png_write_idat_parallel(writer, row_pointers, height,
+                row_bytes, pixel_size, swap, options, threads)) {
+            png_error(png_ptr, "unable to write image data");
+        }
+    } else {
         if (swap) {
             png_set_swap(png_ptr);
         }
+        // write image buffer
+        png_write_image(png_ptr, row_pointers);
+        // finish advancing file pointer to end of stream (useful?)
+        png_write_end(png_ptr, nullptr);
     }
-    // write image buffer
-    png_write_image(png_ptr, row_pointers);
-    // finish advancing file pointer to end of stream (useful?)
-    png_write_end(png_ptr, nullptr);
     // release data
     png_free(png_ptr, buffer);
     png_free(png_ptr, row_pointers);
@@ -730,189 +1146,247 @@ int store_png(t_io *writer, const image<T,N> &in,
     return 1;
 }
 
-template <typename U, typename T, size_t N>
-int store_png(FILE *file, const image<T,N> &in,
-    const image_attributes &attrs) {
+template <typename U, typename T, size_t N, e_organization O>
+int store_png(FILE *file, const image<T,N,O> &in,
+    const image_attributes &attrs, const png_write_options &options) {
     t_io writer;
     io_file_writer_init(&writer, file);
-    int ret = store_png<U>(&writer, in, attrs);
+    int ret = store_png<U>(&writer, in, attrs, options);
     writer.done(&writer);
     return ret;
 }
 
-template <typename U, typename T, size_t N>
-int store_png(std::string *memory, const image<T,N> &in,
-    const image_attributes &attrs) {
+template <typename U, typename T, size_t N, e_organization O>
+int store_png(std::string *memory, const image<T,N,O> &in,
+    const image_attributes &attrs, const png_write_options &options) {
     t_io writer;
     io_memory_writer_init(&writer);
-    int ret = store_png<U>(&writer, in, attrs);
+    int ret = store_png<U>(&writer, in, attrs, options);
     memory->insert(memory->end(), writer.context.memory.data,
-        writer.context.memory.data+ writer.context.memory.size);
+        writer.context.memory.data+writer.context.memory.pos);
+    writer.done(&writer);
     return ret;
 }
 
 // instantiate all required overloads
 template int store_png<uint8_t>(FILE *file, const image<uint8_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<uint8_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<uint8_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<uint8_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint8_t>(FILE *file, const image<uint16_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<uint16_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<uint16_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<uint16_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint8_t>(FILE *file, const image<float, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<float, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<float, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(FILE *file, const image<float, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint8_t>(std::string *memory,
     const image<uint8_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<uint8_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<uint8_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<uint8_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint8_t>(std::string *memory,
     const image<uint16_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<uint16_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<uint16_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<uint16_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint8_t>(std::string *memory,
     const image<float, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<float, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<float, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint8_t>(std::string *memory,
     const image<float, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint16_t>(FILE *file, const image<uint8_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<uint8_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<uint8_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<uint8_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint16_t>(FILE *file, const image<uint16_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<uint16_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<uint16_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<uint16_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint16_t>(FILE *file, const image<float, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<float, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<float, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const image<float, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint16_t>(std::string *memory,
     const image<uint8_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<uint8_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<uint8_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<uint8_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint16_t>(std::string *memory,
     const image<uint16_t, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<uint16_t, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<uint16_t, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<uint16_t, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint16_t>(std::string *memory,
     const image<float, 1> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<float, 2> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<float, 3> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
     const image<float, 4> &out,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
+
+template int store_png<uint8_t>(FILE *file,
+    const packed_image<uint8_t, 1> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint8_t>(FILE *file,
+    const packed_image<uint8_t, 2> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint8_t>(FILE *file,
+    const packed_image<uint8_t, 3> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint8_t>(FILE *file,
+    const packed_image<uint8_t, 4> &out,
+    const image_attributes &attrs, const png_write_options &options);
+
+template int store_png<uint16_t>(FILE *file,
+    const packed_image<uint16_t, 1> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint16_t>(FILE *file,
+    const packed_image<uint16_t, 2> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint16_t>(FILE *file,
+    const packed_image<uint16_t, 3> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint16_t>(FILE *file,
+    const packed_image<uint16_t, 4> &out,
+    const image_attributes &attrs, const png_write_options &options);
+
+template int store_png<uint8_t>(std::string *memory,
+    const packed_image<uint8_t, 1> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint8_t>(std::string *memory,
+    const packed_image<uint8_t, 2> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint8_t>(std::string *memory,
+    const packed_image<uint8_t, 3> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint8_t>(std::string *memory,
+    const packed_image<uint8_t, 4> &out,
+    const image_attributes &attrs, const png_write_options &options);
+
+template int store_png<uint16_t>(std::string *memory,
+    const packed_image<uint16_t, 1> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint16_t>(std::string *memory,
+    const packed_image<uint16_t, 2> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint16_t>(std::string *memory,
+    const packed_image<uint16_t, 3> &out,
+    const image_attributes &attrs, const png_write_options &options);
+template int store_png<uint16_t>(std::string *memory,
+    const packed_image<uint16_t, 4> &out,
+    const image_attributes &attrs, const png_write_options &options);
 
 template <typename U, typename T, size_t N>
 int store_png(t_io *writer, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs) {
+    const image_attributes &attrs, const png_write_options &options) {
+    if (in_ptr->get_organization() == e_organization::packed) {
+        return store_png<U>(writer,
+            *reinterpret_cast<const packed_image<T, N> *>(in_ptr.get()),
+            attrs, options);
+    }
     return store_png<U>(writer, *reinterpret_cast<const image<T, N> *>(
-        in_ptr.get()), attrs);
+        in_ptr.get()), attrs, options);
 }
 
 template <typename U, typename T>
 int store_png(t_io *writer, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs) {
+    const image_attributes &attrs, const png_write_options &options) {
     switch (in_ptr->get_num_channels()) {
-        case 1: return store_png<U, T, 1>(writer, in_ptr, attrs);
-        case 2: return store_png<U, T, 2>(writer, in_ptr, attrs);
-        case 3: return store_png<U, T, 3>(writer, in_ptr, attrs);
-        case 4: return store_png<U, T, 4>(writer, in_ptr, attrs);
+        case 1: return store_png<U, T, 1>(writer, in_ptr, attrs, options);
+        case 2: return store_png<U, T, 2>(writer, in_ptr, attrs, options);
+        case 3: return store_png<U, T, 3>(writer, in_ptr, attrs, options);
+        case 4: return store_png<U, T, 4>(writer, in_ptr, attrs, options);
         default: return 0;
     }
 }
 
 template <typename U>
 int store_png(t_io *writer, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs) {
+    const image_attributes &attrs, const png_write_options &options) {
     switch (in_ptr->get_channel_type()) {
         case rvg::e_channel_type::uint8_t_:
-            return store_png<U, uint8_t>(writer, in_ptr, attrs);
+            return store_png<U, uint8_t>(writer, in_ptr, attrs, options);
         case rvg::e_channel_type::uint16_t_:
-            return store_png<U, uint16_t>(writer, in_ptr, attrs);
+            return store_png<U, uint16_t>(writer, in_ptr, attrs, options);
         case rvg::e_channel_type::float_:
-            return store_png<U, float>(writer, in_ptr, attrs);
+            return store_png<U, float>(writer, in_ptr, attrs, options);
         default:
             return 0;
     }
@@ -920,33 +1394,158 @@ int store_png(t_io *writer, const i_image::const_ptr in_ptr,
 
 template <typename U>
 int store_png(FILE *file, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs) {
+    const image_attributes &attrs, const png_write_options &options) {
     t_io writer;
     io_file_writer_init(&writer, file);
-    int ret = store_png<U>(&writer, in_ptr, attrs);
+    int ret = store_png<U>(&writer, in_ptr, attrs, options);
     writer.done(&writer);
     return ret;
 }
 
 template <typename U>
 int store_png(std::string *memory, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs) {
+    const image_attributes &attrs, const png_write_options &options) {
     t_io writer;
     io_memory_writer_init(&writer);
-    int ret = store_png<U>(&writer, in_ptr, attrs);
+    int ret = store_png<U>(&writer, in_ptr, attrs, options);
     memory->insert(memory->end(), writer.context.memory.data,
-        writer.context.memory.data+writer.context.memory.size);
+        writer.context.memory.data+writer.context.memory.pos);
+    writer.done(&writer);
     return ret;
 }
 
 template int store_png<uint8_t>(FILE *file, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 template int store_png<uint16_t>(FILE *file, const i_image::const_ptr in_ptr,
-    const image_attributes &attrs);
+    const image_attributes &attrs, const png_write_options &options);
 
 template int store_png<uint8_t>(std::string *memory,
-    const i_image::const_ptr in_ptr, const image_attributes &attrs);
+    const i_image::const_ptr in_ptr, const image_attributes &attrs,
+    const png_write_options &options);
 template int store_png<uint16_t>(std::string *memory,
-    const i_image::const_ptr in_ptr, const image_attributes &attrs);
+    const i_image::const_ptr in_ptr, const image_attributes &attrs,
+    const png_write_options &options);
+
+struct png_stream_writer::impl {
+    t_io writer;
+    png_structp png_ptr = nullptr;
+    png_infop info_ptr = nullptr;
+    png_text *png_attrs = nullptr;
+    // only used when deflating in parallel
+    std::unique_ptr<png_idat_writer> idat;
+    int width = 0, height = 0, channels = 0, bit_depth = 0, rows = 0;
+
+    ~impl() {
+        if (png_ptr) {
+            png_free(png_ptr, png_attrs);
+            png_destroy_write_struct(&png_ptr, &info_ptr);
+            writer.done(&writer);
+        }
+    }
+};
+
+png_stream_writer::png_stream_writer(void) { ; }
+
+png_stream_writer::~png_stream_writer() { ; }
+
+bool png_stream_writer::accepts(int width, int channels,
+    int bit_depth) const {
+    return m_impl && m_impl->width == width &&
+        m_impl->channels == channels && m_impl->bit_depth == bit_depth;
+}
+
+int png_stream_writer::open(FILE *file, int width, int height, int channels,
+    int bit_depth, e_color_space color_space, const image_attributes &attrs,
+    const png_write_options &options) {
+    m_impl.reset();
+    if (channels < 1 || channels > 4 || (bit_depth != 8 &&
+            bit_depth != 16) || width <= 0 || height <= 0) {
+        fprintf(stderr, "invalid image format\n");
+        return 0;
+    }
+    std::unique_ptr<impl> p(new impl);
+    p->png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr,
+        user_error_fn, user_warning_fn);
+    if (p->png_ptr) {
+        p->info_ptr = png_create_info_struct(p->png_ptr);
+    }
+    if (!p->png_ptr || !p->info_ptr) {
+        png_destroy_write_struct(&p->png_ptr, &p->info_ptr);
+        fprintf(stderr, "unable to allocate structures\n");
+        return 0;
+    }
+    io_file_writer_init(&p->writer, file);
+    p->width = width;
+    p->height = height;
+    p->channels = channels;
+    p->bit_depth = bit_depth;
+    // setup long jump for error return
+    if (setjmp(png_jmpbuf(p->png_ptr))) {
+        return 0;
+    }
+    p->png_attrs = png_set_attributes(p->png_ptr, p->info_ptr, attrs);
+    png_set_write_fn(p->png_ptr, &p->writer, io_fn, nullptr);
+    png_set_header(p->png_ptr, p->info_ptr, width, height, channels,
+        bit_depth, color_space, options);
+    png_write_info(p->png_ptr, p->info_ptr);
+    // same choice as store_png
+    bool swap = png_swap_16(bit_depth);
+    int threads = png_threads(options);
+    size_t pixel_size = static_cast<size_t>(channels*bit_depth/8);
+    size_t row_bytes = static_cast<size_t>(width)*pixel_size;
+    if (threads > 1 && row_bytes*height >= 2*png_band_size) {
+        p->idat.reset(new png_idat_writer(&p->writer, row_bytes,
+            pixel_size, swap, options, threads));
+    } else if (swap) {
+        png_set_swap(p->png_ptr);
+    }
+    m_impl = std::move(p);
+    return 1;
+}
+
+int png_stream_writer::write_row(const void *row) {
+    if (!m_impl || m_impl->rows >= m_impl->height) {
+        return 0;
+    }
+    impl *p = m_impl.get();
+    if (p->idat) {
+        if (!p->idat->write_row(reinterpret_cast<const uint8_t *>(row))) {
+            m_impl.reset();
+            return 0;
+        }
+    } else {
+        if (setjmp(png_jmpbuf(p->png_ptr))) {
+            m_impl.reset();
+            return 0;
+        }
+        png_write_row(p->png_ptr, reinterpret_cast<png_const_bytep>(row));
+    }
+    ++p->rows;
+    return 1;
+}
+
+int png_stream_writer::close(void) {
+    if (!m_impl) {
+        return 0;
+    }
+    impl *p = m_impl.get();
+    if (p->rows != p->height) {
+        fprintf(stderr, "missing rows\n");
+        m_impl.reset();
+        return 0;
+    }
+    int ok = 1;
+    if (p->idat) {
+        ok = p->idat->finish();
+    } else {
+        if (setjmp(png_jmpbuf(p->png_ptr))) {
+            m_impl.reset();
+            return 0;
+        }
+        png_write_end(p->png_ptr, nullptr);
+    }
+    m_impl.reset();
+    return ok;
+}
 
 } // namespaces rvg
@@ -16,51 +16,128 @@
 #ifndef RVG_PNGIO_H
 #define RVG_PNGIO_H
 
+#include <cstdio>
+#include <memory>
 #include <string>
 
 #include "rvg-image.h"
 
 namespace rvg {
 
+    // Compression settings for store_png. When more than one thread is
+    // available and the image is large enough, rows are filtered and
+    // deflated in independent bands, in parallel. Each band is primed
+    // with the last 32KiB of the previous one and ends in a sync flush,
+    // so the bands concatenate into a single zlib stream.
+    struct png_write_options {
+        int compression_level = -1; // 0 to 9, or -1 for the zlib default
+        int filter = -1;            // PNG filter type 0 to 4, or -1 to
+                                    // pick the best filter for each row
+        int threads = 0;            // 0 uses all available threads
+
+        // Trades file size for speed
+        static png_write_options fast(void) {
+            png_write_options options;
+            options.compression_level = 1;
+            options.filter = 1; // sub
+            return options;
+        }
+    };
+
+    // Encodes a PNG file one row at a time, so images too large to
+    // be held in memory can be rendered in bands. Rows go from the top
+    // of the image to the bottom, with interleaved samples in native
+    // byte order. Rows are only buffered until there is enough data
+    // to deflate, so writing a row never waits for the encoder.
+    class png_stream_writer {
+    public:
+        png_stream_writer(void);
+        ~png_stream_writer();
+
+        png_stream_writer(const png_stream_writer &) = delete;
+        png_stream_writer &operator=(const png_stream_writer &) = delete;
+
+        // Writes everything that comes before the image data, for an
+        // image with 1 to 4 channels and 8 or 16 bits per sample.
+        // Returns 0 on failure
+        int open(FILE *file_out, int width, int height, int channels,
+            int bit_depth, e_color_space color_space = e_color_space::sRGB,
+            const image_attributes &attrs = image_attributes(),
+            const png_write_options &options = png_write_options());
+
+        // Appends the next row. Returns 0 on failure
+        int write_row(const void *row);
+
+        // Appends the rows of a band, from its top row to its bottom row
+        template <typename U, size_t N>
+        int write_band(const packed_image<U,N> &band) {
+            if (!accepts(band.get_width(), static_cast<int>(N),
+                    static_cast<int>(8*sizeof(U)))) {
+                return 0;
+            }
+            for (int y = band.get_height()-1; y >= 0; --y) {
+                if (!write_row(band.get_row(y))) return 0;
+            }
+            return 1;
+        }
+
+        // Writes the end of the file, once all rows are in. Returns 0
+        // on failure, or if rows are missing
+        int close(void);
+
+    private:
+        struct impl;
+        std::unique_ptr<impl> m_impl;
+
+        bool accepts(int width, int channels, int bit_depth) const;
+    };
+
     int describe_png(FILE *file_in, int *width, int *height,
         int *channels, int *bit_depth);
 
     int describe_png(const std::string &memory_in, int *width, int *height,
         int *channels, int *bit_depth);
 
-    // load png image from file
-    template <typename T, size_t N>
-    int load_png(FILE *file_in, image<T,N> *out,
+    // load png image from file. Packed 8- and 16-bit images receive
+    // the decoded rows directly, without conversion
+    template <typename T, size_t N, e_organization O>
+    int load_png(FILE *file_in, image<T,N,O> *out,
         image_attributes *attrs = nullptr);
 
+    // The image returned is packed
     i_image::ptr load_png(FILE *file_in, int wanted_channels = 0,
         image_attributes *attrs = nullptr);
 
     // load png image from memory
-    template <typename T, size_t N>
-    int load_png(const std::string &memory_in, image<T,N> *out,
+    template <typename T, size_t N, e_organization O>
+    int load_png(const std::string &memory_in, image<T,N,O> *out,
         image_attributes *attrs = nullptr);
 
     i_image::ptr load_png(const std::string &memory_in, int wanted_channels = 0,
         image_attributes *attrs = nullptr);
 
-    // store png image to file
-    template <typename U, typename T, size_t N>
-    int store_png(FILE *file_out, const image<T,N> &in,
-        const image_attributes &attrs = image_attributes());
+    // store png image to file. Packed images whose channel type is U
+    // are encoded directly from their rows, without conversion
+    template <typename U, typename T, size_t N, e_organization O>
+    int store_png(FILE *file_out, const image<T,N,O> &in,
+        const image_attributes &attrs = image_attributes(),
+        const png_write_options &options = png_write_options());
 
     template <typename U>
     int store_png(FILE *file_out, i_image::const_ptr in,
-        const image_attributes &attrs = image_attributes());
+        const image_attributes &attrs = image_attributes(),
+        const png_write_options &options = png_write_options());
 
     // store png to memory
-    template <typename U, typename T, size_t N>
-    int store_png(std::string *memory_out, const image<T,N> &in,
-        const image_attributes &attrs = image_attributes());
+    template <typename U, typename T, size_t N, e_organization O>
+    int store_png(std::string *memory_out, const image<T,N,O> &in,
+        const image_attributes &attrs = image_attributes(),
+        const png_write_options &options = png_write_options());
 
     template <typename U>
     int store_png(std::string *memory_out, i_image::const_ptr in,
-        const image_attributes &attrs = image_attributes());
+        const image_attributes &attrs = image_attributes(),
+        const png_write_options &options = png_write_options());
 
     // delcare explicit instantiations for all image types
     extern template int load_png(FILE *file_in, image<uint8_t, 1> *out,
@@ -118,121 +195,261 @@ namespace rvg {
         image<float, 4> *out, image_attributes *attrs);
 
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint8_t, 1> &in, const image_attributes &attrs);
+        const image<uint8_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint8_t, 2> &in, const image_attributes &attrs);
+        const image<uint8_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint8_t, 3> &in, const image_attributes &attrs);
+        const image<uint8_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint8_t, 4> &in, const image_attributes &attrs);
+        const image<uint8_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint16_t, 1> &in, const image_attributes &attrs);
+        const image<uint16_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint16_t, 2> &in, const image_attributes &attrs);
+        const image<uint16_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint16_t, 3> &in, const image_attributes &attrs);
+        const image<uint16_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<uint16_t, 4> &in, const image_attributes &attrs);
+        const image<uint16_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<float, 1> &in, const image_attributes &attrs);
+        const image<float, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<float, 2> &in, const image_attributes &attrs);
+        const image<float, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<float, 3> &in, const image_attributes &attrs);
+        const image<float, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        const image<float, 4> &in, const image_attributes &attrs);
+        const image<float, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint8_t, 1> &in, const image_attributes &attrs);
+        const image<uint8_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint8_t, 2> &in, const image_attributes &attrs);
+        const image<uint8_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint8_t, 3> &in, const image_attributes &attrs);
+        const image<uint8_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint8_t, 4> &in, const image_attributes &attrs);
+        const image<uint8_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint16_t, 1> &in, const image_attributes &attrs);
+        const image<uint16_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint16_t, 2> &in, const image_attributes &attrs);
+        const image<uint16_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint16_t, 3> &in, const image_attributes &attrs);
+        const image<uint16_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<uint16_t, 4> &in, const image_attributes &attrs);
+        const image<uint16_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<float, 1> &in, const image_attributes &attrs);
+        const image<float, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<float, 2> &in, const image_attributes &attrs);
+        const image<float, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<float, 3> &in, const image_attributes &attrs);
+        const image<float, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        const image<float, 4> &in, const image_attributes &attrs);
+        const image<float, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint8_t, 1> &in, const image_attributes &attrs);
+        const image<uint8_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint8_t, 2> &in, const image_attributes &attrs);
+        const image<uint8_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint8_t, 3> &in, const image_attributes &attrs);
+        const image<uint8_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint8_t, 4> &in, const image_attributes &attrs);
+        const image<uint8_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint16_t, 1> &in, const image_attributes &attrs);
+        const image<uint16_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint16_t, 2> &in, const image_attributes &attrs);
+        const image<uint16_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint16_t, 3> &in, const image_attributes &attrs);
+        const image<uint16_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<uint16_t, 4> &in, const image_attributes &attrs);
+        const image<uint16_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<float, 1> &in, const image_attributes &attrs);
+        const image<float, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<float, 2> &in, const image_attributes &attrs);
+        const image<float, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<float, 3> &in, const image_attributes &attrs);
+        const image<float, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(std::string *memory_out,
-        const image<float, 4> &in, const image_attributes &attrs);
+        const image<float, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
+
+    extern template int store_png<uint16_t>(std::string *memory_out,
+        const image<uint8_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint16_t>(std::string *memory_out,
+        const image<uint8_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint16_t>(std::string *memory_out,
+        const image<uint8_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint16_t>(std::string *memory_out,
+        const image<uint8_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint8_t, 1> &in, const image_attributes &attrs);
+        const image<uint16_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint8_t, 2> &in, const image_attributes &attrs);
+        const image<uint16_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint8_t, 3> &in, const image_attributes &attrs);
+        const image<uint16_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint8_t, 4> &in, const image_attributes &attrs);
+        const image<uint16_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint16_t, 1> &in, const image_attributes &attrs);
+        const image<float, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint16_t, 2> &in, const image_attributes &attrs);
+        const image<float, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint16_t, 3> &in, const image_attributes &attrs);
+        const image<float, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<uint16_t, 4> &in, const image_attributes &attrs);
+        const image<float, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
+
+    extern template int load_png(FILE *file_in,
+        packed_image<uint8_t, 1> *out, image_attributes *attrs);
+    extern template int load_png(FILE *file_in,
+        packed_image<uint8_t, 2> *out, image_attributes *attrs);
+    extern template int load_png(FILE *file_in,
+        packed_image<uint8_t, 3> *out, image_attributes *attrs);
+    extern template int load_png(FILE *file_in,
+        packed_image<uint8_t, 4> *out, image_attributes *attrs);
+
+    extern template int load_png(FILE *file_in,
+        packed_image<uint16_t, 1> *out, image_attributes *attrs);
+    extern template int load_png(FILE *file_in,
+        packed_image<uint16_t, 2> *out, image_attributes *attrs);
+    extern template int load_png(FILE *file_in,
+        packed_image<uint16_t, 3> *out, image_attributes *attrs);
+    extern template int load_png(FILE *file_in,
+        packed_image<uint16_t, 4> *out, image_attributes *attrs);
+
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint8_t, 1> *out, image_attributes *attrs);
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint8_t, 2> *out, image_attributes *attrs);
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint8_t, 3> *out, image_attributes *attrs);
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint8_t, 4> *out, image_attributes *attrs);
+
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint16_t, 1> *out, image_attributes *attrs);
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint16_t, 2> *out, image_attributes *attrs);
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint16_t, 3> *out, image_attributes *attrs);
+    extern template int load_png(const std::string &memory_in,
+        packed_image<uint16_t, 4> *out, image_attributes *attrs);
+
+    extern template int store_png<uint8_t>(FILE *file_out,
+        const packed_image<uint8_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint8_t>(FILE *file_out,
+        const packed_image<uint8_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint8_t>(FILE *file_out,
+        const packed_image<uint8_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint8_t>(FILE *file_out,
+        const packed_image<uint8_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
+
+    extern template int store_png<uint16_t>(FILE *file_out,
+        const packed_image<uint16_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint16_t>(FILE *file_out,
+        const packed_image<uint16_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint16_t>(FILE *file_out,
+        const packed_image<uint16_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint16_t>(FILE *file_out,
+        const packed_image<uint16_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
+
+    extern template int store_png<uint8_t>(std::string *memory_out,
+        const packed_image<uint8_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint8_t>(std::string *memory_out,
+        const packed_image<uint8_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint8_t>(std::string *memory_out,
+        const packed_image<uint8_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
+    extern template int store_png<uint8_t>(std::string *memory_out,
+        const packed_image<uint8_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<float, 1> &in, const image_attributes &attrs);
+        const packed_image<uint16_t, 1> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<float, 2> &in, const image_attributes &attrs);
+        const packed_image<uint16_t, 2> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<float, 3> &in, const image_attributes &attrs);
+        const packed_image<uint16_t, 3> &in, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        const image<float, 4> &in, const image_attributes &attrs);
+        const packed_image<uint16_t, 4> &in, const image_attributes &attrs,
+        const png_write_options &options);
 
     extern template int store_png<uint8_t>(std::string *memory_out,
-        i_image::const_ptr in_ptr, const image_attributes &attrs);
+        i_image::const_ptr in_ptr, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(std::string *memory_out,
-        i_image::const_ptr in_ptr, const image_attributes &attrs);
+        i_image::const_ptr in_ptr, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint8_t>(FILE *file_out,
-        i_image::const_ptr in_ptr, const image_attributes &attrs);
+        i_image::const_ptr in_ptr, const image_attributes &attrs,
+        const png_write_options &options);
     extern template int store_png<uint16_t>(FILE *file_out,
-        i_image::const_ptr in_ptr, const image_attributes &attrs);
+        i_image::const_ptr in_ptr, const image_attributes &attrs,
+        const png_write_options &options);
 
 } // namespace rvg
 
@@ -0,0 +1,223 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_PRECISION_ESCALATION_H
+#define RVG_PRECISION_ESCALATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+// The analysis filters in the stroking pipeline look for roots of
+// curvature and inflection polynomials. They first process each
+// segment in single precision, and then run a cheap test on the
+// intermediate results (vanishing denominators, function values too
+// close to zero at the endpoints of a root bracket, roots too close to
+// each other). Only the segments that fail the test are processed
+// again in double precision. This gives us double-precision robustness
+// for the fragile cases at single-precision throughput for the rest.
+//
+// Define RVG_PRECISION_ESCALATION_NEVER to disable escalation, or
+// RVG_PRECISION_ESCALATION_ALWAYS to process every segment in double
+// precision (useful for comparisons).
+
+// Values within this many ulps of zero, relative to their scale,
+// are considered fragile
+#define RVG_PRECISION_ESCALATION_ULP (64)
+
+namespace rvg {
+    namespace precision_escalation {
+
+// Each analysis is counted by the filter that runs it. Input segments
+// are analysed by find_offsetting_parameters, and cubics also by
+// find_cubic_parameters before that. The regular pieces the second
+// offsetting pass analyses are counted separately.
+struct stats {
+    uint64_t analyzed;         // segments analysed
+    uint64_t escalated;        // segments re-analysed in double precision
+    uint64_t cubics_analyzed;  // cubics analysed for inflections
+    uint64_t cubics_escalated; // cubics re-analysed in double precision
+    uint64_t pieces_analyzed;  // pieces analysed
+    uint64_t pieces_escalated; // pieces re-analysed in double precision
+};
+
+namespace detail {
+    // Each thread updates its own counters, so threads stroking in
+    // parallel do not contend for them. Only the owner writes to them,
+    // but any thread can read them
+    struct alignas(64) counters {
+        std::atomic<uint64_t> analyzed{0};
+        std::atomic<uint64_t> escalated{0};
+        std::atomic<uint64_t> cubics_analyzed{0};
+        std::atomic<uint64_t> cubics_escalated{0};
+        std::atomic<uint64_t> pieces_analyzed{0};
+        std::atomic<uint64_t> pieces_escalated{0};
+    };
+
+    using counter = std::atomic<uint64_t> counters::*;
+
+    static constexpr counter all_counters[] = {
+        &counters::analyzed, &counters::escalated,
+        &counters::cubics_analyzed, &counters::cubics_escalated,
+        &counters::pieces_analyzed, &counters::pieces_escalated
+    };
+
+    // Counters of the running threads, and the sum of the counters
+    // of the threads that exited
+    struct registry {
+        std::mutex mutex;
+        std::vector<counters *> running;
+        counters exited;
+    };
+
+    inline registry &get_registry(void) {
+        static registry r;
+        return r;
+    }
+
+    class thread_counters {
+        counters m_counters;
+    public:
+        thread_counters() {
+            auto &r = get_registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.running.push_back(&m_counters);
+        }
+        ~thread_counters() {
+            auto &r = get_registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for (auto c: all_counters) {
+                (r.exited.*c).fetch_add((m_counters.*c).load(
+                    std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            r.running.erase(std::find(r.running.begin(), r.running.end(),
+                &m_counters));
+        }
+        counters &get(void) {
+            return m_counters;
+        }
+    };
+
+    inline counters &get_counters(void) {
+        static thread_local thread_counters c;
+        return c.get();
+    }
+
+    // Only the owning thread writes, so there is no need for an
+    // atomic read-modify-write
+    static inline void increment(std::atomic<uint64_t> &c) {
+        c.store(c.load(std::memory_order_relaxed)+1,
+            std::memory_order_relaxed);
+    }
+
+    static inline void count(counter analyzed, counter escalated,
+        bool was_escalated) {
+        auto &c = get_counters();
+        increment(c.*analyzed);
+        if (was_escalated) {
+            increment(c.*escalated);
+        }
+    }
+}
+
+// Returns true if segments should first be tried in single precision
+static inline constexpr bool try_single(void) {
+#ifdef RVG_PRECISION_ESCALATION_ALWAYS
+    return false;
+#else
+    return true;
+#endif
+}
+
+// Returns true if segments failing the test should be escalated
+static inline constexpr bool allowed(void) {
+#ifdef RVG_PRECISION_ESCALATION_NEVER
+    return false;
+#else
+    return true;
+#endif
+}
+
+// Records the outcome of the analysis of a segment
+static inline void count(bool escalated) {
+    detail::count(&detail::counters::analyzed,
+        &detail::counters::escalated, escalated);
+}
+
+// Records the outcome of the analysis of a cubic for inflections
+// and double points
+static inline void count_cubic(bool escalated) {
+    detail::count(&detail::counters::cubics_analyzed,
+        &detail::counters::cubics_escalated, escalated);
+}
+
+// Records the outcome of the analysis of a regular piece
+static inline void count_piece(bool escalated) {
+    detail::count(&detail::counters::pieces_analyzed,
+        &detail::counters::pieces_escalated, escalated);
+}
+
+// Sums the counters of all threads
+static inline stats get_stats(void) {
+    auto &r = detail::get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto sum = [&r](detail::counter c) {
+        uint64_t s = (r.exited.*c).load(std::memory_order_relaxed);
+        for (auto t: r.running) {
+            s += (t->*c).load(std::memory_order_relaxed);
+        }
+        return s;
+    };
+    return stats{sum(&detail::counters::analyzed),
+        sum(&detail::counters::escalated),
+        sum(&detail::counters::cubics_analyzed),
+        sum(&detail::counters::cubics_escalated),
+        sum(&detail::counters::pieces_analyzed),
+        sum(&detail::counters::pieces_escalated)};
+}
+
+// Should not be called while other threads are stroking
+static inline void reset_stats(void) {
+    auto &r = detail::get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto c: detail::all_counters) {
+        (r.exited.*c).store(0, std::memory_order_relaxed);
+        for (auto t: r.running) {
+            (t->*c).store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Returns true if v is too close to zero, relative to scale,
+// for its sign to be trusted
+template <typename T>
+static inline bool is_fragile(T v, T scale) {
+    return std::fabs(v) <= T{RVG_PRECISION_ESCALATION_ULP}*
+        std::numeric_limits<T>::epsilon()*std::fabs(scale);
+}
+
+// Returns true if a and b are too close to be told apart
+template <typename T>
+static inline bool is_fragile_pair(T a, T b) {
+    return is_fragile(a-b, std::fabs(a)+std::fabs(b)+T{1});
+}
+
+} } // namespace rvg::precision_escalation
+
+#endif
@@ -0,0 +1,147 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_SCENE_BINARY_FORMAT_H
+#define RVG_SCENE_BINARY_FORMAT_H
+
+#include <cstdint>
+
+// Binary scene format shared by scene_f_write_binary, which writes it,
+// and scene_data_file, which maps it into memory and plays it back.
+//
+// Everything is stored in the byte order of the machine that wrote the
+// file. A file can only be read by builds using the same rvgf and the
+// same byte order it was written with.
+//
+//   header (32 bytes)
+//     magic                "RVGSCENE" (8 bytes)
+//     version              uint32_t, currently 1
+//     byte order           uint32_t, 0x01020304
+//     float size           uint32_t, sizeof(rvgf) (4 or 8)
+//     reserved             uint32_t, 0
+//     reserved             uint64_t, 0
+//   records, until an end record
+//
+// Every record starts at a position that is a multiple of 8 with a
+// uint32_t tag. Fields of type uint64_t, and each of the arrays that
+// follow them, also start at positions that are multiples of 8. In the
+// listings below, u32 is uint32_t, u64 is uint64_t, f32 is float, f is
+// rvgf, and xf is 9 f in row-major order.
+//
+//   frame                xf of the scene, background color (4 bytes),
+//                        window (4 f), viewport (4 int32_t)
+//   path                 u64 instruction count, u64 data count,
+//                        instructions, offsets, data (as in path_data)
+//   compact_path         u32 bytes per coordinate (2 or 3),
+//                        u64 instruction count, u64 frame count,
+//                        u64 coordinate byte count, u64 rational count,
+//                        instructions, frames (3 f), coordinates (u8),
+//                        rational (f), as in compact_path_data
+//   polygon              u64 coordinate count, coordinates (f)
+//   ramp                 u32 spread, u32 stop count,
+//                        stops (f32 offset, 4 byte color)
+//   image                u32 channel type, u64 size, PNG encoded image
+//   style                u32 initial, terminal, dash initial, and dash
+//                        terminal caps, u32 join and inner join,
+//                        u32 resets on move, f32 miter limit,
+//                        f32 dash offset, u32 dash count, dashes (f32)
+//   painted_shape        u32 winding rule, shape, paint
+//   stencil_shape        u32 winding rule, shape
+//   tensor_product_patch u32 opacity, xf, 16 points (2 f), 4 colors
+//   coons_patch          u32 opacity, xf, 12 points (2 f), 4 colors
+//   gouraud_triangle     u32 opacity, xf, 3 points (2 f), 3 colors
+//   begin_clip, activate_clip, end_clip
+//                        u32 depth
+//   begin_fade, end_fade u32 depth, u32 opacity
+//   begin_blur, end_blur u32 depth, f32 radius
+//   begin_transform, end_transform
+//                        u32 depth, xf
+//   end
+//
+// A shape is a u32 shape type followed by its xf and
+//
+//   path                 u32 path id
+//   circle               cx, cy, r (f)
+//   triangle             x1, y1, x2, y2, x3, y3 (f)
+//   rect                 x, y, width, height (f)
+//   polygon              u32 polygon id
+//   blend                u32 from path id, u32 to path id, t (f)
+//   stroke               f32 width, u32 style id, stroked shape
+//
+// Shapes nest at most max_shape_depth levels deep, counting the
+// innermost shape, so there can be at most max_shape_depth-1 strokes
+// around it.
+//
+// A paint is a u32 paint type, a u32 opacity, its xf, and
+//
+//   solid_color          color (4 bytes)
+//   linear_gradient      u32 ramp id, x1, y1, x2, y2 (f32)
+//   radial_gradient      u32 ramp id, cx, cy, fx, fy, r (f32)
+//   texture              u32 spread, u32 image id
+//
+// Paths, polygons, ramps, images, and styles are written once, when
+// first used, and are referred to by id from then on. Ids count the
+// records of each kind, starting from 0. Path and compact_path records
+// count as the same kind. Shape and paint types, spreads,
+// caps, joins, winding rules, and channel types hold the values of the
+// corresponding enumerations.
+
+namespace rvg {
+    namespace scene_binary_format {
+
+const char magic[8] = {'R', 'V', 'G', 'S', 'C', 'E', 'N', 'E'};
+const uint32_t version = 1;
+const uint32_t byte_order = 0x01020304;
+const int max_shape_depth = 16;
+
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t float_size;
+    uint32_t reserved;
+    uint64_t reserved2;
+};
+
+static_assert(sizeof(header) == 32, "unexpected header padding");
+
+enum class e_tag: uint32_t {
+    end,
+    frame,
+    path,
+    polygon,
+    ramp,
+    image,
+    style,
+    painted_shape,
+    stencil_shape,
+    tensor_product_patch,
+    coons_patch,
+    gouraud_triangle,
+    begin_clip,
+    activate_clip,
+    end_clip,
+    begin_fade,
+    end_fade,
+    begin_blur,
+    end_blur,
+    begin_transform,
+    end_transform,
+    compact_path
+};
+
+} } // namespace rvg::scene_binary_format
+
+#endif
@@ -0,0 +1,726 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "rvg-pngio.h"
+#include "rvg-compact-path-data.h"
+#include "rvg-scene-binary-format.h"
+#include "rvg-scene-data-file.h"
+
+namespace rvg {
+
+using namespace scene_binary_format;
+
+static_assert(sizeof(RGBA8) == 4 && std::is_trivially_copyable<RGBA8>::value,
+    "colors are stored as 4 bytes");
+
+namespace {
+
+// Decodes records starting at a given position, stopping at the end
+// record. Any inconsistency sets the error flag, after which every read
+// fails.
+class decoder {
+
+    // Where each clip depth is between begin_clip and end_clip
+    enum class e_clip_state: uint8_t {
+        none,
+        begun,
+        activated
+    };
+
+    const unsigned char *m_base;
+    size_t m_length;
+    size_t m_pos;
+    bool m_ok;
+    std::vector<path_data::const_ptr> m_paths;
+    std::vector<polygon_data::const_ptr> m_polygons;
+    std::vector<color_ramp::const_ptr> m_ramps;
+    std::vector<i_image::const_ptr> m_images;
+    std::vector<stroke_style::const_ptr> m_styles;
+    std::vector<e_clip_state> m_clips;
+
+public:
+
+    decoder(const unsigned char *base, size_t length, size_t pos):
+        m_base(base),
+        m_length(length),
+        m_pos(pos),
+        m_ok(true) {
+        ;
+    }
+
+    size_t get_pos(void) const {
+        return m_pos;
+    }
+
+    bool fail(void) {
+        m_ok = false;
+        return false;
+    }
+
+    template <typename T>
+    bool get(T &value) {
+        if (!m_ok || m_length - m_pos < sizeof(T)) {
+            return fail();
+        }
+        memcpy(&value, m_base+m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return true;
+    }
+
+    bool align(void) {
+        size_t aligned = (m_pos + 7) & ~size_t{7};
+        if (!m_ok || aligned > m_length) {
+            return fail();
+        }
+        m_pos = aligned;
+        return true;
+    }
+
+    // Returns a pointer to an array of count T starting at the next
+    // position that is a multiple of 8
+    template <typename T>
+    const T *get_array(uint64_t count) {
+        if (!align() || count > (m_length - m_pos)/sizeof(T)) {
+            fail();
+            return nullptr;
+        }
+        const T *array = reinterpret_cast<const T *>(m_base+m_pos);
+        m_pos += static_cast<size_t>(count)*sizeof(T);
+        return array;
+    }
+
+    template <typename E>
+    bool get_enum(E &value, E last) {
+        uint32_t u = 0;
+        if (!get(u) || u > static_cast<uint32_t>(last)) {
+            return fail();
+        }
+        value = static_cast<E>(u);
+        return true;
+    }
+
+    template <typename PTR>
+    bool get_id(const std::vector<PTR> &objects, PTR &ptr) {
+        uint32_t id = 0;
+        if (!get(id) || id >= objects.size()) {
+            return fail();
+        }
+        ptr = objects[id];
+        return true;
+    }
+
+    bool get_unorm8(unorm8 &value) {
+        uint32_t u = 0;
+        if (!get(u) || u > 255) {
+            return fail();
+        }
+        value = unorm8{static_cast<uint8_t>(u)};
+        return true;
+    }
+
+    bool get_xform(xform &xf) {
+        rvgf m[9];
+        for (auto &v: m) {
+            if (!get(v)) {
+                return false;
+            }
+        }
+        xf = xform{m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]};
+        return true;
+    }
+
+    bool read_frame(xform &xf, RGBA8 &background_color, window &w,
+        viewport &v) {
+        rvgf wc[4];
+        int32_t vc[4];
+        if (!get_xform(xf) || !get(background_color)) {
+            return false;
+        }
+        for (auto &c: wc) {
+            if (!get(c)) {
+                return false;
+            }
+        }
+        for (auto &c: vc) {
+            if (!get(c)) {
+                return false;
+            }
+        }
+        w = make_window(wc[0], wc[1], wc[2], wc[3]);
+        v = make_viewport(vc[0], vc[1], vc[2], vc[3]);
+        return true;
+    }
+
+    bool read_path(void) {
+        uint64_t size = 0, data_size = 0;
+        if (!align() || !get(size) || !get(data_size)) {
+            return false;
+        }
+        auto instructions = get_array<path_instruction>(size);
+        auto offsets = get_array<floatint>(size);
+        auto data = get_array<rvgf>(data_size);
+        if (!m_ok) {
+            return false;
+        }
+        path_data_view view{instructions, offsets,
+            static_cast<size_t>(size), data, static_cast<size_t>(data_size)};
+        // Offsets must stay within the data, as in read_compact_path
+        if (!view.is_valid()) {
+            return fail();
+        }
+        m_paths.push_back(make_intrusive<path_data>(view));
+        return true;
+    }
+
+    bool read_compact_path(void) {
+        uint32_t bytes = 0;
+        uint64_t size = 0, frame_count = 0, coordinate_count = 0,
+            rational_count = 0;
+        if (!get(bytes) || !align() || !get(size) || !get(frame_count) ||
+            !get(coordinate_count) || !get(rational_count)) {
+            return false;
+        }
+        auto instructions = get_array<path_instruction>(size);
+        auto frames = get_array<compact_path_data::frame>(frame_count);
+        auto coordinates = get_array<uint8_t>(coordinate_count);
+        auto rational = get_array<rvgf>(rational_count);
+        if (!m_ok) {
+            return false;
+        }
+        auto compact = make_compact_path_data(
+            static_cast<compact_path_data::precision>(bytes),
+            instructions, static_cast<size_t>(size),
+            frames, static_cast<size_t>(frame_count),
+            coordinates, static_cast<size_t>(coordinate_count),
+            rational, static_cast<size_t>(rational_count));
+        if (!compact) {
+            return fail();
+        }
+        m_paths.push_back(compact->decompact());
+        return true;
+    }
+
+    bool read_polygon(void) {
+        uint64_t count = 0;
+        if (!align() || !get(count)) {
+            return false;
+        }
+        const rvgf *begin = get_array<rvgf>(count);
+        if (!m_ok) {
+            return false;
+        }
+        const rvgf *end = begin + count;
+        m_polygons.push_back(make_intrusive<polygon_data>(begin, end));
+        return true;
+    }
+
+    bool read_ramp(void) {
+        e_spread spread;
+        uint32_t count = 0;
+        if (!get_enum(spread, e_spread::transparent) || !get(count) ||
+            count > (m_length - m_pos)/(sizeof(float)+sizeof(RGBA8))) {
+            return fail();
+        }
+        std::vector<color_stop> stops;
+        stops.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            float offset = 0.f;
+            RGBA8 color;
+            if (!get(offset) || !get(color)) {
+                return false;
+            }
+            stops.emplace_back(offset, color);
+        }
+        auto begin = stops.cbegin();
+        m_ramps.push_back(make_intrusive<color_ramp>(spread, begin,
+            stops.cend()));
+        return true;
+    }
+
+    bool read_image(void) {
+        e_channel_type channel_type;
+        uint64_t size = 0;
+        if (!get_enum(channel_type, e_channel_type::unknown) ||
+            !get(size)) {
+            return false;
+        }
+        auto bytes = get_array<char>(size);
+        if (!m_ok) {
+            return false;
+        }
+        auto image = load_png(std::string(bytes, static_cast<size_t>(size)));
+        if (!image) {
+            return fail();
+        }
+        m_images.push_back(image);
+        return true;
+    }
+
+    bool read_style(void) {
+        e_stroke_cap initial_cap, terminal_cap,
+            dash_initial_cap, dash_terminal_cap;
+        e_stroke_join join, inner_join;
+        uint32_t resets_on_move = 0, count = 0;
+        float miter_limit = 0.f, dash_offset = 0.f;
+        if (!get_enum(initial_cap, e_stroke_cap::fletching) ||
+            !get_enum(terminal_cap, e_stroke_cap::fletching) ||
+            !get_enum(dash_initial_cap, e_stroke_cap::fletching) ||
+            !get_enum(dash_terminal_cap, e_stroke_cap::fletching) ||
+            !get_enum(join, e_stroke_join::bevel) ||
+            !get_enum(inner_join, e_stroke_join::bevel) ||
+            !get(resets_on_move) || !get(miter_limit) ||
+            !get(dash_offset) || !get(count) ||
+            count > (m_length - m_pos)/sizeof(float)) {
+            return fail();
+        }
+        std::vector<float> dashes(count);
+        for (auto &d: dashes) {
+            if (!get(d)) {
+                return false;
+            }
+        }
+        auto style = stroke_style{}.
+            initial_capped(initial_cap).
+            terminal_capped(terminal_cap).
+            dash_initial_capped(dash_initial_cap).
+            dash_terminal_capped(dash_terminal_cap).
+            joined(join).
+            inner_joined(inner_join).
+            reset_on_move(resets_on_move != 0).
+            miter_limited(miter_limit).
+            dash_offset(dash_offset);
+        if (!dashes.empty()) {
+            style = style.dashed(stroke_dashes{std::move(dashes)});
+        }
+        m_styles.push_back(make_intrusive<stroke_style>(std::move(style)));
+        return true;
+    }
+
+    // Depth counts the strokes around the shape
+    bool read_shape(shape &s, int depth = 0) {
+        shape::e_type type;
+        xform xf;
+        if (depth >= max_shape_depth) {
+            return fail();
+        }
+        if (!get_enum(type, shape::e_type::empty) || !get_xform(xf)) {
+            return false;
+        }
+        switch (type) {
+            case shape::e_type::path: {
+                path_data::const_ptr p;
+                if (!get_id(m_paths, p)) {
+                    return false;
+                }
+                s = shape{p};
+                break;
+            }
+            case shape::e_type::circle: {
+                rvgf cx = 0, cy = 0, r = 0;
+                if (!get(cx) || !get(cy) || !get(r)) {
+                    return false;
+                }
+                circle_data::const_ptr c = make_intrusive<circle_data>(cx,
+                    cy, r);
+                s = shape{c};
+                break;
+            }
+            case shape::e_type::triangle: {
+                rvgf x1 = 0, y1 = 0, x2 = 0, y2 = 0, x3 = 0, y3 = 0;
+                if (!get(x1) || !get(y1) || !get(x2) || !get(y2) ||
+                    !get(x3) || !get(y3)) {
+                    return false;
+                }
+                triangle_data::const_ptr t = make_intrusive<triangle_data>(
+                    x1, y1, x2, y2, x3, y3);
+                s = shape{t};
+                break;
+            }
+            case shape::e_type::rect: {
+                rvgf x = 0, y = 0, width = 0, height = 0;
+                if (!get(x) || !get(y) || !get(width) || !get(height)) {
+                    return false;
+                }
+                rect_data::const_ptr r = make_intrusive<rect_data>(x, y,
+                    width, height);
+                s = shape{r};
+                break;
+            }
+            case shape::e_type::polygon: {
+                polygon_data::const_ptr p;
+                if (!get_id(m_polygons, p)) {
+                    return false;
+                }
+                s = shape{p};
+                break;
+            }
+            case shape::e_type::blend: {
+                path_data::const_ptr from, to;
+                rvgf t = 0;
+                if (!get_id(m_paths, from) || !get_id(m_paths, to) ||
+                    !get(t)) {
+                    return false;
+                }
+                s = shape{shape::blend_data{from, to, t}};
+                break;
+            }
+            case shape::e_type::stroke: {
+                float width = 0.f;
+                stroke_style::const_ptr style;
+                shape stroked;
+                if (!get(width) || !get_id(m_styles, style) ||
+                    !read_shape(stroked, depth+1)) {
+                    return false;
+                }
+                s = shape{shape::stroke_data{
+                    make_intrusive<shape>(std::move(stroked)), width, style}};
+                break;
+            }
+            case shape::e_type::empty:
+                s = shape{};
+                break;
+        }
+        s.set_xf(xf);
+        return true;
+    }
+
+    bool read_paint(paint &p) {
+        paint::e_type type;
+        unorm8 opacity;
+        xform xf;
+        if (!get_enum(type, paint::e_type::empty) || !get_unorm8(opacity) ||
+            !get_xform(xf)) {
+            return false;
+        }
+        switch (type) {
+            case paint::e_type::solid_color: {
+                RGBA8 color;
+                if (!get(color)) {
+                    return false;
+                }
+                p = paint{color, opacity};
+                break;
+            }
+            case paint::e_type::linear_gradient: {
+                color_ramp::const_ptr ramp;
+                float x1 = 0.f, y1 = 0.f, x2 = 0.f, y2 = 0.f;
+                if (!get_id(m_ramps, ramp) || !get(x1) || !get(y1) ||
+                    !get(x2) || !get(y2)) {
+                    return false;
+                }
+                linear_gradient_data::const_ptr l =
+                    make_intrusive<linear_gradient_data>(ramp, x1, y1, x2, y2);
+                p = paint{l, opacity};
+                break;
+            }
+            case paint::e_type::radial_gradient: {
+                color_ramp::const_ptr ramp;
+                float cx = 0.f, cy = 0.f, fx = 0.f, fy = 0.f, r = 0.f;
+                if (!get_id(m_ramps, ramp) || !get(cx) || !get(cy) ||
+                    !get(fx) || !get(fy) || !get(r)) {
+                    return false;
+                }
+                radial_gradient_data::const_ptr g =
+                    make_intrusive<radial_gradient_data>(ramp, cx, cy,
+                        fx, fy, r);
+                p = paint{g, opacity};
+                break;
+            }
+            case paint::e_type::texture: {
+                e_spread spread;
+                i_image::const_ptr image;
+                if (!get_enum(spread, e_spread::transparent) ||
+                    !get_id(m_images, image)) {
+                    return false;
+                }
+                texture_data::const_ptr t = make_intrusive<texture_data>(
+                    spread, image);
+                p = paint{t, opacity};
+                break;
+            }
+            case paint::e_type::empty:
+                p = paint{};
+                break;
+        }
+        p.set_xf(xf);
+        return true;
+    }
+
+    template <size_t P, size_t C>
+    bool read_patch(typename patch<P, C>::const_ptr &ptr) {
+        unorm8 opacity;
+        xform xf;
+        R2 points[P];
+        RGBA8 colors[C];
+        if (!get_unorm8(opacity) || !get_xform(xf)) {
+            return false;
+        }
+        for (auto &point: points) {
+            rvgf x = 0, y = 0;
+            if (!get(x) || !get(y)) {
+                return false;
+            }
+            point = R2{x, y};
+        }
+        for (auto &color: colors) {
+            if (!get(color)) {
+                return false;
+            }
+        }
+        auto p = make_intrusive<patch<P, C>>(points, colors, opacity);
+        p->set_xf(xf);
+        ptr = p;
+        return true;
+    }
+
+    bool read_depth(uint16_t &depth) {
+        uint32_t u = 0;
+        if (!get(u) || u > 0xffff) {
+            return fail();
+        }
+        depth = static_cast<uint16_t>(u);
+        return true;
+    }
+
+    // scene_data expects each clip depth to go through begin_clip,
+    // activate_clip, and end_clip, in this order
+    bool check_clip(e_tag tag, uint16_t depth) {
+        if (m_clips.size() <= depth) {
+            m_clips.resize(depth+1, e_clip_state::none);
+        }
+        auto &state = m_clips[depth];
+        if (tag == e_tag::begin_clip && state == e_clip_state::none) {
+            state = e_clip_state::begun;
+        } else if (tag == e_tag::activate_clip &&
+            state == e_clip_state::begun) {
+            state = e_clip_state::activated;
+        } else if (tag == e_tag::end_clip &&
+            state == e_clip_state::activated) {
+            state = e_clip_state::none;
+        } else {
+            return fail();
+        }
+        return true;
+    }
+
+    bool clips_closed(void) const {
+        for (auto state: m_clips) {
+            if (state != e_clip_state::none) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Sends all records until the end record to scene_data
+    bool run(scene_data &sd) {
+        while (m_ok) {
+            e_tag tag;
+            if (!align() || !get_enum(tag, e_tag::compact_path)) {
+                return false;
+            }
+            switch (tag) {
+                case e_tag::end:
+                    return clips_closed() || fail();
+                case e_tag::frame: {
+                    // only allowed at the start, and skipped by the caller
+                    return fail();
+                }
+                case e_tag::path:
+                    read_path();
+                    break;
+                case e_tag::compact_path:
+                    read_compact_path();
+                    break;
+                case e_tag::polygon:
+                    read_polygon();
+                    break;
+                case e_tag::ramp:
+                    read_ramp();
+                    break;
+                case e_tag::image:
+                    read_image();
+                    break;
+                case e_tag::style:
+                    read_style();
+                    break;
+                case e_tag::painted_shape: {
+                    e_winding_rule wr;
+                    shape s;
+                    paint p;
+                    if (get_enum(wr, e_winding_rule::even) &&
+                        read_shape(s) && read_paint(p)) {
+                        sd.painted_shape(wr, s, p);
+                    }
+                    break;
+                }
+                case e_tag::stencil_shape: {
+                    e_winding_rule wr;
+                    shape s;
+                    if (get_enum(wr, e_winding_rule::even) &&
+                        read_shape(s)) {
+                        sd.stencil_shape(wr, s);
+                    }
+                    break;
+                }
+                case e_tag::tensor_product_patch: {
+                    patch<16,4>::const_ptr p;
+                    if (read_patch<16,4>(p)) {
+                        sd.tensor_product_patch(*p);
+                    }
+                    break;
+                }
+                case e_tag::coons_patch: {
+                    patch<12,4>::const_ptr p;
+                    if (read_patch<12,4>(p)) {
+                        sd.coons_patch(*p);
+                    }
+                    break;
+                }
+                case e_tag::gouraud_triangle: {
+                    patch<3,3>::const_ptr p;
+                    if (read_patch<3,3>(p)) {
+                        sd.gouraud_triangle(*p);
+                    }
+                    break;
+                }
+                case e_tag::begin_clip:
+                case e_tag::activate_clip:
+                case e_tag::end_clip: {
+                    uint16_t depth = 0;
+                    if (!read_depth(depth) || !check_clip(tag, depth)) {
+                        break;
+                    }
+                    if (tag == e_tag::begin_clip) {
+                        sd.begin_clip(depth);
+                    } else if (tag == e_tag::activate_clip) {
+                        sd.activate_clip(depth);
+                    } else {
+                        sd.end_clip(depth);
+                    }
+                    break;
+                }
+                case e_tag::begin_fade:
+                case e_tag::end_fade: {
+                    uint16_t depth = 0;
+                    unorm8 opacity;
+                    if (!read_depth(depth) || !get_unorm8(opacity)) {
+                        break;
+                    }
+                    if (tag == e_tag::begin_fade) {
+                        sd.begin_fade(depth, opacity);
+                    } else {
+                        sd.end_fade(depth, opacity);
+                    }
+                    break;
+                }
+                case e_tag::begin_blur:
+                case e_tag::end_blur: {
+                    uint16_t depth = 0;
+                    float radius = 0.f;
+                    if (!read_depth(depth) || !get(radius)) {
+                        break;
+                    }
+                    if (tag == e_tag::begin_blur) {
+                        sd.begin_blur(depth, radius);
+                    } else {
+                        sd.end_blur(depth, radius);
+                    }
+                    break;
+                }
+                case e_tag::begin_transform:
+                case e_tag::end_transform: {
+                    uint16_t depth = 0;
+                    xform xf;
+                    if (!read_depth(depth) || !get_xform(xf)) {
+                        break;
+                    }
+                    if (tag == e_tag::begin_transform) {
+                        sd.begin_transform(depth, xf);
+                    } else {
+                        sd.end_transform(depth, xf);
+                    }
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+bool check_header(const unsigned char *base, size_t length) {
+    header h;
+    if (length < sizeof(h)) {
+        return false;
+    }
+    memcpy(&h, base, sizeof(h));
+    return memcmp(h.magic, magic, sizeof(magic)) == 0 &&
+        h.version == version && h.byte_order == byte_order &&
+        h.float_size == sizeof(rvgf);
+}
+
+} // anonymous namespace
+
+scene_data_file::scene_data_file(void):
+    m_first(sizeof(header)),
+    m_has_frame(false),
+    m_background_color{255,255,255,255} {
+    ;
+}
+
+bool scene_data_file::open(const char *filename) {
+    if (!m_file.open(filename) ||
+        !check_header(m_file.get_base(), m_file.get_length())) {
+        return false;
+    }
+    // Read the frame, if any
+    decoder d{m_file.get_base(), m_file.get_length(), sizeof(header)};
+    uint32_t tag = 0;
+    if (!d.get(tag)) {
+        return false;
+    }
+    if (tag == static_cast<uint32_t>(e_tag::frame)) {
+        if (!d.read_frame(m_xf, m_background_color, m_window, m_viewport)) {
+            return false;
+        }
+        m_has_frame = true;
+        m_first = d.get_pos();
+    }
+    return true;
+}
+
+scene_data::ptr scene_data_file::get_scene_data(void) const {
+    auto sd = make_intrusive<scene_data>();
+    decoder d{m_file.get_base(), m_file.get_length(), m_first};
+    if (!d.run(*sd)) {
+        return nullptr;
+    }
+    return sd;
+}
+
+scene_data_file::ptr map_scene_data_file(const char *filename) {
+    auto file = make_intrusive<scene_data_file>();
+    if (!file->open(filename)) {
+        return nullptr;
+    }
+    return file;
+}
+
+} // namespace rvg
@@ -0,0 +1,109 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_SCENE_DATA_FILE_H
+#define RVG_SCENE_DATA_FILE_H
+
+#include <cstddef>
+
+#include "rvg-ptr.h"
+#include "rvg-mapped-file.h"
+#include "rvg-scene.h"
+#include "rvg-window.h"
+#include "rvg-viewport.h"
+
+namespace rvg {
+
+// A scene written by scene_f_write_binary, mapped into memory.
+//
+// The records are only decoded when the scene is requested. Path and
+// polygon arrays are copied straight out of the mapping, compact paths
+// are decoded back to full precision, and each path, polygon, ramp,
+// image, and style is built once and shared by all shapes and paints
+// that refer to it. The result is a scene_data rather than an
+// i_scene_data iterating in place over the mapping, because drivers
+// receive a scene, which holds a scene_data, and shapes hold their own
+// path_data.
+//
+// The reader checks that every record fits in the file and that every
+// id and enumeration is in range, that strokes do not nest too deeply,
+// that clips are properly bracketed, and that every path reads only
+// from its own data (see path_data_view::is_valid and
+// make_compact_path_data).
+class scene_data_file final:
+    public boost::intrusive_ref_counter<scene_data_file> {
+
+    mapped_file m_file;
+    size_t m_first;
+    bool m_has_frame;
+    xform m_xf;
+    RGBA8 m_background_color;
+    window m_window;
+    viewport m_viewport;
+
+public:
+
+    using ptr = boost::intrusive_ptr<scene_data_file>;
+    using const_ptr = boost::intrusive_ptr<const scene_data_file>;
+
+    // Use map_scene_data_file instead
+    scene_data_file(void);
+
+    // Size of the file in bytes
+    size_t get_length(void) const {
+        return m_file.get_length();
+    }
+
+    // Whether the file has a frame record. Otherwise, the scene has
+    // the identity xform and a white background, and the window and
+    // viewport are empty.
+    bool has_frame(void) const {
+        return m_has_frame;
+    }
+
+    const xform &get_xf(void) const {
+        return m_xf;
+    }
+
+    RGBA8 get_background_color(void) const {
+        return m_background_color;
+    }
+
+    const window &get_window(void) const {
+        return m_window;
+    }
+
+    const viewport &get_viewport(void) const {
+        return m_viewport;
+    }
+
+    // Decodes the scene data. Returns a null pointer if the file is
+    // corrupt.
+    scene_data::ptr get_scene_data(void) const;
+
+private:
+
+    bool open(const char *filename);
+
+friend scene_data_file::ptr map_scene_data_file(const char *filename);
+};
+
+// Maps a file written by scene_f_write_binary into memory.
+// Returns a null pointer on failure.
+scene_data_file::ptr map_scene_data_file(const char *filename);
+
+} // namespace rvg
+
+#endif
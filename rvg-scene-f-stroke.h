@@ -20,6 +20,7 @@
 #include "rvg-i-scene-data-f-forwarder.h"
 
 #include "rvg-stroker-rvg.h"
+#include "rvg-stroke-instance-cache.h"
 
 #ifdef STROKER_LIVAROT
 #include "livarot/rvg-stroker-livarot.h"
@@ -70,6 +71,7 @@ class scene_f_stroke:
 
     e_stroke_method m_method;
     bool m_mock;
+    stroke_instance_cache::ptr m_cache;
     SINK m_sink;
 
 	std::vector<xform> m_xf_stack;
@@ -82,6 +84,16 @@ public:
         ;
     }
 
+    // Reuses outlines of repeated strokes, and shares repeated paths
+	scene_f_stroke(e_stroke_method method, stroke_instance_cache::ptr cache,
+        SINK &&sink):
+        m_method{method},
+        m_mock{false},
+        m_cache{cache},
+        m_sink{std::forward<SINK>(sink)} {
+        ;
+    }
+
 private:
 
     void push_xf(const xform &xf) {
@@ -186,20 +198,40 @@ friend i_sink<scene_f_stroke<SINK>>;
 
 friend i_scene_data<scene_f_stroke<SINK>>;
 
+    // Replaces a path by the canonical path with the same content
+    shape interned(const shape &s) {
+        if (m_cache && s.get_type() == shape::e_type::path) {
+            shape i{m_cache->intern(s.get_path_data_ptr())};
+            i.set_xf(s.get_xf());
+            return i;
+        }
+        return s;
+    }
+
     void do_painted_shape(e_winding_rule rule, const shape &s, const paint &p) {
         if (s.get_type() == shape::e_type::stroke) {
             if (m_mock) {
                 m_sink.painted_shape(e_winding_rule::non_zero,
                     stroke_to_fill(shape{}, m_method, top_xf()), p);
+            } else if (m_cache) {
+                m_sink.painted_shape(e_winding_rule::non_zero,
+                    m_cache->stroke(m_method, s, top_xf(),
+                        [this](const shape &t, const xform &screen_xf) {
+                            return stroke_to_fill(t, m_method, screen_xf);
+                        }), p);
             } else {
                 m_sink.painted_shape(e_winding_rule::non_zero,
                     stroke_to_fill(s, m_method, top_xf()), p);
             }
         } else {
-            m_sink.painted_shape(rule, s, p);
+            m_sink.painted_shape(rule, interned(s), p);
         }
 	}
 
+    void do_stencil_shape(e_winding_rule rule, const shape &s) {
+        m_sink.stencil_shape(rule, interned(s));
+    }
+
     void do_begin_transform(uint16_t depth, const xform &xf) {
         push_xf(xf);
         m_sink.begin_transform(depth, xf);
@@ -224,6 +256,13 @@ make_scene_f_stroke(e_stroke_method method, bool mock, SINK &&sink) {
     return scene_f_stroke<SINK>{method, mock, std::forward<SINK>(sink)};
 }
 
+template <typename SINK>
+static inline auto
+make_scene_f_stroke(e_stroke_method method,
+    stroke_instance_cache::ptr cache, SINK &&sink) {
+    return scene_f_stroke<SINK>{method, cache, std::forward<SINK>(sink)};
+}
+
 } // namespace rvg
 
 #endif
@@ -0,0 +1,430 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "rvg-pngio.h"
+#include "rvg-scene-f-write-binary.h"
+
+namespace rvg {
+
+using namespace scene_binary_format;
+
+scene_f_write_binary::scene_f_write_binary(std::ostream &out,
+    int compact_bits):
+    m_out(out),
+    m_pos(0),
+    m_compact_bits(compact_bits) {
+    header h;
+    memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.byte_order = byte_order;
+    h.float_size = sizeof(rvgf);
+    h.reserved = 0;
+    h.reserved2 = 0;
+    put(h);
+}
+
+template <typename T>
+void scene_f_write_binary::put(const T &value) {
+    put_bytes(&value, sizeof(value));
+}
+
+void scene_f_write_binary::put_bytes(const void *data, size_t length) {
+    m_out.write(static_cast<const char *>(data),
+        static_cast<std::streamsize>(length));
+    m_pos += length;
+}
+
+void scene_f_write_binary::pad(void) {
+    static const char zeros[8] = {0};
+    size_t n = static_cast<size_t>((8 - (m_pos & 7)) & 7);
+    put_bytes(zeros, n);
+}
+
+void scene_f_write_binary::put_tag(e_tag tag) {
+    pad();
+    put(static_cast<uint32_t>(tag));
+}
+
+void scene_f_write_binary::put_xform(const xform &xf) {
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            put(xf[i][j]);
+        }
+    }
+}
+
+void scene_f_write_binary::frame(const xform &xf, RGBA8 background,
+    const window &w, const viewport &v) {
+    put_tag(e_tag::frame);
+    put_xform(xf);
+    put(background);
+    for (int i = 0; i < 4; ++i) {
+        put(static_cast<rvgf>(w.corners()[i]));
+    }
+    for (int i = 0; i < 4; ++i) {
+        put(static_cast<int32_t>(v.corners()[i]));
+    }
+}
+
+void scene_f_write_binary::end(void) {
+    put_tag(e_tag::end);
+    pad();
+    m_out.flush();
+}
+
+void scene_f_write_binary::put_path(const path_data &p) {
+    auto v = p.view();
+    put_tag(e_tag::path);
+    pad();
+    put(static_cast<uint64_t>(v.size()));
+    put(static_cast<uint64_t>(v.data_size()));
+    put_bytes(v.get_instructions(), v.size()*sizeof(path_instruction));
+    pad();
+    put_bytes(v.get_offsets(), v.size()*sizeof(floatint));
+    pad();
+    put_bytes(v.get_data(), v.data_size()*sizeof(rvgf));
+}
+
+void scene_f_write_binary::put_compact_path(const compact_path_data &c) {
+    const auto &instructions = c.get_instructions();
+    const auto &frames = c.get_frames();
+    const auto &coordinates = c.get_coordinates();
+    const auto &rational = c.get_rational();
+    put_tag(e_tag::compact_path);
+    put(static_cast<uint32_t>(c.get_precision()));
+    pad();
+    put(static_cast<uint64_t>(instructions.size()));
+    put(static_cast<uint64_t>(frames.size()));
+    put(static_cast<uint64_t>(coordinates.size()));
+    put(static_cast<uint64_t>(rational.size()));
+    put_bytes(instructions.data(),
+        instructions.size()*sizeof(path_instruction));
+    pad();
+    put_bytes(frames.data(), frames.size()*sizeof(frames[0]));
+    pad();
+    put_bytes(coordinates.data(), coordinates.size());
+    pad();
+    put_bytes(rational.data(), rational.size()*sizeof(rvgf));
+}
+
+uint32_t scene_f_write_binary::write_path(const path_data::const_ptr &p) {
+    uint32_t id;
+    if (!m_paths.find_or_insert(p, id)) {
+        compact_path_data::ptr c;
+        if (m_compact_bits == 16) {
+            c = make_compact_path_data(*p,
+                compact_path_data::precision::bits16);
+        } else if (m_compact_bits == 24) {
+            c = make_compact_path_data(*p,
+                compact_path_data::precision::bits24);
+        }
+        if (c) {
+            put_compact_path(*c);
+        } else {
+            put_path(*p);
+        }
+    }
+    return id;
+}
+
+uint32_t scene_f_write_binary::write_polygon(
+    const polygon_data::const_ptr &p) {
+    uint32_t id;
+    if (!m_polygons.find_or_insert(p, id)) {
+        const auto c = p->get_coordinates();
+        put_tag(e_tag::polygon);
+        pad();
+        put(static_cast<uint64_t>(c.size()));
+        put_bytes(c.data(), c.size()*sizeof(rvgf));
+    }
+    return id;
+}
+
+uint32_t scene_f_write_binary::write_ramp(const color_ramp::const_ptr &r) {
+    uint32_t id;
+    if (!m_ramps.find_or_insert(r, id)) {
+        const auto &stops = r->get_color_stops();
+        put_tag(e_tag::ramp);
+        put(static_cast<uint32_t>(r->get_spread()));
+        put(static_cast<uint32_t>(stops.size()));
+        for (const auto &stop: stops) {
+            put(stop.get_offset());
+            put(stop.get_color());
+        }
+    }
+    return id;
+}
+
+uint32_t scene_f_write_binary::write_image(const i_image::const_ptr &i) {
+    uint32_t id;
+    if (!m_images.find_or_insert(i, id)) {
+        std::string s;
+        if (i->get_channel_type() == e_channel_type::uint8_t_) {
+            store_png<uint8_t>(&s, i);
+        } else {
+            store_png<uint16_t>(&s, i);
+        }
+        put_tag(e_tag::image);
+        put(static_cast<uint32_t>(i->get_channel_type()));
+        put(static_cast<uint64_t>(s.size()));
+        put_bytes(s.data(), s.size());
+    }
+    return id;
+}
+
+uint32_t scene_f_write_binary::write_style(const stroke_style::const_ptr &s) {
+    uint32_t id;
+    if (!m_styles.find_or_insert(s, id)) {
+        put_tag(e_tag::style);
+        put(static_cast<uint32_t>(s->get_initial_cap()));
+        put(static_cast<uint32_t>(s->get_terminal_cap()));
+        put(static_cast<uint32_t>(s->get_dash_initial_cap()));
+        put(static_cast<uint32_t>(s->get_dash_terminal_cap()));
+        put(static_cast<uint32_t>(s->get_join()));
+        put(static_cast<uint32_t>(s->get_inner_join()));
+        put(static_cast<uint32_t>(s->get_resets_on_move()));
+        put(s->get_miter_limit());
+        put(s->get_dash_offset());
+        const auto &dashes = s->get_dashes();
+        put(static_cast<uint32_t>(dashes.size()));
+        for (float d: dashes) {
+            put(d);
+        }
+    }
+    return id;
+}
+
+void scene_f_write_binary::define_shape(const shape &s) {
+    switch (s.get_type()) {
+        case shape::e_type::path:
+            write_path(s.get_path_data_ptr());
+            break;
+        case shape::e_type::polygon:
+            write_polygon(s.get_polygon_data_ptr());
+            break;
+        case shape::e_type::blend:
+            write_path(s.get_blend_data().get_from_ptr());
+            write_path(s.get_blend_data().get_to_ptr());
+            break;
+        case shape::e_type::stroke:
+            write_style(s.get_stroke_data().get_style_ptr());
+            define_shape(s.get_stroke_data().get_shape());
+            break;
+        default:
+            break;
+    }
+}
+
+void scene_f_write_binary::define_paint(const paint &p) {
+    switch (p.get_type()) {
+        case paint::e_type::linear_gradient:
+            write_ramp(p.get_linear_gradient_data().get_color_ramp_ptr());
+            break;
+        case paint::e_type::radial_gradient:
+            write_ramp(p.get_radial_gradient_data().get_color_ramp_ptr());
+            break;
+        case paint::e_type::texture:
+            write_image(p.get_texture_data().get_image_ptr());
+            break;
+        default:
+            break;
+    }
+}
+
+// Called after define_shape, so all ids are already known
+void scene_f_write_binary::put_shape(const shape &s) {
+    put(static_cast<uint32_t>(s.get_type()));
+    put_xform(s.get_xf());
+    switch (s.get_type()) {
+        case shape::e_type::path:
+            put(write_path(s.get_path_data_ptr()));
+            break;
+        case shape::e_type::circle: {
+            const auto &c = s.get_circle_data();
+            put(c.get_cx()); put(c.get_cy()); put(c.get_r());
+            break;
+        }
+        case shape::e_type::triangle: {
+            const auto &t = s.get_triangle_data();
+            put(t.get_x1()); put(t.get_y1());
+            put(t.get_x2()); put(t.get_y2());
+            put(t.get_x3()); put(t.get_y3());
+            break;
+        }
+        case shape::e_type::rect: {
+            const auto &r = s.get_rect_data();
+            put(r.get_x()); put(r.get_y());
+            put(r.get_width()); put(r.get_height());
+            break;
+        }
+        case shape::e_type::polygon:
+            put(write_polygon(s.get_polygon_data_ptr()));
+            break;
+        case shape::e_type::blend: {
+            const auto &b = s.get_blend_data();
+            put(write_path(b.get_from_ptr()));
+            put(write_path(b.get_to_ptr()));
+            put(b.t());
+            break;
+        }
+        case shape::e_type::stroke: {
+            const auto &stk = s.get_stroke_data();
+            put(stk.get_width());
+            put(write_style(stk.get_style_ptr()));
+            put_shape(stk.get_shape());
+            break;
+        }
+        case shape::e_type::empty:
+            break;
+    }
+}
+
+// Called after define_paint, so all ids are already known
+void scene_f_write_binary::put_paint(const paint &p) {
+    put(static_cast<uint32_t>(p.get_type()));
+    put(static_cast<uint32_t>(static_cast<uint8_t>(p.get_opacity())));
+    put_xform(p.get_xf());
+    switch (p.get_type()) {
+        case paint::e_type::solid_color:
+            put(p.get_solid_color());
+            break;
+        case paint::e_type::linear_gradient: {
+            const auto &l = p.get_linear_gradient_data();
+            put(write_ramp(l.get_color_ramp_ptr()));
+            put(l.get_x1()); put(l.get_y1());
+            put(l.get_x2()); put(l.get_y2());
+            break;
+        }
+        case paint::e_type::radial_gradient: {
+            const auto &r = p.get_radial_gradient_data();
+            put(write_ramp(r.get_color_ramp_ptr()));
+            put(r.get_cx()); put(r.get_cy());
+            put(r.get_fx()); put(r.get_fy());
+            put(r.get_r());
+            break;
+        }
+        case paint::e_type::texture: {
+            const auto &t = p.get_texture_data();
+            put(static_cast<uint32_t>(t.get_spread()));
+            put(write_image(t.get_image_ptr()));
+            break;
+        }
+        case paint::e_type::empty:
+            break;
+    }
+}
+
+template <size_t P, size_t C>
+void scene_f_write_binary::put_patch(e_tag tag, const patch<P, C> &p) {
+    put_tag(tag);
+    put(static_cast<uint32_t>(static_cast<uint8_t>(p.get_opacity())));
+    put_xform(p.get_xf());
+    for (const auto &point: p.get_patch_data().get_points()) {
+        put(point[0]);
+        put(point[1]);
+    }
+    for (const auto &color: p.get_patch_data().get_colors()) {
+        put(color);
+    }
+}
+
+void scene_f_write_binary::do_painted_shape(e_winding_rule wr,
+    const shape &s, const paint &p) {
+    define_shape(s);
+    define_paint(p);
+    put_tag(e_tag::painted_shape);
+    put(static_cast<uint32_t>(wr));
+    put_shape(s);
+    put_paint(p);
+}
+
+void scene_f_write_binary::do_stencil_shape(e_winding_rule wr,
+    const shape &s) {
+    define_shape(s);
+    put_tag(e_tag::stencil_shape);
+    put(static_cast<uint32_t>(wr));
+    put_shape(s);
+}
+
+void scene_f_write_binary::do_tensor_product_patch(const patch<16,4> &tpp) {
+    put_patch(e_tag::tensor_product_patch, tpp);
+}
+
+void scene_f_write_binary::do_coons_patch(const patch<12,4> &cp) {
+    put_patch(e_tag::coons_patch, cp);
+}
+
+void scene_f_write_binary::do_gouraud_triangle(const patch<3,3> &gt) {
+    put_patch(e_tag::gouraud_triangle, gt);
+}
+
+void scene_f_write_binary::do_begin_clip(uint16_t depth) {
+    put_tag(e_tag::begin_clip);
+    put(static_cast<uint32_t>(depth));
+}
+
+void scene_f_write_binary::do_activate_clip(uint16_t depth) {
+    put_tag(e_tag::activate_clip);
+    put(static_cast<uint32_t>(depth));
+}
+
+void scene_f_write_binary::do_end_clip(uint16_t depth) {
+    put_tag(e_tag::end_clip);
+    put(static_cast<uint32_t>(depth));
+}
+
+void scene_f_write_binary::do_begin_fade(uint16_t depth, unorm8 opacity) {
+    put_tag(e_tag::begin_fade);
+    put(static_cast<uint32_t>(depth));
+    put(static_cast<uint32_t>(static_cast<uint8_t>(opacity)));
+}
+
+void scene_f_write_binary::do_end_fade(uint16_t depth, unorm8 opacity) {
+    put_tag(e_tag::end_fade);
+    put(static_cast<uint32_t>(depth));
+    put(static_cast<uint32_t>(static_cast<uint8_t>(opacity)));
+}
+
+void scene_f_write_binary::do_begin_blur(uint16_t depth, float radius) {
+    put_tag(e_tag::begin_blur);
+    put(static_cast<uint32_t>(depth));
+    put(radius);
+}
+
+void scene_f_write_binary::do_end_blur(uint16_t depth, float radius) {
+    put_tag(e_tag::end_blur);
+    put(static_cast<uint32_t>(depth));
+    put(radius);
+}
+
+void scene_f_write_binary::do_begin_transform(uint16_t depth,
+    const xform &xf) {
+    put_tag(e_tag::begin_transform);
+    put(static_cast<uint32_t>(depth));
+    put_xform(xf);
+}
+
+void scene_f_write_binary::do_end_transform(uint16_t depth,
+    const xform &xf) {
+    put_tag(e_tag::end_transform);
+    put(static_cast<uint32_t>(depth));
+    put_xform(xf);
+}
+
+} // namespace rvg
@@ -0,0 +1,140 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_SCENE_F_WRITE_BINARY_H
+#define RVG_SCENE_F_WRITE_BINARY_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+
+#include "rvg-i-scene-data.h"
+#include "rvg-compact-path-data.h"
+#include "rvg-scene-binary-format.h"
+#include "rvg-window.h"
+#include "rvg-viewport.h"
+
+namespace rvg {
+
+// Writes a scene in the binary format described in
+// rvg-scene-binary-format.h. The header is written on construction.
+// Call frame() before sending the scene, if the file is to be loaded
+// by process.lua, and end() after the scene has been sent.
+//
+// If compact_bits is 16 or 24, paths are quantized to that many bits
+// per coordinate and written as compact_path records (see
+// compact_path_data). Paths that cannot be quantized are written in
+// full precision.
+class scene_f_write_binary final:
+    public i_scene_data<scene_f_write_binary> {
+
+    using e_tag = scene_binary_format::e_tag;
+
+    // Ids of objects already written. The objects are kept alive, so
+    // their addresses cannot be reused by new objects while we write
+    template <typename PTR>
+    class id_map {
+        std::unordered_map<const void *, uint32_t> m_ids;
+        std::vector<PTR> m_objects;
+    public:
+        // Returns true and sets id if ptr has been seen before.
+        // Otherwise, assigns a new id to ptr and returns false.
+        bool find_or_insert(const PTR &ptr, uint32_t &id) {
+            auto inserted = m_ids.emplace(ptr.get(),
+                static_cast<uint32_t>(m_objects.size()));
+            id = inserted.first->second;
+            if (inserted.second) {
+                m_objects.push_back(ptr);
+                return false;
+            }
+            return true;
+        }
+    };
+
+    std::ostream &m_out;
+    uint64_t m_pos;
+    int m_compact_bits;
+    id_map<path_data::const_ptr> m_paths;
+    id_map<polygon_data::const_ptr> m_polygons;
+    id_map<color_ramp::const_ptr> m_ramps;
+    id_map<i_image::const_ptr> m_images;
+    id_map<stroke_style::const_ptr> m_styles;
+
+public:
+
+    explicit scene_f_write_binary(std::ostream &out, int compact_bits = 0);
+
+    // Writes the scene xform, background color, window, and viewport
+    void frame(const xform &xf, RGBA8 background, const window &w,
+        const viewport &v);
+
+    // Writes the end record
+    void end(void);
+
+private:
+
+    template <typename T>
+    void put(const T &value);
+
+    void put_bytes(const void *data, size_t length);
+    void put_tag(e_tag tag);
+    void pad(void);
+    void put_xform(const xform &xf);
+
+    uint32_t write_path(const path_data::const_ptr &p);
+    void put_path(const path_data &p);
+    void put_compact_path(const compact_path_data &c);
+    uint32_t write_polygon(const polygon_data::const_ptr &p);
+    uint32_t write_ramp(const color_ramp::const_ptr &r);
+    uint32_t write_image(const i_image::const_ptr &i);
+    uint32_t write_style(const stroke_style::const_ptr &s);
+
+    // Definitions of everything a shape or paint refers to must come
+    // before the record that uses them
+    void define_shape(const shape &s);
+    void define_paint(const paint &p);
+    void put_shape(const shape &s);
+    void put_paint(const paint &p);
+
+    template <size_t P, size_t C>
+    void put_patch(e_tag tag, const patch<P, C> &p);
+
+friend i_scene_data<scene_f_write_binary>;
+
+    void do_painted_shape(e_winding_rule wr, const shape &s, const paint &p);
+    void do_stencil_shape(e_winding_rule wr, const shape &s);
+    void do_tensor_product_patch(const patch<16,4> &tpp);
+    void do_coons_patch(const patch<12,4> &cp);
+    void do_gouraud_triangle(const patch<3,3> &gt);
+    void do_begin_clip(uint16_t depth);
+    void do_activate_clip(uint16_t depth);
+    void do_end_clip(uint16_t depth);
+    void do_begin_fade(uint16_t depth, unorm8 opacity);
+    void do_end_fade(uint16_t depth, unorm8 opacity);
+    void do_begin_blur(uint16_t depth, float radius);
+    void do_end_blur(uint16_t depth, float radius);
+    void do_begin_transform(uint16_t depth, const xform &xf);
+    void do_end_transform(uint16_t depth, const xform &xf);
+};
+
+static inline scene_f_write_binary make_scene_f_write_binary(
+    std::ostream &out, int compact_bits = 0) {
+    return scene_f_write_binary{out, compact_bits};
+}
+
+} // namespace rvg
+
+#endif
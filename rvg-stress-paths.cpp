@@ -0,0 +1,206 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "rvg-stress-paths.h"
+
+namespace rvg {
+
+namespace {
+
+class stress_random {
+    std::mt19937 m_gen;
+
+public:
+
+    explicit stress_random(uint32_t seed): m_gen(seed) { ; }
+
+    // Uniform in [a, b), from the top 24 bits of the generator
+    rvgf uniform(rvgf a, rvgf b) {
+        return a + (b-a)*static_cast<rvgf>((m_gen() >> 8)*(1./16777216.));
+    }
+
+    // Uniform in [a, b]
+    int integer(int a, int b) {
+        return a + static_cast<int>(m_gen() %
+            static_cast<uint32_t>(b-a+1));
+    }
+};
+
+const rvgf two_pi = static_cast<rvgf>(2.*3.141592653589793);
+
+} // anonymous namespace
+
+path_data::ptr make_stress_cubic_chain(int n, uint32_t seed) {
+    stress_random random(seed);
+    auto p = make_intrusive<path_data>();
+    const rvgf step = 20;
+    rvgf x0 = 0, y0 = 0;
+    p->begin_contour(x0, y0);
+    for (int i = 0; i < n; ++i) {
+        rvgf x1 = x0 + random.uniform(-step, step);
+        rvgf y1 = y0 + random.uniform(-step, step);
+        rvgf x2 = x1 + random.uniform(-step, step);
+        rvgf y2 = y1 + random.uniform(-step, step);
+        rvgf x3 = x2 + random.uniform(-step, step);
+        rvgf y3 = y2 + random.uniform(-step, step);
+        p->cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3);
+        x0 = x3; y0 = y3;
+    }
+    p->end_open_contour(x0, y0);
+    return p;
+}
+
+path_data::ptr make_stress_near_cusps(int n, uint32_t seed) {
+    stress_random random(seed);
+    auto p = make_intrusive<path_data>();
+    const rvgf size = 50, spacing = 80;
+    int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(n))));
+    for (int i = 0; i < n; ++i) {
+        rvgf ox = spacing*static_cast<rvgf>(i % columns);
+        rvgf oy = spacing*static_cast<rvgf>(i / columns);
+        // (0,0), (1,1), (0,1), (1,0) has a cusp at t = 1/2. Moving
+        // the third control point turns it into a loop or a bend
+        rvgf e = std::pow(rvgf{10}, -random.uniform(1, 6));
+        rvgf a = random.uniform(0, two_pi);
+        rvgf x2 = e*std::cos(a), y2 = 1 + e*std::sin(a);
+        rvgf x0 = ox, y0 = oy, x3 = ox+size, y3 = oy;
+        p->begin_contour(x0, y0);
+        p->cubic_segment(x0, y0, ox+size, oy+size, ox+size*x2, oy+size*y2,
+            x3, y3);
+        p->end_open_contour(x3, y3);
+    }
+    return p;
+}
+
+path_data::ptr make_stress_spiral(int n, uint32_t seed) {
+    stress_random random(seed);
+    auto p = make_intrusive<path_data>();
+    // r = a + b*theta, with the turns 20 units apart, in steps of
+    // about 20 units of arc length, so the length grows linearly with n
+    const rvgf b = rvgf{20}/two_pi, step = 20;
+    rvgf a = random.uniform(5, 10), t = random.uniform(0, two_pi);
+    rvgf r = a + b*t;
+    rvgf x0 = r*std::cos(t), y0 = r*std::sin(t);
+    rvgf dx0 = b*std::cos(t) - r*std::sin(t);
+    rvgf dy0 = b*std::sin(t) + r*std::cos(t);
+    p->begin_contour(x0, y0);
+    for (int i = 0; i < n; ++i) {
+        // Hermite interpolation of each step, at most 1/16 of a turn
+        rvgf dt = std::min(step/std::hypot(r, b), two_pi/16);
+        rvgf t3 = t + dt;
+        rvgf r3 = a + b*t3;
+        rvgf x3 = r3*std::cos(t3), y3 = r3*std::sin(t3);
+        rvgf dx3 = b*std::cos(t3) - r3*std::sin(t3);
+        rvgf dy3 = b*std::sin(t3) + r3*std::cos(t3);
+        p->cubic_segment(x0, y0, x0+dx0*dt/3, y0+dy0*dt/3,
+            x3-dx3*dt/3, y3-dy3*dt/3, x3, y3);
+        t = t3; r = r3; x0 = x3; y0 = y3; dx0 = dx3; dy0 = dy3;
+    }
+    p->end_open_contour(x0, y0);
+    return p;
+}
+
+path_data::ptr make_stress_polylines(int n, uint32_t seed) {
+    stress_random random(seed);
+    auto p = make_intrusive<path_data>();
+    const int vertices = 16;
+    const rvgf size = 100, spacing = 120;
+    int contours = std::max(1, (n+vertices-1)/vertices);
+    int columns = std::max(1, static_cast<int>(
+        std::ceil(std::sqrt(contours))));
+    for (int i = 0; i < contours; ++i) {
+        rvgf ox = spacing*static_cast<rvgf>(i % columns);
+        rvgf oy = spacing*static_cast<rvgf>(i / columns);
+        rvgf x0 = ox + random.uniform(0, size);
+        rvgf y0 = oy + random.uniform(0, size);
+        rvgf xs = x0, ys = y0;
+        p->begin_contour(x0, y0);
+        int segments = (i % 2)? vertices-1: vertices;
+        for (int j = 0; j < segments; ++j) {
+            rvgf x1 = ox + random.uniform(0, size);
+            rvgf y1 = oy + random.uniform(0, size);
+            p->linear_segment(x0, y0, x1, y1);
+            x0 = x1; y0 = y1;
+        }
+        if (i % 2) {
+            p->linear_segment(x0, y0, xs, ys);
+            p->end_closed_contour(xs, ys);
+        } else {
+            p->end_open_contour(x0, y0);
+        }
+    }
+    return p;
+}
+
+namespace {
+
+// A closed contour of k quadratics through points at random radii
+// around (cx, cy), with the control points where the tangents meet
+void stress_glyph_contour(stress_random &random, path_data &p, rvgf cx,
+    rvgf cy, rvgf radius, int k, bool clockwise) {
+    std::vector<rvgf> rx(k), ry(k);
+    rvgf dt = (clockwise? -two_pi: two_pi)/static_cast<rvgf>(k);
+    for (int j = 0; j < k; ++j) {
+        rvgf r = radius*random.uniform(rvgf{.8}, rvgf{1.2});
+        rvgf t = dt*static_cast<rvgf>(j);
+        rx[j] = r*std::cos(t);
+        ry[j] = r*std::sin(t);
+    }
+    // The on-curve points are the midpoints between off-curve points
+    rvgf x0 = cx + (rx[k-1]+rx[0])/2, y0 = cy + (ry[k-1]+ry[0])/2;
+    p.begin_contour(x0, y0);
+    for (int j = 0; j < k; ++j) {
+        int l = (j+1) % k;
+        rvgf x2 = cx + (rx[j]+rx[l])/2, y2 = cy + (ry[j]+ry[l])/2;
+        p.quadratic_segment(x0, y0, cx+rx[j], cy+ry[j], x2, y2);
+        x0 = x2; y0 = y2;
+    }
+    p.end_closed_contour(x0, y0);
+}
+
+} // anonymous namespace
+
+path_data::ptr make_stress_glyphs(int n, uint32_t seed) {
+    stress_random random(seed);
+    auto p = make_intrusive<path_data>();
+    const rvgf em = 100;
+    int segments = 0, i = 0;
+    while (segments < n) {
+        rvgf cx = em*static_cast<rvgf>(i % 64) + em/2;
+        rvgf cy = -em*static_cast<rvgf>(i / 64) - em/2;
+        int outer = random.integer(8, 24);
+        int inner = random.integer(4, 12);
+        stress_glyph_contour(random, *p, cx, cy, em*rvgf{.4}, outer, false);
+        stress_glyph_contour(random, *p, cx, cy, em*rvgf{.15}, inner, true);
+        segments += outer + inner;
+        ++i;
+    }
+    return p;
+}
+
+const std::array<stress_path, 5> stress_paths{{
+    { "cubic_chain", make_stress_cubic_chain },
+    { "near_cusps", make_stress_near_cusps },
+    { "spiral", make_stress_spiral },
+    { "polylines", make_stress_polylines },
+    { "glyphs", make_stress_glyphs },
+}};
+
+} // namespace rvg
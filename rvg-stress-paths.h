@@ -0,0 +1,58 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_STRESS_PATHS_H
+#define RVG_STRESS_PATHS_H
+
+#include <array>
+#include <cstdint>
+
+#include "rvg-path-data.h"
+
+// Synthetic paths for scaling tests, with about n segments each. The
+// generators draw from std::mt19937 directly, rather than through the
+// std distributions, so a seed produces the same path everywhere.
+
+namespace rvg {
+
+// One open contour of n random cubics, each starting where the
+// previous one ended
+path_data::ptr make_stress_cubic_chain(int n, uint32_t seed);
+
+// n separate cubics, each within a random distance of having a cusp,
+// from 1e-1 down to 1e-6 relative to its size
+path_data::ptr make_stress_near_cusps(int n, uint32_t seed);
+
+// An Archimedean spiral of n cubics of about the same length, meant to
+// be dashed
+path_data::ptr make_stress_spiral(int n, uint32_t seed);
+
+// Random polylines with 16 segments each, alternately open and closed
+path_data::ptr make_stress_polylines(int n, uint32_t seed);
+
+// Rows of glyph-like outlines, each an outer contour and a counter
+// in the opposite orientation, made of quadratics as in TrueType fonts
+path_data::ptr make_stress_glyphs(int n, uint32_t seed);
+
+struct stress_path {
+    const char *name;
+    path_data::ptr (*generate)(int n, uint32_t seed);
+};
+
+extern const std::array<stress_path, 5> stress_paths;
+
+} // namespace rvg
+
+#endif
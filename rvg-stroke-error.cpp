@@ -0,0 +1,483 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "rvg-i-input-path.h"
+#include "rvg-input-path-f-xform.h"
+#include "rvg-stroke-error.h"
+
+namespace rvg {
+
+namespace {
+
+// Distances are measured in double precision, on polylines that follow
+// the curves to within flatness, with edges no longer than spacing.
+// Output edges are also classified by looking at resolution away on
+// each side
+const double flatness = 1.e-4;
+const double resolution = 1.e-2;
+const double max_spacing = .25;
+const double pi = 3.141592653589793;
+
+struct point {
+    double x, y;
+};
+
+struct edge {
+    point p0, p1;
+};
+
+// A vertex of a flattened path and the derivative of its segment there
+struct sample {
+    point p, d;
+};
+
+double distance_to_edge(const point &q, const edge &e) {
+    double ex = e.p1.x-e.p0.x, ey = e.p1.y-e.p0.y;
+    double qx = q.x-e.p0.x, qy = q.y-e.p0.y;
+    double l2 = ex*ex+ey*ey;
+    double t = l2 > 0? std::min(1., std::max(0., (qx*ex+qy*ey)/l2)): 0.;
+    double dx = qx-t*ex, dy = qy-t*ey;
+    return std::sqrt(dx*dx+dy*dy);
+}
+
+// Any segment of an input path, evaluated in double precision
+class segment {
+    int m_degree;
+    point m_p[4];
+    double m_w1; // weight of middle control point of rational quadratics
+
+public:
+
+    segment(point p0, point p1): m_degree{1}, m_p{p0, p1}, m_w1{1} { ; }
+
+    segment(point p0, point p1, point p2, double w1 = 1):
+        m_degree{2}, m_p{p0, p1, p2}, m_w1{w1} { ; }
+
+    segment(point p0, point p1, point p2, point p3):
+        m_degree{3}, m_p{p0, p1, p2, p3}, m_w1{1} { ; }
+
+    // Point and derivative at t. The middle control point of rational
+    // quadratics is in homogeneous coordinates, as in path_data
+    sample evaluate(double t) const {
+        double s = 1.-t;
+        switch (m_degree) {
+            case 1:
+                return {{s*m_p[0].x+t*m_p[1].x, s*m_p[0].y+t*m_p[1].y},
+                    {m_p[1].x-m_p[0].x, m_p[1].y-m_p[0].y}};
+            case 2: {
+                double b0 = s*s, b1 = 2.*s*t, b2 = t*t;
+                double db0 = -2.*s, db1 = 2.*(s-t), db2 = 2.*t;
+                double nx = b0*m_p[0].x+b1*m_p[1].x+b2*m_p[2].x;
+                double ny = b0*m_p[0].y+b1*m_p[1].y+b2*m_p[2].y;
+                double w = b0+b1*m_w1+b2;
+                double dnx = db0*m_p[0].x+db1*m_p[1].x+db2*m_p[2].x;
+                double dny = db0*m_p[0].y+db1*m_p[1].y+db2*m_p[2].y;
+                double dw = db0+db1*m_w1+db2;
+                return {{nx/w, ny/w},
+                    {(dnx*w-nx*dw)/(w*w), (dny*w-ny*dw)/(w*w)}};
+            }
+            default: {
+                double b0 = s*s*s, b1 = 3.*s*s*t, b2 = 3.*s*t*t, b3 = t*t*t;
+                double db0 = -3.*s*s, db1 = 3.*s*(s-2.*t),
+                    db2 = 3.*t*(2.*s-t), db3 = 3.*t*t;
+                return {{b0*m_p[0].x+b1*m_p[1].x+b2*m_p[2].x+b3*m_p[3].x,
+                    b0*m_p[0].y+b1*m_p[1].y+b2*m_p[2].y+b3*m_p[3].y},
+                    {db0*m_p[0].x+db1*m_p[1].x+db2*m_p[2].x+db3*m_p[3].x,
+                    db0*m_p[0].y+db1*m_p[1].y+db2*m_p[2].y+db3*m_p[3].y}};
+            }
+        }
+    }
+};
+
+// Replaces each segment with a polyline. Closes every contour if
+// close_all is set, for paths that are meant to be filled. Segment
+// endpoints are also kept as corners, where the exact stroke has a
+// round join or cap
+class input_path_f_flatten final:
+    public i_input_path<input_path_f_flatten> {
+
+    double m_spacing;
+    bool m_close_all;
+    point m_start;
+    std::vector<edge> m_edges;
+    std::vector<sample> m_samples;
+    std::vector<point> m_corners;
+
+public:
+
+    input_path_f_flatten(double spacing, bool close_all):
+        m_spacing{spacing},
+        m_close_all{close_all},
+        m_start{0, 0} {
+        ;
+    }
+
+    const std::vector<edge> &get_edges(void) const {
+        return m_edges;
+    }
+
+    const std::vector<sample> &get_samples(void) const {
+        return m_samples;
+    }
+
+    const std::vector<point> &get_corners(void) const {
+        return m_corners;
+    }
+
+private:
+
+    void subdivide(const segment &s, double a, const sample &sa,
+        double b, const sample &sb, int depth) {
+        double m = .5*(a+b);
+        sample sm = s.evaluate(m);
+        edge chord{sa.p, sb.p};
+        bool flat = distance_to_edge(sm.p, chord) <= flatness &&
+            std::hypot(sb.p.x-sa.p.x, sb.p.y-sa.p.y) <= m_spacing;
+        if (depth >= 24 || (depth >= 2 && flat)) {
+            m_edges.push_back(chord);
+            m_samples.push_back(sb);
+        } else {
+            subdivide(s, a, sa, m, sm, depth+1);
+            subdivide(s, m, sm, b, sb, depth+1);
+        }
+    }
+
+    void flatten(const segment &s) {
+        sample s0 = s.evaluate(0.), s1 = s.evaluate(1.);
+        m_samples.push_back(s0);
+        m_corners.push_back(s0.p);
+        subdivide(s, 0., s0, 1., s1, 0);
+        m_corners.push_back(s1.p);
+    }
+
+    void end_contour(double x0, double y0, bool close) {
+        if (close && (x0 != m_start.x || y0 != m_start.y)) {
+            flatten(segment{{x0, y0}, m_start});
+        }
+    }
+
+friend i_input_path<input_path_f_flatten>;
+
+    void do_begin_contour(rvgf x0, rvgf y0) {
+        m_start = {x0, y0};
+        m_corners.push_back(m_start);
+    }
+
+    void do_end_open_contour(rvgf x0, rvgf y0) {
+        end_contour(x0, y0, m_close_all);
+    }
+
+    void do_end_closed_contour(rvgf x0, rvgf y0) {
+        end_contour(x0, y0, true);
+    }
+
+    void do_linear_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1) {
+        flatten(segment{{x0, y0}, {x1, y1}});
+    }
+
+    void do_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2) {
+        flatten(segment{{x0, y0}, {x1, y1}, {x2, y2}});
+    }
+
+    void do_rational_quadratic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf w1, rvgf x2, rvgf y2) {
+        flatten(segment{{x0, y0}, {x1, y1}, {x2, y2}, w1});
+    }
+
+    void do_cubic_segment(rvgf x0, rvgf y0, rvgf x1, rvgf y1,
+        rvgf x2, rvgf y2, rvgf x3, rvgf y3) {
+        flatten(segment{{x0, y0}, {x1, y1}, {x2, y2}, {x3, y3}});
+    }
+};
+
+// Runs of consecutive edges, bucketed in a uniform grid by their
+// bounding boxes, for distance queries. Consecutive edges are close to
+// each other, and a query only looks at the edges of a run if its box
+// is closer than the nearest edge found so far
+class edge_grid {
+
+    static const size_t run_length = 16;
+
+    struct run {
+        double x0, y0, x1, y1;
+        size_t begin, end;
+    };
+
+    double m_x0, m_y0, m_cell;
+    int m_width, m_height;
+    std::vector<edge> m_edges;
+    std::vector<run> m_runs;
+    std::vector<std::vector<size_t>> m_cells;
+
+    int column(double x) const {
+        return std::min(m_width-1, std::max(0,
+            static_cast<int>(std::floor((x-m_x0)/m_cell))));
+    }
+
+    int row(double y) const {
+        return std::min(m_height-1, std::max(0,
+            static_cast<int>(std::floor((y-m_y0)/m_cell))));
+    }
+
+    static double distance_to_box(const point &q, const run &r) {
+        double dx = std::max({r.x0-q.x, 0., q.x-r.x1});
+        double dy = std::max({r.y0-q.y, 0., q.y-r.y1});
+        return std::sqrt(dx*dx+dy*dy);
+    }
+
+public:
+
+    explicit edge_grid(std::vector<edge> &&edges):
+        m_x0{0}, m_y0{0}, m_cell{1}, m_width{0}, m_height{0},
+        m_edges{std::move(edges)} {
+        if (m_edges.empty()) {
+            return;
+        }
+        for (size_t i = 0; i < m_edges.size(); i += run_length) {
+            run r{m_edges[i].p0.x, m_edges[i].p0.y, m_edges[i].p0.x,
+                m_edges[i].p0.y, i, std::min(i+run_length, m_edges.size())};
+            for (size_t j = r.begin; j < r.end; ++j) {
+                const auto &e = m_edges[j];
+                r.x0 = std::min({r.x0, e.p0.x, e.p1.x});
+                r.y0 = std::min({r.y0, e.p0.y, e.p1.y});
+                r.x1 = std::max({r.x1, e.p0.x, e.p1.x});
+                r.y1 = std::max({r.y1, e.p0.y, e.p1.y});
+            }
+            m_runs.push_back(r);
+        }
+        double x1 = m_x0 = m_runs[0].x0, y1 = m_y0 = m_runs[0].y0;
+        for (const auto &r: m_runs) {
+            m_x0 = std::min(m_x0, r.x0);
+            m_y0 = std::min(m_y0, r.y0);
+            x1 = std::max(x1, r.x1);
+            y1 = std::max(y1, r.y1);
+        }
+        // About two cells per run on a side, with at most 512
+        double extent = std::max({x1-m_x0, y1-m_y0, flatness});
+        int n = static_cast<int>(std::min(512., std::max(1.,
+            2.*std::sqrt(static_cast<double>(m_runs.size())))));
+        m_cell = extent/n;
+        m_width = std::min(n, static_cast<int>((x1-m_x0)/m_cell)+1);
+        m_height = std::min(n, static_cast<int>((y1-m_y0)/m_cell)+1);
+        m_cells.resize(static_cast<size_t>(m_width)*m_height);
+        for (size_t i = 0; i < m_runs.size(); ++i) {
+            const auto &r = m_runs[i];
+            for (int y = row(r.y0); y <= row(r.y1); ++y) {
+                for (int x = column(r.x0); x <= column(r.x1); ++x) {
+                    m_cells[static_cast<size_t>(y)*m_width+x].push_back(i);
+                }
+            }
+        }
+    }
+
+    // Distance from q to the nearest edge, or infinity if there are none.
+    // Cells are visited in rings around the cell nearest to q, until
+    // the next ring cannot hold anything closer
+    double distance(const point &q) const {
+        double best = std::numeric_limits<double>::infinity();
+        if (m_edges.empty()) {
+            return best;
+        }
+        int c = column(q.x), r = row(q.y);
+        int rings = std::max({c, r, m_width-1-c, m_height-1-r});
+        for (int k = 0; k <= rings; ++k) {
+            for (int j = r-k; j <= r+k; ++j) {
+                if (j < 0 || j >= m_height) {
+                    continue;
+                }
+                int step = (j == r-k || j == r+k)? 1: 2*k;
+                for (int i = c-k; i <= c+k; i += std::max(step, 1)) {
+                    if (i < 0 || i >= m_width) {
+                        continue;
+                    }
+                    for (auto n: m_cells[static_cast<size_t>(j)*m_width+i]) {
+                        const auto &run = m_runs[n];
+                        if (distance_to_box(q, run) < best) {
+                            for (size_t e = run.begin; e < run.end; ++e) {
+                                best = std::min(best, distance_to_edge(q,
+                                    m_edges[e]));
+                            }
+                        }
+                    }
+                }
+            }
+            if (best <= k*m_cell) {
+                break;
+            }
+        }
+        return best;
+    }
+};
+
+// Edges bucketed in horizontal bands, for winding number queries
+class edge_bands {
+    double m_y0, m_band;
+    std::vector<std::vector<edge>> m_bands;
+
+public:
+
+    explicit edge_bands(const std::vector<edge> &edges):
+        m_y0{0}, m_band{1} {
+        if (edges.empty()) {
+            return;
+        }
+        double y1 = m_y0 = edges[0].p0.y;
+        for (const auto &e: edges) {
+            m_y0 = std::min({m_y0, e.p0.y, e.p1.y});
+            y1 = std::max({y1, e.p0.y, e.p1.y});
+        }
+        int n = static_cast<int>(std::min(4096.,
+            std::max(1., edges.size()/4.)));
+        m_band = std::max(y1-m_y0, flatness)/n;
+        m_bands.resize(static_cast<size_t>(n));
+        for (const auto &e: edges) {
+            int b0 = band(std::min(e.p0.y, e.p1.y));
+            int b1 = band(std::max(e.p0.y, e.p1.y));
+            for (int b = b0; b <= b1; ++b) {
+                m_bands[static_cast<size_t>(b)].push_back(e);
+            }
+        }
+    }
+
+    int band(double y) const {
+        return std::min(static_cast<int>(m_bands.size())-1,
+            std::max(0, static_cast<int>(std::floor((y-m_y0)/m_band))));
+    }
+
+    // Winding number of the closed polylines around q
+    int winding(const point &q) const {
+        if (m_bands.empty()) {
+            return 0;
+        }
+        int w = 0;
+        for (const auto &e: m_bands[static_cast<size_t>(band(q.y))]) {
+            if ((e.p0.y <= q.y) != (e.p1.y <= q.y)) {
+                double x = e.p0.x + (q.y-e.p0.y)*(e.p1.x-e.p0.x)/
+                    (e.p1.y-e.p0.y);
+                if (x > q.x) {
+                    w += e.p1.y > e.p0.y? 1: -1;
+                }
+            }
+        }
+        return w;
+    }
+};
+
+} // anonymous namespace
+
+int measure_stroke_error(const shape &input, float width,
+    const shape &output, stroke_error *error) {
+    if (!(width > 0.f) || !error) {
+        return 0;
+    }
+    double radius = .5*width;
+    double spacing = std::min(max_spacing, width/16.);
+    input_path_f_flatten path(spacing, false);
+    input.as_path_data_ptr(input.get_xf())->iterate(
+        make_input_path_f_xform(input.get_xf(), path));
+    edge_grid path_grid(std::vector<edge>(path.get_edges()));
+    input_path_f_flatten filled(spacing, true);
+    output.as_path_data_ptr(output.get_xf())->iterate(
+        make_input_path_f_xform(output.get_xf(), filled));
+    // Keep the output edges that separate filled from unfilled. Only
+    // those that also do so at resolution are sampled, so rounding
+    // slivers and the overlaps near crossings do not count as error
+    const auto &edges = filled.get_edges();
+    edge_bands bands(edges);
+    std::vector<char> on_boundary(edges.size());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (size_t i = 0; i < edges.size(); ++i) {
+        const auto &e = edges[i];
+        double dx = e.p1.x-e.p0.x, dy = e.p1.y-e.p0.y;
+        double l = std::hypot(dx, dy);
+        if (l > 0) {
+            point m{.5*(e.p0.x+e.p1.x), .5*(e.p0.y+e.p1.y)};
+            auto separates = [&](double h) {
+                double nx = -h*dy/l, ny = h*dx/l;
+                return (bands.winding({m.x+nx, m.y+ny}) != 0) !=
+                    (bands.winding({m.x-nx, m.y-ny}) != 0);
+            };
+            if (separates(flatness)) {
+                on_boundary[i] = separates(resolution)? 2: 1;
+            }
+        }
+    }
+    std::vector<edge> boundary;
+    std::vector<point> sampled;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (on_boundary[i]) {
+            const auto &e = edges[i];
+            boundary.push_back(e);
+            if (on_boundary[i] == 2) {
+                sampled.push_back({.5*(e.p0.x+e.p1.x), .5*(e.p0.y+e.p1.y)});
+            }
+        }
+    }
+    // Output boundary against the exact distance to the path, at the
+    // midpoints where the edges were classified
+    double max_error = 0, sum2 = 0;
+    size_t samples = 0;
+    #pragma omp parallel for schedule(dynamic, 256) \
+        reduction(max: max_error) reduction(+: sum2, samples)
+    for (size_t i = 0; i < sampled.size(); ++i) {
+        double d = std::fabs(path_grid.distance(sampled[i])-radius);
+        max_error = std::max(max_error, d);
+        sum2 += d*d;
+        ++samples;
+    }
+    // Exact offsets, and circles around corners for the joins, caps,
+    // and cusps, against the output boundary. Points closer than the
+    // radius to some other part of the path are inside the stroke
+    std::vector<point> exact;
+    for (const auto &s: path.get_samples()) {
+        double l = std::hypot(s.d.x, s.d.y);
+        if (l > 0) {
+            double nx = -radius*s.d.y/l, ny = radius*s.d.x/l;
+            exact.push_back({s.p.x+nx, s.p.y+ny});
+            exact.push_back({s.p.x-nx, s.p.y-ny});
+        }
+    }
+    int n = static_cast<int>(std::min(4096.,
+        std::ceil(2.*pi*radius/spacing)));
+    for (const auto &c: path.get_corners()) {
+        for (int k = 0; k < n; ++k) {
+            double a = 2.*pi*k/n;
+            exact.push_back({c.x+radius*std::cos(a), c.y+radius*std::sin(a)});
+        }
+    }
+    edge_grid boundary_grid(std::move(boundary));
+    #pragma omp parallel for schedule(dynamic, 256) \
+        reduction(max: max_error) reduction(+: sum2, samples)
+    for (size_t i = 0; i < exact.size(); ++i) {
+        if (path_grid.distance(exact[i]) >= radius-2.*flatness) {
+            double d = boundary_grid.distance(exact[i]);
+            max_error = std::max(max_error, d);
+            sum2 += d*d;
+            ++samples;
+        }
+    }
+    error->max_error = max_error;
+    error->rms_error = samples > 0? std::sqrt(sum2/samples): 0.;
+    error->samples = samples;
+    return 1;
+}
+
+} // namespace rvg
@@ -0,0 +1,50 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_STROKE_ERROR_H
+#define RVG_STROKE_ERROR_H
+
+#include <cstddef>
+
+#include "rvg-shape.h"
+
+namespace rvg {
+
+// Geometric error of a stroker's output, in the units of the output
+struct stroke_error {
+    double max_error = 0;  // largest distance between the two boundaries
+    double rms_error = 0;  // root mean square of the sampled distances
+    size_t samples = 0;    // samples taken on both boundaries
+};
+
+// Compares the boundary of the region filled by output, under the
+// nonzero winding rule, with the boundary of the exact stroke of input
+// with round joins and caps and no dashes, i.e., the set of points
+// within width/2 of the path. Both boundaries are densely sampled.
+// Samples on the output are measured against the exact distance to
+// the path, samples on the exact offsets, joins and caps against the
+// output boundary, and the result is the symmetric Hausdorff distance
+// between the two. Output edges with the same winding classification
+// on both sides, such as the overlaps a stroker leaves inside the
+// stroke, do not count as boundary. Neither do the edges of slivers
+// thinner than about 1e-2, but wider cracks in the output show up as
+// large errors. The error is infinite if the output is empty and the
+// stroke is not. Returns 0 if width is not positive
+int measure_stroke_error(const shape &input, float width,
+    const shape &output, stroke_error *error);
+
+} // namespace rvg
+
+#endif // RVG_STROKE_ERROR_H
@@ -0,0 +1,248 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#include <algorithm>
+#include <cstring>
+
+#include "rvg-stroke-instance-cache.h"
+
+namespace rvg {
+
+namespace {
+
+// Mixes the bytes of an array into a 64-bit hash, 8 bytes at a time
+uint64_t hash_bytes(const void *data, size_t length, uint64_t h) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    const uint64_t k = UINT64_C(0x9e3779b97f4a7c15);
+    while (length >= sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, bytes, sizeof(w));
+        h = (h ^ w)*k;
+        h ^= h >> 29;
+        bytes += sizeof(w);
+        length -= sizeof(w);
+    }
+    if (length > 0) {
+        uint64_t w = 0;
+        memcpy(&w, bytes, length);
+        h = (h ^ w)*k;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+uint64_t hash_content(const path_data &path) {
+    auto v = path.view();
+    uint64_t h = hash_bytes(v.get_instructions(),
+        v.size()*sizeof(path_instruction), v.size());
+    h = hash_bytes(v.get_offsets(), v.size()*sizeof(floatint), h);
+    return hash_bytes(v.get_data(), v.data_size()*sizeof(rvgf), h);
+}
+
+bool same_content(const path_data &a, const path_data &b) {
+    auto va = a.view(), vb = b.view();
+    return va.size() == vb.size() && va.data_size() == vb.data_size() &&
+        memcmp(va.get_instructions(), vb.get_instructions(),
+            va.size()*sizeof(path_instruction)) == 0 &&
+        memcmp(va.get_offsets(), vb.get_offsets(),
+            va.size()*sizeof(floatint)) == 0 &&
+        memcmp(va.get_data(), vb.get_data(),
+            va.data_size()*sizeof(rvgf)) == 0;
+}
+
+uint64_t hash_content(const stroke_style &style) {
+    uint32_t fields[] = {
+        static_cast<uint32_t>(style.get_initial_cap()),
+        static_cast<uint32_t>(style.get_terminal_cap()),
+        static_cast<uint32_t>(style.get_dash_initial_cap()),
+        static_cast<uint32_t>(style.get_dash_terminal_cap()),
+        static_cast<uint32_t>(style.get_join()),
+        static_cast<uint32_t>(style.get_inner_join()),
+        static_cast<uint32_t>(style.get_resets_on_move())
+    };
+    float values[] = { style.get_miter_limit(), style.get_dash_offset() };
+    uint64_t h = hash_bytes(fields, sizeof(fields), 0);
+    h = hash_bytes(values, sizeof(values), h);
+    for (float d: style.get_dashes()) {
+        h = hash_bytes(&d, sizeof(d), h);
+    }
+    return h;
+}
+
+bool same_content(const stroke_style &a, const stroke_style &b) {
+    const auto &da = a.get_dashes(), &db = b.get_dashes();
+    return a.get_initial_cap() == b.get_initial_cap() &&
+        a.get_terminal_cap() == b.get_terminal_cap() &&
+        a.get_dash_initial_cap() == b.get_dash_initial_cap() &&
+        a.get_dash_terminal_cap() == b.get_dash_terminal_cap() &&
+        a.get_join() == b.get_join() &&
+        a.get_inner_join() == b.get_inner_join() &&
+        a.get_resets_on_move() == b.get_resets_on_move() &&
+        a.get_miter_limit() == b.get_miter_limit() &&
+        a.get_dash_offset() == b.get_dash_offset() &&
+        da.size() == db.size() &&
+        std::equal(da.begin(), da.end(), db.begin());
+}
+
+template <typename PTR, typename INTERNED>
+PTR intern_helper(const PTR &object, INTERNED &table) {
+    auto found = table.by_address.find(object.get());
+    if (found != table.by_address.end()) {
+        return found->second.second;
+    }
+    PTR canonical = object;
+    auto &bucket = table.by_hash[hash_content(*object)];
+    for (const auto &candidate: bucket) {
+        if (same_content(*candidate, *object)) {
+            canonical = candidate;
+            break;
+        }
+    }
+    if (canonical == object) {
+        bucket.push_back(object);
+    }
+    table.by_address.emplace(object.get(), std::make_pair(object, canonical));
+    return canonical;
+}
+
+bool is_affine(const xform &xf) {
+    return xf[2][0] == 0 && xf[2][1] == 0 && xf[2][2] == 1;
+}
+
+} // anonymous namespace
+
+size_t stroke_instance_cache::key_hash::operator()(const key &k) const {
+    uint64_t h = hash_bytes(k.values.data(), sizeof(k.values), k.method);
+    h = hash_bytes(&k.shape, sizeof(k.shape), h ^ k.type);
+    return static_cast<size_t>(hash_bytes(&k.style, sizeof(k.style), h));
+}
+
+stroke_instance_cache::stroke_instance_cache(void):
+    m_instances(0),
+    m_strokes(0),
+    m_misses(0),
+    m_path_lookups(0),
+    m_stroke_time(0.),
+    m_miss_time(0.) {
+    ;
+}
+
+path_data::const_ptr stroke_instance_cache::intern(
+    const path_data::const_ptr &path) {
+    ++m_path_lookups;
+    return intern_helper(path, m_paths);
+}
+
+stroke_style::const_ptr stroke_instance_cache::intern(
+    const stroke_style::const_ptr &style) {
+    return intern_helper(style, m_styles);
+}
+
+uint64_t stroke_instance_cache::get_unique_paths(void) const {
+    uint64_t unique = 0;
+    for (const auto &bucket: m_paths.by_hash) {
+        unique += bucket.second.size();
+    }
+    return unique;
+}
+
+bool stroke_instance_cache::make_key(e_stroke_method method,
+    const shape &s, const xform &screen_xf, key &k, shape &canonical,
+    rvgf &tx, rvgf &ty) {
+    if (s.get_type() != shape::e_type::stroke) {
+        return false;
+    }
+    const auto &stroke = s.get_stroke_data();
+    const shape &stroked = stroke.get_shape();
+    // The stroker sees the stroked shape under this transformation
+    xform outer_xf = s.get_xf().transformed(screen_xf);
+    const xform &inner_xf = stroked.get_xf();
+    if (!is_affine(outer_xf) || !is_affine(inner_xf)) {
+        return false;
+    }
+    k.values.fill(0);
+    k.shape = nullptr;
+    k.method = static_cast<uint32_t>(method);
+    k.type = static_cast<uint32_t>(stroked.get_type());
+    shape untranslated;
+    switch (stroked.get_type()) {
+        case shape::e_type::path: {
+            auto path = intern(stroked.get_path_data_ptr());
+            k.shape = path.get();
+            untranslated = shape{path};
+            break;
+        }
+        case shape::e_type::polygon:
+            k.shape = stroked.get_polygon_data_ptr().get();
+            untranslated = shape{stroked.get_polygon_data_ptr()};
+            break;
+        case shape::e_type::circle: {
+            const auto &c = stroked.get_circle_data();
+            k.values[8] = c.get_cx();
+            k.values[9] = c.get_cy();
+            k.values[10] = c.get_r();
+            untranslated = shape{stroked.get_circle_data_ptr()};
+            break;
+        }
+        case shape::e_type::triangle: {
+            const auto &t = stroked.get_triangle_data();
+            k.values[8] = t.get_x1();
+            k.values[9] = t.get_y1();
+            k.values[10] = t.get_x2();
+            k.values[11] = t.get_y2();
+            k.values[12] = t.get_x3();
+            k.values[13] = t.get_y3();
+            untranslated = shape{stroked.get_triangle_data_ptr()};
+            break;
+        }
+        case shape::e_type::rect: {
+            const auto &r = stroked.get_rect_data();
+            k.values[8] = r.get_x();
+            k.values[9] = r.get_y();
+            k.values[10] = r.get_width();
+            k.values[11] = r.get_height();
+            untranslated = shape{stroked.get_rect_data_ptr()};
+            break;
+        }
+        default:
+            return false;
+    }
+    auto style = intern(stroke.get_style_ptr());
+    k.style = style.get();
+    k.values[0] = inner_xf[0][0];
+    k.values[1] = inner_xf[0][1];
+    k.values[2] = inner_xf[1][0];
+    k.values[3] = inner_xf[1][1];
+    k.values[4] = outer_xf[0][0];
+    k.values[5] = outer_xf[0][1];
+    k.values[6] = outer_xf[1][0];
+    k.values[7] = outer_xf[1][1];
+    k.values[14] = stroke.get_width();
+    // Hashing looks at bytes, so make -0 and +0 the same
+    for (auto &v: k.values) {
+        v += rvgf{0};
+    }
+    tx = inner_xf[0][2];
+    ty = inner_xf[1][2];
+    untranslated.set_xf(make_linearity(inner_xf[0][0], inner_xf[0][1],
+        inner_xf[1][0], inner_xf[1][1]));
+    canonical = shape{shape::stroke_data{
+        make_intrusive<shape>(std::move(untranslated)),
+        stroke.get_width(), style}};
+    canonical.set_xf(s.get_xf());
+    return true;
+}
+
+} // namespace rvg
@@ -0,0 +1,175 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_STROKE_INSTANCE_CACHE_H
+#define RVG_STROKE_INSTANCE_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "rvg-ptr.h"
+#include "rvg-chronos.h"
+#include "rvg-shape.h"
+#include "rvg-path-data.h"
+#include "rvg-stroke-style.h"
+#include "rvg-stroke-method.h"
+#include "rvg-xform.h"
+
+namespace rvg {
+
+// Strokes each distinct combination of stroked shape, width, style, and
+// transformation once, and reuses the outline for every other instance.
+//
+// Documents often repeat the same symbol (a map icon, a glyph) many
+// times, under transformations that differ only by a translation. Path
+// contents and stroke styles are hash-consed, so equal paths and styles
+// share a single const_ptr regardless of where they came from. Instances
+// are keyed by the stroke method, the interned path (or primitive
+// parameters), width, and style, and by the linear parts of the shape
+// transformation and of the screen transformation. The translation of
+// the shape transformation is factored out before stroking and applied
+// to the cached outline.
+//
+// Stroking commutes with translation, so instances that share a key
+// yield the same outline up to rounding. Shapes under projective
+// transformations, nested strokes, and blends are stroked directly.
+class stroke_instance_cache final:
+    public boost::intrusive_ref_counter<stroke_instance_cache> {
+
+    struct key {
+        std::array<rvgf, 15> values;
+        const void *shape, *style;
+        uint32_t method, type;
+        bool operator==(const key &o) const {
+            return shape == o.shape && style == o.style &&
+                method == o.method && type == o.type &&
+                values == o.values;
+        }
+    };
+
+    struct key_hash {
+        size_t operator()(const key &k) const;
+    };
+
+    // Canonical objects with a given content hash
+    template <typename PTR>
+    struct interned {
+        std::unordered_map<uint64_t, std::vector<PTR>> by_hash;
+        // Keeps the inputs alive so their addresses cannot be reused
+        std::unordered_map<const void *, std::pair<PTR, PTR>> by_address;
+    };
+
+    interned<path_data::const_ptr> m_paths;
+    interned<stroke_style::const_ptr> m_styles;
+    std::unordered_map<key, shape, key_hash> m_outlines;
+    uint64_t m_instances, m_strokes, m_misses;
+    uint64_t m_path_lookups;
+    double m_stroke_time, m_miss_time;
+    chronos m_time;
+
+public:
+
+    using ptr = boost::intrusive_ptr<stroke_instance_cache>;
+    using const_ptr = boost::intrusive_ptr<const stroke_instance_cache>;
+
+    stroke_instance_cache(void);
+
+    // Returns the canonical path with the same content
+    path_data::const_ptr intern(const path_data::const_ptr &path);
+
+    // Returns the canonical style with the same content
+    stroke_style::const_ptr intern(const stroke_style::const_ptr &style);
+
+    // Converts stroke shape s to a fill using the given function, which
+    // receives a stroke shape and the screen transformation, or reuses
+    // the outline from an earlier instance
+    template <typename STROKE_TO_FILL>
+    shape stroke(e_stroke_method method, const shape &s,
+        const xform &screen_xf, STROKE_TO_FILL &&stroke_to_fill) {
+        ++m_instances;
+        key k;
+        shape canonical;
+        rvgf tx = 0, ty = 0;
+        if (!make_key(method, s, screen_xf, k, canonical, tx, ty)) {
+            ++m_strokes;
+            m_time.reset();
+            auto outline = stroke_to_fill(s, screen_xf);
+            m_stroke_time += m_time.elapsed();
+            return outline;
+        }
+        auto found = m_outlines.find(k);
+        if (found == m_outlines.end()) {
+            ++m_strokes;
+            ++m_misses;
+            m_time.reset();
+            auto outline = stroke_to_fill(canonical, screen_xf);
+            double elapsed = m_time.elapsed();
+            m_stroke_time += elapsed;
+            m_miss_time += elapsed;
+            found = m_outlines.emplace(k, std::move(outline)).first;
+        }
+        if (tx != 0 || ty != 0) {
+            return found->second.translated(tx, ty);
+        }
+        return found->second;
+    }
+
+    // Number of stroke shapes received
+    uint64_t get_instances(void) const {
+        return m_instances;
+    }
+
+    // Number of stroke shapes actually stroked
+    uint64_t get_strokes(void) const {
+        return m_strokes;
+    }
+
+    // Instances per stroke
+    double get_dedup_ratio(void) const {
+        return m_strokes > 0? static_cast<double>(m_instances)/
+            static_cast<double>(m_strokes): 1.;
+    }
+
+    // Number of paths interned, and how many of them were distinct
+    uint64_t get_path_lookups(void) const {
+        return m_path_lookups;
+    }
+
+    uint64_t get_unique_paths(void) const;
+
+    // Seconds spent stroking
+    double get_stroke_time(void) const {
+        return m_stroke_time;
+    }
+
+    // Estimated seconds saved, assuming each reused outline would have
+    // taken the average time of the cacheable strokes
+    double get_saved_time(void) const {
+        return m_misses > 0? static_cast<double>(m_instances-m_strokes)*
+            m_miss_time/static_cast<double>(m_misses): 0.;
+    }
+
+private:
+
+    bool make_key(e_stroke_method method, const shape &s,
+        const xform &screen_xf, key &k, shape &canonical,
+        rvgf &tx, rvgf &ty);
+};
+
+} // namespace rvg
+
+#endif
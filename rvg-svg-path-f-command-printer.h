@@ -19,6 +19,7 @@
 #include <iostream>
 
 #include "rvg-i-svg-path.h"
+#include "rvg-number-format.h"
 
 namespace rvg {
 
@@ -28,6 +29,7 @@ class svg_path_f_command_printer final:
     std::ostream &m_out;
     int m_prev;
     char m_sep;
+    int m_precision;
 
     template <typename ...DATA>
     void print_cmd(int cmd, DATA ...data) {
@@ -43,7 +45,15 @@ class svg_path_f_command_printer final:
 
     template <typename ...REST>
     void print_data(rvgf f, REST... rest) {
-        m_out << m_sep << f;
+        // Streams imbued with a number format get the numbers directly
+        if (m_precision >= 0) {
+            char buf[number_format_buffer_size+1];
+            buf[0] = m_sep;
+            char *end = format_number(f, m_precision, buf+1);
+            m_out.write(buf, end-buf);
+        } else {
+            m_out << m_sep << f;
+        }
         print_data(rest...);
     }
 
@@ -51,7 +61,8 @@ public:
     svg_path_f_command_printer(std::ostream &out, char sep):
         m_out(out),
         m_prev(' '),
-        m_sep(sep) { ; }
+        m_sep(sep),
+        m_precision(get_number_format_precision(out)) { ; }
 
 private:
     friend i_svg_path<svg_path_f_command_printer>;
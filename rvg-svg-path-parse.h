@@ -19,12 +19,15 @@
 #include <type_traits>
 #include <array>
 #include <utility>
+#include <cstring>
 
 #include "rvg-i-path.h"
 #include "rvg-i-svg-path.h"
 #include "rvg-input-path-f-close-contours.h"
 #include "rvg-svg-path-f-to-input-path.h"
 #include "rvg-svg-path-tokenizer.h"
+#include "rvg-svg-path-scan.h"
+#include "rvg-path-data.h"
 #include "rvg-meta.h"
 
 namespace rvg {
@@ -61,6 +64,28 @@ pass(IT &begin, const IT &end, CO &obj, RET (CM::*method)(Args...)) {
     return 1;
 }
 
+// Token kinds returned by svg_path_next, besides command letters
+enum: int {
+    svg_path_end = -1,
+    svg_path_number = -2,
+    svg_path_bad = -3
+};
+
+// Reads the next token, with the same rules as svg_path_tokenizer
+inline int svg_path_next(const char *&curr, rvgf &value) {
+    curr = svg_path_skip_separators(curr);
+    if (!*curr) {
+        return svg_path_end;
+    }
+    if (svg_path_is_alpha(*curr)) {
+        return *curr++;
+    }
+    if (svg_path_scan_number(curr, value) == svg_path_token::e_type::number) {
+        return svg_path_number;
+    }
+    return svg_path_bad;
+}
+
 } // namespace detail
 
 // ??D Make sure this reports an error if the end of string
@@ -199,10 +224,196 @@ svg_path_iterate(IT token, IT end, SINK &&p) {
                 std::forward<SINK>(p))));
 }
 
+// Same as svg_path_iterate(svg_path_tokenizer(svg),
+//     svg_path_tokenizer(nullptr), sink),
+// but in a single pass over the string, without tokens in between
+template <typename SVGSINK>
+typename std::enable_if<
+    rvg::meta::is_an_i_svg_path<SVGSINK>::value,
+int>::type
+svg_path_parse(const char *svg, SVGSINK &sink) {
+    using detail::svg_path_next;
+    using detail::svg_path_end;
+    using detail::svg_path_number;
+    // As with svg_path_tokenizer, a null string is an empty path
+    if (!svg) {
+        return 1;
+    }
+    rvgf value = 0;
+    int token = svg_path_next(svg, value);
+    if (token == svg_path_end) {
+        return 1;
+    }
+    // must start with M or m
+    if (token != 'm' && token != 'M') {
+        return 0;
+    }
+    int command = token;
+    token = svg_path_next(svg, value);
+    rvgf a[7];
+    // loads the arguments to the current command. as in pass(),
+    // arguments missing at the end of the string are zero
+    auto load = [&](int n) {
+        for (int i = 0; i < n; i++) {
+            a[i] = rvgf{0};
+        }
+        for (int i = 0; i < n && token != svg_path_end; i++) {
+            if (token != svg_path_number) {
+                return false;
+            }
+            a[i] = value;
+            token = svg_path_next(svg, value);
+        }
+        return true;
+    };
+    while (1) {
+        switch (command) {
+            case 'T':
+                if (!load(2)) return 0;
+                sink.squad_to_abs(a[0], a[1]);
+                break;
+            case 't':
+                if (!load(2)) return 0;
+                sink.squad_to_rel(a[0], a[1]);
+                break;
+            case 'R':
+                if (!load(5)) return 0;
+                sink.rquad_to_abs(a[0], a[1], a[2], a[3], a[4]);
+                break;
+            case 'r':
+                if (!load(5)) return 0;
+                sink.rquad_to_rel(a[0], a[1], a[2], a[3], a[4]);
+                break;
+            case 'A':
+                if (!load(7)) return 0;
+                sink.svg_arc_to_abs(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+                break;
+            case 'a':
+                if (!load(7)) return 0;
+                sink.svg_arc_to_rel(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+                break;
+            case 'C':
+                if (!load(6)) return 0;
+                sink.cubic_to_abs(a[0], a[1], a[2], a[3], a[4], a[5]);
+                break;
+            case 'c':
+                if (!load(6)) return 0;
+                sink.cubic_to_rel(a[0], a[1], a[2], a[3], a[4], a[5]);
+                break;
+            case 'H':
+                if (!load(1)) return 0;
+                sink.hline_to_abs(a[0]);
+                break;
+            case 'h':
+                if (!load(1)) return 0;
+                sink.hline_to_rel(a[0]);
+                break;
+            case 'L':
+                if (!load(2)) return 0;
+                sink.line_to_abs(a[0], a[1]);
+                break;
+            case 'l':
+                if (!load(2)) return 0;
+                sink.line_to_rel(a[0], a[1]);
+                break;
+            case 'M':
+                if (!load(2)) return 0;
+                sink.move_to_abs(a[0], a[1]);
+                command = 'L';
+                break;
+            case 'm':
+                if (!load(2)) return 0;
+                sink.move_to_rel(a[0], a[1]);
+                command = 'l';
+                break;
+            case 'Q':
+                if (!load(4)) return 0;
+                sink.quad_to_abs(a[0], a[1], a[2], a[3]);
+                break;
+            case 'q':
+                if (!load(4)) return 0;
+                sink.quad_to_rel(a[0], a[1], a[2], a[3]);
+                break;
+            case 'S':
+                if (!load(4)) return 0;
+                sink.scubic_to_abs(a[0], a[1], a[2], a[3]);
+                break;
+            case 's':
+                if (!load(4)) return 0;
+                sink.scubic_to_rel(a[0], a[1], a[2], a[3]);
+                break;
+            case 'V':
+                if (!load(1)) return 0;
+                sink.vline_to_abs(a[0]);
+                break;
+            case 'v':
+                if (!load(1)) return 0;
+                sink.vline_to_rel(a[0]);
+                break;
+            case 'Z': case 'z':
+                sink.close_path();
+                break;
+            default:
+                return 0;
+        }
+        // if string ended
+        if (token == svg_path_end) {
+            sink.end();
+            return 1;
+        // otherwise, if next token is a command
+        } else if (token >= 0) {
+            command = token;
+            token = svg_path_next(svg, value);
+        // if we just closed a path, next token must be a new command or end
+        // otherwise, if we se a number, we are repeating the previous command
+        // otherwise, quit in error
+        } else if (command == 'Z' || command == 'z' ||
+            token != svg_path_number) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+template <typename SVGSINK>
+typename std::enable_if<
+    rvg::meta::is_an_i_svg_path<SVGSINK>::value,
+int>::type
+svg_path_parse(const char *svg, SVGSINK &&sink) {
+    return svg_path_parse(svg, sink);
+}
+
+template <typename SVGSINK>
+typename std::enable_if<
+    rvg::meta::is_an_i_svg_path<SVGSINK>::value,
+int>::type
+svg_path_iterate(const char *svg, SVGSINK &&sink) {
+    return svg_path_parse(svg, sink);
+}
+
 template <typename SINK>
-int svg_path_iterate(const char *svg, SINK &&p) {
-    return svg_path_iterate(svg_path_tokenizer(svg),
-        svg_path_tokenizer(nullptr), std::forward<SINK>(p));
+typename std::enable_if<
+    rvg::meta::is_an_i_path<SINK>::value,
+int>::type
+svg_path_iterate(const char *svg, SINK &&p) {
+    auto sink = make_svg_path_f_to_input_path(
+        make_input_path_f_close_contours(std::forward<SINK>(p)));
+    return svg_path_parse(svg, sink);
+}
+
+// Returns a new path_data with the contents of the SVG path data,
+// or a null pointer if it is invalid. Space is reserved up front,
+// based on the length of the string.
+inline path_data::ptr make_path_data_from_svg_path(const char *svg) {
+    auto p = make_intrusive<path_data>();
+    // typically about 7 characters per coordinate, and each
+    // segment has at least two coordinates
+    size_t length = svg? strlen(svg): 0;
+    p->reserve(length/16+4, length/6+4);
+    if (!svg_path_iterate(svg, *p)) {
+        return nullptr;
+    }
+    return p;
 }
 
 template <typename SINK>
@@ -0,0 +1,213 @@
+// Stroke-to-fill conversion program and test harness
+// Copyright (C) 2020 Diego Nehab
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// Contact information: diego.nehab@gmail.com
+//
+#ifndef RVG_SVG_PATH_SCAN_H
+#define RVG_SVG_PATH_SCAN_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#include "rvg-svg-path-token.h"
+
+// Lexical analysis of SVG path data, shared by svg_path_tokenizer and
+// svg_path_parse. Numbers are scanned by hand, in the "C" locale, and
+// converted exactly whenever the significand fits in a double and the
+// decimal exponent is small. Everything else (too many digits, large
+// exponents, hexadecimal, infinities, NaNs, results that would
+// overflow or underflow) falls back to strtof/strtod.
+
+namespace rvg {
+
+template <typename T> T strtodf(const char* str, char** str_end);
+
+template <>
+inline float strtodf<float>(const char* str, char** str_end) {
+    return strtof(str, str_end);
+}
+
+template <>
+inline double strtodf<double>(const char* str, char** str_end) {
+    return strtod(str, str_end);
+}
+
+namespace detail {
+
+// isspace, isalpha, and isdigit in the "C" locale
+inline bool svg_path_is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool svg_path_is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool svg_path_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Computes m * 10^e, for m <= 2^53 and |e| <= 22. Both m and 10^e are
+// exact in double precision, so the result is correctly rounded.
+inline double svg_path_scale(uint64_t m, int e) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    double d = static_cast<double>(m);
+    return e >= 0? d*pow10[e]: d/pow10[-e];
+}
+
+// Converts m * 10^e, returning false if it cannot be done exactly
+template <typename T>
+bool svg_path_convert(uint64_t m, int e, T &value);
+
+template <>
+inline bool svg_path_convert<double>(uint64_t m, int e, double &value) {
+    value = svg_path_scale(m, e);
+    return true;
+}
+
+template <>
+inline bool svg_path_convert<float>(uint64_t m, int e, float &value) {
+    double q = svg_path_scale(m, e);
+    // Rounding the correctly rounded double to float only goes wrong
+    // when it lands exactly halfway between two floats, i.e., when the
+    // 29 bits of its significand that do not fit in a float are 100...0
+    uint64_t bits;
+    memcpy(&bits, &q, sizeof(bits));
+    if ((bits & 0x1fffffff) == 0x10000000) {
+        return false;
+    }
+    value = static_cast<float>(q);
+    // Leave overflow and underflow to strtof
+    return value <= std::numeric_limits<float>::max() &&
+        value >= std::numeric_limits<float>::min();
+}
+
+} // namespace detail
+
+// Skips spaces and at most one comma. Returns a pointer to the
+// first character of the next token.
+inline const char *svg_path_skip_separators(const char *curr) {
+    while (detail::svg_path_is_space(*curr)) {
+        ++curr;
+    }
+    if (*curr == ',') {
+        ++curr;
+        while (detail::svg_path_is_space(*curr)) {
+            ++curr;
+        }
+    }
+    return curr;
+}
+
+// Scans a number starting at curr, with the same syntax and semantics
+// as strtof/strtod. On success, returns number and advances curr past
+// the number. Returns underflow or overflow if the number does not fit
+// in a rvgf, and error, without advancing curr, if there is no number.
+inline svg_path_token::e_type svg_path_scan_number(const char *&curr,
+    rvgf &value) {
+    using detail::svg_path_is_digit;
+    const char *s = curr;
+    bool negative = false;
+    if (*s == '+' || *s == '-') {
+        negative = (*s == '-');
+        ++s;
+    }
+    uint64_t m = 0; // significand
+    int n = 0;      // significant digits in m
+    int e = 0;      // decimal exponent
+    bool digits = false, exact = true;
+    for ( ; svg_path_is_digit(*s); ++s) {
+        digits = true;
+        if (n < 19) {
+            m = 10*m + static_cast<uint64_t>(*s - '0');
+            n += (m != 0);
+        } else {
+            exact = false;
+        }
+    }
+    if (*s == '.') {
+        ++s;
+        for ( ; svg_path_is_digit(*s); ++s) {
+            digits = true;
+            if (n < 19) {
+                m = 10*m + static_cast<uint64_t>(*s - '0');
+                n += (m != 0);
+                --e;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    // Exponent is only part of the number if it has digits
+    if (digits && (*s == 'e' || *s == 'E')) {
+        const char *t = s+1;
+        bool negative_exponent = false;
+        if (*t == '+' || *t == '-') {
+            negative_exponent = (*t == '-');
+            ++t;
+        }
+        if (svg_path_is_digit(*t)) {
+            int x = 0;
+            for ( ; svg_path_is_digit(*t); ++t) {
+                if (x < 100000) {
+                    x = 10*x + (*t - '0');
+                }
+            }
+            e += negative_exponent? -x: x;
+            s = t;
+        }
+    }
+    // Hexadecimal numbers, infinities, and NaNs are left to strtof
+    if (digits && *s != 'x' && *s != 'X' && exact) {
+        if (m == 0) {
+            value = negative? -rvgf{0}: rvgf{0};
+            curr = s;
+            return svg_path_token::e_type::number;
+        }
+        rvgf v;
+        if (m <= (uint64_t{1} << 53) && e >= -22 && e <= 22 &&
+            detail::svg_path_convert<rvgf>(m, e, v)) {
+            value = negative? -v: v;
+            curr = s;
+            return svg_path_token::e_type::number;
+        }
+    }
+    // Slow path
+    char *end;
+    errno = 0;
+    value = strtodf<rvgf>(curr, &end);
+    if (end == curr) {
+        return svg_path_token::e_type::error;
+    }
+    curr = end;
+    if (errno == ERANGE) {
+        if (value == rvgf{0}) {
+            value = rvgf{0};
+            return svg_path_token::e_type::underflow;
+        } else {
+            return svg_path_token::e_type::overflow;
+        }
+    }
+    return svg_path_token::e_type::number;
+}
+
+} // namespace rvg
+
+#endif
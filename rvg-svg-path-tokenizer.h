@@ -17,24 +17,12 @@
 #define RVG_SVG_PATH_TOKENIZER_H
 
 #include <boost/iterator/iterator_facade.hpp>
-#include <cctype>
 
 #include "rvg-svg-path-token.h"
+#include "rvg-svg-path-scan.h"
 
 namespace rvg {
 
-template <typename T> T strtodf(const char* str, char** str_end);
-
-template <>
-inline float strtodf<float>(const char* str, char** str_end) {
-    return strtof(str, str_end);
-}
-
-template <>
-inline double strtodf<double>(const char* str, char** str_end) {
-    return strtod(str, str_end);
-}
-
 // Given a string, iterates over all tokens in it
 class svg_path_tokenizer final: public boost::iterator_facade<
     svg_path_tokenizer, svg_path_token const,
@@ -90,17 +78,8 @@ private:
         if (!m_curr)
             return set(svg_path_token::e_type::error, rvgi{0});
 
-        // skip optional spaces
-        while (isspace(*m_curr))
-            ++m_curr;
-
-        // skip one optional comma
-        if (*m_curr== ',') {
-            ++m_curr;
-            // skip optional spaces following optional comma
-            while (isspace(*m_curr))
-                ++m_curr;
-        }
+        // skip optional spaces and one optional comma
+        m_curr = svg_path_skip_separators(m_curr);
 
         // reached end of string
         if (!(*m_curr)) {
@@ -109,28 +88,20 @@ private:
         }
 
         // try command
-        if (isalpha(*m_curr))
+        if (detail::svg_path_is_alpha(*m_curr))
             return set(svg_path_token::e_type::command, rvgi{*m_curr++});
 
         // try number
-        char *end;
-        rvgf value = strtodf<rvgf>(m_curr, &end);
+        rvgf value = 0;
+        auto type = svg_path_scan_number(m_curr, value);
         // error parsing number
-        if (end == m_curr) {
+        if (type == svg_path_token::e_type::error) {
             // advance 1 and error
             ++m_curr;
             return set(svg_path_token::e_type::error, rvgi{0});
         }
-        m_curr = end;
-        // overflow or underflow
-        if (errno == ERANGE) {
-            if (value == 0.f)
-                return set(svg_path_token::e_type::underflow, rvgf{0});
-            else
-                return set(svg_path_token::e_type::overflow, value);
-        }
-        // number is ok
-        return set(svg_path_token::e_type::number, value);
+        // number, overflow, or underflow
+        return set(type, value);
     }
 };
 
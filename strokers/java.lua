@@ -17,98 +17,159 @@ local _M = { }
 
 local filter = require"filter"
 
-local function tod(v)
-    return string.format("%.8f", v)
-end
+local spack = string.pack
+local sunpack = string.unpack
+
+-- Number of untimed strokes the worker performs before the timed one
+_M.warmup = 0
+
+-- Values of the BasicStroke constants. Anything else falls back to
+-- butt caps and miter joins
+local caps = {
+    ["stroke_cap.butt"] = 0,
+    ["stroke_cap.round"] = 1,
+    ["stroke_cap.square"] = 2,
+}
+
+local joins = {
+    ["stroke_join.miter"] = 0,
+    ["stroke_join.round"] = 1,
+    ["stroke_join.bevel"] = 2,
+}
 
-local function make_input_path_f_to_json_path(out)
+-- Appends the path commands in the format of the worker protocol
+-- (see App.java) to table t
+local function make_input_path_f_to_commands(t)
     local filter = {}
-    local first = true
-    local function comma()
-        if not first then
-            out:write(',')
-        else
-            first = false
-        end
-    end
     function filter:begin_contour(x0, y0)
-        comma()
-        out:write('["M",', tod(x0), ',', tod(y0), ']')
+        t[#t+1] = spack(">c1dd", "M", x0, y0)
     end
     function filter:end_closed_contour(x0, y0)
-        comma()
-        out:write('["Z"]')
+        t[#t+1] = "Z"
     end
     function filter:end_open_contour(x0, y0)
     end
     function filter:degenerate_segment(x0, y0, dx, dy, x1, y1)
-        comma()
-        out:write('["L",', tod(x1), ',', tod(y1), ']')
+        t[#t+1] = spack(">c1dd", "L", x1, y1)
     end
     function filter:linear_segment(x0, y0, x1, y1)
-        comma()
-        out:write('["L",', tod(x1), ',', tod(y1), ']')
+        t[#t+1] = spack(">c1dd", "L", x1, y1)
     end
     function filter:quadratic_segment(x0, y0, x1, y1, x2, y2)
-        comma()
-        out:write('["Q",', tod(x1), ',', tod(y1), ',', tod(x2), ',', tod(y2), ']')
+        t[#t+1] = spack(">c1dddd", "Q", x1, y1, x2, y2)
     end
     function filter:rational_quadratic_segment(x0, y0, x1, y1, w1, x2, y2)
     end
     function filter:cubic_segment(x0, y0, x1, y1, x2, y2, x3, y3)
-        comma()
-        out:write('["C",', tod(x1), ',', tod(y1), ',', tod(x2), ',', tod(y2), ',', tod(x3), ',', tod(y3), ']')
+        t[#t+1] = spack(">c1dddddd", "C", x1, y1, x2, y2, x3, y3)
     end
     return filter
 end
 
+-- Coordinates and SVG format of each command in a worker response
+local response_commands = {
+    M = { 2, "M %.9g %.9g" },
+    L = { 2, "L %.9g %.9g" },
+    Q = { 4, "Q %.9g %.9g %.9g %.9g" },
+    C = { 6, "C %.9g %.9g %.9g %.9g %.9g %.9g" },
+    Z = { 0, "Z" },
+}
+
+-- Starting a JVM, and warming up its JIT, costs much more than the
+-- strokes themselves. So each script runs a single worker, started on
+-- first use and kept alive until we exit. We write requests to its
+-- standard input and read responses from a named pipe connected to
+-- its standard output
+local workers = {}
+
+local function get_worker(script)
+    local worker = workers[script]
+    if worker then return worker end
+    local fifo = os.tmpname()
+    os.remove(fifo)
+    assert(os.execute("mkfifo " .. fifo), "unable to create pipe")
+    -- the shell opens the pipe before it runs the script, so the open
+    -- below returns even if the script fails to start
+    local requests = io.popen(string.format("exec > %s; exec %s -worker",
+        fifo, script), "w")
+    if not requests then
+        os.remove(fifo)
+        error("unable to start " .. script)
+    end
+    -- blocks until the shell opens the other end
+    local responses = assert(io.open(fifo, "rb"))
+    os.remove(fifo)
+    -- the worker greets us with an empty message once it is running.
+    -- if it exits instead, we read end of file
+    local hello = responses:read(4)
+    if not hello or #hello < 4 or sunpack(">I4", hello) ~= 0 then
+        responses:close()
+        requests:close()
+        error("unable to start java stroker worker " .. script)
+    end
+    requests:setvbuf("full")
+    worker = { requests = requests, responses = responses }
+    workers[script] = worker
+    return worker
+end
+
+local function request(worker, message)
+    worker.requests:write(spack(">s4", message))
+    worker.requests:flush()
+    local header = worker.responses:read(4)
+    if not header or #header < 4 then
+        error("java stroker worker exited")
+    end
+    local response = worker.responses:read((sunpack(">I4", header)))
+    return response or ""
+end
+
+-- Returns the stroked shape and the time spent stroking in the worker
 local function stroke(script, input_shape, screen_xf, width, style)
     local input_path_data = input_shape:as_path_data(input_shape:get_xf():
         transformed(screen_xf))
-    local inname = os.tmpname()
---io.stderr:write(inname, "\n")
-    local infile = assert(io.open(inname, "w"))
-    infile:write('{"width":', tod(width), ',')
-    infile:write('"cap":"', tostring(style:get_initial_cap()), '",')
-    infile:write('"join":"', tostring(style:get_join()), '",')
-    infile:write('"miterlimit":', tod(style:get_miter_limit()), ',')
-    infile:write('"dashoffset":', tod(style:get_dash_offset()), ',')
-    infile:write('"resetsonmove":', tostring(style:get_resets_on_move()), ',')
-    infile:write('"dasharray":[')
     local dashes = style:get_dashes()
+    local t = {
+        spack(">i4dbbddi4", _M.warmup, width,
+            caps[tostring(style:get_initial_cap())] or 0,
+            joins[tostring(style:get_join())] or 0,
+            style:get_miter_limit(), style:get_dash_offset(), #dashes)
+    }
     for i, d in ipairs(dashes) do
-        infile:write(tod(d))
-        if dashes[i+1] then
-            infile:write(",")
-        end
+        t[#t+1] = spack(">d", d)
     end
-    infile:write("],")
-    infile:write('"path":[')
     input_path_data:iterate(
         filter.make_input_path_f_xform(input_shape:get_xf(),
             filter.make_input_path_f_rational_quadratic_to_cubics(
-                make_input_path_f_to_json_path(infile))))
-    infile:write("]}\n")
-    local java = assert(io.popen(string.format(script, inname), "r"))
-    local outpath = java:read("*a")
---io.stderr:write(outpath, "\n")
-    java:close()
-    os.remove(inname)
-    return path(outpath)
+                make_input_path_f_to_commands(t))))
+    local response = request(get_worker(script), table.concat(t))
+    local elapsed, pos = sunpack(">i8", response)
+    local svg = {}
+    while pos <= #response do
+        local c
+        c, pos = sunpack("c1", response, pos)
+        local command = assert(response_commands[c],
+            "invalid java stroker response")
+        local n = command[1]
+        local v = { sunpack(">" .. string.rep("f", n), response, pos) }
+        pos = v[n+1]
+        svg[#svg+1] = string.format(command[2], table.unpack(v, 1, n))
+    end
+    return path(table.concat(svg, " ")), elapsed*1e-9
 end
 
 function _M.openjdk8(input_shape, screen_xf, width, style)
-    return stroke("strokers/java/openjdk8.sh < %s",
+    return stroke("strokers/java/openjdk8.sh",
         input_shape, screen_xf, width, style)
 end
 
 function _M.openjdk11(input_shape, screen_xf, width, style)
-    return stroke("strokers/java/openjdk11.sh < %s",
+    return stroke("strokers/java/openjdk11.sh",
         input_shape, screen_xf, width, style)
 end
 
 function _M.oraclejdk8(input_shape, screen_xf, width, style)
-    return stroke("strokers/java/oraclejdk8.sh < %s",
+    return stroke("strokers/java/oraclejdk8.sh",
         input_shape, screen_xf, width, style)
 end
 
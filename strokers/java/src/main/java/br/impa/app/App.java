@@ -12,8 +12,16 @@ import java.util.Map;
 import org.json.simple.JSONArray;
 import org.json.simple.JSONObject;
 import org.json.simple.parser.*;
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
 import java.io.FileReader;
 import java.io.InputStreamReader;
+import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.Iterator;
 import java.util.Map;
 
@@ -40,8 +48,138 @@ class App {
         }
     }
 
+    static BasicStroke basicStroke(double width, int cap, int join,
+            double miterlimit, float dashes[], double dashoffset) {
+        if (dashes != null && dashes.length > 0) {
+            return new BasicStroke((float) width, cap, join,
+                (float) miterlimit, dashes, (float) dashoffset);
+        } else {
+            return new BasicStroke((float) width, cap, join,
+                (float) miterlimit);
+        }
+    }
+
+    // Worker mode keeps the JVM alive (and its JIT warm) across strokes.
+    // Requests and responses are length-prefixed, big-endian messages.
+    //
+    // On start, the worker writes an empty message (int 0), so clients
+    // can tell it launched.
+    //
+    // Request:  int length, then
+    //           int warmup (untimed strokes before the timed one),
+    //           double width, byte cap, byte join, double miterlimit,
+    //           double dashoffset, int ndashes, ndashes doubles,
+    //           then commands until the end of the message, each a byte
+    //           'M', 'L', 'Q', 'C' or 'Z' followed by 2, 2, 4, 6 or 0
+    //           doubles
+    // Response: int length, then long nanoseconds spent stroking, then
+    //           commands in the same format, with floats for coordinates
+    //
+    // Caps and joins use the values of the BasicStroke constants. Dashes
+    // and the dash offset are in units of width.
+    static void worker() throws IOException {
+        DataInputStream in = new DataInputStream(
+            new BufferedInputStream(System.in));
+        DataOutputStream out = new DataOutputStream(
+            new BufferedOutputStream(System.out));
+        ByteArrayOutputStream buf = new ByteArrayOutputStream();
+        DataOutputStream res = new DataOutputStream(buf);
+        float coords[] = new float[6];
+        out.writeInt(0);
+        out.flush();
+        while (true) {
+            int length;
+            try {
+                length = in.readInt();
+            } catch (EOFException e) {
+                break;
+            }
+            byte msg[] = new byte[length];
+            in.readFully(msg);
+            ByteBuffer req = ByteBuffer.wrap(msg);
+            int warmup = req.getInt();
+            double width = req.getDouble();
+            int cap = req.get();
+            int join = req.get();
+            double miterlimit = req.getDouble();
+            double dashoffset = width * req.getDouble();
+            int ndashes = req.getInt();
+            float dashes[] = new float[ndashes];
+            for (int i = 0; i < ndashes; i++) {
+                dashes[i] = (float) (width * req.getDouble());
+            }
+            GeneralPath p = new GeneralPath();
+            while (req.hasRemaining()) {
+                byte c = req.get();
+                if (c == 'M') {
+                    p.moveTo((float) req.getDouble(), (float) req.getDouble());
+                } else if (c == 'L') {
+                    p.lineTo((float) req.getDouble(), (float) req.getDouble());
+                } else if (c == 'Q') {
+                    p.quadTo((float) req.getDouble(), (float) req.getDouble(),
+                        (float) req.getDouble(), (float) req.getDouble());
+                } else if (c == 'C') {
+                    p.curveTo((float) req.getDouble(), (float) req.getDouble(),
+                        (float) req.getDouble(), (float) req.getDouble(),
+                        (float) req.getDouble(), (float) req.getDouble());
+                } else if (c == 'Z') {
+                    p.closePath();
+                }
+            }
+            BasicStroke st = basicStroke(width, cap, join, miterlimit,
+                dashes, dashoffset);
+            for (int i = 0; i < warmup; i++) {
+                st.createStrokedShape(p);
+            }
+            long start = System.nanoTime();
+            Shape s = st.createStrokedShape(p);
+            long elapsed = System.nanoTime() - start;
+            buf.reset();
+            res.writeLong(elapsed);
+            PathIterator it = s.getPathIterator(new AffineTransform());
+            while (!it.isDone()) {
+                int what = it.currentSegment(coords);
+                int n = 0;
+                switch (what) {
+                    case PathIterator.SEG_CLOSE:
+                        res.writeByte('Z');
+                        break;
+                    case PathIterator.SEG_MOVETO:
+                        res.writeByte('M');
+                        n = 2;
+                        break;
+                    case PathIterator.SEG_LINETO:
+                        res.writeByte('L');
+                        n = 2;
+                        break;
+                    case PathIterator.SEG_QUADTO:
+                        res.writeByte('Q');
+                        n = 4;
+                        break;
+                    case PathIterator.SEG_CUBICTO:
+                        res.writeByte('C');
+                        n = 6;
+                        break;
+                }
+                for (int i = 0; i < n; i++) {
+                    res.writeFloat(coords[i]);
+                }
+                it.next();
+            }
+            res.flush();
+            out.writeInt(buf.size());
+            buf.writeTo(out);
+            out.flush();
+        }
+    }
+
     public static void main(String args[]) throws Exception {
 
+        if (args.length > 0 && args[0].equals("-worker")) {
+            worker();
+            return;
+        }
+
         // typecasting obj to JSONObject
         JSONObject jo = (JSONObject) new JSONParser().parse(new InputStreamReader(System.in));
 
@@ -86,18 +224,13 @@ class App {
                 p.closePath();
             }
         }
-        BasicStroke st;
         JSONArray jdashes = (JSONArray) jo.get("dasharray");
-        if (jdashes.size() > 0) {
-            float dashes[] = new float[jdashes.size()];
-            for (int i = 0; i < jdashes.size(); i++) {
-                dashes[i] = (float) (width * (double) jdashes.get(i));
-            }
-            st = new BasicStroke((float) width, cap, join, (float) miterlimit,
-                dashes, (float) dashoffset);
-        } else {
-            st = new BasicStroke((float) width, cap, join, (float) miterlimit);
+        float dashes[] = new float[jdashes.size()];
+        for (int i = 0; i < jdashes.size(); i++) {
+            dashes[i] = (float) (width * (double) jdashes.get(i));
         }
+        BasicStroke st = basicStroke(width, cap, join, miterlimit, dashes,
+            dashoffset);
         Locale.setDefault(new Locale ("en", "US"));
         Shape s = st.createStrokedShape(p);
         float coords[] = new float[6];
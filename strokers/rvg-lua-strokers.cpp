@@ -13,6 +13,9 @@
 //
 // Contact information: diego.nehab@gmail.com
 //
+#include <cstring>
+#include <sstream>
+
 #include "rvg-bezier-arc-length.h"
 #include "rvg-gaussian-quadrature.h"
 #include "rvg-i-point-input-path-f-forwarder.h"
@@ -22,6 +25,9 @@
 
 #ifdef STROKER_RVG
 #include "rvg-stroker-rvg.h"
+#include "rvg-precision-escalation.h"
+#include "rvg-path-instrumentation.h"
+#include "rvg-stress-paths.h"
 #endif
 
 #ifdef STROKER_LIVAROT
@@ -155,6 +161,73 @@ static int luacairopolygonstroke(lua_State *L) {
 static int luarvgstroke(lua_State *L) {
     return luastroke(L, stroker::rvg);
 }
+
+// Returns the stroked shape and a report with one table per stage of
+// the pipeline, in order, and the summary and folded stacks as text
+static int luarvginstrumentedstroke(lua_State *L) {
+    auto s = rvg_lua_check<shape>(L, 1);
+    auto xf = rvg_lua_check<xform>(L, 2);
+    float width = static_cast<float>(luaL_checknumber(L, 3));
+    auto style = rvg_lua_opt<stroke_style::const_ptr>(L, 4,
+		default_stroke_style_ptr);
+    path_instrumentation instrumentation;
+    rvg_lua_push<shape>(L, stroker::rvg_instrumented(s, xf, width, style,
+        instrumentation));
+    lua_createtable(L, static_cast<int>(instrumentation.size()), 2);
+    for (size_t i = 0; i < instrumentation.size(); ++i) {
+        const auto &stage = instrumentation[i];
+        lua_createtable(L, 0, 7);
+        lua_pushstring(L, stage.name.c_str());
+        lua_setfield(L, -2, "name");
+        lua_pushinteger(L, static_cast<lua_Integer>(stage.calls));
+        lua_setfield(L, -2, "calls");
+        lua_pushnumber(L, stage.nanoseconds*1.e-9);
+        lua_setfield(L, -2, "total");
+        lua_pushnumber(L, instrumentation.get_self_nanoseconds(i)*1.e-9);
+        lua_setfield(L, -2, "self");
+        lua_pushinteger(L, static_cast<lua_Integer>(stage.cycles));
+        lua_setfield(L, -2, "cycles");
+        lua_pushinteger(L, static_cast<lua_Integer>(
+            instrumentation.get_self_cycles(i)));
+        lua_setfield(L, -2, "self_cycles");
+        lua_newtable(L);
+        for (size_t j = 0; j < stage.instructions.size(); ++j) {
+            if (stage.instructions[j] > 0) {
+                lua_pushinteger(L,
+                    static_cast<lua_Integer>(stage.instructions[j]));
+                lua_setfield(L, -2, path_instrumentation::
+                    get_instruction_name(static_cast<path_instruction>(j)));
+            }
+        }
+        lua_setfield(L, -2, "instructions");
+        lua_rawseti(L, -2, static_cast<lua_Integer>(i+1));
+    }
+    std::ostringstream summary, folded;
+    instrumentation.print_summary(summary);
+    instrumentation.print_folded(folded);
+    lua_pushstring(L, summary.str().c_str());
+    lua_setfield(L, -2, "summary");
+    lua_pushstring(L, folded.str().c_str());
+    lua_setfield(L, -2, "folded");
+    return 2;
+}
+
+static int luaescalationstats(lua_State *L) {
+    auto s = precision_escalation::get_stats();
+    lua_pushinteger(L, static_cast<lua_Integer>(s.analyzed));
+    lua_pushinteger(L, static_cast<lua_Integer>(s.escalated));
+    lua_pushinteger(L, static_cast<lua_Integer>(s.cubics_analyzed));
+    lua_pushinteger(L, static_cast<lua_Integer>(s.cubics_escalated));
+    lua_pushinteger(L, static_cast<lua_Integer>(s.pieces_analyzed));
+    lua_pushinteger(L, static_cast<lua_Integer>(s.pieces_escalated));
+    return 6;
+}
+
+static int luaresetescalationstats(lua_State *L) {
+    (void) L;
+    precision_escalation::reset_stats();
+    return 0;
+}
 #endif
 
 #ifdef STROKER_LIVAROT
@@ -246,12 +319,31 @@ static int luaarclength(lua_State *L) {
     return 1;
 }
 
+// Returns the stress path with the given name (see rvg-stress-paths.h),
+// with about n segments, generated from an optional seed
+static int luastresspath(lua_State *L) {
+    const char *name = luaL_checkstring(L, 1);
+    int n = static_cast<int>(luaL_checkinteger(L, 2));
+    if (n < 1) luaL_argerror(L, 2, "invalid number of segments");
+    auto seed = static_cast<uint32_t>(luaL_optinteger(L, 3, 0));
+    for (const auto &s: stress_paths) {
+        if (strcmp(s.name, name) == 0) {
+            rvg_lua_push<shape>(L, shape{s.generate(n, seed)});
+            return 1;
+        }
+    }
+    return luaL_argerror(L, 1, "unknown stress path");
+}
 
 // List of Lua functions exported into module table
 static const luaL_Reg modother[] = {
     {"arc_length", luaarclength },
+    {"stress_path", luastresspath },
 #ifdef STROKER_RVG
     {"rvg", luarvgstroke },
+    {"rvg_instrumented", luarvginstrumentedstroke },
+    {"escalation_stats", luaescalationstats },
+    {"reset_escalation_stats", luaresetescalationstats },
 #endif
 #ifdef STROKER_LIVAROT
     {"livarot_stroke", lualivarotstrokestroke },
@@ -15,19 +15,74 @@
 //
 #include "rvg-stroker-rvg.h"
 #include "rvg-input-path-f-xform.h"
-#include "rvg-input-path-f-stroke.h"
+#include "rvg-input-path-f-stroke-instrumented.h"
+#include "rvg-cubic-parameters-batch.h"
 
 namespace rvg {
     namespace stroker {
 
+// Strokes path, transformed by xf, into the pipeline made by stroke from
+// the find_cubic_parameters stage. Long paths have all their cubics
+// analysed at once, up front
+template <typename STROKE>
+static void stroke_path(const path_data &path, const xform &xf,
+    const STROKE &stroke) {
+#ifndef RVG_THICKEN_WITH_CUBICS
+    if (path.size() >= RVG_CUBIC_PARAMETERS_BATCH_THRESHOLD) {
+        cubic_parameters_batch batch{path, xf};
+        path.iterate(make_input_path_f_xform(xf, stroke(batch)));
+        return;
+    }
+#endif
+    path.iterate(make_input_path_f_xform(xf,
+        stroke(stroke_find_cubic_parameters{})));
+}
+
 shape rvg(const shape &input_shape, const xform &screen_xf, float width,
     stroke_style::const_ptr style) {
     auto output_path = make_intrusive<path_data>();
+    stroke_path(*input_shape.as_path_data_ptr(input_shape.get_xf().
+        transformed(screen_xf)), input_shape.get_xf(),
+        [&](const auto &find_cubic_parameters) {
+            return make_input_path_f_stroke_wrapped(width, style,
+                RVG_STROKE_APPROXIMATION_TOLERANCE,
+                RVG_STROKE_APPROXIMATION_TOLERANCE,
+                RVG_REGULARITY_ANGULAR_TOLERANCE,
+                RVG_REGULARITY_NUMERICAL_TOLERANCE*
+                    std::numeric_limits<rvgf>::epsilon(),
+                find_cubic_parameters, stroke_stage_identity{},
+                *output_path);
+        });
+    return shape{output_path};
+}
+
+shape rvg_with_tolerances(const shape &input_shape, const xform &screen_xf,
+    float width, stroke_style::const_ptr style, float stroke_tolerance,
+    float bezier_tolerance) {
+    auto output_path = make_intrusive<path_data>();
+    stroke_path(*input_shape.as_path_data_ptr(input_shape.get_xf().
+        transformed(screen_xf)), input_shape.get_xf(),
+        [&](const auto &find_cubic_parameters) {
+            return make_input_path_f_stroke_wrapped(width, style,
+                stroke_tolerance, bezier_tolerance,
+                RVG_REGULARITY_ANGULAR_TOLERANCE,
+                RVG_REGULARITY_NUMERICAL_TOLERANCE*
+                    std::numeric_limits<rvgf>::epsilon(),
+                find_cubic_parameters, stroke_stage_identity{},
+                *output_path);
+        });
+    return shape{output_path};
+}
+
+shape rvg_instrumented(const shape &input_shape, const xform &screen_xf,
+    float width, stroke_style::const_ptr style,
+    path_instrumentation &instrumentation) {
+    auto output_path = make_intrusive<path_data>();
     input_shape.as_path_data_ptr(input_shape.get_xf().
         transformed(screen_xf))->iterate(
             make_input_path_f_xform(input_shape.get_xf(),
-                make_input_path_f_stroke(
-                    width, style, *output_path)));
+                make_input_path_f_stroke_instrumented(
+                    width, style, instrumentation, *output_path)));
     return shape{output_path};
 }
 
@@ -19,6 +19,7 @@
 #include <vector>
 #include "rvg-stroke-style.h"
 #include "rvg-shape.h"
+#include "rvg-path-instrumentation.h"
 
 namespace rvg {
     namespace stroker {
@@ -26,6 +27,18 @@ namespace rvg {
 shape rvg(const shape &input_shape, const xform &screen_xf, float width,
     stroke_style::const_ptr style);
 
+// Same as rvg, with the stroke approximation tolerance and the Bezier
+// approximation tolerance of the thicken stage given explicitly
+shape rvg_with_tolerances(const shape &input_shape, const xform &screen_xf,
+    float width, stroke_style::const_ptr style, float stroke_tolerance,
+    float bezier_tolerance);
+
+// Same as rvg, but fills instrumentation with a breakdown of the
+// instructions received and time spent by each stage of the pipeline
+shape rvg_instrumented(const shape &input_shape, const xform &screen_xf,
+    float width, stroke_style::const_ptr style,
+    path_instrumentation &instrumentation);
+
 } }
 
 #endif
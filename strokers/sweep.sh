@@ -6,32 +6,33 @@ stroker_test=$1
 shift
 stroker=$1
 shift
-length=$(./test-strokers.lua -test:$stroker_test -arc-length $*)
 n=300
-
-p=$(command nproc) || p=$(command gnproc) || p=4
-
-task() {
-    local t=$1
-    shift
-    local output=$(lua -e "print(string.format('%04d.png', $t))")
-    local dashes=$(lua -e "print($t/$n * $length)"),$(lua -e "print(2*$length)")
-    ./test-strokers.lua -stroker:$stroker -test:$stroker_test -dashes:$dashes -driver:skia $* > fun/png/bare-$output;
-    ./test-strokers.lua -stroker:$stroker -test:$stroker_test -dashes:$dashes -driver:cairo -outline -generatrix $* > fun/png/outline-$output;
-    local distroke=distroke_${stroker_test}_${output}
-    if [ ! -f fun/png/$distroke ]; then
-        echo $distroke
-        echo ./test-strokers.lua -stroker:native -test:$stroker_test -dashes:$dashes -driver:distroke fun/png/$distroke;
-        ./test-strokers.lua -stroker:native -test:$stroker_test -dashes:$dashes -driver:distroke > fun/png/$distroke;
-    fi
-    compare -fuzz 20% fun/png/$distroke fun/png/bare-$output fun/png/compare-$output
+jobs=$(command nproc) || jobs=$(command gnproc) || jobs=4
+
+# renders all frames of a variant, split into one single-threaded
+# process per cpu
+sweep() {
+    local pids=()
+    for k in $(seq 1 $jobs); do
+        OMP_NUM_THREADS=1 ./test-strokers.lua -test:$stroker_test -animate-dashes:$n -animate-slice:$k:$jobs "$@" &
+        pids+=($!)
+    done
+    for pid in "${pids[@]}"; do
+        wait $pid
+    done
 }
 
+sweep -stroker:$stroker -driver:skia -output:fun/png/bare-%04d.png $*
+sweep -stroker:$stroker -driver:cairo -outline -generatrix -output:fun/png/outline-%04d.png $*
+# ground truth is cached across runs
+mkdir -p fun/cache
+sweep -stroker:native -driver:distroke -cache:fun/cache -output:fun/png/distroke_${stroker_test}_%04d.png
+
+# compare all frames in a single process
 for t in $(seq 1 $n); do
-    (((t-1)%p==0)) && echo batch $t && wait
-    task "$t" $* &
-done
-wait
+    output=$(printf '%04d.png' $t)
+    echo fun/png/distroke_${stroker_test}_${output} fun/png/bare-$output fun/png/compare-$output
+done | ./compare-images -fuzz:20 -batch:- > /dev/null || true
 
 ffmpeg -y -i fun/png/bare-%04d.png -c:v libx264 -pix_fmt yuv420p -preset:v slow -profile:v baseline -crf 20 -vf 'crop=trunc(iw/2)*2:trunc(ih/2)*2' fun/${stroker_test}_sweep_${stroker}_bare.m4v
 
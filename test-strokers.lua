@@ -36,6 +36,15 @@ local function reverse_path(p)
     return path(rpath_data):transformed(p:get_xf())
 end
 
+-- converts a string to an integer, or returns nil if it is not one.
+-- works in Lua 5.1 and LuaJIT, which have no math.tointeger
+local function tointeger(s)
+    local n = tonumber(s)
+    if n and n == math.floor(n) and n > -math.huge and n < math.huge then
+        return n
+    end
+end
+
 local function stderr(...)
     if not quiet then
         io.stderr:write(string.format(...), "\n")
@@ -73,6 +82,11 @@ Optional arguments:
   -output:<output name>           output file name
                                   (default: output to stdout)
 
+  -cache:<dir>                    reuse distroke renders from <dir>,
+                                  keyed by a hash of the scene, the
+                                  driver options and the driver version,
+                                  and add new renders to it
+
   -flip                           flip Y in output
 
   -parameter:<value>              pass parameter <value> to test
@@ -83,6 +97,16 @@ Optional arguments:
 
   -arc-length                     print arc-length of input path and exit
 
+  -bench-corpus                   print all tests in viewport coordinates,
+                                  as read by bench-strokers, and exit
+
+  -instrument                     print per-stage breakdown of the rvg
+                                  stroker pipeline and folded stacks
+                                  to stderr
+
+  -java-warmup:<count>            stroke <count> times, untimed, before
+                                  each timed stroke of the java strokers
+
   -control-points                 render all output outline control points
 
   -interpolated-points            render interpolated output outline
@@ -147,12 +171,25 @@ Optional arguments:
 
   -animate-fill                   generate animation of fill
 
+  -animate-dashes:<frames>        generate <frames> frames, in-process,
+                                  sweeping the first dash along the path
+                                  and writing each frame to a file named
+                                  by the -output:<format> pattern
+                                  (default: dashes-%04u.png)
+
+  -animate-slice:<k>:<n>          render only frames k, k+n, k+2n, ...
+                                  of -animate-dashes, so n processes
+                                  can render the sweep in parallel
+
 ]])
     os.exit()
 end
 
 local quiet = false
 local arc_length = false
+local bench_corpus = false
+local instrument = false
+local java_warmup = 0
 local generatrix = false
 local reverse = false
 local outline_width = 1
@@ -166,6 +203,8 @@ local outline = false
 local animate_outline = false
 local animate_outline_speed = 20
 local animate_fill = false
+local animate_dashes
+local animate_slice_first, animate_slice_step = 1, 1
 local precomputed_scale = 1
 local width_scale = 1
 local inner_points = false
@@ -184,6 +223,7 @@ local dash_offset
 local resets_on_move
 local dashes
 local testname, strokername, outputname
+local cache_dir
 local drivername = "svg"
 local precomputed
 local parameter = 0.5
@@ -224,6 +264,24 @@ local options = {
         arc_length = true
         return true
     end },
+    { "^%-bench%-corpus$", function(o)
+        if not o then return false end
+        bench_corpus = true
+        return true
+    end },
+    { "^%-instrument$", function(o)
+        if not o then return false end
+        instrument = true
+        return true
+    end },
+    { "^%-java%-warmup%:(.*)$", function(o)
+        if not o or #o < 1 then return false end
+        java_warmup = tointeger(o)
+        if not java_warmup or java_warmup < 0 then
+            error("invalid number of warmup strokes")
+        end
+        return true
+    end },
     { "^%-differences$", function(o)
         if not o then return false end
         differences = true
@@ -271,6 +329,24 @@ local options = {
         animate_fill = true
         return true
     end },
+    { "^%-animate%-dashes%:(.*)$", function(o)
+        if not o or #o < 1 then return false end
+        animate_dashes = tointeger(o)
+        if not animate_dashes or animate_dashes < 1 then
+            error("invalid number of frames")
+        end
+        return true
+    end },
+    { "^%-animate%-slice%:(.*)$", function(o)
+        if not o or #o < 1 then return false end
+        local k, n = o:match("^(%d+)%:(%d+)$")
+        k, n = tonumber(k), tonumber(n)
+        if not k or k < 1 or k > n then
+            error("invalid animation slice")
+        end
+        animate_slice_first, animate_slice_step = k, n
+        return true
+    end },
     { "^%-reverse$", function(o)
         if not o then return false end
         reverse = true
@@ -367,6 +443,11 @@ local options = {
         outputname = o
         return true
     end },
+    { "^%-cache%:(.*)$", function(o)
+        if not o or #o < 1 then return false end
+        cache_dir = o
+        return true
+    end },
 
     { "^%-join%:(.*)$", function(o)
         if not o or #o < 1 then return false end
@@ -486,6 +567,7 @@ local java = require"strokers.java"
 strokers.openjdk8 = java.openjdk8
 strokers.openjdk11 = java.openjdk11
 strokers.oraclejdk8 = java.oraclejdk8
+java.warmup = java_warmup
 
 local bevels = stroke_style():inner_joined(stroke_join.bevel):
     joined(stroke_join.bevel)
@@ -716,45 +798,25 @@ if testname == "list" then
 	os.exit()
 end
 
+-- entries in the strokers module that are not strokers
+local not_strokers = {
+    native = true,
+    arc_length = true,
+    stress_path = true,
+    rvg_instrumented = true,
+    escalation_stats = true,
+    reset_escalation_stats = true,
+}
+
 if strokername == "list" then
 	for i,v in pairs(strokers) do
-        if i ~= "native" and i ~= "arc_length" then
+        if not not_strokers[i] then
             print(i)
         end
 	end
 	os.exit()
 end
 
-local test = tests[testname]
-    or error(string.format("test '%s' not found", tostring(testname)))
-
-if type(test) == "function" then
-    test = test(parameter)
-end
-
-if arc_length then
-    print(strokers.arc_length(test[1])/(test[2]*width_scale))
-    os.exit()
-end
-
-local stroker = strokers[strokername]
-    or error(string.format("stroker '%s' not found", tostring(strokername)))
-
-if strokername == "openvg_ri" then
-    if not no_idempotent then
-        idempotent = true
-    end
-    split = true
-end
-
-local stroke_color = rgba(1, 0, 0, 0.5)
-
-local generatrix_color = rgb8(136, 49, 0)
-
-if idempotent then
-    stroke_color = rgba(1, 0.5, 0.5, 1)
-end
-
 local function newbbox()
 	return {
 		xmin = math.huge, ymin = math.huge,
@@ -859,6 +921,161 @@ local function adjust_style(style)
     return style
 end
 
+-- transforms a path to viewport coordinates, framing it together with
+-- its stroke (or the bbox of the test, if given), and returns it with
+-- the stroke width in viewport units and the viewport
+local function to_viewport(p, stroke_width, test_bbox)
+    -- acquire bounding box of path
+    local bbox = newbbox()
+    p:as_path_data():iterate(
+        filter.make_input_path_f_xform(p:get_xf(),
+        filterx.monotonize(bbox)))
+    -- expand to include stroke
+    local half_stroke_width = .5*stroke_width
+    bbox.xmin = bbox.xmin-half_stroke_width
+    bbox.ymin = bbox.ymin-half_stroke_width
+    bbox.xmax = bbox.xmax+half_stroke_width
+    bbox.ymax = bbox.ymax+half_stroke_width
+    -- add a border
+    local bbox_width = bbox.xmax-bbox.xmin
+    local bbox_border = viewport_border*bbox_width
+    bbox.xmin = bbox.xmin-bbox_border
+    bbox.ymin = bbox.ymin-bbox_border
+    bbox.xmax = bbox.xmax+bbox_border
+    bbox.ymax = bbox.ymax+bbox_border
+    -- allow bbox override
+    bbox = test_bbox or bbox
+    -- compute viewport to preserve aspect ratio
+    bbox_width = bbox.xmax-bbox.xmin
+    local bbox_height = bbox.ymax-bbox.ymin
+    local viewport_height = math.ceil(viewport_width*bbox_height/bbox_width)
+    local vp = viewport(0, 0, math.ceil(viewport_width), math.ceil(viewport_height))
+    -- transform path to viewport coordinates
+    return p:windowviewport(window(bbox.xmin, bbox.ymax, bbox.xmax, bbox.ymin), vp),
+        stroke_width*viewport_width/bbox_width, vp, viewport_height
+end
+
+-- sink that appends the svg path commands of the path it receives to
+-- table t, with rational quadratic segments as the R command
+local function svg_path_writer(t)
+    local function put(command, ...)
+        t[#t+1] = command
+        for i = 1, select("#", ...) do
+            t[#t+1] = string.format("%.9g", (select(i, ...)))
+        end
+    end
+    return {
+        begin_contour = function(self, x0, y0)
+            put("M", x0, y0)
+        end,
+        linear_segment = function(self, x0, y0, x1, y1)
+            put("L", x1, y1)
+        end,
+        quadratic_segment = function(self, x0, y0, x1, y1, x2, y2)
+            put("Q", x1, y1, x2, y2)
+        end,
+        rational_quadratic_segment = function(self, x0, y0, x1, y1, w1, x2, y2)
+            put("R", x1, y1, w1, x2, y2)
+        end,
+        cubic_segment = function(self, x0, y0, x1, y1, x2, y2, x3, y3)
+            put("C", x1, y1, x2, y2, x3, y3)
+        end,
+        end_open_contour = function(self, x0, y0)
+        end,
+        end_closed_contour = function(self, x0, y0)
+            put("Z")
+        end,
+    }
+end
+
+-- print every test in viewport coordinates, one per line, as
+--   name width join inner_join initial_cap terminal_cap dash_initial_cap
+--   dash_terminal_cap miter_limit dash_offset resets_on_move
+--   dash_count dashes... svg_path
+-- tests that depend on a parameter are taken at -parameter
+if bench_corpus then
+    -- enumerations print as stroke_join.round, stroke_cap.butt etc
+    local function name_of(value)
+        return (tostring(value):match("%.(.*)$"))
+    end
+    local names = {}
+    for name in pairs(tests) do
+        names[#names+1] = name
+    end
+    table.sort(names)
+    for _, name in ipairs(names) do
+        local test = tests[name]
+        if type(test) == "function" then
+            test = test(parameter)
+        end
+        local p = test[1]
+        if reverse then
+            p = reverse_path(p)
+        end
+        local width
+        p, width = to_viewport(p, test[2], test[4])
+        local style = adjust_style(test[3])
+        local dashes = style:get_dashes()
+        local line = {
+            name,
+            string.format("%.9g", width*width_scale),
+            name_of(style:get_join()),
+            name_of(style:get_inner_join()),
+            name_of(style:get_initial_cap()),
+            name_of(style:get_terminal_cap()),
+            name_of(style:get_dash_initial_cap()),
+            name_of(style:get_dash_terminal_cap()),
+            string.format("%.9g", style:get_miter_limit()),
+            string.format("%.9g", style:get_dash_offset()),
+            style:get_resets_on_move() and "1" or "0",
+            tostring(#dashes)
+        }
+        for i = 1, #dashes do
+            line[#line+1] = string.format("%.9g", dashes[i])
+        end
+        p:as_path_data():iterate(filter.make_input_path_f_xform(p:get_xf(),
+            svg_path_writer(line)))
+        io.write(table.concat(line, " "), "\n")
+    end
+    os.exit()
+end
+
+local test = tests[testname]
+    or error(string.format("test '%s' not found", tostring(testname)))
+
+if type(test) == "function" then
+    test = test(parameter)
+end
+
+if arc_length then
+    print(strokers.arc_length(test[1])/(test[2]*width_scale))
+    os.exit()
+end
+
+-- arc-length in units of stroke width, as dashes are
+local dash_sweep_length
+if animate_dashes then
+    dash_sweep_length = strokers.arc_length(test[1])/(test[2]*width_scale)
+end
+
+local stroker = strokers[strokername]
+    or error(string.format("stroker '%s' not found", tostring(strokername)))
+
+if strokername == "openvg_ri" then
+    if not no_idempotent then
+        idempotent = true
+    end
+    split = true
+end
+
+local stroke_color = rgba(1, 0, 0, 0.5)
+
+local generatrix_color = rgb8(136, 49, 0)
+
+if idempotent then
+    stroke_color = rgba(1, 0.5, 0.5, 1)
+end
+
 local test_path = test[1]
 local test_stroke_width = test[2]
 local test_stroke_style = adjust_style(test[3])
@@ -868,41 +1085,127 @@ if reverse then
     test_path = reverse_path(test_path)
 end
 
--- acquire bounding box of path
-local bbox = newbbox()
-test_path:as_path_data():iterate(
-    filter.make_input_path_f_xform(test_path:get_xf(),
-    filterx.monotonize(bbox)))
--- expand to include stroke
-local half_stroke_width = .5*test_stroke_width
-bbox.xmin = bbox.xmin-half_stroke_width
-bbox.ymin = bbox.ymin-half_stroke_width
-bbox.xmax = bbox.xmax+half_stroke_width
-bbox.ymax = bbox.ymax+half_stroke_width
--- add a border
-local bbox_width = bbox.xmax-bbox.xmin
-local bbox_border = viewport_border*bbox_width
-bbox.xmin = bbox.xmin-bbox_border
-bbox.ymin = bbox.ymin-bbox_border
-bbox.xmax = bbox.xmax+bbox_border
-bbox.ymax = bbox.ymax+bbox_border
--- allow bbox override
-bbox = test_bbox or bbox
--- compute viewport to preserve aspect ratio
-bbox_width = bbox.xmax-bbox.xmin
-bbox_height = bbox.ymax-bbox.ymin
-local viewport_height = math.ceil(viewport_width*bbox_height/bbox_width)
-local vp = viewport(0, 0, math.ceil(viewport_width), math.ceil(viewport_height))
 -- transform path to viewport coordinates
-test_path = test_path:windowviewport(window(bbox.xmin, bbox.ymax, bbox.xmax, bbox.ymin), vp)
-test_stroke_width = test_stroke_width*viewport_width/bbox_width
+local vp, viewport_height
+test_path, test_stroke_width, vp, viewport_height =
+    to_viewport(test_path, test_stroke_width, test_bbox)
 -- compute window
 local window_width = viewport_width
 local window_height = viewport_height
 local wnd = window(0, 0, window_width, window_height)
 
--- stroke path
-local stroked_shape
+-- hash of a string, in hexadecimal, made of two 32-bit polynomial
+-- hashes. there are no bitwise operators in Lua 5.1 and LuaJIT, so it
+-- uses arithmetic that is exact in doubles as well as in integers
+local function hash(str)
+    local byte = string.byte
+    local h1, h2 = 5381, 0
+    for i = 1, #str do
+        local b = byte(str, i)
+        h1 = (h1*33 + b) % 4294967291
+        h2 = (h2*65599 + b) % 4294967279
+    end
+    return string.format("%08x%08x", h1, h2)
+end
+
+-- distroke renders are by far the most expensive, so they can be
+-- cached. The key covers everything that can change the output: the
+-- scene, window and viewport (as serialized by the rvg writer), the
+-- options passed to the driver, and the version of the driver
+local rvg_lua_driver
+local function cache_key(sc)
+    rvg_lua_driver = rvg_lua_driver or require"driver.rvg_lua"
+    local tmp = assert(io.tmpfile())
+    rvg_lua_driver.render(sc, wnd, vp, tmp)
+    tmp:seek("set")
+    local serialized = tmp:read("*a")
+    tmp:close()
+    return hash(table.concat({ "distroke", tostring(driver.version),
+        table.concat(rejected, " "), serialized }, "\n"))
+end
+
+-- render scene elements to file, going through the cache if enabled
+local function render_scene(s, file)
+    local sc = scene(s)
+    if not cache_dir or not drivername:match("distroke$") then
+        render(accelerate(sc, wnd, vp, rejected), wnd, vp, file, rejected)
+        return
+    end
+    local name = cache_dir .. "/" .. cache_key(sc) .. ".png"
+    local cached = io.open(name, "rb")
+    if cached then
+        file:write(cached:read("*a"))
+        cached:close()
+        return
+    end
+    local tmp = assert(io.tmpfile())
+    render(accelerate(sc, wnd, vp, rejected), wnd, vp, tmp, rejected)
+    tmp:seek("set")
+    local png = tmp:read("*a")
+    tmp:close()
+    file:write(png)
+    -- write under a temporary name, so concurrent runs never see
+    -- a partial file. the name must be unique to this writer and in
+    -- the cache directory, so the rename is atomic. os.tmpname
+    -- reserves a unique name, so borrow its last component
+    local reserved = os.tmpname()
+    local partial = name .. "." .. reserved:match("[^/\\]*$") .. ".part"
+    local out = io.open(partial, "wb")
+    local added = out and out:write(png) and out:close() and
+        os.rename(partial, name)
+    os.remove(reserved)
+    if added then
+        return
+    end
+    os.remove(partial)
+    stderr("unable to add %s to cache", name)
+end
+
+-- sweep the first dash along the path, stroking and rendering every
+-- frame of the slice in this process. Lua runs a single thread, so
+-- frames are rendered in parallel by running one process per slice
+if animate_dashes then
+    local fmt = outputname or "dashes-%04u.png"
+    for i = animate_slice_first, animate_dashes, animate_slice_step do
+        local style = test_stroke_style:dashed{
+            i/animate_dashes*dash_sweep_length, 2*dash_sweep_length}
+        local frame_shape = stroker(test_path, identity(),
+            test_stroke_width*width_scale, style)
+        if flip then
+            frame_shape = frame_shape:translated(0,-viewport_height):
+                scaled(1, -1)
+        end
+        local s = {}
+        if not no_background then
+            s[#s+1] = fill(rect(0, 0, viewport_width, viewport_height),
+                color.white)
+        end
+        if not no_fill then
+            s[#s+1] = fill(frame_shape, stroke_color)
+        end
+        if outline then
+            s[#s+1] = fill(frame_shape:stroked(outline_width), color.black)
+        end
+        if generatrix then
+            s[#s+1] = fill(test_path:stroked(outline_width):
+                joined(stroke_join.round), generatrix_color)
+        end
+        local file = assert(io.open(string.format(fmt, i), "wb"))
+        render_scene(s, file)
+        file:close()
+        stderr("%u", i)
+    end
+    os.exit()
+end
+
+-- a runner that embeds this script (see run-stroker-tests.cpp) can
+-- collect the stroke and render times in this global table
+local timing = rawget(_G, "test_strokers_timing")
+local time = timing and require"chronos".chronos()
+
+-- stroke path. strokers that run out of process (the java strokers)
+-- also return the time spent stroking, without the communication
+local stroked_shape, stroke_time
 if precomputed then
     local rvg = assert(assert(loadfile(precomputed, "bt", driver))())
     local ps = {}
@@ -924,9 +1227,20 @@ if precomputed then
         stroked_shape = ps[#ps]
     end
 else
-    stroked_shape = stroker(test_path, identity(),
+    stroked_shape, stroke_time = stroker(test_path, identity(),
         test_stroke_width*width_scale, test_stroke_style)
 end
+if timing then
+    timing.stroke = stroke_time or time:elapsed()
+elseif stroke_time then
+    stderr("%s stroke time: %.9gs", strokername, stroke_time)
+end
+
+if instrument then
+    local _, report = strokers.rvg_instrumented(test_path, identity(),
+        test_stroke_width*width_scale, test_stroke_style)
+    stderr("%s%s", report.summary, report.folded)
+end
 
 local rvg_stroked_shape
 
@@ -1083,7 +1397,7 @@ end
 
 local function save(s, i, fmt)
     local file = io.open(string.format(fmt, i), "wb")
-    render(accelerate(scene(s), wnd, vp), wnd, vp, file)
+    render_scene(s, file)
     stderr("%u", i)
     file:close()
 end
@@ -1239,7 +1553,13 @@ if outputname then
 end
 
 -- render result to stdout
-render(accelerate(scene(s), wnd, vp, rejected), wnd, vp, out, rejected)
+if timing then
+    time:reset()
+end
+render_scene(s, out)
+if timing then
+    timing.render = time:elapsed()
+end
 
 if outputname then
     out:close()